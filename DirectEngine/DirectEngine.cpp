@@ -292,6 +292,17 @@ int CALLBACK wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
 
 		EngineCore engine(1920, 1080, createGame);
 		engineCore = &engine;
+
+		// -memoryreport <path> dumps arena telemetry as JSON on shutdown
+		const wchar_t* memoryReportArg = wcsstr(lpCmdLine, L"-memoryreport ");
+		if (memoryReportArg != nullptr)
+		{
+			std::wstring path{ memoryReportArg + wcslen(L"-memoryreport ") };
+			path = path.substr(0, path.find(L' '));
+			const int byteCount = WideCharToMultiByte(CP_UTF8, 0, path.c_str(), static_cast<int>(path.size()), nullptr, 0, nullptr, nullptr);
+			engine.m_memoryReportPath.resize(byteCount);
+			WideCharToMultiByte(CP_UTF8, 0, path.c_str(), static_cast<int>(path.size()), engine.m_memoryReportPath.data(), byteCount, nullptr, nullptr);
+		}
 		engine.OnInit(hInstance, nCmdShow, WndProc);
 
 		GameThreadData data{ &engine };
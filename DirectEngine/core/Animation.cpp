@@ -0,0 +1,603 @@
+#include "Animation.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// Index of the first key after animationTime, the frame count if there is none
+	size_t FindNextKey(AnimationData& animData, float animationTime)
+	{
+		const float* times = animData.times;
+		size_t next = animData.cursor;
+		// Keys before the cursor are known to be at or before animationTime, so the search can start there
+		if (next == 0 || (next <= animData.frameCount && times[next - 1] <= animationTime))
+		{
+			const size_t end = std::min(animData.frameCount, next + ANIMATION_CURSOR_MAX_STEPS);
+			while (next < end && times[next] <= animationTime)
+			{
+				next++;
+			}
+			if (next == animData.frameCount || times[next] > animationTime)
+			{
+				animData.cursor = next;
+				return next;
+			}
+		}
+
+		next = std::upper_bound(times, times + animData.frameCount, animationTime) - times;
+		animData.cursor = next;
+		return next;
+	}
+
+	float GetKeyTime(const AnimationData& animData, size_t key)
+	{
+		return animData.sampleRate > 0.f ? animData.startTime + static_cast<float>(key) / animData.sampleRate : animData.times[key];
+	}
+
+	XMVECTOR DecodeKey(const CompressedAnimationData& compressed, size_t key)
+	{
+		const XMVECTOR value = XMVectorMultiplyAdd(XMLoadUShortN4(&compressed.keys[key]), XMLoadFloat4(&compressed.rangeExtent), XMLoadFloat4(&compressed.rangeMin));
+		if (!compressed.rotation)
+		{
+			return value;
+		}
+
+		// The largest component was made positive, so it follows from the length of the quaternion being one
+		const XMVECTOR largest = XMVectorSqrt(XMVectorMax(XMVectorSubtract(XMVectorSplatOne(), XMVector3Dot(value, value)), XMVectorZero()));
+		const XMVECTOR quaternion = XMVectorSelect(largest, value, g_XMSelect1110.v);
+		switch (compressed.keys[key].w)
+		{
+		case 0:
+			return XMVectorSwizzle<XM_SWIZZLE_W, XM_SWIZZLE_X, XM_SWIZZLE_Y, XM_SWIZZLE_Z>(quaternion);
+		case 1:
+			return XMVectorSwizzle<XM_SWIZZLE_X, XM_SWIZZLE_W, XM_SWIZZLE_Y, XM_SWIZZLE_Z>(quaternion);
+		case 2:
+			return XMVectorSwizzle<XM_SWIZZLE_X, XM_SWIZZLE_Y, XM_SWIZZLE_W, XM_SWIZZLE_Z>(quaternion);
+		default:
+			return quaternion;
+		}
+	}
+
+	XMVECTOR GetKey(const AnimationData& animData, size_t key)
+	{
+		return animData.compressed != nullptr ? DecodeKey(*animData.compressed, key) : animData.data[key];
+	}
+
+	// Drops the largest component and stores its index in w instead
+	XMFLOAT4 GetSmallestThree(XMVECTOR quaternion)
+	{
+		XMFLOAT4 q;
+		XMStoreFloat4(&q, XMQuaternionNormalize(quaternion));
+		float components[4] = { q.x, q.y, q.z, q.w };
+		size_t largestIndex = 0;
+		for (size_t i = 1; i < 4; i++)
+		{
+			if (fabsf(components[i]) > fabsf(components[largestIndex]))
+			{
+				largestIndex = i;
+			}
+		}
+
+		const float sign = components[largestIndex] < 0.f ? -1.f : 1.f;
+		float smallest[3];
+		size_t smallestCount = 0;
+		for (size_t i = 0; i < 4; i++)
+		{
+			if (i != largestIndex)
+			{
+				smallest[smallestCount++] = components[i] * sign;
+			}
+		}
+		return { smallest[0], smallest[1], smallest[2], static_cast<float>(largestIndex) };
+	}
+
+	float GetKeyError(XMVECTOR a, XMVECTOR b, bool rotation)
+	{
+		if (rotation && XMVectorGetX(XMVector4Dot(a, b)) < 0.f)
+		{
+			b = XMVectorNegate(b);
+		}
+		XMFLOAT4 components;
+		XMStoreFloat4(&components, XMVectorAbs(XMVectorSubtract(a, b)));
+		return std::max({ components.x, components.y, components.z, components.w });
+	}
+
+	// Keys of one channel for the lanes of a group as rows, returns the lanes that have any. Lanes without keys interpolate what a and b had with itself
+	uint32_t GatherGroupKeys(TransformAnimation& animation, AnimationData AnimationJointData::* channel, size_t firstJoint, uint32_t lanes, float animationTime,
+		XMMATRIX& a, XMMATRIX& b, XMVECTOR& t)
+	{
+		XMFLOAT4 fractions{ 0.f, 0.f, 0.f, 0.f };
+		float* fraction = &fractions.x;
+		uint32_t keyedLanes = 0;
+		for (size_t lane = 0; lane < POSE_LANES; lane++)
+		{
+			AnimationData& animData = animation.jointChannels[firstJoint + lane].*channel;
+			if ((lanes >> lane) & 1 && animData.frameCount > 0)
+			{
+				fraction[lane] = FindAnimationKeys(animData, animationTime, a.r[lane], b.r[lane]);
+				keyedLanes |= 1u << lane;
+			}
+		}
+		t = XMLoadFloat4(&fractions);
+		return keyedLanes;
+	}
+
+	XMVECTOR GetLaneSelect(uint32_t lanes)
+	{
+		return XMVectorSelectControl(lanes & 1, (lanes >> 1) & 1, (lanes >> 2) & 1, (lanes >> 3) & 1);
+	}
+
+	// Hamilton product of four quaternions given as components, the rotation of b followed by a like XMQuaternionMultiply(b, a)
+	void MultiplyGroup(XMVECTOR* result, const XMVECTOR* a, const XMVECTOR* b)
+	{
+		const XMVECTOR x = XMVectorSubtract(XMVectorAdd(XMVectorAdd(XMVectorMultiply(a[3], b[0]), XMVectorMultiply(a[0], b[3])), XMVectorMultiply(a[1], b[2])), XMVectorMultiply(a[2], b[1]));
+		const XMVECTOR y = XMVectorAdd(XMVectorAdd(XMVectorSubtract(XMVectorMultiply(a[3], b[1]), XMVectorMultiply(a[0], b[2])), XMVectorMultiply(a[1], b[3])), XMVectorMultiply(a[2], b[0]));
+		const XMVECTOR z = XMVectorAdd(XMVectorSubtract(XMVectorAdd(XMVectorMultiply(a[3], b[2]), XMVectorMultiply(a[0], b[1])), XMVectorMultiply(a[1], b[0])), XMVectorMultiply(a[2], b[3]));
+		const XMVECTOR w = XMVectorSubtract(XMVectorSubtract(XMVectorSubtract(XMVectorMultiply(a[3], b[3]), XMVectorMultiply(a[0], b[0])), XMVectorMultiply(a[1], b[1])), XMVectorMultiply(a[2], b[2]));
+		result[0] = x;
+		result[1] = y;
+		result[2] = z;
+		result[3] = w;
+	}
+
+	// XMQuaternionSlerp for four quaternions given as components
+	void SlerpGroup(XMVECTOR* result, const XMVECTOR* a, const XMVECTOR* b, XMVECTOR t)
+	{
+		const XMVECTOR one = XMVectorSplatOne();
+		XMVECTOR cosOmega = XMVectorMultiply(a[0], b[0]);
+		for (size_t i = 1; i < 4; i++)
+		{
+			cosOmega = XMVectorMultiplyAdd(a[i], b[i], cosOmega);
+		}
+		// Going the short way around
+		const XMVECTOR sign = XMVectorSelect(one, XMVectorNegate(one), XMVectorLess(cosOmega, XMVectorZero()));
+		cosOmega = XMVectorMultiply(cosOmega, sign);
+
+		// Almost equal quaternions are interpolated linearly like XMQuaternionSlerp does
+		const XMVECTOR curved = XMVectorLess(cosOmega, XMVectorReplicate(1.f - 0.00001f));
+		const XMVECTOR sinOmega = XMVectorSqrt(XMVectorNegativeMultiplySubtract(cosOmega, cosOmega, one));
+		const XMVECTOR omega = XMVectorATan2(sinOmega, cosOmega);
+		const XMVECTOR invSinOmega = XMVectorReciprocal(sinOmega);
+		const XMVECTOR remaining = XMVectorSubtract(one, t);
+		const XMVECTOR scaleA = XMVectorSelect(remaining, XMVectorMultiply(XMVectorSin(XMVectorMultiply(remaining, omega)), invSinOmega), curved);
+		XMVECTOR scaleB = XMVectorSelect(t, XMVectorMultiply(XMVectorSin(XMVectorMultiply(t, omega)), invSinOmega), curved);
+		scaleB = XMVectorMultiply(scaleB, sign);
+		for (size_t i = 0; i < 4; i++)
+		{
+			result[i] = XMVectorMultiplyAdd(b[i], scaleB, XMVectorMultiply(a[i], scaleA));
+		}
+	}
+
+	// Keys and the points halfway between them, that's where two piecewise linear curves are furthest apart
+	size_t AddErrorTimes(const AnimationData& animData, float* times)
+	{
+		size_t count = 0;
+		for (size_t i = 0; i < animData.frameCount; i++)
+		{
+			times[count++] = GetKeyTime(animData, i);
+			if (i + 1 < animData.frameCount)
+			{
+				times[count++] = (GetKeyTime(animData, i) + GetKeyTime(animData, i + 1)) * 0.5f;
+			}
+		}
+		return count;
+	}
+}
+
+XMVECTOR SampleAnimation(AnimationData& animData, float animationTime, XMVECTOR(__vectorcall* interp)(XMVECTOR a, XMVECTOR b, float t))
+{
+	assert(animData.data != nullptr || animData.compressed != nullptr);
+	assert(animData.frameCount > 0);
+	if (animData.sampleRate > 0.f)
+	{
+		// Written so that NaN ends up at the last key like it does with the search
+		const float position = (animationTime - animData.startTime) * animData.sampleRate;
+		if (position <= 0.f)
+		{
+			return animData.data[0];
+		}
+		if (!(position < static_cast<float>(animData.frameCount - 1)))
+		{
+			return animData.data[animData.frameCount - 1];
+		}
+		const size_t i = static_cast<size_t>(position);
+		return interp(animData.data[i], animData.data[i + 1], position - static_cast<float>(i));
+	}
+
+	const size_t i = FindNextKey(animData, animationTime);
+	if (i == 0)
+	{
+		return GetKey(animData, 0);
+	}
+	if (i == animData.frameCount)
+	{
+		return GetKey(animData, animData.frameCount - 1);
+	}
+	float t = (animationTime - animData.times[i - 1]) / (animData.times[i] - animData.times[i - 1]);
+	return interp(GetKey(animData, i - 1), GetKey(animData, i), t);
+}
+
+float FindAnimationKeys(AnimationData& animData, float animationTime, XMVECTOR& a, XMVECTOR& b)
+{
+	assert(animData.data != nullptr || animData.compressed != nullptr);
+	assert(animData.frameCount > 0);
+	size_t next;
+	float t = 0.f;
+	if (animData.sampleRate > 0.f)
+	{
+		const float position = (animationTime - animData.startTime) * animData.sampleRate;
+		if (position <= 0.f)
+		{
+			next = 0;
+		}
+		else if (!(position < static_cast<float>(animData.frameCount - 1)))
+		{
+			next = animData.frameCount;
+		}
+		else
+		{
+			next = static_cast<size_t>(position) + 1;
+			t = position - static_cast<float>(next - 1);
+		}
+	}
+	else
+	{
+		next = FindNextKey(animData, animationTime);
+		if (next > 0 && next < animData.frameCount)
+		{
+			t = (animationTime - animData.times[next - 1]) / (animData.times[next] - animData.times[next - 1]);
+		}
+	}
+
+	if (next == 0 || next == animData.frameCount)
+	{
+		a = b = GetKey(animData, next == 0 ? 0 : animData.frameCount - 1);
+		return 0.f;
+	}
+	a = GetKey(animData, next - 1);
+	b = GetKey(animData, next);
+	return t;
+}
+
+bool ResampleAnimationData(const AnimationData& keys, bool rotation, float sampleRate, float tolerance, AnimationData& resampled, MemoryArena& arena)
+{
+	assert(keys.frameCount > 0);
+	assert(keys.sampleRate == 0.f);
+	assert(sampleRate > 0.f);
+	ArenaScope scratch{ GetScratchArena(&arena) };
+	AnimationData source = keys;
+	const auto interp = rotation ? &XMQuaternionSlerp : &XMVectorLerp;
+	const float startTime = keys.times[0];
+	const float span = keys.times[keys.frameCount - 1] - startTime;
+
+	for (float rate = sampleRate; rate <= ANIMATION_RESAMPLE_MAX_RATE; rate *= 2.f)
+	{
+		// The last key gets a frame of its own, so the rate goes up a little to make the span a whole number of frames
+		AnimationData candidate{};
+		candidate.frameCount = static_cast<size_t>(ceilf(span * rate)) + 1;
+		candidate.sampleRate = candidate.frameCount > 1 ? static_cast<float>(candidate.frameCount - 1) / span : rate;
+		candidate.startTime = startTime;
+		candidate.data = scratch.arena.Allocate<XMVECTOR>(candidate.frameCount);
+		for (size_t i = 0; i < candidate.frameCount; i++)
+		{
+			candidate.data[i] = SampleAnimation(source, GetKeyTime(candidate, i), interp);
+		}
+
+		if (GetAnimationDataError(candidate, keys, rotation) <= tolerance)
+		{
+			resampled = candidate;
+			resampled.data = NewArrayTagged(arena, AllocationTag::Animation, XMVECTOR, candidate.frameCount);
+			memcpy(resampled.data, candidate.data, sizeof(XMVECTOR) * candidate.frameCount);
+			return true;
+		}
+	}
+	return false;
+}
+
+float GetAnimationDataError(const AnimationData& a, const AnimationData& b, bool rotation)
+{
+	// Sorted so the cursor of channels with keys can follow along
+	ArenaScope scratch{ GetScratchArena() };
+	float* times = scratch.arena.Allocate<float>(2 * (a.frameCount + b.frameCount));
+	size_t timeCount = AddErrorTimes(a, times);
+	timeCount += AddErrorTimes(b, times + timeCount);
+	std::sort(times, times + timeCount);
+
+	const auto interp = rotation ? &XMQuaternionSlerp : &XMVectorLerp;
+	AnimationData sampledA = a;
+	AnimationData sampledB = b;
+	float error = 0.f;
+	for (size_t i = 0; i < timeCount; i++)
+	{
+		const float time = times[i];
+		error = std::max(error, GetKeyError(SampleAnimation(sampledA, time, interp), SampleAnimation(sampledB, time, interp), rotation));
+	}
+	return error;
+}
+
+bool CompressAnimationData(const AnimationData& source, bool rotation, float tolerance, AnimationData& compressed, MemoryArena& arena)
+{
+	assert(source.frameCount > 0);
+	assert(source.compressed == nullptr);
+	ArenaScope scratch{ GetScratchArena(&arena) };
+	const size_t frameCount = source.frameCount;
+	const auto interp = rotation ? &XMQuaternionSlerp : &XMVectorLerp;
+
+	// Every key gets quantized first, the range covers what is stored so rotations only need it for three components
+	XMFLOAT4* stored = scratch.arena.Allocate<XMFLOAT4>(frameCount);
+	XMVECTOR rangeMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR rangeMax = XMVectorReplicate(-FLT_MAX);
+	for (size_t i = 0; i < frameCount; i++)
+	{
+		if (rotation)
+		{
+			stored[i] = GetSmallestThree(GetKey(source, i));
+		}
+		else
+		{
+			XMStoreFloat4(&stored[i], GetKey(source, i));
+		}
+		rangeMin = XMVectorMin(rangeMin, XMLoadFloat4(&stored[i]));
+		rangeMax = XMVectorMax(rangeMax, XMLoadFloat4(&stored[i]));
+	}
+
+	CompressedAnimationData quantized{};
+	quantized.rotation = rotation;
+	if (rotation)
+	{
+		rangeMin = XMVectorSetW(rangeMin, 0.f);
+		rangeMax = XMVectorSetW(rangeMax, 0.f);
+	}
+	const XMVECTOR rangeExtent = XMVectorSubtract(rangeMax, rangeMin);
+	XMStoreFloat4(&quantized.rangeMin, rangeMin);
+	XMStoreFloat4(&quantized.rangeExtent, rangeExtent);
+	// Components that never change store zero instead of dividing by an empty range
+	const XMVECTOR scale = XMVectorSelect(XMVectorReciprocal(rangeExtent), XMVectorZero(), XMVectorEqual(rangeExtent, XMVectorZero()));
+	quantized.keys = scratch.arena.Allocate<XMUSHORTN4>(frameCount);
+
+	XMVECTOR* decoded = scratch.arena.Allocate<XMVECTOR>(frameCount);
+	for (size_t i = 0; i < frameCount; i++)
+	{
+		XMStoreUShortN4(&quantized.keys[i], XMVectorMultiply(XMVectorSubtract(XMLoadFloat4(&stored[i]), rangeMin), scale));
+		if (rotation)
+		{
+			quantized.keys[i].w = static_cast<uint16_t>(stored[i].w);
+		}
+		decoded[i] = DecodeKey(quantized, i);
+		if (GetKeyError(decoded[i], GetKey(source, i), rotation) > tolerance)
+		{
+			return false;
+		}
+	}
+
+	// Greedily extends the segment from the last kept key for as long as interpolating the quantized keys at its ends stays within tolerance at the keys it skips
+	size_t* kept = scratch.arena.Allocate<size_t>(frameCount);
+	size_t keptCount = 0;
+	kept[keptCount++] = 0;
+	for (size_t end = 2; end < frameCount; end++)
+	{
+		const size_t start = kept[keptCount - 1];
+		const float startTime = GetKeyTime(source, start);
+		const float span = GetKeyTime(source, end) - startTime;
+		for (size_t skipped = start + 1; skipped < end; skipped++)
+		{
+			const XMVECTOR value = interp(decoded[start], decoded[end], (GetKeyTime(source, skipped) - startTime) / span);
+			if (GetKeyError(value, GetKey(source, skipped), rotation) > tolerance)
+			{
+				kept[keptCount++] = end - 1;
+				break;
+			}
+		}
+	}
+	if (frameCount > 1)
+	{
+		kept[keptCount++] = frameCount - 1;
+	}
+
+	CompressedAnimationData* result = NewObjectTagged(arena, AllocationTag::Animation, CompressedAnimationData, quantized);
+	result->keys = NewArrayTagged(arena, AllocationTag::Animation, XMUSHORTN4, keptCount);
+	compressed = {};
+	compressed.frameCount = keptCount;
+	compressed.times = NewArrayTagged(arena, AllocationTag::Animation, float, keptCount);
+	compressed.compressed = result;
+	for (size_t i = 0; i < keptCount; i++)
+	{
+		result->keys[i] = quantized.keys[kept[i]];
+		compressed.times[i] = GetKeyTime(source, kept[i]);
+	}
+	return true;
+}
+
+void InitializeBasePose(TransformHierachy& hierachy)
+{
+	assert(hierachy.nodeCount <= MAX_BONES);
+	for (size_t group = 0; group < POSE_GROUPS; group++)
+	{
+		XMMATRIX translations{ XMVectorZero(), XMVectorZero(), XMVectorZero(), XMVectorZero() };
+		XMMATRIX rotations{ XMQuaternionIdentity(), XMQuaternionIdentity(), XMQuaternionIdentity(), XMQuaternionIdentity() };
+		XMMATRIX scales{ XMVectorSplatOne(), XMVectorSplatOne(), XMVectorSplatOne(), XMVectorSplatOne() };
+		for (size_t lane = 0; lane < POSE_LANES && group * POSE_LANES + lane < hierachy.nodeCount; lane++)
+		{
+			XMMatrixDecompose(&scales.r[lane], &rotations.r[lane], &translations.r[lane], hierachy.nodes[group * POSE_LANES + lane].baseLocal);
+		}
+
+		translations = XMMatrixTranspose(translations);
+		rotations = XMMatrixTranspose(rotations);
+		scales = XMMatrixTranspose(scales);
+		PoseGroup& pose = hierachy.basePose.groups[group];
+		for (size_t i = 0; i < 3; i++)
+		{
+			pose.translation[i] = translations.r[i];
+			pose.scale[i] = scales.r[i];
+		}
+		for (size_t i = 0; i < 4; i++)
+		{
+			pose.rotation[i] = rotations.r[i];
+		}
+	}
+}
+
+void BlendAnimationLayers(TransformAnimation* const* layers, size_t layerCount, const AnimationPose& basePose, size_t jointCount, AnimationPose& pose)
+{
+	assert(jointCount <= MAX_BONES);
+	JointMask activeJoints{};
+	for (size_t i = 0; i < layerCount; i++)
+	{
+		activeJoints |= layers[i]->jointMask;
+	}
+
+	const XMVECTOR one = XMVectorSplatOne();
+	const XMVECTOR identity[4] = { XMVectorZero(), XMVectorZero(), XMVectorZero(), one };
+	for (size_t firstJoint = 0; firstJoint < jointCount; firstJoint += POSE_LANES)
+	{
+		const size_t groupIndex = firstJoint / POSE_LANES;
+		const uint32_t validLanes = jointCount - firstJoint < POSE_LANES ? (1u << (jointCount - firstJoint)) - 1 : (1u << POSE_LANES) - 1;
+		if ((activeJoints.GetGroup(groupIndex) & validLanes) == 0)
+		{
+			continue;
+		}
+
+		PoseGroup& group = pose.groups[groupIndex];
+		const PoseGroup& base = basePose.groups[groupIndex];
+		for (size_t layerIndex = 0; layerIndex < layerCount; layerIndex++)
+		{
+			TransformAnimation& layer = *layers[layerIndex];
+			const uint32_t lanes = layer.jointMask.GetGroup(groupIndex) & validLanes;
+			if (lanes == 0)
+			{
+				continue;
+			}
+			const bool additive = layer.blendMode == AnimationBlendMode::Additive;
+			const bool fullWeight = !additive && layer.weight >= 1.f;
+			const XMVECTOR weight = XMVectorReplicate(layer.weight);
+			XMVECTOR t;
+
+			// Keys come out one joint per row, transposing turns them into the components of four joints
+			XMMATRIX a = XMMatrixTranspose(XMMATRIX{ group.translation[0], group.translation[1], group.translation[2], XMVectorZero() });
+			XMMATRIX b = a;
+			uint32_t keyedLanes = GatherGroupKeys(layer, &AnimationJointData::translations, firstJoint, lanes, layer.time, a, b, t);
+			if (keyedLanes != 0)
+			{
+				a = XMMatrixTranspose(a);
+				b = XMMatrixTranspose(b);
+				const XMVECTOR select = GetLaneSelect(keyedLanes);
+				for (size_t i = 0; i < 3; i++)
+				{
+					const XMVECTOR sampled = XMVectorLerpV(a.r[i], b.r[i], t);
+					const XMVECTOR blended = additive ? XMVectorMultiplyAdd(XMVectorSubtract(sampled, base.translation[i]), weight, group.translation[i])
+						: fullWeight ? sampled : XMVectorLerpV(group.translation[i], sampled, weight);
+					group.translation[i] = XMVectorSelect(group.translation[i], blended, select);
+				}
+			}
+
+			a = XMMatrixTranspose(XMMATRIX{ group.rotation[0], group.rotation[1], group.rotation[2], group.rotation[3] });
+			b = a;
+			keyedLanes = GatherGroupKeys(layer, &AnimationJointData::rotations, firstJoint, lanes, layer.time, a, b, t);
+			if (keyedLanes != 0)
+			{
+				a = XMMatrixTranspose(a);
+				b = XMMatrixTranspose(b);
+				XMVECTOR sampled[4];
+				SlerpGroup(sampled, a.r, b.r, t);
+				XMVECTOR blended[4];
+				if (additive)
+				{
+					// The rotation from the base pose to the animation, applied on top of the pose so far
+					const XMVECTOR inverseBase[4] = { XMVectorNegate(base.rotation[0]), XMVectorNegate(base.rotation[1]), XMVectorNegate(base.rotation[2]), base.rotation[3] };
+					XMVECTOR difference[4];
+					MultiplyGroup(difference, inverseBase, sampled);
+					SlerpGroup(difference, identity, difference, weight);
+					MultiplyGroup(blended, group.rotation, difference);
+				}
+				else if (fullWeight)
+				{
+					memcpy(blended, sampled, sizeof(blended));
+				}
+				else
+				{
+					SlerpGroup(blended, group.rotation, sampled, weight);
+				}
+				const XMVECTOR select = GetLaneSelect(keyedLanes);
+				for (size_t i = 0; i < 4; i++)
+				{
+					group.rotation[i] = XMVectorSelect(group.rotation[i], blended[i], select);
+				}
+			}
+
+			a = XMMatrixTranspose(XMMATRIX{ group.scale[0], group.scale[1], group.scale[2], XMVectorZero() });
+			b = a;
+			keyedLanes = GatherGroupKeys(layer, &AnimationJointData::scales, firstJoint, lanes, layer.time, a, b, t);
+			if (keyedLanes != 0)
+			{
+				a = XMMatrixTranspose(a);
+				b = XMMatrixTranspose(b);
+				const XMVECTOR select = GetLaneSelect(keyedLanes);
+				for (size_t i = 0; i < 3; i++)
+				{
+					const XMVECTOR sampled = XMVectorLerpV(a.r[i], b.r[i], t);
+					const XMVECTOR blended = additive ? XMVectorMultiply(group.scale[i], XMVectorLerpV(one, XMVectorDivide(sampled, base.scale[i]), weight))
+						: fullWeight ? sampled : XMVectorLerpV(group.scale[i], sampled, weight);
+					group.scale[i] = XMVectorSelect(group.scale[i], blended, select);
+				}
+			}
+		}
+	}
+}
+
+void BuildPoseMatrices(const AnimationPose& pose, TransformHierachy& hierachy)
+{
+	assert(hierachy.nodeCount <= MAX_BONES);
+	const XMVECTOR one = XMVectorSplatOne();
+	for (size_t firstJoint = 0; firstJoint < hierachy.nodeCount; firstJoint += POSE_LANES)
+	{
+		const PoseGroup& group = pose.groups[firstJoint / POSE_LANES];
+		const XMVECTOR x = group.rotation[0];
+		const XMVECTOR y = group.rotation[1];
+		const XMVECTOR z = group.rotation[2];
+		const XMVECTOR w = group.rotation[3];
+
+		// Same terms as XMMatrixRotationQuaternion
+		const XMVECTOR x2 = XMVectorAdd(x, x);
+		const XMVECTOR y2 = XMVectorAdd(y, y);
+		const XMVECTOR z2 = XMVectorAdd(z, z);
+		const XMVECTOR xx = XMVectorMultiply(x, x2);
+		const XMVECTOR yy = XMVectorMultiply(y, y2);
+		const XMVECTOR zz = XMVectorMultiply(z, z2);
+		const XMVECTOR xy = XMVectorMultiply(x, y2);
+		const XMVECTOR xz = XMVectorMultiply(x, z2);
+		const XMVECTOR yz = XMVectorMultiply(y, z2);
+		const XMVECTOR wx = XMVectorMultiply(x2, w);
+		const XMVECTOR wy = XMVectorMultiply(y2, w);
+		const XMVECTOR wz = XMVectorMultiply(z2, w);
+
+		// Scale applies to the rows, translation is the last one
+		const XMVECTOR sx = group.scale[0];
+		const XMVECTOR sy = group.scale[1];
+		const XMVECTOR sz = group.scale[2];
+		const XMMATRIX rows0 = XMMatrixTranspose(XMMATRIX{
+			XMVectorMultiply(XMVectorSubtract(XMVectorSubtract(one, yy), zz), sx),
+			XMVectorMultiply(XMVectorAdd(xy, wz), sx),
+			XMVectorMultiply(XMVectorSubtract(xz, wy), sx),
+			XMVectorZero() });
+		const XMMATRIX rows1 = XMMatrixTranspose(XMMATRIX{
+			XMVectorMultiply(XMVectorSubtract(xy, wz), sy),
+			XMVectorMultiply(XMVectorSubtract(XMVectorSubtract(one, xx), zz), sy),
+			XMVectorMultiply(XMVectorAdd(yz, wx), sy),
+			XMVectorZero() });
+		const XMMATRIX rows2 = XMMatrixTranspose(XMMATRIX{
+			XMVectorMultiply(XMVectorAdd(xz, wy), sz),
+			XMVectorMultiply(XMVectorSubtract(yz, wx), sz),
+			XMVectorMultiply(XMVectorSubtract(XMVectorSubtract(one, xx), yy), sz),
+			XMVectorZero() });
+		const XMMATRIX rows3 = XMMatrixTranspose(XMMATRIX{ group.translation[0], group.translation[1], group.translation[2], one });
+
+		for (size_t lane = 0; lane < POSE_LANES && firstJoint + lane < hierachy.nodeCount; lane++)
+		{
+			hierachy.nodes[firstJoint + lane].currentLocal = { rows0.r[lane], rows1.r[lane], rows2.r[lane], rows3.r[lane] };
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Memory.h"
+#include "Mesh.h"
+
+// Keys SampleAnimation steps ahead from the cursor before it falls back to a binary search
+#define ANIMATION_CURSOR_MAX_STEPS 4
+// Channels that miss the tolerance at a rate get resampled at twice the rate until they reach this one, then they keep their keys
+#define ANIMATION_RESAMPLE_MAX_RATE 240.f
+
+/// <summary>
+/// Interpolates between the keys around animationTime and clamps to the first and last key. Resampled channels find their keys by index arithmetic.
+/// Others continue from animData.cursor when time moves forward by a few keys at most, loops and seeks binary search the keys instead. Compressed keys get decoded on the fly.
+/// </summary>
+XMVECTOR SampleAnimation(AnimationData& animData, float animationTime, XMVECTOR(__vectorcall* interp)(XMVECTOR a, XMVECTOR b, float t));
+
+/// <summary>
+/// The keys SampleAnimation would interpolate between and how far animationTime is between them. Both keys are the same one outside of the channel.
+/// </summary>
+float FindAnimationKeys(AnimationData& animData, float animationTime, XMVECTOR& a, XMVECTOR& b);
+
+/// <summary>
+/// Resamples a channel with linear keys to keys that are evenly spaced between its first and last key, at least sampleRate per second.
+/// The rate doubles up to ANIMATION_RESAMPLE_MAX_RATE while the curve differs from the original by more than tolerance in any component,
+/// rotations are interpolated with slerp and compared up to sign. Returns false and leaves resampled alone if no rate is good enough.
+/// </summary>
+bool ResampleAnimationData(const AnimationData& keys, bool rotation, float sampleRate, float tolerance, AnimationData& resampled, MemoryArena& arena);
+
+/// <summary>
+/// Largest component difference between two channels, checked at the keys of both and halfway between them.
+/// </summary>
+float GetAnimationDataError(const AnimationData& a, const AnimationData& b, bool rotation);
+
+/// <summary>
+/// Quantizes the keys of a channel to 16 bits per component and removes the keys that interpolating their neighbours gets within tolerance of.
+/// Rotations keep their three smallest components only. Returns false and leaves compressed alone if quantizing alone already misses the tolerance.
+/// </summary>
+bool CompressAnimationData(const AnimationData& source, bool rotation, float tolerance, AnimationData& compressed, MemoryArena& arena);
+
+/// <summary>
+/// Takes apart the baseLocal of every joint into hierachy.basePose. Loaders call this once so evaluating poses never has to decompose a matrix.
+/// </summary>
+void InitializeBasePose(TransformHierachy& hierachy);
+
+/// <summary>
+/// Applies the layers to pose in order, each sampled at its own time. Override layers blend the joints they have channels for towards the animation by their weight,
+/// additive layers add the difference between the animation and basePose scaled by their weight. Joints outside of a layer's jointMask keep what they had.
+/// Every group of joints that any layer has in its mask gets visited once with all layers, four joints are interpolated and blended at once.
+/// </summary>
+void BlendAnimationLayers(TransformAnimation* const* layers, size_t layerCount, const AnimationPose& basePose, size_t jointCount, AnimationPose& pose);
+
+/// <summary>
+/// Sets currentLocal of every joint to the matrix XMMatrixAffineTransformation builds from its transform in pose, POSE_LANES joints at once.
+/// </summary>
+void BuildPoseMatrices(const AnimationPose& pose, TransformHierachy& hierachy);
@@ -91,7 +91,7 @@ AudioBuffer* LoadAudioFile(const wchar_t* path, MemoryArena& arena)
 
     //fill out the audio data buffer with the contents of the fourccDATA chunk
     FindChunk(audioFile, fourccDATA, dwChunkSize, dwChunkPosition);
-    BYTE* pDataBuffer = NewArray(arena, BYTE, dwChunkSize);
+    BYTE* pDataBuffer = NewArrayTagged(arena, AllocationTag::Audio, BYTE, dwChunkSize);
     ReadChunkData(audioFile, pDataBuffer, dwChunkSize, dwChunkPosition);
 
     audioBuffer->buffer.AudioBytes = dwChunkSize;  //size of the audio buffer in bytes
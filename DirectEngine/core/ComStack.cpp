@@ -26,7 +26,14 @@ void** ComStack::AddPointer(void** pointer, bool replace)
 
 void ComStack::Clear()
 {
-	while (pointerIndex > 0)
+	Rewind(0);
+}
+
+// Releases everything that was added after the stack had pointerCount entries
+void ComStack::Rewind(size_t pointerCount)
+{
+	assert(pointerCount <= pointerIndex);
+	while (pointerIndex > pointerCount)
 	{
 		pointerIndex--;
 		IUnknown* unknown = *comPointers[pointerIndex];
@@ -13,6 +13,7 @@ public:
 
 	void** AddPointer(void** pointer, bool replace = false);
     void Clear();
+    void Rewind(size_t pointerCount);
 };
 
 #define NewComObject(stack, pointer) __uuidof(**(pointer)), (stack).AddPointer(IID_PPV_ARGS_Helper(pointer))
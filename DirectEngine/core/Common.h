@@ -6,7 +6,9 @@
 using namespace DirectX;
 
 #include "Memory.h"
+#include "Name.h"
 #include "Constants.h"
+#include "Vertex.h"
 
 struct DescriptorHandle
 {
@@ -18,7 +20,7 @@ struct TextureGPU
 {
     ID3D12Resource* buffer = nullptr;
     DescriptorHandle handle = {};
-    std::string name = {};
+    Name name = {};
 };
 
 class PipelineConfig
@@ -39,6 +41,8 @@ public:
     D3D12_RASTERIZER_DESC rasterizerDesc = CD3DX12_RASTERIZER_DESC{ D3D12_DEFAULT };
     D3D12_DEPTH_STENCIL_DESC depthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
     DXGI_FORMAT format = DISPLAY_FORMAT;
+    // Packed mesh vertices unless the pipeline draws from its own vertex buffer
+    D3D12_INPUT_LAYOUT_DESC inputLayout = { VertexData::VERTEX_DESCS, _countof(VertexData::VERTEX_DESCS) };
 
     ID3D12PipelineState* pipelineState = nullptr;
     ID3D12PipelineState* pipelineVariant1 = nullptr;
@@ -56,7 +60,7 @@ enum class RootConstantType
 struct RootConstantInfo
 {
     RootConstantType type = RootConstantType::UINT;
-    FixedStr name = "-";
+    Name name = "-";
     uint32_t defaultValue = 0;
 };
 
@@ -64,7 +68,7 @@ struct EntityData;
 class MaterialData
 {
 public:
-    StackArray<EntityData*, MAX_ENTITIES_PER_MATERIAL> entities = {};
+    ArenaVector<EntityData*> entities{};
     StackArray<TextureGPU*, MAX_TEXTURES_PER_MATERIAL> textures = {};
     StackArray<RootConstantInfo, MAX_ROOT_CONSTANTS_PER_MATERIAL> rootConstants = {};
     UINT rootConstantData[MAX_ROOT_CONSTANTS_PER_MATERIAL] = {};
@@ -5,19 +5,21 @@
 #define MAX_MATERIALS 128
 #define MAX_CAMERAS 8
 #define MAX_ENTITIES_PER_SCENE 1024
-#define MAX_ENTITIES_PER_MATERIAL 128
 #define MAX_TEXTURES_PER_MATERIAL 32
 #define MAX_ROOT_CONSTANTS_PER_MATERIAL 32
 #define MAX_DEFINES_PER_MATERIAL 32
 #define MAX_DEBUG_LINE_VERTICES 1024
 #define MAX_VERTICES 65536
 #define MAX_MESHES 1024
+#define MAX_MESH_LODS 4
 #define MAX_BONES 128
 #define MAX_ANIMATIONS 128
 #define MAX_CHILDREN 32
 #define MAX_ENTITY_CHILDREN 32
 #define MAX_COLLISION_RESULTS 128
 #define MAX_AUDIO_FILES 64
+#define MAX_SNAPSHOT_ARENAS 8
+#define MAX_TRACKED_ARENAS 32
 #define MAX_DEBUG_TEXTURES 32
 #define MAX_COLLISION_EVENTS 1024
 #define MAX_CONTACT_POINTS 128
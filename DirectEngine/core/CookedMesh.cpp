@@ -0,0 +1,581 @@
+#include "CookedMesh.h"
+#include "Animation.h"
+#include "../Helpers.h"
+#include "../core/Log.h"
+
+#include <memory_resource>
+#include <mutex>
+
+namespace
+{
+	struct CookedBlock
+	{
+		uint64_t offset;
+		const void* data;
+		size_t size;
+	};
+
+	// Hands out file offsets in the order blocks are added, the blocks are written in a second pass
+	// so tables can still be filled in after their offset is known
+	struct CookedLayout
+	{
+		std::pmr::vector<CookedBlock> blocks;
+		uint64_t size = 0;
+
+		CookedLayout(std::pmr::memory_resource* resource) : blocks(resource) {}
+
+		uint64_t Add(const void* data, size_t byteCount, size_t alignment = COOKED_MESH_ALIGNMENT)
+		{
+			size = Align(size, alignment);
+			blocks.push_back({ size, data, byteCount });
+			size += byteCount;
+			return blocks.back().offset;
+		}
+
+		CookedString AddString(Name name)
+		{
+			const size_t length = strlen(name.c_str());
+			return { Add(name.c_str(), length + 1, 1), length };
+		}
+	};
+
+	CookedAnimationData AddAnimationData(CookedLayout& layout, const AnimationData& data)
+	{
+		if (data.frameCount == 0)
+		{
+			return {};
+		}
+		CookedAnimationData cooked{
+			data.frameCount,
+			data.times != nullptr ? layout.Add(data.times, sizeof(float) * data.frameCount) : 0,
+			data.data != nullptr ? layout.Add(data.data, sizeof(XMVECTOR) * data.frameCount) : 0,
+			data.sampleRate,
+			data.startTime,
+		};
+		if (data.compressed != nullptr)
+		{
+			cooked.compressedKeysOffset = layout.Add(data.compressed->keys, sizeof(XMUSHORTN4) * data.frameCount);
+			cooked.rangeMin = data.compressed->rangeMin;
+			cooked.rangeExtent = data.compressed->rangeExtent;
+			cooked.compressedRotation = data.compressed->rotation;
+		}
+		return cooked;
+	}
+
+	struct CookedFile
+	{
+		uint8_t* view;
+		size_t size;
+	};
+
+	struct CookedFileTable
+	{
+		MemoryArena arena{ 1024 * 1024 };
+		ArenaHashMap<Name, CookedFile> files{ arena, MAX_COOKED_FILES };
+		// The map can't be iterated, views are kept here as well so they can be unmapped
+		ArenaArray<uint8_t*> views{ arena, MAX_COOKED_FILES };
+		std::mutex mutex;
+	};
+
+	CookedFileTable& GetCookedFileTable()
+	{
+		static CookedFileTable table{};
+		return table;
+	}
+
+	// Mapped copy on write, mesh data is handed out as non const pointers and an in place edit
+	// should get a private page instead of an access violation
+	uint8_t* MapCookedFile(const char* path, size_t& fileSize)
+	{
+		CookedFileTable& table = GetCookedFileTable();
+		const Name key = Name::Intern(path);
+		std::lock_guard<std::mutex> lock(table.mutex);
+
+		CookedFile* existing = table.files.find(key);
+		if (existing != nullptr)
+		{
+			fileSize = existing->size;
+			return existing->view;
+		}
+
+		HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return nullptr;
+		}
+
+		LARGE_INTEGER size{};
+		if (!GetFileSizeEx(file, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(CookedMeshHeader)))
+		{
+			CloseHandle(file);
+			return nullptr;
+		}
+
+		// The view keeps the file mapped on its own, neither handle is needed afterwards
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+		CloseHandle(file);
+		if (mapping == NULL)
+		{
+			ERR("Failed to create file mapping for {}", path);
+			return nullptr;
+		}
+
+		void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+		CloseHandle(mapping);
+		if (view == nullptr)
+		{
+			ERR("Failed to map {}", path);
+			return nullptr;
+		}
+
+		fileSize = static_cast<size_t>(size.QuadPart);
+		table.files.insert(key, { static_cast<uint8_t*>(view), fileSize });
+		table.views.newElement() = static_cast<uint8_t*>(view);
+		return static_cast<uint8_t*>(view);
+	}
+
+	// count elements of T starting at offset have to lie inside the file and be aligned for T
+	template <typename T>
+	bool IsValidRange(uint64_t offset, uint64_t count, size_t fileSize)
+	{
+		return offset <= fileSize && offset % alignof(T) == 0 && count <= (fileSize - offset) / sizeof(T);
+	}
+
+	bool IsValidString(const CookedString& string, size_t fileSize)
+	{
+		return string.length < fileSize && IsValidRange<char>(string.offset, string.length + 1, fileSize);
+	}
+
+	bool IsValidAnimationData(const CookedAnimationData& cooked, size_t fileSize)
+	{
+		if (cooked.frameCount == 0)
+		{
+			return true;
+		}
+		if (cooked.sampleRate == 0.f && !IsValidRange<float>(cooked.timesOffset, cooked.frameCount, fileSize))
+		{
+			return false;
+		}
+		if (cooked.compressedKeysOffset != 0)
+		{
+			return IsValidRange<XMUSHORTN4>(cooked.compressedKeysOffset, cooked.frameCount, fileSize);
+		}
+		return IsValidRange<XMVECTOR>(cooked.dataOffset, cooked.frameCount, fileSize);
+	}
+
+	// Checks every offset, count and index before anything is read through them, so a truncated or stale file
+	// makes LoadModel fall back to the glTF instead of reading past the end of the mapping
+	bool IsValidCookedMesh(const uint8_t* file, size_t fileSize)
+	{
+		const CookedMeshHeader& header = *reinterpret_cast<const CookedMeshHeader*>(file);
+		if (header.meshCount > MAX_MESHES || !IsValidRange<CookedMeshEntry>(header.meshesOffset, header.meshCount, fileSize))
+		{
+			return false;
+		}
+
+		const CookedMeshEntry* entries = reinterpret_cast<const CookedMeshEntry*>(file + header.meshesOffset);
+		for (size_t i = 0; i < header.meshCount; i++)
+		{
+			const CookedMeshEntry& entry = entries[i];
+			if (!IsValidRange<PackedVertex>(entry.verticesOffset, entry.vertexCount, fileSize) ||
+				!IsValidRange<INDEX_BUFFER_TYPE>(entry.indicesOffset, entry.indexCount, fileSize) ||
+				!IsValidRange<Meshlet>(entry.meshletsOffset, entry.meshletCount, fileSize) ||
+				!IsValidString(entry.materialName, fileSize) ||
+				entry.lodCount > MAX_MESH_LODS - 1)
+			{
+				return false;
+			}
+			for (size_t level = 0; level < entry.lodCount; level++)
+			{
+				if (!IsValidRange<INDEX_BUFFER_TYPE>(entry.lods[level].indicesOffset, entry.lods[level].indexCount, fileSize))
+				{
+					return false;
+				}
+			}
+		}
+
+		if (header.hierachyOffset == 0)
+		{
+			return true;
+		}
+		if (!IsValidRange<CookedHierachy>(header.hierachyOffset, 1, fileSize))
+		{
+			return false;
+		}
+
+		const CookedHierachy& hierachy = *reinterpret_cast<const CookedHierachy*>(file + header.hierachyOffset);
+		if (hierachy.nodeCount == 0 || hierachy.nodeCount > MAX_BONES || hierachy.animationCount > MAX_ANIMATIONS ||
+			!IsValidRange<CookedNode>(hierachy.nodesOffset, hierachy.nodeCount, fileSize) ||
+			!IsValidRange<CookedAnimation>(hierachy.animationsOffset, hierachy.animationCount, fileSize))
+		{
+			return false;
+		}
+
+		const CookedNode* nodes = reinterpret_cast<const CookedNode*>(file + hierachy.nodesOffset);
+		for (size_t i = 0; i < hierachy.nodeCount; i++)
+		{
+			const CookedNode& node = nodes[i];
+			if (node.parent >= static_cast<int32_t>(hierachy.nodeCount) || node.childCount > MAX_CHILDREN || !IsValidString(node.name, fileSize))
+			{
+				return false;
+			}
+			for (size_t j = 0; j < node.childCount; j++)
+			{
+				if (node.children[j] >= hierachy.nodeCount)
+				{
+					return false;
+				}
+			}
+		}
+
+		const CookedAnimation* animations = reinterpret_cast<const CookedAnimation*>(file + hierachy.animationsOffset);
+		for (size_t i = 0; i < hierachy.animationCount; i++)
+		{
+			const CookedAnimation& animation = animations[i];
+			if (!IsValidString(animation.name, fileSize))
+			{
+				return false;
+			}
+			for (size_t j = 0; j < MAX_BONES; j++)
+			{
+				if (!IsValidAnimationData(animation.translations[j], fileSize) ||
+					!IsValidAnimationData(animation.rotations[j], fileSize) ||
+					!IsValidAnimationData(animation.scales[j], fileSize))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	Name ReadString(const uint8_t* file, const CookedString& string)
+	{
+		return Name::Intern({ reinterpret_cast<const char*>(file + string.offset), string.length });
+	}
+
+	void ReadAnimationData(uint8_t* file, const CookedAnimationData& cooked, AnimationData& data, MemoryArena& arena)
+	{
+		data.frameCount = cooked.frameCount;
+		data.times = cooked.frameCount > 0 && cooked.sampleRate == 0.f ? reinterpret_cast<float*>(file + cooked.timesOffset) : nullptr;
+		data.data = cooked.frameCount > 0 && cooked.compressedKeysOffset == 0 ? reinterpret_cast<XMVECTOR*>(file + cooked.dataOffset) : nullptr;
+		data.sampleRate = cooked.sampleRate;
+		data.startTime = cooked.startTime;
+		data.compressed = nullptr;
+		if (cooked.frameCount > 0 && cooked.compressedKeysOffset != 0)
+		{
+			CompressedAnimationData* compressed = NewObjectTagged(arena, AllocationTag::Animation, CompressedAnimationData);
+			compressed->keys = reinterpret_cast<XMUSHORTN4*>(file + cooked.compressedKeysOffset);
+			compressed->rangeMin = cooked.rangeMin;
+			compressed->rangeExtent = cooked.rangeExtent;
+			compressed->rotation = cooked.compressedRotation != 0;
+			data.compressed = compressed;
+		}
+	}
+}
+
+std::pmr::string GetCookedMeshPath(std::string_view gltfPath, std::pmr::memory_resource* resource)
+{
+	const size_t fileNameStart = gltfPath.find_last_of("/\\") + 1;
+	const size_t extensionStart = gltfPath.rfind('.');
+	if (extensionStart != std::string_view::npos && extensionStart > fileNameStart)
+	{
+		gltfPath = gltfPath.substr(0, extensionStart);
+	}
+	std::pmr::string result{ resource };
+	result.reserve(gltfPath.size() + sizeof(COOKED_MESH_EXTENSION));
+	result += gltfPath;
+	result += COOKED_MESH_EXTENSION;
+	return result;
+}
+
+bool IsCookedMeshCurrent(const char* gltfPath, const char* cookedPath)
+{
+	WIN32_FILE_ATTRIBUTE_DATA cookedAttributes{};
+	if (!GetFileAttributesExA(cookedPath, GetFileExInfoStandard, &cookedAttributes))
+	{
+		return false;
+	}
+
+	// Files from an older cooker need a recook even if the glTF didn't change
+	CookedMeshHeader header{};
+	FILE* fileHandle = fopen(cookedPath, "rb");
+	if (fileHandle == nullptr)
+	{
+		return false;
+	}
+	const size_t headerRead = fread(&header, sizeof(header), 1, fileHandle);
+	fclose(fileHandle);
+	if (headerRead != 1 || header.magic != COOKED_MESH_MAGIC || header.version != COOKED_MESH_VERSION)
+	{
+		return false;
+	}
+
+	// Builds without the source file only ship the cooked one
+	WIN32_FILE_ATTRIBUTE_DATA gltfAttributes{};
+	return !GetFileAttributesExA(gltfPath, GetFileExInfoStandard, &gltfAttributes) ||
+		CompareFileTime(&cookedAttributes.ftLastWriteTime, &gltfAttributes.ftLastWriteTime) >= 0;
+}
+
+bool WriteCookedMesh(const GltfResult& model, const char* cookedPath)
+{
+	ArenaScope scratch{ GetScratchArena() };
+	ArenaMemoryResource resource{ scratch.arena };
+	CookedLayout layout{ &resource };
+
+	CookedMeshHeader* header = NewObject(scratch.arena, CookedMeshHeader);
+	header->magic = COOKED_MESH_MAGIC;
+	header->version = COOKED_MESH_VERSION;
+	header->meshCount = model.meshes.size;
+	layout.Add(header, sizeof(CookedMeshHeader));
+
+	CookedMeshEntry* entries = NewArray(scratch.arena, CookedMeshEntry, model.meshes.size);
+	header->meshesOffset = layout.Add(entries, sizeof(CookedMeshEntry) * model.meshes.size);
+
+	const TransformHierachy* hierachy = model.transformHierachy;
+	CookedHierachy* cookedHierachy = nullptr;
+	CookedNode* cookedNodes = nullptr;
+	CookedAnimation* cookedAnimations = nullptr;
+	if (hierachy != nullptr)
+	{
+		cookedHierachy = NewObject(scratch.arena, CookedHierachy);
+		header->hierachyOffset = layout.Add(cookedHierachy, sizeof(CookedHierachy));
+
+		cookedHierachy->nodeCount = hierachy->nodeCount;
+		cookedNodes = NewArray(scratch.arena, CookedNode, hierachy->nodeCount);
+		cookedHierachy->nodesOffset = layout.Add(cookedNodes, sizeof(CookedNode) * hierachy->nodeCount);
+
+		cookedHierachy->animationCount = hierachy->animationCount;
+		cookedAnimations = NewArray(scratch.arena, CookedAnimation, hierachy->animationCount);
+		cookedHierachy->animationsOffset = layout.Add(cookedAnimations, sizeof(CookedAnimation) * hierachy->animationCount);
+	}
+
+	for (size_t i = 0; i < model.meshes.size; i++)
+	{
+		const MeshFile& meshFile = model.meshes[i];
+		CookedMeshEntry& entry = entries[i];
+		entry.vertexCount = meshFile.mesh.vertexCount;
+		// Stored in the GPU layout so loading is a single copy from the mapping into the upload buffer
+		const PackedVertex* packedVertices = meshFile.mesh.packedVertices;
+		if (packedVertices == nullptr)
+		{
+			PackedVertex* packed = NewArray(scratch.arena, PackedVertex, meshFile.mesh.vertexCount);
+			PackVertices(meshFile.mesh.vertices, packed, meshFile.mesh.vertexCount);
+			packedVertices = packed;
+		}
+		entry.verticesOffset = layout.Add(packedVertices, sizeof(PackedVertex) * meshFile.mesh.vertexCount);
+		entry.indexCount = meshFile.mesh.indexCount;
+		entry.indicesOffset = layout.Add(meshFile.mesh.indices, sizeof(INDEX_BUFFER_TYPE) * meshFile.mesh.indexCount);
+		entry.meshletCount = meshFile.mesh.meshletCount;
+		entry.meshletsOffset = layout.Add(meshFile.mesh.meshlets, sizeof(Meshlet) * meshFile.mesh.meshletCount);
+		entry.lodCount = meshFile.mesh.lodCount;
+		for (size_t level = 0; level < meshFile.mesh.lodCount; level++)
+		{
+			const MeshLod& lod = meshFile.mesh.lods[level];
+			entry.lods[level].indexCount = lod.indexCount;
+			entry.lods[level].indicesOffset = layout.Add(lod.indices, sizeof(INDEX_BUFFER_TYPE) * lod.indexCount);
+			entry.lods[level].error = lod.error;
+		}
+		entry.materialName = layout.AddString(meshFile.materialName);
+	}
+
+	if (hierachy != nullptr)
+	{
+		for (size_t i = 0; i < MAX_BONES; i++)
+		{
+			cookedHierachy->jointToNodeIndex[i] = static_cast<uint32_t>(hierachy->jointToNodeIndex[i]);
+			cookedHierachy->nodeToJointIndex[i] = static_cast<uint32_t>(hierachy->nodeToJointIndex[i]);
+		}
+
+		for (size_t i = 0; i < hierachy->nodeCount; i++)
+		{
+			const TransformNode& node = hierachy->nodes[i];
+			CookedNode& cookedNode = cookedNodes[i];
+			XMStoreFloat4x4(&cookedNode.inverseBind, node.inverseBind);
+			XMStoreFloat4x4(&cookedNode.baseLocal, node.baseLocal);
+			cookedNode.parent = node.parent != nullptr ? static_cast<int32_t>(node.parent - hierachy->nodes) : -1;
+			cookedNode.childCount = static_cast<uint32_t>(node.childCount);
+			for (size_t j = 0; j < node.childCount; j++)
+			{
+				cookedNode.children[j] = static_cast<uint32_t>(node.children[j] - hierachy->nodes);
+			}
+			cookedNode.name = layout.AddString(node.name);
+		}
+
+		for (size_t i = 0; i < hierachy->animationCount; i++)
+		{
+			const TransformAnimation& animation = hierachy->animations[i];
+			CookedAnimation& cookedAnimation = cookedAnimations[i];
+			cookedAnimation.name = layout.AddString(animation.name);
+			cookedAnimation.onlyInMainCamera = animation.onlyInMainCamera;
+			cookedAnimation.duration = animation.duration;
+			memcpy(cookedAnimation.jointMask, animation.jointMask.words, sizeof(cookedAnimation.jointMask));
+			for (size_t j = 0; j < MAX_BONES; j++)
+			{
+				cookedAnimation.translations[j] = AddAnimationData(layout, animation.jointChannels[j].translations);
+				cookedAnimation.rotations[j] = AddAnimationData(layout, animation.jointChannels[j].rotations);
+				cookedAnimation.scales[j] = AddAnimationData(layout, animation.jointChannels[j].scales);
+			}
+		}
+	}
+
+	header->fileSize = layout.size;
+
+	FILE* fileHandle = fopen(cookedPath, "wb");
+	if (fileHandle == nullptr)
+	{
+		ERR("Failed to open {} for writing", cookedPath);
+		return false;
+	}
+
+	static const uint8_t padding[COOKED_MESH_ALIGNMENT]{};
+	uint64_t position = 0;
+	bool success = true;
+	for (const CookedBlock& block : layout.blocks)
+	{
+		assert(block.offset >= position && block.offset - position < COOKED_MESH_ALIGNMENT);
+		const size_t paddingSize = block.offset - position;
+		success &= fwrite(padding, 1, paddingSize, fileHandle) == paddingSize;
+		success &= fwrite(block.data, 1, block.size, fileHandle) == block.size;
+		position = block.offset + block.size;
+	}
+	success &= fclose(fileHandle) == 0;
+
+	if (!success)
+	{
+		ERR("Failed to write {}", cookedPath);
+		remove(cookedPath);
+	}
+	return success;
+}
+
+GltfResult* LoadCookedMesh(const char* cookedPath, MemoryArena& arena)
+{
+	INIT_TIMER(timer);
+
+	size_t fileSize = 0;
+	uint8_t* file = MapCookedFile(cookedPath, fileSize);
+	if (file == nullptr)
+	{
+		return nullptr;
+	}
+
+	const CookedMeshHeader& header = *reinterpret_cast<const CookedMeshHeader*>(file);
+	if (header.magic != COOKED_MESH_MAGIC || header.version != COOKED_MESH_VERSION || header.fileSize != fileSize || !IsValidCookedMesh(file, fileSize))
+	{
+		WARN("Cooked mesh {} is outdated or corrupt", cookedPath);
+		return nullptr;
+	}
+
+	GltfResult* result = NewObject(arena, GltfResult, arena);
+
+	const CookedMeshEntry* entries = reinterpret_cast<const CookedMeshEntry*>(file + header.meshesOffset);
+	for (size_t i = 0; i < header.meshCount; i++)
+	{
+		const CookedMeshEntry& entry = entries[i];
+		MeshFile& meshFile = result->meshes.newElement();
+		meshFile.mesh.packedVertices = reinterpret_cast<PackedVertex*>(file + entry.verticesOffset);
+		meshFile.mesh.vertexCount = entry.vertexCount;
+		meshFile.mesh.indices = reinterpret_cast<INDEX_BUFFER_TYPE*>(file + entry.indicesOffset);
+		meshFile.mesh.indexCount = entry.indexCount;
+		meshFile.mesh.meshlets = reinterpret_cast<Meshlet*>(file + entry.meshletsOffset);
+		meshFile.mesh.meshletCount = entry.meshletCount;
+		meshFile.mesh.lodCount = entry.lodCount;
+		for (size_t level = 0; level < entry.lodCount; level++)
+		{
+			MeshLod& lod = meshFile.mesh.lods[level];
+			lod.indices = reinterpret_cast<INDEX_BUFFER_TYPE*>(file + entry.lods[level].indicesOffset);
+			lod.indexCount = entry.lods[level].indexCount;
+			lod.error = entry.lods[level].error;
+		}
+		meshFile.materialName = ReadString(file, entry.materialName);
+	}
+
+	if (header.hierachyOffset != 0)
+	{
+		const CookedHierachy& cookedHierachy = *reinterpret_cast<const CookedHierachy*>(file + header.hierachyOffset);
+		TransformHierachy* hierachy = NewObjectTagged(arena, AllocationTag::Animation, TransformHierachy, arena);
+		result->transformHierachy = hierachy;
+
+		for (size_t i = 0; i < MAX_BONES; i++)
+		{
+			hierachy->jointToNodeIndex[i] = cookedHierachy.jointToNodeIndex[i];
+			hierachy->nodeToJointIndex[i] = cookedHierachy.nodeToJointIndex[i];
+		}
+
+		hierachy->nodeCount = cookedHierachy.nodeCount;
+		const CookedNode* cookedNodes = reinterpret_cast<const CookedNode*>(file + cookedHierachy.nodesOffset);
+		for (size_t i = 0; i < cookedHierachy.nodeCount; i++)
+		{
+			const CookedNode& cookedNode = cookedNodes[i];
+			TransformNode& node = hierachy->nodes[i];
+			node.inverseBind = XMLoadFloat4x4(&cookedNode.inverseBind);
+			node.baseLocal = XMLoadFloat4x4(&cookedNode.baseLocal);
+			node.currentLocal = node.baseLocal;
+			node.parent = cookedNode.parent >= 0 ? &hierachy->nodes[cookedNode.parent] : nullptr;
+			node.childCount = cookedNode.childCount;
+			for (size_t j = 0; j < cookedNode.childCount; j++)
+			{
+				node.children[j] = &hierachy->nodes[cookedNode.children[j]];
+			}
+			node.name = ReadString(file, cookedNode.name);
+		}
+		hierachy->root = &hierachy->nodes[0];
+		hierachy->UpdateNode(hierachy->root);
+		InitializeBasePose(*hierachy);
+
+		hierachy->animationCount = 0;
+		const CookedAnimation* cookedAnimations = reinterpret_cast<const CookedAnimation*>(file + cookedHierachy.animationsOffset);
+		for (size_t i = 0; i < cookedHierachy.animationCount; i++)
+		{
+			const CookedAnimation& cookedAnimation = cookedAnimations[i];
+			TransformAnimation& animation = hierachy->animations[hierachy->animationCount] = {};
+			animation.name = ReadString(file, cookedAnimation.name);
+			animation.onlyInMainCamera = cookedAnimation.onlyInMainCamera != 0;
+			animation.duration = cookedAnimation.duration;
+			memcpy(animation.jointMask.words, cookedAnimation.jointMask, sizeof(cookedAnimation.jointMask));
+			for (size_t j = 0; j < MAX_BONES; j++)
+			{
+				ReadAnimationData(file, cookedAnimation.translations[j], animation.jointChannels[j].translations, arena);
+				ReadAnimationData(file, cookedAnimation.rotations[j], animation.jointChannels[j].rotations, arena);
+				ReadAnimationData(file, cookedAnimation.scales[j], animation.jointChannels[j].scales, arena);
+			}
+
+			hierachy->animationNameToIndex.insert(animation.name, hierachy->animationCount);
+			hierachy->animationCount++;
+		}
+	}
+
+	result->success = true;
+	LOG_TIMER(timer, "Load Cooked Mesh");
+	return result;
+}
+
+void ReleaseCookedMeshes()
+{
+	CookedFileTable& table = GetCookedFileTable();
+	std::lock_guard<std::mutex> lock(table.mutex);
+
+	for (uint8_t* view : table.views)
+	{
+		UnmapViewOfFile(view);
+	}
+	table.views.clear();
+	table.files.clear();
+}
+
+GltfResult* LoadModel(const char* gltfPath, MemoryArena& arena)
+{
+	ArenaScope scratch{ GetScratchArena(&arena) };
+	ArenaMemoryResource resource{ scratch.arena };
+	const std::pmr::string cookedPath = GetCookedMeshPath(gltfPath, &resource);
+	if (IsCookedMeshCurrent(gltfPath, cookedPath.c_str()))
+	{
+		GltfResult* result = LoadCookedMesh(cookedPath.c_str(), arena);
+		if (result != nullptr)
+		{
+			return result;
+		}
+	}
+	return LoadGltfFromFile(gltfPath, arena);
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+#define COOKED_MESH_MAGIC 0x48534d43 // "CMSH"
+#define COOKED_MESH_VERSION 8
+#define COOKED_MESH_ALIGNMENT 64
+#define COOKED_MESH_EXTENSION ".cmesh"
+#define MAX_COOKED_FILES 256
+
+// Everything in a cooked file is addressed by byte offsets from the start of the file,
+// so the file can be mapped anywhere and used without any fixups.
+
+struct CookedString
+{
+    uint64_t offset;
+    uint64_t length;
+};
+
+struct CookedMeshHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t fileSize;
+    uint64_t meshCount;
+    uint64_t meshesOffset;
+    // 0 if the model has no skin
+    uint64_t hierachyOffset;
+};
+
+struct CookedMeshLod
+{
+    uint64_t indicesOffset;
+    uint64_t indexCount;
+    float error;
+};
+
+struct CookedMeshEntry
+{
+    // PackedVertex array
+    uint64_t verticesOffset;
+    uint64_t vertexCount;
+    uint64_t indicesOffset;
+    uint64_t indexCount;
+    uint64_t meshletsOffset;
+    uint64_t meshletCount;
+    CookedMeshLod lods[MAX_MESH_LODS - 1];
+    uint64_t lodCount;
+    CookedString materialName;
+};
+
+struct CookedNode
+{
+    XMFLOAT4X4 inverseBind;
+    XMFLOAT4X4 baseLocal;
+    // Joint indices, -1 for the root
+    int32_t parent;
+    uint32_t childCount;
+    uint32_t children[MAX_CHILDREN];
+    CookedString name;
+};
+
+struct CookedAnimationData
+{
+    uint64_t frameCount;
+    // Unused for resampled channels
+    uint64_t timesOffset;
+    // XMVECTORs, 16 byte aligned, unused for compressed channels
+    uint64_t dataOffset;
+    float sampleRate;
+    float startTime;
+    // XMUSHORTN4s of compressed channels, 0 for all others
+    uint64_t compressedKeysOffset;
+    XMFLOAT4 rangeMin;
+    XMFLOAT4 rangeExtent;
+    uint32_t compressedRotation;
+};
+
+struct CookedAnimation
+{
+    CookedAnimationData translations[MAX_BONES];
+    CookedAnimationData rotations[MAX_BONES];
+    CookedAnimationData scales[MAX_BONES];
+    // JointMask::words
+    uint64_t jointMask[(MAX_BONES + 63) / 64];
+    CookedString name;
+    uint32_t onlyInMainCamera;
+    float duration;
+};
+
+struct CookedHierachy
+{
+    uint64_t nodeCount;
+    uint64_t nodesOffset;
+    uint64_t animationCount;
+    uint64_t animationsOffset;
+    uint32_t jointToNodeIndex[MAX_BONES];
+    uint32_t nodeToJointIndex[MAX_BONES];
+};
+
+/// <summary>
+/// models/foo.glb -> models/foo.cmesh
+/// </summary>
+std::pmr::string GetCookedMeshPath(std::string_view gltfPath, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+/// <summary>
+/// True if the cooked file exists, was written by this version and is at least as new as the glTF it was cooked from.
+/// </summary>
+bool IsCookedMeshCurrent(const char* gltfPath, const char* cookedPath);
+
+/// <summary>
+/// Serializes a loaded model so LoadCookedMesh can use it without any parsing.
+/// </summary>
+bool WriteCookedMesh(const GltfResult& model, const char* cookedPath);
+
+/// <summary>
+/// Maps a cooked file, vertex, index, LOD, meshlet and keyframe data point straight into the mapping and only the hierachy and the ranges of compressed channels are built in the arena.
+/// Vertices are stored as PackedVertex, the loaded meshes only have packedVertices.
+/// Mappings stay alive until ReleaseCookedMeshes, loading the same file again reuses the existing view.
+/// Returns nullptr if the file is missing, was cooked by a different version or has any range outside of the file.
+/// </summary>
+GltfResult* LoadCookedMesh(const char* cookedPath, MemoryArena& arena);
+
+/// <summary>
+/// Unmaps every cooked file so MeshCook can rewrite them and the next load sees the new contents.
+/// All meshes loaded from cooked files point into the mappings, call this only once none of them are used anymore.
+/// </summary>
+void ReleaseCookedMeshes();
+
+/// <summary>
+/// Loads the cooked version of a glTF file if it's up to date and parses the glTF otherwise.
+/// </summary>
+GltfResult* LoadModel(const char* gltfPath, MemoryArena& arena);
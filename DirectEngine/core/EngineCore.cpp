@@ -22,6 +22,9 @@
 #include "UI.h"
 #include "EngineCore.h"
 #include "Materials.h"
+#include "CookedMesh.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
 #include "DirectXRaytracingHelper.h"
 #include "../directx-tex/DDSTextureLoader12.h"
 
@@ -35,6 +38,23 @@ EngineCore::EngineCore(UINT width, UINT height, CreateGameFunc gameFunc) :
     m_height(height),
     m_aspectRatio((float)width / (float)height)
 {
+    engineArena.debugName = "Engine";
+    configArena.debugName = "Config";
+    levelArena.debugName = "Level";
+    snapshotArena.debugName = "Snapshot";
+    entityDataArena.debugName = "EntityData";
+
+    m_arenas.newElement() = &engineArena;
+    m_arenas.newElement() = &configArena;
+    m_arenas.newElement() = &levelArena;
+    for (size_t i = 0; i < FrameCount; i++)
+    {
+        frameArenas.arenas[i].debugName = Name::Intern(std::format("Frame {}", i)).c_str();
+        m_arenas.newElement() = &frameArenas.arenas[i];
+    }
+    m_arenas.newElement() = &snapshotArena;
+    m_arenas.newElement() = &entityDataArena;
+
     m_game = gameFunc(engineArena, configArena, levelArena);
 }
 
@@ -615,7 +635,7 @@ void EngineCore::CreatePipelineState(PipelineConfig* config)
 
     // Describe and create the graphics pipeline state object (PSO).
     D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-    psoDesc.InputLayout = { VertexData::VERTEX_DESCS, _countof(VertexData::VERTEX_DESCS) };
+    psoDesc.InputLayout = config->inputLayout;
     psoDesc.pRootSignature = config->rootSignature;
     psoDesc.VS = CD3DX12_SHADER_BYTECODE(vertexShader.Get());
     psoDesc.PS = CD3DX12_SHADER_BYTECODE(pixelShader.Get());
@@ -720,23 +740,13 @@ void EngineCore::LoadAssets()
     m_debugLineConfig->depthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_ALWAYS;
     m_debugLineConfig->depthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
     m_debugLineConfig->topologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE;
+    m_debugLineConfig->inputLayout = { VertexData::FULL_VERTEX_DESCS, _countof(VertexData::FULL_VERTEX_DESCS) };
     m_debugLineConfig->sampleCount = m_msaaEnabled ? m_msaaSampleCount : 1;
     m_debugLineConfig->rasterizerDesc.FillMode = D3D12_FILL_MODE_WIREFRAME;
     m_debugLineConfig->rasterizerDesc.CullMode = D3D12_CULL_MODE_NONE;
     ThrowIfFailed(CreatePipeline(m_debugLineConfig, 0, 0));
 
-    {
-        // Debug lines
-        CD3DX12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(MAX_DEBUG_LINE_VERTICES * sizeof(VertexData::Vertex));
-        ThrowIfFailed(m_device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, NewComObject(comPointers, &m_debugLineData.vertexBuffer)));
-        m_debugLineData.vertexBuffer->SetName(L"Debug Line Vertex Buffer");
-
-        m_debugLineData.vertexBufferView = {};
-        m_debugLineData.vertexBufferView.BufferLocation = m_debugLineData.vertexBuffer->GetGPUVirtualAddress();
-        m_debugLineData.vertexBufferView.StrideInBytes = sizeof(VertexData::Vertex);
-        m_debugLineData.vertexBufferView.SizeInBytes = MAX_DEBUG_LINE_VERTICES * sizeof(VertexData::Vertex);
-    }
+    CreateDebugLineBuffer(MAX_DEBUG_LINE_VERTICES);
 
     {
         // General vertex buffer
@@ -793,7 +803,7 @@ void EngineCore::LoadAssets()
         RenderTexture* renderTexture = m_renderTextures.newElement() = NewObject(engineArena, RenderTexture);
         CreateRenderTexture(m_width, m_height, m_msaaEnabled, *renderTexture);
         renderTexture->camera->skipRenderTextures = true;
-        renderTexture->camera->name = ("Render Texture " + std::to_string(i)).c_str();
+        renderTexture->camera->name = Name::Intern("Render Texture " + std::to_string(i));
     }
 
     // Compute Shaders
@@ -830,7 +840,100 @@ void EngineCore::ResetLevelData()
 
     comPointersLevel.Clear();
     levelArena.Reset();
+    ReleaseCookedMeshes();
     ResetVertexBuffer();
+    m_levelSnapshot.valid = false;
+}
+
+void EngineCore::RegisterArena(const MemoryArena& arena)
+{
+    if (!m_arenas.contains(&arena))
+    {
+        m_arenas.newElement() = &arena;
+    }
+}
+
+void EngineCore::TakeLevelSnapshot(MemoryArena* const* gameArenas, size_t gameArenaCount)
+{
+    snapshotArena.Reset();
+    m_levelSnapshot.arenas.clear();
+
+    auto addArena = [&](MemoryArena& arena) {
+        LevelSnapshot::Arena& entry = m_levelSnapshot.arenas.newElement();
+        entry.arena = &arena;
+        arena.TakeSnapshot(entry.snapshot, snapshotArena);
+    };
+    addArena(levelArena);
+    addArena(entityDataArena);
+    for (size_t i = 0; i < gameArenaCount; i++)
+    {
+        addArena(*gameArenas[i]);
+    }
+
+    m_levelSnapshot.meshCount = m_meshes.size;
+    m_levelSnapshot.vertexCount = m_geometryBuffer.vertexCount;
+    m_levelSnapshot.indexCount = m_geometryBuffer.indexCount;
+    m_levelSnapshot.comPointerCount = comPointersLevel.pointerIndex;
+
+    // Entity lists of all materials end to end
+    size_t entityCount = 0;
+    m_levelSnapshot.materialEntityCounts = NewArray(snapshotArena, size_t, m_materials.size);
+    for (size_t i = 0; i < m_materials.size; i++)
+    {
+        m_levelSnapshot.materialEntityCounts[i] = m_materials[i].entities.size;
+        entityCount += m_materials[i].entities.size;
+    }
+
+    m_levelSnapshot.materialEntities = NewArray(snapshotArena, EntityData*, entityCount);
+    EntityData** materialEntities = m_levelSnapshot.materialEntities;
+    for (size_t i = 0; i < m_materials.size; i++)
+    {
+        for (EntityData* entity : m_materials[i].entities)
+        {
+            *materialEntities++ = entity;
+        }
+    }
+
+    m_levelSnapshot.materialCount = m_materials.size;
+    m_levelSnapshot.valid = true;
+    LOG("Took level snapshot ({:.2f} MB)", snapshotArena.used.load() / (1024.f * 1024.f));
+}
+
+void EngineCore::RestoreLevelSnapshot()
+{
+    assert(m_levelSnapshot.valid);
+    std::chrono::steady_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    // Constant buffers of entities that were created after the snapshot are the only GPU objects that have to go
+    if (comPointersLevel.pointerIndex > m_levelSnapshot.comPointerCount)
+    {
+        WaitForGpu();
+        comPointersLevel.Rewind(m_levelSnapshot.comPointerCount);
+    }
+
+    for (LevelSnapshot::Arena& entry : m_levelSnapshot.arenas)
+    {
+        entry.arena->RestoreSnapshot(entry.snapshot);
+    }
+
+    m_meshes.truncate(m_levelSnapshot.meshCount);
+    m_geometryBuffer.vertexCount = m_levelSnapshot.vertexCount;
+    m_geometryBuffer.indexCount = m_levelSnapshot.indexCount;
+
+    EntityData** materialEntities = m_levelSnapshot.materialEntities;
+    for (size_t i = 0; i < m_materials.size; i++)
+    {
+        MaterialData& material = m_materials[i];
+        material.entities.clear();
+        if (i >= m_levelSnapshot.materialCount) continue;
+
+        for (size_t entityIndex = 0; entityIndex < m_levelSnapshot.materialEntityCounts[i]; entityIndex++)
+        {
+            material.entities.newElement() = *materialEntities++;
+        }
+    }
+
+    LOG("Restored level snapshot in {:.3f} ms", NanosecondsToSeconds(std::chrono::high_resolution_clock::now() - start) * 1000.);
 }
 
 CameraData* EngineCore::CreateCamera()
@@ -948,7 +1051,7 @@ void EngineCore::CreateGBuffer(UINT width, UINT height, GBuffer& gBuffer, DXGI_F
 
 void EngineCore::CreateEmptyTexture(int width, int height, const std::string& name, TextureGPU& texture, const IID& riidTexture, void** ppvTexture, D3D12_RESOURCE_FLAGS flags)
 {
-    texture.name = name;
+    texture.name = Name::Intern(name);
 
     D3D12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(DISPLAY_FORMAT, width, height);
     textureDesc.Flags = flags;
@@ -972,7 +1075,7 @@ void EngineCore::CreateEmptyTexture(int width, int height, const std::string& na
 
 void EngineCore::CreateEmptyUAV(int width, int height, const std::string& name, TextureGPU& texture, const IID& riidBuffer, void** ppvBuffer, D3D12_RESOURCE_FLAGS flags)
 {
-    texture.name = name;
+    texture.name = Name::Intern(name);
 
     D3D12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32G32B32A32_FLOAT, width, height);
     textureDesc.Flags = flags | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
@@ -991,20 +1094,56 @@ void EngineCore::CreateEmptyUAV(int width, int height, const std::string& name,
     m_device->CreateUnorderedAccessView(texture.buffer, nullptr, nullptr, texture.handle.cpuHandle);
 }
 
-TextureGPU* EngineCore::CreateTexture(const std::string& filePath, bool isSRGB)
+TextureGPU* EngineCore::CreateTexture(const char* filePath, bool isSRGB)
 {
     TextureGPU& texture = m_textures.newElement();
-    texture.name = filePath;
+    texture.name = Name::Intern(filePath);
+
+    // The file only has to live until UploadTexture copied it into the upload heap,
+    // the subresource list is reused so loading a texture doesn't touch the heap once it has grown
+    ArenaScope scratch{ GetScratchArena() };
+    const uint8_t* fileData = nullptr;
+    DWORD fileSize = 0;
+    HRESULT hr = S_OK;
+    HANDLE file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+    }
+    else
+    {
+        // ReadFile takes a DWORD, DDS files never get anywhere close to 4 GB
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(file, &size))
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        else if (size.QuadPart > MAXDWORD)
+        {
+            hr = HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+        }
+        else
+        {
+            uint8_t* data = NewArray(scratch.arena, uint8_t, static_cast<size_t>(size.QuadPart));
+            if (ReadFile(file, data, static_cast<DWORD>(size.QuadPart), &fileSize, NULL))
+            {
+                fileData = data;
+            }
+            else
+            {
+                hr = HRESULT_FROM_WIN32(GetLastError());
+            }
+        }
+        CloseHandle(file);
+    }
 
-    std::unique_ptr<uint8_t[]> data{};
-    std::vector<D3D12_SUBRESOURCE_DATA> subresources{};
     DDS_ALPHA_MODE alphaMode = DDS_ALPHA_MODE_UNKNOWN;
     bool isCubemap = false;
 
-    wchar_t test[128];
-    GetCurrentDirectory(128, test);
-
-    HRESULT hr = LoadDDSTextureFromFileEx(m_device, std::wstring{ filePath.begin(), filePath.end() }.c_str(), 0, D3D12_RESOURCE_FLAG_NONE, DDS_LOADER_DEFAULT, &texture.buffer, data, subresources, &alphaMode, &isCubemap);
+    if (SUCCEEDED(hr))
+    {
+        hr = LoadDDSTextureFromMemoryEx(m_device, fileData, fileSize, 0, D3D12_RESOURCE_FLAG_NONE, DDS_LOADER_DEFAULT, &texture.buffer, m_textureSubresources, &alphaMode, &isCubemap);
+    }
     if (FAILED(hr))
     {
         // TODO: log error and load default texture instead
@@ -1013,7 +1152,7 @@ TextureGPU* EngineCore::CreateTexture(const std::string& filePath, bool isSRGB)
     CHECK_HRCMD(hr);
 
     comPointers.AddPointer((void**)&texture.buffer);
-    UploadTexture(texture, subresources, isSRGB, isCubemap);
+    UploadTexture(texture, m_textureSubresources, isSRGB, isCubemap);
 
     return &texture;
 }
@@ -1115,7 +1254,7 @@ MaterialData* EngineCore::CreateMaterial(const std::string& shaderName, const st
         data.rootConstants.newElement() = rootConstantInfo;
     }
 
-    data.pipeline = NewObject(engineArena, PipelineConfig, shaderName, textures.size());
+    data.pipeline = NewObjectTagged(engineArena, AllocationTag::Material, PipelineConfig, shaderName, textures.size());
     data.pipeline->rasterizerDesc = rasterizerDesc;
     if (m_msaaEnabled) data.pipeline->sampleCount = m_msaaSampleCount;
     ThrowIfFailed(CreatePipeline(data.pipeline, 0, rootConstants.size()));
@@ -1128,20 +1267,55 @@ MaterialData* EngineCore::CreateMaterial(const std::string& shaderName, const st
 
 MeshDataGPU* EngineCore::CreateMesh(VertexData::MeshData& meshFile)
 {
-    assert(meshFile.vertices != nullptr);
+    assert(meshFile.vertices != nullptr || meshFile.packedVertices != nullptr);
     assert(meshFile.indices != nullptr);
 
+    // Cooked meshes are already packed and get copied as they are, only meshes straight from glTF need packing.
+    // They get packed before hashing so both kinds of meshes hash the same bytes
+    ArenaScope scratch{ GetScratchArena() };
+    VertexData::MeshData packedFile = meshFile;
+    if (packedFile.packedVertices == nullptr)
+    {
+        packedFile.packedVertices = NewArray(scratch.arena, VertexData::PackedVertex, meshFile.vertexCount);
+        VertexData::PackVertices(meshFile.vertices, packedFile.packedVertices, meshFile.vertexCount);
+    }
+
+    // Entries can point past m_meshes after a snapshot restore or at a slot that got reused since, the stored hash catches both.
+    // Comparing the sizes too means a hash collision between different meshes would also need identical vertex and index counts
+    const uint64_t contentHash = HashMeshContent(packedFile);
+    const size_t contentVertexBytes = m_geometryBuffer.vertexStride * meshFile.vertexCount;
+    const size_t contentIndexBytes = m_geometryBuffer.indexStride * meshFile.indexCount;
+    const size_t* existingIndex = m_meshRegistry.find(contentHash);
+    if (existingIndex != nullptr && *existingIndex < m_meshes.size)
+    {
+        const MeshDataGPU& existing = m_meshes[*existingIndex];
+        if (existing.contentHash == contentHash && existing.contentVertexBytes == contentVertexBytes && existing.contentIndexBytes == contentIndexBytes)
+        {
+            m_geometryBuffer.sharedBytes += contentVertexBytes + contentIndexBytes;
+            return &m_meshes[*existingIndex];
+        }
+    }
+
     // Calculate data sizes
     size_t addedVertexBytes = m_geometryBuffer.vertexStride * meshFile.vertexCount;
     size_t offsetInVertexBuffer = m_geometryBuffer.vertexCount * m_geometryBuffer.vertexStride;
     assert(m_geometryBuffer.vertexCount + meshFile.vertexCount <= m_geometryBuffer.maxVertexCount);
 
-    size_t addedIndexBytes = m_geometryBuffer.indexStride * meshFile.indexCount;
+    size_t totalIndexCount = meshFile.indexCount;
+    for (size_t level = 0; level < meshFile.lodCount; level++)
+    {
+        totalIndexCount += meshFile.lods[level].indexCount;
+    }
+    size_t addedIndexBytes = m_geometryBuffer.indexStride * totalIndexCount;
     size_t offsetInIndexBuffer = m_geometryBuffer.indexCount * m_geometryBuffer.indexStride;
-    assert(m_geometryBuffer.indexCount + meshFile.indexCount <= m_geometryBuffer.maxIndexCount);
+    assert(m_geometryBuffer.indexCount + totalIndexCount <= m_geometryBuffer.maxIndexCount);
 
     // Crate object
     MeshDataGPU& mesh = m_meshes.newElement();
+    mesh.contentHash = contentHash;
+    mesh.contentVertexBytes = contentVertexBytes;
+    mesh.contentIndexBytes = contentIndexBytes;
+    m_meshRegistry[contentHash] = m_meshes.size - 1;
     mesh.vertexBufferView.BufferLocation = m_geometryBuffer.vertexBuffer->GetGPUVirtualAddress() + offsetInVertexBuffer;
     mesh.vertexBufferView.StrideInBytes = m_geometryBuffer.vertexStride;
     mesh.vertexBufferView.SizeInBytes = addedVertexBytes;
@@ -1155,15 +1329,39 @@ MeshDataGPU* EngineCore::CreateMesh(VertexData::MeshData& meshFile)
 
     UINT8* pVertexDataBegin = nullptr;
     ThrowIfFailed(m_geometryBuffer.vertexUploadBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-    memcpy(pVertexDataBegin + offsetInVertexBuffer, meshFile.vertices, addedVertexBytes);
+    memcpy(pVertexDataBegin + offsetInVertexBuffer, packedFile.packedVertices, addedVertexBytes);
     m_geometryBuffer.vertexUploadBuffer->Unmap(0, nullptr);
     m_geometryBuffer.vertexCount += meshFile.vertexCount;
 
     UINT8* pIndexDataBegin = nullptr;
     ThrowIfFailed(m_geometryBuffer.indexUploadBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pIndexDataBegin)));
-    memcpy(pIndexDataBegin + offsetInIndexBuffer, meshFile.indices, addedIndexBytes);
+    INDEX_BUFFER_TYPE* indexData = reinterpret_cast<INDEX_BUFFER_TYPE*>(pIndexDataBegin + offsetInIndexBuffer);
+    mesh.lodIndexCounts[0] = meshFile.indexCount;
+    memcpy(indexData, meshFile.indices, m_geometryBuffer.indexStride * meshFile.indexCount);
+    mesh.lodCount = 1;
+    for (size_t level = 0; level < meshFile.lodCount; level++)
+    {
+        const VertexData::MeshLod& lod = meshFile.lods[level];
+        mesh.lodFirstIndices[mesh.lodCount] = mesh.lodFirstIndices[mesh.lodCount - 1] + mesh.lodIndexCounts[mesh.lodCount - 1];
+        mesh.lodIndexCounts[mesh.lodCount] = lod.indexCount;
+        mesh.lodErrors[mesh.lodCount] = lod.error;
+        memcpy(indexData + mesh.lodFirstIndices[mesh.lodCount], lod.indices, m_geometryBuffer.indexStride * lod.indexCount);
+        mesh.lodCount++;
+    }
     m_geometryBuffer.indexUploadBuffer->Unmap(0, nullptr);
-    m_geometryBuffer.indexCount += meshFile.indexCount;
+    m_geometryBuffer.indexCount += totalIndexCount;
+
+    XMVECTOR boundsMin = g_XMFltMax;
+    XMVECTOR boundsMax = XMVectorNegate(g_XMFltMax);
+    for (size_t i = 0; i < meshFile.vertexCount; i++)
+    {
+        XMVECTOR position = XMLoadFloat3(&packedFile.packedVertices[i].position);
+        boundsMin = XMVectorMin(boundsMin, position);
+        boundsMax = XMVectorMax(boundsMax, position);
+    }
+    XMVECTOR boundsCenter = XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f);
+    XMStoreFloat3(&mesh.boundsCenter, boundsCenter);
+    mesh.boundsRadius = XMVectorGetX(XMVector3Length(XMVectorSubtract(boundsMax, boundsCenter)));
 
     if (m_raytracingSupport)
     {
@@ -1186,7 +1384,7 @@ MeshDataGPU* EngineCore::CreateMesh(VertexData::MeshData& meshFile)
 size_t EngineCore::CreateEntity(MaterialData* material, MeshDataGPU* meshData)
 {
     assert(material != nullptr);
-    EntityData* entity = NewObject(entityDataArena, EntityData);
+    EntityData* entity = NewObjectTagged(entityDataArena, AllocationTag::Entity, EntityData);
     material->entities.newElement() = entity;
     entity->entityIndex = material->entities.size - 1;
     entity->material = material;
@@ -1249,8 +1447,11 @@ void EngineCore::BuildTopLevelAccelerationStructure(ID3D12GraphicsCommandList4*
     ID3D12Device5* dxrDevice = nullptr;
     ThrowIfFailed(m_device->QueryInterface(IID_PPV_ARGS(&dxrDevice)));
 
+    // Instance descs are copied into an upload buffer below, no need to keep them around
+    ArenaScope scratch{ GetScratchArena() };
+
     assert(D3D12_RAYTRACING_INSTANCE_DESCS_BYTE_ALIGNMENT == 16);
-    D3D12_RAYTRACING_INSTANCE_DESC* instanceDescData = NewArray(frameArena, D3D12_RAYTRACING_INSTANCE_DESC, entityDataArena.Count());
+    D3D12_RAYTRACING_INSTANCE_DESC* instanceDescData = NewArray(scratch.arena, D3D12_RAYTRACING_INSTANCE_DESC, entityDataArena.Count());
     size_t instanceCount = 0;
     for (EntityData& entity : entityDataArena)
     {
@@ -1312,11 +1513,17 @@ void EngineCore::ResetVertexBuffer()
 {
     m_geometryBuffer.indexCount = 0;
     m_geometryBuffer.vertexCount = 0;
-    m_geometryBuffer.vertexStride = sizeof(VertexData::Vertex);
+    m_geometryBuffer.vertexStride = sizeof(VertexData::PackedVertex);
+    m_geometryBuffer.sharedBytes = 0;
+    m_meshRegistry.clear();
 }
 
 void EngineCore::UploadVertices()
 {
+    LOG("Uploading {:.2f} MB of geometry, sharing identical meshes saved {:.2f} MB",
+        (m_geometryBuffer.vertexCount * m_geometryBuffer.vertexStride + m_geometryBuffer.indexCount * m_geometryBuffer.indexStride) / (1024.f * 1024.f),
+        m_geometryBuffer.sharedBytes / (1024.f * 1024.f));
+
     CD3DX12_RESOURCE_BARRIER transitions[2] = {};
 
     m_uploadCommandList->CopyResource(m_geometryBuffer.vertexBuffer, m_geometryBuffer.vertexUploadBuffer);
@@ -1382,8 +1589,16 @@ void EngineCore::OnUpdate()
     if (m_resetLevel)
     {
         m_resetLevel = false;
+        m_restoreLevel = false;
         ResetLevelData();
     }
+    else if (m_restoreLevel)
+    {
+        m_restoreLevel = false;
+        BeginProfile("Restore Level", ImColor::HSV(.9f, .5f, 1.f));
+        RestoreLevelSnapshot();
+        EndProfile("Restore Level");
+    }
 }
 
 void EngineCore::OnRender()
@@ -1418,8 +1633,6 @@ void EngineCore::OnRender()
     EndProfile("Frame Fence");
 
     //RunComputeShaderPostPass();
-
-    frameArena.Reset();
 }
 
 void EngineCore::ExecCommandList(ID3D12GraphicsCommandList* commandList)
@@ -1815,7 +2028,8 @@ void EngineCore::RenderGBuffer(ID3D12GraphicsCommandList4* renderList)
             renderList->IASetIndexBuffer(&entity->meshData->indexBufferView);
             renderList->SetGraphicsRootDescriptorTable(ENTITY, entity->constantBuffer.handles[m_frameIndex].gpuHandle);
             renderList->SetGraphicsRootDescriptorTable(BONES, entity->boneConstantBuffer.handles[m_frameIndex].gpuHandle);
-            renderList->DrawIndexedInstanced(entity->meshData->indexBufferView.SizeInBytes / sizeof(INDEX_BUFFER_TYPE), 1, 0, 0, 0);
+            const size_t lod = SelectLod(entity, mainCamera);
+            renderList->DrawIndexedInstanced(entity->meshData->lodIndexCounts[lod], 1, entity->meshData->lodFirstIndices[lod], 0, 0);
         }
     }
 
@@ -1849,7 +2063,7 @@ void EngineCore::RenderPortalStencil(ID3D12GraphicsCommandList4* renderList, D3D
     renderList->OMSetStencilRef(0xFF);
 
     renderList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
-    renderList->DrawIndexedInstanced(entity->meshData->indexBufferView.SizeInBytes / sizeof(INDEX_BUFFER_TYPE), 1, 0, 0, 0);
+    renderList->DrawIndexedInstanced(entity->meshData->lodIndexCounts[0], 1, 0, 0, 0);
 }
 
 void EngineCore::RaytraceShadows(ID3D12GraphicsCommandList4* renderList)
@@ -1919,7 +2133,9 @@ void EngineCore::RenderShadows(ID3D12GraphicsCommandList* renderList)
             renderList->IASetIndexBuffer(&entity->meshData->indexBufferView);
             renderList->SetGraphicsRootDescriptorTable(ENTITY, entity->constantBuffer.handles[m_frameIndex].gpuHandle);
             renderList->SetGraphicsRootDescriptorTable(BONES, entity->boneConstantBuffer.handles[m_frameIndex].gpuHandle);
-            renderList->DrawIndexedInstanced(entity->meshData->indexBufferView.SizeInBytes / sizeof(INDEX_BUFFER_TYPE), 1, 0, 0, 0);
+            // Same LOD as the main camera sees, so the geometry never shadows itself differently from how it looks
+            const size_t lod = SelectLod(entity, mainCamera);
+            renderList->DrawIndexedInstanced(entity->meshData->lodIndexCounts[lod], 1, entity->meshData->lodFirstIndices[lod], 0, 0);
         }
     }
 
@@ -1998,11 +2214,28 @@ void EngineCore::RenderScene(ID3D12GraphicsCommandList* renderList, D3D12_CPU_DE
             {
                 renderList->SetGraphicsRoot32BitConstants(DEFAULT_ROOT_SIG_COUNT + data.pipeline->textureSlotCount, data.rootConstants.size, &data.rootConstantData, 0);
             }
-            renderList->DrawIndexedInstanced(entity->meshData->indexBufferView.SizeInBytes / sizeof(INDEX_BUFFER_TYPE), 1 + data.shellCount, 0, 0, 0);
+            const size_t lod = SelectLod(entity, camera);
+            renderList->DrawIndexedInstanced(entity->meshData->lodIndexCounts[lod], 1 + data.shellCount, entity->meshData->lodFirstIndices[lod], 0, 0);
         }
     }
 }
 
+size_t EngineCore::SelectLod(const EntityData* entity, const CameraData* camera)
+{
+    const MeshDataGPU* mesh = entity->meshData;
+    if (mesh->lodCount <= 1) return 0;
+
+    // Closest point of the bounding sphere, so no part of the mesh gets a coarser LOD than it should
+    XMMATRIX world = XMMatrixTranspose(entity->constantBuffer.data.worldTransform);
+    float scale = std::max({ XMVectorGetX(XMVector3Length(world.r[0])), XMVectorGetX(XMVector3Length(world.r[1])), XMVectorGetX(XMVector3Length(world.r[2])) });
+    XMVECTOR center = XMVector3Transform(XMLoadFloat3(&mesh->boundsCenter), world);
+    float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(center, camera->worldMatrix.translation))) - mesh->boundsRadius * scale;
+    if (distance <= camera->nearClip) return 0;
+
+    float projectionScale = XMVectorGetY(camera->constantBuffer.data.cameraProjection.r[1]);
+    return ::SelectLod(mesh->lodErrors, mesh->lodCount, GetLodPixelsPerUnit(distance, projectionScale, static_cast<float>(m_height)) * scale);
+}
+
 void EngineCore::RenderWireframe(ID3D12GraphicsCommandList* renderList, D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle, D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle, CameraData* camera)
 {
     // Set necessary state.
@@ -2035,7 +2268,7 @@ void EngineCore::RenderWireframe(ID3D12GraphicsCommandList* renderList, D3D12_CP
                 renderList->IASetIndexBuffer(&entity->meshData->indexBufferView);
                 renderList->SetGraphicsRootDescriptorTable(ENTITY, entity->constantBuffer.handles[m_frameIndex].gpuHandle);
                 renderList->SetGraphicsRootDescriptorTable(BONES, entity->boneConstantBuffer.handles[m_frameIndex].gpuHandle);
-                renderList->DrawIndexedInstanced(entity->meshData->indexBufferView.SizeInBytes / sizeof(INDEX_BUFFER_TYPE), 1, 0, 0, 0);
+                renderList->DrawIndexedInstanced(entity->meshData->lodIndexCounts[0], 1, 0, 0, 0);
             }
         }
     }
@@ -2058,6 +2291,13 @@ void EngineCore::RenderDebugLines(ID3D12GraphicsCommandList* renderList, D3D12_C
 
     renderList->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
 
+    // Grow the upload buffer if the lines don't fit anymore, the old one might still be in use by previous frames
+    if (m_debugLineData.lineVertices.size > m_debugLineData.vertexBufferCapacity)
+    {
+        WaitForGpu();
+        CreateDebugLineBuffer(std::max(m_debugLineData.vertexBufferCapacity * 2, m_debugLineData.lineVertices.size));
+    }
+
     // Upload lines for current frame to lineVertexBuffer
     UINT8* pVertexDataBegin = nullptr;
     CD3DX12_RANGE readRange(0, 0);
@@ -2072,6 +2312,20 @@ void EngineCore::RenderDebugLines(ID3D12GraphicsCommandList* renderList, D3D12_C
 	renderList->DrawInstanced(m_debugLineData.lineVertices.size, 1, 0, 0);
 }
 
+void EngineCore::CreateDebugLineBuffer(size_t vertexCapacity)
+{
+    CD3DX12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+    CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(vertexCapacity * sizeof(VertexData::Vertex));
+    ThrowIfFailed(m_device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, NewComObjectReplace(comPointers, &m_debugLineData.vertexBuffer)));
+    m_debugLineData.vertexBuffer->SetName(L"Debug Line Vertex Buffer");
+    m_debugLineData.vertexBufferCapacity = vertexCapacity;
+
+    m_debugLineData.vertexBufferView = {};
+    m_debugLineData.vertexBufferView.BufferLocation = m_debugLineData.vertexBuffer->GetGPUVirtualAddress();
+    m_debugLineData.vertexBufferView.StrideInBytes = sizeof(VertexData::Vertex);
+    m_debugLineData.vertexBufferView.SizeInBytes = vertexCapacity * sizeof(VertexData::Vertex);
+}
+
 // Wait for pending GPU work to complete.
 void EngineCore::WaitForGpu()
 {
@@ -2092,6 +2346,7 @@ void EngineCore::MoveToNextFrame()
     // Schedule a Signal command in the queue.
     const UINT64 currentFenceValue = m_fenceValues[m_frameIndex];
     ThrowIfFailed(m_commandQueue->Signal(m_fence, currentFenceValue));
+    frameArenas.EndFrame(currentFenceValue);
 
     // Update the frame index.
     m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
@@ -2103,6 +2358,7 @@ void EngineCore::MoveToNextFrame()
         ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValues[m_frameIndex], m_fenceEvent));
         WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
     }
+    frameArenas.BeginFrame(m_frameIndex, m_fence->GetCompletedValue());
 
     // Set the fence value for the next frame.
     m_fenceValues[m_frameIndex] = currentFenceValue + 1;
@@ -2174,12 +2430,18 @@ void EngineCore::OnShaderReload()
 
 void EngineCore::OnDestroy()
 {
+    if (!m_memoryReportPath.empty() && !WriteArenaStatsJson(m_memoryReportPath.c_str(), m_arenas.base, m_arenas.size))
+    {
+        ERR("Failed to write memory report to {}", m_memoryReportPath);
+    }
+
     WaitForGpu();
     m_wantedWindowMode = WindowMode::Windowed;
     ApplyWindowMode();
     CloseHandle(m_fenceEvent);
 
     m_imgui.DestroyImgui();
+    ReleaseCookedMeshes();
 
     comPointersLevel.Clear();
     comPointersTextureUpload.Clear();
@@ -2205,16 +2467,17 @@ void EngineCore::CheckTearingSupport()
 #endif
 }
 
-void EngineCore::BeginProfile(std::string name, ImColor color)
+void EngineCore::BeginProfile(Name name, ImColor color)
 {
-    m_profilerTaskData.emplace_back(TimeSinceFrameStart(), 0, name, color);
-    m_profilerTasks.emplace(name, m_profilerTaskData.size() - 1);
+    m_profilerTaskData.emplace_back(TimeSinceFrameStart(), 0, name.c_str(), color);
+    m_profilerTasks.insert(name, m_profilerTaskData.size() - 1);
 }
 
-void EngineCore::EndProfile(std::string name)
+void EngineCore::EndProfile(Name name)
 {
-    assert(m_profilerTasks.contains(name));
-    m_profilerTaskData[m_profilerTasks[name]].endTime = TimeSinceFrameStart();
+    size_t* taskIndex = m_profilerTasks.find(name);
+    assert(taskIndex != nullptr);
+    m_profilerTaskData[*taskIndex].endTime = TimeSinceFrameStart();
 }
 
 double EngineCore::TimeSinceStart()
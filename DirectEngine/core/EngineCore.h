@@ -3,6 +3,7 @@
 #define WIN32_LEAN_AND_MEAN
 #include "Windows.h"
 #include "ComStack.h"
+#include "HashMap.h"
 
 #include <d3d12.h>
 #include <d3dx12.h>
@@ -167,6 +168,18 @@ struct MeshDataGPU
     D3D12_RAYTRACING_GEOMETRY_DESC geometryDesc = {};
     ID3D12Resource* bottomLevelAccelerationStructure = {};
     ID3D12Resource* scratchResource = {};
+    // HashMeshContent of the mesh it was created from, the sizes have to match as well before another mesh shares this one
+    uint64_t contentHash = 0;
+    size_t contentVertexBytes = 0;
+    size_t contentIndexBytes = 0;
+    // LOD 0 is the full mesh, every level uses the same vertices and its indices follow the previous one in the index buffer
+    uint32_t lodFirstIndices[MAX_MESH_LODS] = {};
+    uint32_t lodIndexCounts[MAX_MESH_LODS] = {};
+    float lodErrors[MAX_MESH_LODS] = {};
+    size_t lodCount = 0;
+    // Mesh space bounding sphere for LOD selection
+    XMFLOAT3 boundsCenter = {};
+    float boundsRadius = 0.f;
 };
 
 struct EntityData
@@ -183,6 +196,29 @@ struct EntityData
     MeshDataGPU* meshData;
 };
 
+/// <summary>
+/// Level state right after loading. Restoring it copies the arenas back in place and rolls the engine tables
+/// back to their old sizes, so a level reset doesn't have to load anything again.
+/// </summary>
+struct LevelSnapshot
+{
+    struct Arena
+    {
+        MemoryArena* arena = nullptr;
+        ArenaSnapshot snapshot{};
+    };
+
+    bool valid = false;
+    StackArray<Arena, MAX_SNAPSHOT_ARENAS> arenas{};
+    size_t meshCount = 0;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    size_t comPointerCount = 0;
+    size_t materialCount = 0;
+    size_t* materialEntityCounts = nullptr;
+    EntityData** materialEntities = nullptr;
+};
+
 struct GeometryBuffer
 {
     size_t vertexCount = 0;
@@ -195,15 +231,16 @@ struct GeometryBuffer
     size_t indexStride = sizeof(INDEX_BUFFER_FORMAT);
     ID3D12Resource* indexUploadBuffer = nullptr;
     ID3D12Resource* indexBuffer = nullptr;
+    // Bytes CreateMesh didn't have to upload because an identical mesh was already there
+    size_t sharedBytes = 0;
 };
 
 class DebugLineData
 {
 public:
-    DebugLineData(MemoryArena& arena) : lineVertices(arena, MAX_DEBUG_LINE_VERTICES) {}
-
-    ArenaArray<VertexData::Vertex> lineVertices;
+    ArenaVector<VertexData::Vertex> lineVertices{};
     ID3D12Resource* vertexBuffer = nullptr;
+    size_t vertexBufferCapacity = 0;
     D3D12_VERTEX_BUFFER_VIEW vertexBufferView = {};
 
     void AddLine(XMVECTOR startPos, XMVECTOR endPos, XMVECTOR startColor = { 1., 1., 1., 1. }, XMVECTOR endColor = { 1., 1., 1., 1. })
@@ -246,7 +283,7 @@ struct CameraData
     float nearClip = .1f;
     float farClip = 100.f;
     bool skipRenderTextures = false;
-    FixedStr name = "Camera";
+    Name name = "Camera";
 
     void UpdateViewMatrix(MAT_RMAJ& cameraEntityWorldMatrix)
     {
@@ -396,6 +433,7 @@ public:
     bool m_gameStarted = false;
     bool m_quit = false;
     bool m_resetLevel = false;
+    bool m_restoreLevel = false;
 
     ComStack comPointers = {};
     ComStack comPointersSizeDependent = {};
@@ -403,9 +441,13 @@ public:
     ComStack comPointersLevel = {};
     MemoryArena engineArena = {};
     MemoryArena configArena = {};
-    MemoryArena levelArena = {};
-    MemoryArena frameArena = {};
+    MemoryArena levelArena{ ARENA_DEFAULT_CAPACITY, false, ArenaBacking::CommitAhead, true }; // Single threaded, loader workers allocate from their scratch arenas and the results get copied in on the calling thread
+    FrameArenaRing<FrameCount> frameArenas = {}; // Current() stays valid until the GPU finished the frame
+    MemoryArena snapshotArena = {};
     TypedMemoryArena<EntityData> entityDataArena = {};
+    ArenaArray<const MemoryArena*> m_arenas{ engineArena, MAX_TRACKED_ARENAS }; // Everything the memory window and report show
+    LevelSnapshot m_levelSnapshot{};
+    std::string m_memoryReportPath{}; // Arena stats get written here on shutdown if set, UTF-8
 
     // Window Handle
     HWND m_hwnd;
@@ -463,11 +505,14 @@ public:
     GBuffer* m_gBuffer = nullptr;
     ID3D12Resource* m_textureUploadHeaps[MAX_TEXTURES] = {};
     size_t m_textureUploadIndex = 0;
+    std::vector<D3D12_SUBRESOURCE_DATA> m_textureSubresources = {};
     GeometryBuffer m_geometryBuffer = {};
     ArenaArray<MaterialData> m_materials = { engineArena, MAX_MATERIALS };
     ArenaArray<TextureGPU> m_textures = { engineArena, MAX_TEXTURES };
     ArenaArray<CameraData> m_cameras = { engineArena, MAX_CAMERAS };
-    ArenaArray<MeshDataGPU> m_meshes = { engineArena, MAX_MESHES };
+    ArenaVector<MeshDataGPU> m_meshes{};
+    // Content hash -> index in m_meshes, identical meshes share one upload
+    ArenaHashMap<uint64_t, size_t> m_meshRegistry{ engineArena, MAX_MESHES };
 
     ImGuiUI m_imgui = {};
     CameraData* mainCamera = nullptr;
@@ -517,9 +562,9 @@ public:
     // Debug stuff
     std::string m_shaderError = {};
     std::vector<legit::ProfilerTask> m_profilerTaskData{};
-    std::unordered_map<std::string, size_t> m_profilerTasks{};
+    ArenaHashMap<Name, size_t> m_profilerTasks{ engineArena, 256 };
     bool m_inUpdate = false;
-    DebugLineData m_debugLineData{ engineArena };
+    DebugLineData m_debugLineData{};
 
     const float m_renderTargetClearColor[4] = {0.0f, 0.0f, 0.0f, 0.0f};
     
@@ -547,6 +592,10 @@ public:
     void SerializeAndCreateRaytracingRootSignature(D3D12_ROOT_SIGNATURE_DESC& desc, ID3D12RootSignature** rootSig);
     void LoadRaytracingShaderTables(ID3D12StateObject* dxrStateObject, const wchar_t* raygenShaderName, const wchar_t* missShaderName, const wchar_t* hitGroupShaderName);
     void ResetLevelData();
+    // Game owned arenas show up in the memory window and the shutdown report next to the engine ones
+    void RegisterArena(const MemoryArena& arena);
+    void TakeLevelSnapshot(MemoryArena* const* gameArenas, size_t gameArenaCount);
+    void RestoreLevelSnapshot();
     CameraData* CreateCamera();
     CD3DX12_CPU_DESCRIPTOR_HANDLE CreateDepthStencilView(UINT width, UINT height, ComStack& comStack, ID3D12Resource** bufferTarget, int fixedOffset = -1, UINT sampleCount = 1);
     HRESULT CreatePipeline(PipelineConfig* config, size_t constantBufferCount, size_t rootConstantCount);
@@ -555,7 +604,7 @@ public:
     void CreateGBuffer(UINT width, UINT height, GBuffer& gBuffer, DXGI_FORMAT textureFormat);
     void CreateEmptyTexture(int width, int height, const std::string& name, TextureGPU& texture, const IID& riidTexture, void** ppvTexture, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
     void CreateEmptyUAV(int width, int height, const std::string& name, TextureGPU& texture, const IID& riidBuffer, void** ppvBuffer, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
-    TextureGPU* CreateTexture(const std::string& filePath, bool isSRGB);
+    TextureGPU* CreateTexture(const char* filePath, bool isSRGB);
     void UploadTexture(TextureGPU& targetTexture, std::vector<D3D12_SUBRESOURCE_DATA>& subresources, bool isSRGB, bool isCubemap = false);
     MaterialData* CreateMaterial(const std::string& shaderName, const std::vector<TextureGPU*>& textures = {}, const std::vector<RootConstantInfo>& rootConstants = {}, const D3D12_RASTERIZER_DESC& rasterizerDesc = CD3DX12_RASTERIZER_DESC{ D3D12_DEFAULT });
     MeshDataGPU* CreateMesh(VertexData::MeshData& meshFile);
@@ -574,6 +623,8 @@ public:
     void RenderScene(ID3D12GraphicsCommandList* renderList, D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle, D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle, CameraData* camera, bool useVariant);
     void RenderWireframe(ID3D12GraphicsCommandList* renderList, D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle, D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle, CameraData* camera);
     void RenderDebugLines(ID3D12GraphicsCommandList* renderList, D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle, D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle, CameraData* camera);
+    void CreateDebugLineBuffer(size_t vertexCapacity);
+    size_t SelectLod(const EntityData* entity, const CameraData* camera);
     void ExecCommandList(ID3D12GraphicsCommandList* commandList);
     void PopulateCommandList();
     void MoveToNextFrame();
@@ -581,8 +632,8 @@ public:
     void CheckTearingSupport();
     void ToggleWindowMode();
     void ApplyWindowMode();
-    void BeginProfile(std::string name, ImColor color);
-    void EndProfile(std::string name);
+    void BeginProfile(Name name, ImColor color);
+    void EndProfile(Name name);
     double TimeSinceStart();
     double TimeSinceFrameStart();
 
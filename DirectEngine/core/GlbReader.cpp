@@ -0,0 +1,977 @@
+#include "GlbReader.h"
+#include "../Helpers.h"
+#include "../core/Log.h"
+#include "../core/MeshoptDecoder.h"
+
+#include <charconv>
+#include <cstdint>
+
+namespace
+{
+	struct GlbHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t length;
+	};
+
+	struct GlbChunkHeader
+	{
+		uint32_t length;
+		uint32_t type;
+	};
+
+	// EXT_meshopt_compression data of a buffer view, the view itself then usually points into a fallback buffer without data
+	struct GltfMeshoptSource
+	{
+		bool compressed = false;
+		int32_t buffer = 0;
+		size_t byteOffset = 0;
+		size_t byteLength = 0;
+		size_t byteStride = 0;
+		size_t count = 0;
+		MeshoptMode mode = MeshoptMode::Attributes;
+		MeshoptFilter filter = MeshoptFilter::None;
+		bool valid = true;
+	};
+
+	struct GltfBufferView
+	{
+		int32_t buffer = 0;
+		size_t byteOffset = 0;
+		size_t byteLength = 0;
+		size_t byteStride = 0;
+		GltfMeshoptSource meshopt;
+		// Where the view's bytes are once it's resolved, the BIN chunk or decompressed data in the arena
+		const uint8_t* data = nullptr;
+	};
+
+	struct GltfBuffer
+	{
+		bool external = false;
+		// Only there as a placeholder for EXT_meshopt_compression views, it has no data of its own
+		bool meshoptFallback = false;
+	};
+
+	// Where an accessor's data lives, only needed until the buffer views are parsed too
+	struct GltfAccessorSource
+	{
+		int32_t bufferView = -1;
+		size_t byteOffset = 0;
+		bool sparse = false;
+	};
+
+	// Forward only cursor over the JSON chunk. Every Read function consumes exactly one value,
+	// errors stop the whole parse so callers only have to check failed at the end
+	struct JsonReader
+	{
+		const char* cursor;
+		const char* end;
+		MemoryArena& arena;
+		bool failed = false;
+		// Where parsing stopped, for the error message
+		const char* failedAt = nullptr;
+
+		JsonReader(std::string_view text, MemoryArena& arena) : cursor(text.data()), end(text.data() + text.size()), arena(arena) {}
+
+		void Fail()
+		{
+			if (!failed)
+			{
+				failed = true;
+				failedAt = cursor;
+			}
+			cursor = end;
+		}
+
+		char Peek()
+		{
+			while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r'))
+			{
+				cursor++;
+			}
+			return cursor < end ? *cursor : '\0';
+		}
+
+		void Expect(char c)
+		{
+			if (Peek() == c)
+			{
+				cursor++;
+			}
+			else
+			{
+				Fail();
+			}
+		}
+
+		// Strings without escapes point into the file, the rest get decoded into the arena
+		std::string_view ReadString()
+		{
+			Expect('"');
+			const char* start = cursor;
+			bool escaped = false;
+			while (cursor < end && *cursor != '"')
+			{
+				if (*cursor == '\\')
+				{
+					escaped = true;
+					cursor++;
+				}
+				cursor++;
+			}
+			if (cursor >= end)
+			{
+				Fail();
+				return {};
+			}
+			std::string_view raw{ start, static_cast<size_t>(cursor - start) };
+			cursor++;
+			return escaped ? Unescape(raw) : raw;
+		}
+
+		std::string_view Unescape(std::string_view raw)
+		{
+			// Escapes never get longer when decoded, \uXXXX is at most 3 bytes of UTF-8 and a surrogate pair 4 for 12 characters
+			char* decoded = NewArray(arena, char, raw.size());
+			size_t length = 0;
+			for (size_t i = 0; i < raw.size(); i++)
+			{
+				if (raw[i] != '\\')
+				{
+					decoded[length++] = raw[i];
+					continue;
+				}
+
+				i++;
+				switch (raw[i])
+				{
+				case 'b': decoded[length++] = '\b'; break;
+				case 'f': decoded[length++] = '\f'; break;
+				case 'n': decoded[length++] = '\n'; break;
+				case 'r': decoded[length++] = '\r'; break;
+				case 't': decoded[length++] = '\t'; break;
+				case 'u':
+				{
+					uint32_t codePoint = ReadHex(raw, i + 1);
+					i += 4;
+					if (codePoint >= 0xd800 && codePoint < 0xdc00 && i + 6 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u')
+					{
+						const uint32_t low = ReadHex(raw, i + 3);
+						if (low >= 0xdc00 && low < 0xe000)
+						{
+							codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+							i += 6;
+						}
+					}
+					length += EncodeUtf8(codePoint, &decoded[length]);
+					break;
+				}
+				default: decoded[length++] = raw[i]; break;
+				}
+			}
+			return { decoded, length };
+		}
+
+		uint32_t ReadHex(std::string_view raw, size_t start)
+		{
+			uint32_t value = 0;
+			if (start + 4 > raw.size() || std::from_chars(&raw[start], &raw[start] + 4, value, 16).ptr != &raw[start] + 4)
+			{
+				Fail();
+				return 0;
+			}
+			return value;
+		}
+
+		static size_t EncodeUtf8(uint32_t codePoint, char* destination)
+		{
+			if (codePoint < 0x80)
+			{
+				destination[0] = static_cast<char>(codePoint);
+				return 1;
+			}
+			if (codePoint < 0x800)
+			{
+				destination[0] = static_cast<char>(0xc0 | (codePoint >> 6));
+				destination[1] = static_cast<char>(0x80 | (codePoint & 0x3f));
+				return 2;
+			}
+			if (codePoint < 0x10000)
+			{
+				destination[0] = static_cast<char>(0xe0 | (codePoint >> 12));
+				destination[1] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+				destination[2] = static_cast<char>(0x80 | (codePoint & 0x3f));
+				return 3;
+			}
+			destination[0] = static_cast<char>(0xf0 | (codePoint >> 18));
+			destination[1] = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+			destination[2] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+			destination[3] = static_cast<char>(0x80 | (codePoint & 0x3f));
+			return 4;
+		}
+
+		double ReadNumber()
+		{
+			Peek();
+			double value = 0.;
+			const std::from_chars_result parsed = std::from_chars(cursor, end, value);
+			if (parsed.ec != std::errc{})
+			{
+				Fail();
+				return 0.;
+			}
+			cursor = parsed.ptr;
+			return value;
+		}
+
+		int32_t ReadInt()
+		{
+			const double value = ReadNumber();
+			if (value < INT32_MIN || value > INT32_MAX || value != static_cast<int32_t>(value))
+			{
+				Fail();
+				return -1;
+			}
+			return static_cast<int32_t>(value);
+		}
+
+		size_t ReadSize()
+		{
+			const double value = ReadNumber();
+			if (value < 0. || value != static_cast<double>(static_cast<size_t>(value)))
+			{
+				Fail();
+				return 0;
+			}
+			return static_cast<size_t>(value);
+		}
+
+		bool ReadBool()
+		{
+			const char c = Peek();
+			const std::string_view literal = c == 't' ? "true" : "false";
+			if (static_cast<size_t>(end - cursor) < literal.size() || std::string_view{ cursor, literal.size() } != literal)
+			{
+				Fail();
+				return false;
+			}
+			cursor += literal.size();
+			return c == 't';
+		}
+
+		void ReadFloats(float* values, size_t count)
+		{
+			ReadArray([&](size_t i)
+			{
+				const float value = static_cast<float>(ReadNumber());
+				if (i < count)
+				{
+					values[i] = value;
+				}
+			});
+		}
+
+		// onMember gets the key and has to consume the value
+		template <typename OnMember>
+		void ReadObject(OnMember onMember)
+		{
+			Expect('{');
+			if (Peek() == '}')
+			{
+				cursor++;
+				return;
+			}
+			while (!failed)
+			{
+				const std::string_view key = ReadString();
+				Expect(':');
+				onMember(key);
+				if (Peek() == ',')
+				{
+					cursor++;
+					continue;
+				}
+				Expect('}');
+				break;
+			}
+		}
+
+		// onElement gets the index and has to consume the value
+		template <typename OnElement>
+		void ReadArray(OnElement onElement)
+		{
+			Expect('[');
+			if (Peek() == ']')
+			{
+				cursor++;
+				return;
+			}
+			for (size_t i = 0; !failed; i++)
+			{
+				onElement(i);
+				if (Peek() == ',')
+				{
+					cursor++;
+					continue;
+				}
+				Expect(']');
+				break;
+			}
+		}
+
+		void SkipValue()
+		{
+			switch (Peek())
+			{
+			case '{': ReadObject([&](std::string_view) { SkipValue(); }); break;
+			case '[': ReadArray([&](size_t) { SkipValue(); }); break;
+			case '"': SkipString(); break;
+			case 't':
+			case 'f': ReadBool(); break;
+			case 'n':
+				if (static_cast<size_t>(end - cursor) >= 4 && std::string_view{ cursor, 4 } == "null")
+				{
+					cursor += 4;
+				}
+				else
+				{
+					Fail();
+				}
+				break;
+			default: ReadNumber(); break;
+			}
+		}
+
+		void SkipString()
+		{
+			Expect('"');
+			while (cursor < end && *cursor != '"')
+			{
+				cursor += *cursor == '\\' ? 2 : 1;
+			}
+			Expect('"');
+		}
+
+		// Counts the elements of the array at the cursor without consuming it, so arrays can be allocated at their final size
+		size_t CountArray()
+		{
+			const char* start = cursor;
+			size_t count = 0;
+			ReadArray([&](size_t) { SkipValue(); count++; });
+			if (!failed)
+			{
+				cursor = start;
+			}
+			return count;
+		}
+
+		template <typename T, typename ReadElement>
+		T* ReadArrayOf(size_t& count, ReadElement readElement)
+		{
+			count = CountArray();
+			T* elements = NewArray(arena, T, count);
+			ReadArray([&](size_t i) { readElement(elements[i]); });
+			return elements;
+		}
+
+		int32_t* ReadIndices(size_t& count)
+		{
+			return ReadArrayOf<int32_t>(count, [&](int32_t& index) { index = ReadInt(); });
+		}
+	};
+
+	uint32_t GetComponentCount(std::string_view type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		if (type == "MAT2") return 4;
+		if (type == "MAT3") return 9;
+		if (type == "MAT4") return 16;
+		return 0;
+	}
+
+	size_t GetComponentSize(uint32_t componentType)
+	{
+		switch (componentType)
+		{
+		case GLTF_BYTE:
+		case GLTF_UNSIGNED_BYTE: return 1;
+		case GLTF_SHORT:
+		case GLTF_UNSIGNED_SHORT: return 2;
+		case GLTF_UNSIGNED_INT:
+		case GLTF_FLOAT: return 4;
+		default: return 0;
+		}
+	}
+
+	GltfAttribute GetAttribute(std::string_view name)
+	{
+		if (name == GLTF_POSITION) return GltfAttribute::Position;
+		if (name == GLTF_NORMAL) return GltfAttribute::Normal;
+		if (name == GLTF_TANGENT) return GltfAttribute::Tangent;
+		if (name == GLTF_TEXCOORD0) return GltfAttribute::TexCoord0;
+		if (name == GLTF_JOINTS) return GltfAttribute::Joints0;
+		if (name == GLTF_WEIGHTS) return GltfAttribute::Weights0;
+		return GltfAttribute::Count;
+	}
+
+	GltfAnimationPath GetAnimationPath(std::string_view path)
+	{
+		if (path == "translation") return GltfAnimationPath::Translation;
+		if (path == "rotation") return GltfAnimationPath::Rotation;
+		if (path == "scale") return GltfAnimationPath::Scale;
+		return GltfAnimationPath::Unknown;
+	}
+
+	bool IsValidIndex(int32_t index, size_t count, bool optional = true)
+	{
+		return (optional && index == -1) || (index >= 0 && static_cast<size_t>(index) < count);
+	}
+
+	MeshoptMode GetMeshoptMode(std::string_view mode, bool& valid)
+	{
+		if (mode == "ATTRIBUTES") return MeshoptMode::Attributes;
+		if (mode == "TRIANGLES") return MeshoptMode::Triangles;
+		if (mode == "INDICES") return MeshoptMode::Indices;
+		valid = false;
+		return MeshoptMode::Attributes;
+	}
+
+	MeshoptFilter GetMeshoptFilter(std::string_view filter, bool& valid)
+	{
+		if (filter == "NONE") return MeshoptFilter::None;
+		if (filter == "OCTAHEDRAL") return MeshoptFilter::Octahedral;
+		if (filter == "QUATERNION") return MeshoptFilter::Quaternion;
+		if (filter == "EXPONENTIAL") return MeshoptFilter::Exponential;
+		valid = false;
+		return MeshoptFilter::None;
+	}
+
+	bool IsSupportedExtension(std::string_view extension)
+	{
+		return extension == "KHR_mesh_quantization" || extension == "EXT_meshopt_compression";
+	}
+
+	struct GltfJson
+	{
+		GltfAccessorSource* accessorSources = nullptr;
+		GltfBufferView* bufferViews = nullptr;
+		size_t bufferViewCount = 0;
+		GltfBuffer* buffers = nullptr;
+		size_t bufferCount = 0;
+		std::string_view unsupportedExtension;
+	};
+
+	void ReadAccessor(JsonReader& json, GltfAccessor& accessor, GltfAccessorSource& source)
+	{
+		json.ReadObject([&](std::string_view key)
+		{
+			if (key == "bufferView") source.bufferView = json.ReadInt();
+			else if (key == "byteOffset") source.byteOffset = json.ReadSize();
+			else if (key == "componentType") accessor.componentType = static_cast<uint32_t>(json.ReadInt());
+			else if (key == "count") accessor.count = json.ReadSize();
+			else if (key == "type") accessor.componentCount = GetComponentCount(json.ReadString());
+			else if (key == "normalized") accessor.normalized = json.ReadBool();
+			else if (key == "sparse") { source.sparse = true; json.SkipValue(); }
+			else json.SkipValue();
+		});
+	}
+
+	void ReadMeshoptSource(JsonReader& json, GltfMeshoptSource& meshopt)
+	{
+		meshopt.compressed = true;
+		json.ReadObject([&](std::string_view key)
+		{
+			if (key == "buffer") meshopt.buffer = json.ReadInt();
+			else if (key == "byteOffset") meshopt.byteOffset = json.ReadSize();
+			else if (key == "byteLength") meshopt.byteLength = json.ReadSize();
+			else if (key == "byteStride") meshopt.byteStride = json.ReadSize();
+			else if (key == "count") meshopt.count = json.ReadSize();
+			else if (key == "mode") meshopt.mode = GetMeshoptMode(json.ReadString(), meshopt.valid);
+			else if (key == "filter") meshopt.filter = GetMeshoptFilter(json.ReadString(), meshopt.valid);
+			else json.SkipValue();
+		});
+	}
+
+	void ReadBufferView(JsonReader& json, GltfBufferView& bufferView)
+	{
+		json.ReadObject([&](std::string_view key)
+		{
+			if (key == "buffer") bufferView.buffer = json.ReadInt();
+			else if (key == "byteOffset") bufferView.byteOffset = json.ReadSize();
+			else if (key == "byteLength") bufferView.byteLength = json.ReadSize();
+			else if (key == "byteStride") bufferView.byteStride = json.ReadSize();
+			else if (key == "extensions")
+			{
+				json.ReadObject([&](std::string_view extension)
+				{
+					if (extension == "EXT_meshopt_compression") ReadMeshoptSource(json, bufferView.meshopt);
+					else json.SkipValue();
+				});
+			}
+			else json.SkipValue();
+		});
+	}
+
+	void ReadPrimitive(JsonReader& json, GltfPrimitive& primitive)
+	{
+		json.ReadObject([&](std::string_view key)
+		{
+			if (key == "attributes")
+			{
+				json.ReadObject([&](std::string_view name)
+				{
+					const GltfAttribute attribute = GetAttribute(name);
+					const int32_t index = json.ReadInt();
+					if (attribute != GltfAttribute::Count)
+					{
+						primitive.attributes[static_cast<size_t>(attribute)] = index;
+					}
+				});
+			}
+			else if (key == "indices") primitive.indices = json.ReadInt();
+			else if (key == "material") primitive.material = json.ReadInt();
+			else json.SkipValue();
+		});
+	}
+
+	void ReadNode(JsonReader& json, GltfNode& node)
+	{
+		json.ReadObject([&](std::string_view key)
+		{
+			if (key == "name") node.name = json.ReadString();
+			else if (key == "children") node.children = json.ReadIndices(node.childCount);
+			else if (key == "mesh") node.mesh = json.ReadInt();
+			else if (key == "skin") node.skin = json.ReadInt();
+			else if (key == "translation") json.ReadFloats(node.translation, 3);
+			else if (key == "rotation") json.ReadFloats(node.rotation, 4);
+			else if (key == "scale") json.ReadFloats(node.scale, 3);
+			else json.SkipValue();
+		});
+	}
+
+	void ReadSkin(JsonReader& json, GltfSkin& skin)
+	{
+		json.ReadObject([&](std::string_view key)
+		{
+			if (key == "inverseBindMatrices") skin.inverseBindMatrices = json.ReadInt();
+			else if (key == "joints") skin.joints = json.ReadIndices(skin.jointCount);
+			else json.SkipValue();
+		});
+	}
+
+	void ReadAnimation(JsonReader& json, GltfAnimation& animation)
+	{
+		json.ReadObject([&](std::string_view key)
+		{
+			if (key == "name")
+			{
+				animation.name = json.ReadString();
+			}
+			else if (key == "channels")
+			{
+				animation.channels = json.ReadArrayOf<GltfAnimationChannel>(animation.channelCount, [&](GltfAnimationChannel& channel)
+				{
+					json.ReadObject([&](std::string_view channelKey)
+					{
+						if (channelKey == "sampler")
+						{
+							channel.sampler = json.ReadInt();
+						}
+						else if (channelKey == "target")
+						{
+							json.ReadObject([&](std::string_view targetKey)
+							{
+								if (targetKey == "node") channel.targetNode = json.ReadInt();
+								else if (targetKey == "path") channel.path = GetAnimationPath(json.ReadString());
+								else json.SkipValue();
+							});
+						}
+						else
+						{
+							json.SkipValue();
+						}
+					});
+				});
+			}
+			else if (key == "samplers")
+			{
+				animation.samplers = json.ReadArrayOf<GltfAnimationSampler>(animation.samplerCount, [&](GltfAnimationSampler& sampler)
+				{
+					json.ReadObject([&](std::string_view samplerKey)
+					{
+						if (samplerKey == "input") sampler.input = json.ReadInt();
+						else if (samplerKey == "output") sampler.output = json.ReadInt();
+						else if (samplerKey == "interpolation") sampler.interpolation = json.ReadString();
+						else json.SkipValue();
+					});
+				});
+			}
+			else if (key == "extras")
+			{
+				// Custom properties Blender exports, mask is a node name and mainrender only has to exist
+				json.ReadObject([&](std::string_view extraKey)
+				{
+					if (extraKey == "mask" && json.Peek() == '"')
+					{
+						animation.mask = json.ReadString();
+					}
+					else
+					{
+						animation.mainRender |= extraKey == "mainrender";
+						json.SkipValue();
+					}
+				});
+			}
+			else
+			{
+				json.SkipValue();
+			}
+		});
+	}
+
+	void ReadGltfJson(JsonReader& json, GlbFile& file, GltfJson& gltf)
+	{
+		json.ReadObject([&](std::string_view key)
+		{
+			if (key == "accessors")
+			{
+				file.accessorCount = json.CountArray();
+				file.accessors = NewArray(json.arena, GltfAccessor, file.accessorCount);
+				gltf.accessorSources = NewArray(json.arena, GltfAccessorSource, file.accessorCount);
+				json.ReadArray([&](size_t i) { ReadAccessor(json, file.accessors[i], gltf.accessorSources[i]); });
+			}
+			else if (key == "bufferViews")
+			{
+				gltf.bufferViews = json.ReadArrayOf<GltfBufferView>(gltf.bufferViewCount, [&](GltfBufferView& bufferView) { ReadBufferView(json, bufferView); });
+			}
+			else if (key == "buffers")
+			{
+				gltf.buffers = json.ReadArrayOf<GltfBuffer>(gltf.bufferCount, [&](GltfBuffer& buffer)
+				{
+					json.ReadObject([&](std::string_view bufferKey)
+					{
+						if (bufferKey == "uri")
+						{
+							buffer.external = true;
+							json.SkipValue();
+						}
+						else if (bufferKey == "extensions")
+						{
+							json.ReadObject([&](std::string_view extension)
+							{
+								if (extension == "EXT_meshopt_compression")
+								{
+									json.ReadObject([&](std::string_view meshoptKey)
+									{
+										if (meshoptKey == "fallback") buffer.meshoptFallback = json.ReadBool();
+										else json.SkipValue();
+									});
+								}
+								else
+								{
+									json.SkipValue();
+								}
+							});
+						}
+						else
+						{
+							json.SkipValue();
+						}
+					});
+				});
+			}
+			else if (key == "meshes")
+			{
+				file.meshes = json.ReadArrayOf<GltfMesh>(file.meshCount, [&](GltfMesh& mesh)
+				{
+					json.ReadObject([&](std::string_view meshKey)
+					{
+						if (meshKey == "primitives")
+						{
+							mesh.primitives = json.ReadArrayOf<GltfPrimitive>(mesh.primitiveCount, [&](GltfPrimitive& primitive) { ReadPrimitive(json, primitive); });
+						}
+						else
+						{
+							json.SkipValue();
+						}
+					});
+				});
+			}
+			else if (key == "materials")
+			{
+				file.materialNames = json.ReadArrayOf<std::string_view>(file.materialCount, [&](std::string_view& name)
+				{
+					json.ReadObject([&](std::string_view materialKey)
+					{
+						if (materialKey == "name") name = json.ReadString();
+						else json.SkipValue();
+					});
+				});
+			}
+			else if (key == "nodes")
+			{
+				file.nodes = json.ReadArrayOf<GltfNode>(file.nodeCount, [&](GltfNode& node) { ReadNode(json, node); });
+			}
+			else if (key == "skins")
+			{
+				file.skins = json.ReadArrayOf<GltfSkin>(file.skinCount, [&](GltfSkin& skin) { ReadSkin(json, skin); });
+			}
+			else if (key == "animations")
+			{
+				file.animations = json.ReadArrayOf<GltfAnimation>(file.animationCount, [&](GltfAnimation& animation) { ReadAnimation(json, animation); });
+			}
+			else if (key == "extensionsRequired")
+			{
+				json.ReadArray([&](size_t)
+				{
+					const std::string_view extension = json.ReadString();
+					if (!IsSupportedExtension(extension))
+					{
+						gltf.unsupportedExtension = extension;
+					}
+				});
+			}
+			else
+			{
+				json.SkipValue();
+			}
+		});
+	}
+
+	// Points every buffer view at its bytes, views with EXT_meshopt_compression get decompressed into the arena here
+	bool ResolveBufferViews(const GlbFile& file, GltfJson& gltf, MemoryArena& arena, const char* path)
+	{
+		// The BIN chunk is the first buffer, any other buffer can only stand in for compressed views
+		for (size_t i = 0; i < gltf.bufferCount; i++)
+		{
+			if (gltf.buffers[i].external || (i > 0 && !gltf.buffers[i].meshoptFallback))
+			{
+				ERR("{}: only the BIN chunk and EXT_meshopt_compression fallback buffers are supported", path);
+				return false;
+			}
+		}
+
+		for (size_t i = 0; i < gltf.bufferViewCount; i++)
+		{
+			GltfBufferView& bufferView = gltf.bufferViews[i];
+			const GltfMeshoptSource& meshopt = bufferView.meshopt;
+			if (!meshopt.compressed)
+			{
+				if (bufferView.buffer != 0 || bufferView.byteOffset + bufferView.byteLength > file.binSize)
+				{
+					ERR("{}: buffer view {} reads outside of the BIN chunk", path, i);
+					return false;
+				}
+				bufferView.data = file.bin + bufferView.byteOffset;
+				continue;
+			}
+
+			if (!meshopt.valid || meshopt.buffer != 0 || meshopt.byteOffset + meshopt.byteLength > file.binSize || meshopt.count * meshopt.byteStride != bufferView.byteLength)
+			{
+				ERR("{}: buffer view {} has invalid EXT_meshopt_compression data", path, i);
+				return false;
+			}
+			uint8_t* decoded = arena.Allocate<uint8_t>(bufferView.byteLength);
+			if (!DecodeMeshoptBuffer(decoded, meshopt.count, meshopt.byteStride, file.bin + meshopt.byteOffset, meshopt.byteLength, meshopt.mode, meshopt.filter))
+			{
+				ERR("{}: failed to decode EXT_meshopt_compression buffer view {}", path, i);
+				return false;
+			}
+			bufferView.data = decoded;
+		}
+		return true;
+	}
+
+	// Points the accessors into their buffer views, fails if any of them would read outside of it
+	bool ResolveAccessors(GlbFile& file, const GltfJson& gltf, const char* path)
+	{
+		for (size_t i = 0; i < file.accessorCount; i++)
+		{
+			GltfAccessor& accessor = file.accessors[i];
+			const GltfAccessorSource& source = gltf.accessorSources[i];
+			const size_t elementSize = GetAccessorElementSize(accessor);
+			if (elementSize == 0 || source.sparse || !IsValidIndex(source.bufferView, gltf.bufferViewCount, false))
+			{
+				ERR("{}: accessor {} is sparse, has no buffer view or an unknown type", path, i);
+				return false;
+			}
+
+			const GltfBufferView& bufferView = gltf.bufferViews[source.bufferView];
+			accessor.byteStride = bufferView.byteStride != 0 ? bufferView.byteStride : elementSize;
+			const size_t byteLength = accessor.count == 0 ? 0 : source.byteOffset + (accessor.count - 1) * accessor.byteStride + elementSize;
+			if (byteLength > bufferView.byteLength)
+			{
+				ERR("{}: accessor {} reads outside of its buffer view", path, i);
+				return false;
+			}
+			accessor.data = bufferView.data + source.byteOffset;
+		}
+		return true;
+	}
+
+	// Every index the importer follows, so it can use them without checking
+	bool ValidateIndices(const GlbFile& file)
+	{
+		for (size_t i = 0; i < file.meshCount; i++)
+		{
+			for (size_t j = 0; j < file.meshes[i].primitiveCount; j++)
+			{
+				const GltfPrimitive& primitive = file.meshes[i].primitives[j];
+				for (int32_t attribute : primitive.attributes)
+				{
+					if (!IsValidIndex(attribute, file.accessorCount)) return false;
+				}
+				if (!IsValidIndex(primitive.indices, file.accessorCount) || !IsValidIndex(primitive.material, file.materialCount)) return false;
+			}
+		}
+		for (size_t i = 0; i < file.nodeCount; i++)
+		{
+			if (!IsValidIndex(file.nodes[i].mesh, file.meshCount) || !IsValidIndex(file.nodes[i].skin, file.skinCount)) return false;
+			for (size_t j = 0; j < file.nodes[i].childCount; j++)
+			{
+				if (!IsValidIndex(file.nodes[i].children[j], file.nodeCount, false)) return false;
+			}
+		}
+		for (size_t i = 0; i < file.skinCount; i++)
+		{
+			if (!IsValidIndex(file.skins[i].inverseBindMatrices, file.accessorCount)) return false;
+			for (size_t j = 0; j < file.skins[i].jointCount; j++)
+			{
+				if (!IsValidIndex(file.skins[i].joints[j], file.nodeCount, false)) return false;
+			}
+		}
+		for (size_t i = 0; i < file.animationCount; i++)
+		{
+			const GltfAnimation& animation = file.animations[i];
+			for (size_t j = 0; j < animation.channelCount; j++)
+			{
+				const GltfAnimationChannel& channel = animation.channels[j];
+				if (!IsValidIndex(channel.sampler, animation.samplerCount, false) || !IsValidIndex(channel.targetNode, file.nodeCount, false)) return false;
+			}
+			for (size_t j = 0; j < animation.samplerCount; j++)
+			{
+				const GltfAnimationSampler& sampler = animation.samplers[j];
+				if (!IsValidIndex(sampler.input, file.accessorCount, false) || !IsValidIndex(sampler.output, file.accessorCount, false)) return false;
+			}
+		}
+		return true;
+	}
+
+	const uint8_t* MapGlbFile(const char* path, size_t& fileSize)
+	{
+		HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			ERR("Failed to open {}", path);
+			return nullptr;
+		}
+
+		LARGE_INTEGER size{};
+		if (!GetFileSizeEx(file, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(GlbHeader) + sizeof(GlbChunkHeader)))
+		{
+			ERR("{} is too small to be a glb file", path);
+			CloseHandle(file);
+			return nullptr;
+		}
+
+		// The view keeps the file mapped on its own, neither handle is needed afterwards
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		CloseHandle(file);
+		if (mapping == NULL)
+		{
+			ERR("Failed to create file mapping for {}", path);
+			return nullptr;
+		}
+
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (view == nullptr)
+		{
+			ERR("Failed to map {}", path);
+			return nullptr;
+		}
+
+		fileSize = static_cast<size_t>(size.QuadPart);
+		return static_cast<const uint8_t*>(view);
+	}
+}
+
+GlbFile::~GlbFile()
+{
+	if (view != nullptr)
+	{
+		UnmapViewOfFile(view);
+	}
+}
+
+size_t GetAccessorElementSize(const GltfAccessor& accessor)
+{
+	return GetComponentSize(accessor.componentType) * accessor.componentCount;
+}
+
+bool ReadGlbFile(const char* path, GlbFile& file, MemoryArena& arena)
+{
+	file.view = MapGlbFile(path, file.size);
+	if (file.view == nullptr)
+	{
+		return false;
+	}
+
+	GlbHeader header;
+	memcpy(&header, file.view, sizeof(header));
+	GlbChunkHeader jsonChunk;
+	memcpy(&jsonChunk, file.view + sizeof(GlbHeader), sizeof(jsonChunk));
+	const size_t jsonStart = sizeof(GlbHeader) + sizeof(GlbChunkHeader);
+	if (header.magic != GLB_MAGIC || header.version != GLB_VERSION || header.length > file.size ||
+		jsonChunk.type != GLB_CHUNK_JSON || jsonStart + jsonChunk.length > header.length)
+	{
+		ERR("{} is not a version 2 glb file", path);
+		return false;
+	}
+
+	// The BIN chunk is optional and follows the JSON chunk, chunks are 4 byte aligned
+	const size_t binHeaderStart = jsonStart + Align(jsonChunk.length, 4);
+	if (binHeaderStart + sizeof(GlbChunkHeader) <= header.length)
+	{
+		GlbChunkHeader binChunk;
+		memcpy(&binChunk, file.view + binHeaderStart, sizeof(binChunk));
+		const size_t binStart = binHeaderStart + sizeof(GlbChunkHeader);
+		if (binChunk.type == GLB_CHUNK_BIN && binStart + binChunk.length <= header.length)
+		{
+			file.bin = file.view + binStart;
+			file.binSize = binChunk.length;
+		}
+	}
+
+	GltfJson gltf;
+	JsonReader json{ { reinterpret_cast<const char*>(file.view + jsonStart), jsonChunk.length }, arena };
+	ReadGltfJson(json, file, gltf);
+	if (json.failed)
+	{
+		ERR("{}: malformed JSON at byte {}", path, json.failedAt - reinterpret_cast<const char*>(file.view));
+		return false;
+	}
+
+	if (!gltf.unsupportedExtension.empty())
+	{
+		ERR("{}: requires unsupported extension {}", path, gltf.unsupportedExtension);
+		return false;
+	}
+
+	if (!ResolveBufferViews(file, gltf, arena, path) || !ResolveAccessors(file, gltf, path))
+	{
+		return false;
+	}
+
+	if (!ValidateIndices(file))
+	{
+		ERR("{}: index out of range", path);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "Memory.h"
+
+#include <string>
+#include <string_view>
+
+#define GLB_MAGIC 0x46546c67 // "glTF"
+#define GLB_VERSION 2
+#define GLB_CHUNK_JSON 0x4e4f534a // "JSON"
+#define GLB_CHUNK_BIN 0x004e4942 // "BIN\0"
+
+// Component types are the GL enums glTF uses
+#define GLTF_BYTE 5120
+#define GLTF_UNSIGNED_BYTE 5121
+#define GLTF_SHORT 5122
+#define GLTF_UNSIGNED_SHORT 5123
+#define GLTF_UNSIGNED_INT 5125
+#define GLTF_FLOAT 5126
+
+#define GLTF_POSITION "POSITION"
+#define GLTF_NORMAL "NORMAL"
+#define GLTF_TANGENT "TANGENT"
+#define GLTF_TEXCOORD0 "TEXCOORD_0"
+#define GLTF_JOINTS "JOINTS_0"
+#define GLTF_WEIGHTS "WEIGHTS_0"
+
+// The only attributes the importer reads, everything else in a primitive gets skipped
+enum class GltfAttribute
+{
+	Position,
+	Normal,
+	Tangent,
+	TexCoord0,
+	Joints0,
+	Weights0,
+	Count,
+};
+
+enum class GltfAnimationPath
+{
+	Unknown,
+	Translation,
+	Rotation,
+	Scale,
+};
+
+/// <summary>
+/// Typed view into the BIN chunk. Elements are componentCount components of componentType each, byteStride apart.
+/// </summary>
+struct GltfAccessor
+{
+	const uint8_t* data = nullptr;
+	size_t count = 0;
+	size_t byteStride = 0;
+	uint32_t componentType = 0;
+	// 1 for SCALAR up to 16 for MAT4
+	uint32_t componentCount = 0;
+	bool normalized = false;
+};
+
+struct GltfPrimitive
+{
+	// Accessor indices by GltfAttribute, -1 if the primitive doesn't have the attribute
+	int32_t attributes[static_cast<size_t>(GltfAttribute::Count)] = { -1, -1, -1, -1, -1, -1 };
+	int32_t indices = -1;
+	int32_t material = -1;
+};
+
+struct GltfMesh
+{
+	GltfPrimitive* primitives = nullptr;
+	size_t primitiveCount = 0;
+};
+
+struct GltfNode
+{
+	std::string_view name;
+	int32_t* children = nullptr;
+	size_t childCount = 0;
+	int32_t mesh = -1;
+	int32_t skin = -1;
+	float translation[3] = { 0.f, 0.f, 0.f };
+	float rotation[4] = { 0.f, 0.f, 0.f, 1.f };
+	float scale[3] = { 1.f, 1.f, 1.f };
+};
+
+struct GltfSkin
+{
+	int32_t inverseBindMatrices = -1;
+	int32_t* joints = nullptr;
+	size_t jointCount = 0;
+};
+
+struct GltfAnimationSampler
+{
+	int32_t input = -1;
+	int32_t output = -1;
+	std::string_view interpolation = "LINEAR";
+};
+
+struct GltfAnimationChannel
+{
+	int32_t sampler = -1;
+	int32_t targetNode = -1;
+	GltfAnimationPath path = GltfAnimationPath::Unknown;
+};
+
+struct GltfAnimation
+{
+	std::string_view name;
+	GltfAnimationChannel* channels = nullptr;
+	size_t channelCount = 0;
+	GltfAnimationSampler* samplers = nullptr;
+	size_t samplerCount = 0;
+	// From the extras Blender exports custom properties to, empty if there's no mask
+	std::string_view mask;
+	bool mainRender = false;
+};
+
+/// <summary>
+/// Binary glTF mapped into memory with only the parts of the JSON the importer needs parsed.
+/// Accessors point straight into the mapping, or into the arena for compressed buffer views, so they are only valid as long as the GlbFile lives.
+/// Everything else, including unescaped strings, is allocated in the arena passed to ReadGlbFile.
+/// </summary>
+struct GlbFile
+{
+	const uint8_t* view = nullptr;
+	size_t size = 0;
+	const uint8_t* bin = nullptr;
+	size_t binSize = 0;
+
+	GltfAccessor* accessors = nullptr;
+	size_t accessorCount = 0;
+	GltfMesh* meshes = nullptr;
+	size_t meshCount = 0;
+	std::string_view* materialNames = nullptr;
+	size_t materialCount = 0;
+	GltfNode* nodes = nullptr;
+	size_t nodeCount = 0;
+	GltfSkin* skins = nullptr;
+	size_t skinCount = 0;
+	GltfAnimation* animations = nullptr;
+	size_t animationCount = 0;
+
+	GlbFile() = default;
+	GlbFile(const GlbFile&) = delete;
+	GlbFile& operator=(const GlbFile&) = delete;
+	~GlbFile();
+};
+
+/// <summary>
+/// Maps a .glb file read only and parses its JSON chunk, logs and returns false if the file is missing or malformed.
+/// Buffers have to live in the BIN chunk, sparse accessors and external URIs aren't supported.
+/// Buffer views compressed with EXT_meshopt_compression get decoded right away, KHR_mesh_quantization is up to the importer.
+/// Accessors are bounds checked against the BIN chunk here, so reading them afterwards needs no more checks.
+/// </summary>
+bool ReadGlbFile(const char* path, GlbFile& file, MemoryArena& arena);
+
+/// <summary>
+/// Bytes per element of the accessor, the stride of tightly packed data.
+/// </summary>
+size_t GetAccessorElementSize(const GltfAccessor& accessor);
+
+/// <summary>
+/// Typed pointer to the data of a tightly packed accessor.
+/// </summary>
+template <typename T>
+const T* GetAccessorData(const GltfAccessor& accessor)
+{
+	return reinterpret_cast<const T*>(accessor.data);
+}
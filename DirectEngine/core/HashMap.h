@@ -0,0 +1,236 @@
+#pragma once
+
+#include "Memory.h"
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+#define HASHMAP_MIN_CAPACITY 16
+#define HASHMAP_MAX_PROBE_DISTANCE 255
+
+// splitmix64 finalizer
+inline uint64_t MixHash(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+/// <summary>
+/// 64 bit hash of raw bytes, eight at a time with xxHash style rounds. Not meant to be stored in files.
+/// </summary>
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed + size * 0x9e3779b185ebca87ull;
+    size_t offset = 0;
+    for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, bytes + offset, sizeof(uint64_t));
+        hash += word * 0xc2b2ae3d27d4eb4full;
+        hash = ((hash << 31) | (hash >> 33)) * 0x9e3779b185ebca87ull;
+    }
+
+    uint64_t tail = 0;
+    memcpy(&tail, bytes + offset, size - offset);
+    hash += tail * 0xc2b2ae3d27d4eb4full;
+    return MixHash(hash);
+}
+
+/// <summary>
+/// Default hash for ArenaHashMap, integer keys are usually hashes already so they only get mixed.
+/// </summary>
+template <typename K>
+struct ArenaHash
+{
+    uint64_t operator()(const K& key) const
+    {
+        if constexpr (std::is_integral_v<K> || std::is_pointer_v<K>)
+        {
+            return MixHash((uint64_t)key);
+        }
+        else
+        {
+            return std::hash<K>{}(key);
+        }
+    }
+};
+
+/// <summary>
+/// Open addressing hash map using Robin Hood probing, all memory comes from the arena.
+/// Probe distances live in their own byte array so most lookups only touch one or two cache lines.
+/// Growing allocates a new table and leaves the old one in the arena, so pass a sensible expected count.
+/// Like everything in arenas destructors of keys and values are never called.
+/// </summary>
+template <typename K, typename V, typename Hash = ArenaHash<K>>
+class ArenaHashMap
+{
+public:
+    struct Entry
+    {
+        K key;
+        V value;
+    };
+
+    ArenaHashMap(MemoryArena& arena, size_t expectedCount = HASHMAP_MIN_CAPACITY) : arena(arena)
+    {
+        size_t initialCapacity = HASHMAP_MIN_CAPACITY;
+        while (initialCapacity * 7 / 8 < expectedCount)
+        {
+            initialCapacity *= 2;
+        }
+        AllocateTable(initialCapacity);
+    }
+
+    V* find(const K& key)
+    {
+        size_t index = Hash{}(key) & (capacity - 1);
+        for (uint8_t distance = 1; distances[index] >= distance; distance++)
+        {
+            if (entries[index].key == key)
+            {
+                return &entries[index].value;
+            }
+            index = (index + 1) & (capacity - 1);
+        }
+        return nullptr;
+    }
+
+    const V* find(const K& key) const
+    {
+        return const_cast<ArenaHashMap*>(this)->find(key);
+    }
+
+    bool contains(const K& key) const
+    {
+        return find(key) != nullptr;
+    }
+
+    /// <summary>
+    /// Returns false and keeps the existing value if the key is already in the map.
+    /// </summary>
+    bool insert(const K& key, const V& value)
+    {
+        if (find(key) != nullptr)
+        {
+            return false;
+        }
+        InsertNew(key, value);
+        return true;
+    }
+
+    V& operator[](const K& key)
+    {
+        V* value = find(key);
+        if (value != nullptr)
+        {
+            return *value;
+        }
+        return InsertNew(key, V{});
+    }
+
+    void clear()
+    {
+        memset(distances, 0, capacity);
+        size = 0;
+    }
+
+    size_t getSize()
+    {
+        return size;
+    }
+
+    size_t getCapacity()
+    {
+        return capacity;
+    }
+
+    ArenaHashMap(const ArenaHashMap& other) = delete;
+    ArenaHashMap& operator=(const ArenaHashMap& other) = delete;
+
+private:
+    MemoryArena& arena;
+    Entry* entries = nullptr;
+    // Probe distance from the ideal slot + 1, 0 means the slot is empty
+    uint8_t* distances = nullptr;
+    size_t capacity = 0;
+    size_t size = 0;
+
+    void AllocateTable(size_t newCapacity)
+    {
+        capacity = newCapacity;
+        entries = arena.Allocate<Entry>(capacity);
+        distances = arena.Allocate<uint8_t>(capacity);
+        memset(distances, 0, capacity);
+    }
+
+    void Grow()
+    {
+        Entry* oldEntries = entries;
+        uint8_t* oldDistances = distances;
+        const size_t oldCapacity = capacity;
+
+        AllocateTable(capacity * 2);
+        size = 0;
+        for (size_t i = 0; i < oldCapacity; i++)
+        {
+            if (oldDistances[i] != 0)
+            {
+                InsertNew(oldEntries[i].key, oldEntries[i].value);
+            }
+        }
+    }
+
+    V& InsertNew(const K& key, const V& value)
+    {
+        if ((size + 1) > capacity * 7 / 8)
+        {
+            Grow();
+        }
+
+        Entry entry{ key, value };
+        Entry* result = nullptr;
+        size_t index = Hash{}(key) & (capacity - 1);
+        uint8_t distance = 1;
+
+        while (distances[index] != 0)
+        {
+            // Take the slot from entries that are closer to their ideal position, this keeps probe lengths short
+            if (distances[index] < distance)
+            {
+                std::swap(distance, distances[index]);
+                std::swap(entry, entries[index]);
+                if (result == nullptr)
+                {
+                    result = &entries[index];
+                }
+            }
+
+            index = (index + 1) & (capacity - 1);
+            distance++;
+
+            // Distances are stored in a byte, so a cluster this long has to be spread out by a bigger table.
+            // The entry in hand may be one that got displaced, after growing the new key is looked up again
+            if (distance == HASHMAP_MAX_PROBE_DISTANCE)
+            {
+                Grow();
+                InsertNew(entry.key, entry.value);
+                return *find(key);
+            }
+        }
+
+        distances[index] = distance;
+        new(&entries[index]) Entry(entry);
+        size++;
+
+        if (result == nullptr)
+        {
+            result = &entries[index];
+        }
+        return result->value;
+    }
+};
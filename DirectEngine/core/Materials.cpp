@@ -1,6 +1,5 @@
 #include "Materials.h"
-#include <fstream>
-#include <sstream>
+#include <charconv>
 #include <format>
 #include <filesystem>
 #include <iostream>
@@ -9,7 +8,28 @@
 #define WIN32_LEAN_AND_MEAN
 #include "Windows.h"
 
-TextureFile* CreateTextureFile(MaterialFile* material, ArenaArray<TextureFile>& textures, const std::vector<std::string>& tokens)
+// Splits at whitespace, the tokens point into line
+void SplitTokens(std::string_view line, std::pmr::vector<std::string_view>& tokens)
+{
+	const char* whitespace = " \t\r";
+	tokens.clear();
+	for (size_t start = line.find_first_not_of(whitespace); start != std::string_view::npos; start = line.find_first_not_of(whitespace, start))
+	{
+		const size_t end = std::min(line.find_first_of(whitespace, start), line.size());
+		tokens.push_back(line.substr(start, end - start));
+		start = end;
+	}
+}
+
+float ParseFloat(std::string_view token)
+{
+	float value = 0.f;
+	std::from_chars_result result = std::from_chars(token.data(), token.data() + token.size(), value);
+	assert(result.ec == std::errc{});
+	return value;
+}
+
+TextureFile* CreateTextureFile(MaterialFile* material, ArenaArray<TextureFile>& textures, const std::pmr::vector<std::string_view>& tokens)
 {
 	if (material == nullptr)
 	{
@@ -23,27 +43,47 @@ TextureFile* CreateTextureFile(MaterialFile* material, ArenaArray<TextureFile>&
 	}
 
 	TextureFile* texture = &textures.newElement();
-	texture->texturePath = tokens[1].c_str();
-	texture->textureHash = std::hash<std::string>{}(texture->texturePath.str);
+	texture->texturePath = Name::Intern(tokens[1]);
 	return texture;
 }
 
-void LoadMaterials(const std::string& assetListFilePath, ArenaArray<MaterialFile>& materials, ArenaArray<TextureFile>& textures, ArenaArray<StandaloneShaderFile>& standaloneShaders)
+void LoadMaterials(const char* assetListFilePath, ArenaArray<MaterialFile>& materials, ArenaArray<TextureFile>& textures, ArenaArray<StandaloneShaderFile>& standaloneShaders)
 {
-	std::ifstream file(assetListFilePath);
-	assert(file.good());
+	FILE* fileHandle = fopen(assetListFilePath, "rb");
+	assert(fileHandle != nullptr);
+	if (fileHandle == nullptr) return;
+
+	_fseeki64(fileHandle, 0, SEEK_END);
+	const int64_t fileSize = _ftelli64(fileHandle);
+	rewind(fileHandle);
+	if (fileSize < 0)
+	{
+		OutputDebugStringA(std::format("Failed to read {}\n", assetListFilePath).c_str());
+		assert(false);
+		fclose(fileHandle);
+		return;
+	}
 
-	std::string line;
+	// The whole file goes into scratch memory, lines and tokens point into it
+	ScopedArenaMemoryResource scratch{ GetScratchArena() };
+	char* fileData = NewArray(scratch.arena, char, fileSize);
+	const std::string_view fileContents{ fileData, fread(fileData, 1, fileSize, fileHandle) };
+	fclose(fileHandle);
+
+	std::pmr::vector<std::string_view> tokens{ &scratch };
 	MaterialFile* material = nullptr;
 
-	while (std::getline(file, line))
+	for (size_t lineStart = 0; lineStart < fileContents.size();)
 	{
+		const size_t lineEnd = std::min(fileContents.find('\n', lineStart), fileContents.size());
+		std::string_view line = fileContents.substr(lineStart, lineEnd - lineStart);
+		lineStart = lineEnd + 1;
+		if (line.ends_with('\r')) line.remove_suffix(1);
+
 		if (line.size() == 0) continue;
 		if (line[0] == '#') continue;
 
-		std::istringstream iss(line);
-		std::vector<std::string> tokens{ std::istream_iterator<std::string>{iss}, std::istream_iterator<std::string>{} };
-
+		SplitTokens(line, tokens);
 		if (tokens.size() == 0) continue;
 
 		// Shaders unassociated with materials
@@ -56,7 +96,7 @@ void LoadMaterials(const std::string& assetListFilePath, ArenaArray<MaterialFile
 			}
 
 			StandaloneShaderFile* shader = &standaloneShaders.newElement();
-			shader->shaderName = tokens[1].c_str();
+			shader->shaderName = Name::Intern(tokens[1]);
 			if (tokens[2] == "raster")
 			{
 				shader->type = ShaderType::Rasterize;
@@ -87,9 +127,8 @@ void LoadMaterials(const std::string& assetListFilePath, ArenaArray<MaterialFile
 			}
 
 			material = &materials.newElement();
-			material->materialName = tokens[1].c_str();
-			material->materialHash = std::hash<std::string>{}(material->materialName.str);
-			material->shaderName = tokens[2].c_str();
+			material->materialName = Name::Intern(tokens[1]);
+			material->shaderName = Name::Intern(tokens[2]);
 			continue;
 		}
 
@@ -121,7 +160,7 @@ void LoadMaterials(const std::string& assetListFilePath, ArenaArray<MaterialFile
 				assert(false);
 				continue;
 			}
-			material->diffuseColor = { std::stof(tokens[1]), std::stof(tokens[2]), std::stof(tokens[3]), std::stof(tokens[4]) };
+			material->diffuseColor = { ParseFloat(tokens[1]), ParseFloat(tokens[2]), ParseFloat(tokens[3]), ParseFloat(tokens[4]) };
 		}
 		else if (tokens[0] == "normal")
 		{
@@ -172,13 +211,13 @@ void LoadMaterials(const std::string& assetListFilePath, ArenaArray<MaterialFile
 
 			if (tokens[2] == "float")
 			{
-				RootConstantInfo& rootConstant = material->rootConstants.newElement() = { RootConstantType::FLOAT, tokens[1].c_str() };
-				rootConstant.defaultValue = std::stof(tokens[3]);
+				RootConstantInfo& rootConstant = material->rootConstants.newElement() = { RootConstantType::FLOAT, Name::Intern(tokens[1]) };
+				rootConstant.defaultValue = ParseFloat(tokens[3]);
 			}
 			else if (tokens[2] == "uint")
 			{
-				RootConstantInfo& rootConstant = material->rootConstants.newElement() = { RootConstantType::UINT, tokens[1].c_str() };
-				rootConstant.defaultValue = std::stof(tokens[3]);
+				RootConstantInfo& rootConstant = material->rootConstants.newElement() = { RootConstantType::UINT, Name::Intern(tokens[1]) };
+				rootConstant.defaultValue = ParseFloat(tokens[3]);
 			}
 			else
 			{
@@ -203,7 +242,7 @@ HANDLE RunDXC(MemoryArena& arena, const std::string& inputFilePath, const std::s
 	{
 		for (const ShaderDefine& define : *defines)
 		{
-			definesStr += std::format("-D{}={} ", define.name.str, define.value.str);
+			definesStr += std::format("-D{}={} ", define.name.c_str(), define.value.c_str());
 		}
 	}
 
@@ -241,15 +280,15 @@ void CompileShaders(const std::string& shadersDir, const std::string& includeDir
 	ArenaArray<MaterialFile> materials = { materialArena, MAX_MATERIALS };
 	ArenaArray<TextureFile> textures = { materialArena, MAX_TEXTURES };
 	ArenaArray<StandaloneShaderFile> standaloneShaders = { materialArena, 64 };
-	LoadMaterials(materialsFile, materials, textures, standaloneShaders);
+	LoadMaterials(materialsFile.c_str(), materials, textures, standaloneShaders);
 
 	std::filesystem::create_directory(outputDir);
 
 	ArenaArray<HANDLE> processes = { materialArena, 256 };
 	for (StandaloneShaderFile& shader : standaloneShaders)
 	{
-		std::string shaderFileName = std::string{ shader.shaderName.str } + ".hlsl";
-		std::string outputPathStr = (std::filesystem::path(outputDir) / shader.shaderName.str).string();
+		std::string shaderFileName = std::string{ shader.shaderName.c_str() } + ".hlsl";
+		std::string outputPathStr = (std::filesystem::path(outputDir) / shader.shaderName.c_str()).string();
 
 		std::string shaderPathStr = "";
 
@@ -279,9 +318,9 @@ void CompileShaders(const std::string& shadersDir, const std::string& includeDir
 
 	for (MaterialFile& material : materials)
 	{
-		std::string shaderFileName = std::string{ material.shaderName.str } + ".hlsl";
+		std::string shaderFileName = std::string{ material.shaderName.c_str() } + ".hlsl";
 		std::string shaderPathStr = (std::filesystem::path(shadersDir) / "rasterize" / shaderFileName).string();
-		std::string outputPathStr = (std::filesystem::path(outputDir) / material.materialName.str).string();
+		std::string outputPathStr = (std::filesystem::path(outputDir) / material.materialName.c_str()).string();
 
 		processes.newElement() = RunDXC(materialArena, shaderPathStr, includeDir, outputPathStr, "vs_6_0", "vert", "VSMain", &material.defines);
 		processes.newElement() = RunDXC(materialArena, shaderPathStr, includeDir, outputPathStr, "ps_6_0", "frag", "PSMain", &material.defines);
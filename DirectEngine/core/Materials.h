@@ -14,30 +14,28 @@ enum class ShaderType
 
 struct ShaderDefine
 {
-	FixedStr name;
-	FixedStr value;
+	Name name;
+	Name value;
 };
 
 struct StandaloneShaderFile
 {
-	FixedStr shaderName = "";
+	Name shaderName = "";
 	StackArray<ShaderDefine, MAX_DEFINES_PER_MATERIAL> defines = {};
 	ShaderType type = ShaderType::Rasterize;
 };
 
 struct TextureFile
 {
-	FixedStr texturePath = "";
-	uint64_t textureHash = 0;
+	Name texturePath = "";
 	TextureGPU* textureGPU = nullptr;
 	bool isSRGB = false;
 };
 
 struct MaterialFile
 {
-	FixedStr materialName = "";
-	uint64_t materialHash = 0;
-	FixedStr shaderName = "";
+	Name materialName = "";
+	Name shaderName = "";
 	TextureFile* diffuseTexture = nullptr;
 	TextureFile* normalTexture = nullptr;
 	TextureFile* metallicRoughnessTexture = nullptr;
@@ -48,5 +46,5 @@ struct MaterialFile
 	StackArray<RootConstantInfo, MAX_ROOT_CONSTANTS_PER_MATERIAL> rootConstants = {};
 };
 
-void LoadMaterials(const std::string& assetListFilePath, ArenaArray<MaterialFile>& materials, ArenaArray<TextureFile>& textures, ArenaArray<StandaloneShaderFile>& standaloneShaders);
+void LoadMaterials(const char* assetListFilePath, ArenaArray<MaterialFile>& materials, ArenaArray<TextureFile>& textures, ArenaArray<StandaloneShaderFile>& standaloneShaders);
 void CompileShaders(const std::string& shadersDir, const std::string& includeDir, const std::string& outputDir, const std::string& materialsFile);
\ No newline at end of file
@@ -1,36 +1,151 @@
 #include "Memory.h"
+#include <cstdio>
 
 #define WIN32_LEAN_AND_MEAN
 #include "Windows.h"
 
-MemoryArena::MemoryArena(size_t capacity) :
+// Large pages need SeLockMemoryPrivilege, which has to be granted to the user and then enabled for the process.
+static bool EnableLockMemoryPrivilege()
+{
+	HANDLE token;
+	if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+	{
+		return false;
+	}
+
+	TOKEN_PRIVILEGES privileges{};
+	privileges.PrivilegeCount = 1;
+	privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+	const bool enabled = LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid)
+		&& AdjustTokenPrivileges(token, FALSE, &privileges, 0, NULL, NULL)
+		&& GetLastError() == ERROR_SUCCESS;
+
+	CloseHandle(token);
+	return enabled;
+}
+
+static uint8_t* AllocateLargePages(size_t capacity, size_t& committedSize)
+{
+	static const bool privilegeEnabled = EnableLockMemoryPrivilege();
+	const size_t largePageSize = GetLargePageMinimum();
+	if (!privilegeEnabled || largePageSize == 0)
+	{
+		return nullptr;
+	}
+
+	committedSize = Align(capacity, largePageSize);
+	return static_cast<uint8_t*>(VirtualAlloc(NULL, committedSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+}
+
+MemoryArena::MemoryArena(size_t capacity, bool concurrent, ArenaBacking backing, bool writeWatch) :
 	capacity(capacity),
-	base(static_cast<uint8_t*>(VirtualAlloc(NULL, capacity, MEM_RESERVE, PAGE_READWRITE)))
+	concurrent(concurrent),
+	writeWatch(writeWatch && backing != ArenaBacking::LargePages),
+	backing(backing)
 {
 	SYSTEM_INFO info;
 	GetSystemInfo(&info);
 	allocationGranularity = info.dwAllocationGranularity;
+	commitAhead = allocationGranularity;
+
+	if (backing == ArenaBacking::LargePages)
+	{
+		size_t committedSize = 0;
+		base = AllocateLargePages(capacity, committedSize);
+		if (base != nullptr)
+		{
+			committed.store(committedSize, std::memory_order_relaxed);
+			return;
+		}
+
+		OutputDebugString(L"Large pages not available for Memory Arena, falling back to commit ahead.");
+		this->backing = ArenaBacking::CommitAhead;
+	}
+
+	base = static_cast<uint8_t*>(VirtualAlloc(NULL, capacity, MEM_RESERVE | (this->writeWatch ? MEM_WRITE_WATCH : 0), PAGE_READWRITE));
 }
 
-void* MemoryArena::AllocateRaw(size_t byteCount, size_t alignment)
+void* MemoryArena::AllocateRaw(size_t byteCount, size_t alignment, AllocationTag tag)
 {
-	const size_t alignedUsed = Align(used, std::max<size_t>(alignment, MIN_ALIGN));
+	if (tag != AllocationTag::Untagged)
+	{
+		taggedBytes[static_cast<size_t>(tag)].fetch_add(byteCount, std::memory_order_relaxed);
+	}
+
+	if (concurrent)
+	{
+		return AllocateRawConcurrent(byteCount, alignment);
+	}
+
+	const size_t alignedUsed = Align(used.load(std::memory_order_relaxed), std::max<size_t>(alignment, MIN_ALIGN));
 	const size_t newUsed = alignedUsed + byteCount;
 	assert(newUsed <= capacity);
 
-	if (newUsed > committed)
+	if (newUsed > committed.load(std::memory_order_relaxed))
 	{
-		const size_t required = newUsed - committed;
-		const size_t allocationSize = Align(required, allocationGranularity);
-
-		VirtualAlloc(base + committed, allocationSize, MEM_COMMIT, PAGE_READWRITE);
-		committed += allocationSize;
+		Commit(newUsed);
 	}
 
-	used = newUsed;
+	used.store(newUsed, std::memory_order_relaxed);
 	return base + alignedUsed;
 }
 
+// Sizes are padded to MIN_ALIGN so used always stays aligned and a single fetch_add is enough to claim memory.
+// Bigger alignments claim some extra space and align inside of it.
+void* MemoryArena::AllocateRawConcurrent(size_t byteCount, size_t alignment)
+{
+	const size_t padding = alignment > MIN_ALIGN ? alignment - MIN_ALIGN : 0;
+	const size_t claimedSize = Align(byteCount + padding, MIN_ALIGN);
+	const size_t start = used.fetch_add(claimedSize, std::memory_order_relaxed);
+	const size_t end = start + claimedSize;
+	assert(end <= capacity);
+
+	// Only serialize when the committed frontier actually has to move
+	if (end > committed.load(std::memory_order_acquire))
+	{
+		std::lock_guard<std::mutex> lock(commitMutex);
+		if (end > committed.load(std::memory_order_relaxed))
+		{
+			Commit(end);
+		}
+	}
+
+	return base + Align(start, std::max<size_t>(alignment, MIN_ALIGN));
+}
+
+void MemoryArena::Commit(size_t newUsed)
+{
+	const size_t currentCommitted = committed.load(std::memory_order_relaxed);
+	size_t allocationSize = Align(newUsed - currentCommitted, allocationGranularity);
+
+	if (backing == ArenaBacking::CommitAhead)
+	{
+		allocationSize = std::min(std::max(allocationSize, commitAhead), capacity - currentCommitted);
+		commitAhead = std::min<size_t>(commitAhead * 2, ARENA_MAX_COMMIT_AHEAD);
+	}
+
+	VirtualAlloc(base + currentCommitted, allocationSize, MEM_COMMIT, PAGE_READWRITE);
+	committed.store(currentCommitted + allocationSize, std::memory_order_release);
+	commitCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MemoryArena::UpdateHighWaterMark()
+{
+	highWaterMark.store(GetHighWaterMark(), std::memory_order_relaxed);
+}
+
+size_t MemoryArena::GetUntaggedBytes() const
+{
+	size_t tagged = 0;
+	for (size_t i = 1; i < static_cast<size_t>(AllocationTag::Count); i++)
+	{
+		tagged += taggedBytes[i].load(std::memory_order_relaxed);
+	}
+	const size_t currentUsed = used.load(std::memory_order_relaxed);
+	return currentUsed > tagged ? currentUsed - tagged : 0;
+}
+
 size_t Align(size_t value, size_t alignment)
 {
 	return (value + alignment - 1) & ~(alignment - 1);
@@ -38,15 +153,139 @@ size_t Align(size_t value, size_t alignment)
 
 void MemoryArena::Reset(bool freePages)
 {
-	if (freePages)
+	UpdateHighWaterMark();
+	for (std::atomic<size_t>& tagged : taggedBytes)
 	{
-		if (!VirtualFree(base, committed, MEM_DECOMMIT))
+		tagged.store(0, std::memory_order_relaxed);
+	}
+
+	// Large pages stay committed for the whole lifetime of the arena
+	if (freePages && backing != ArenaBacking::LargePages)
+	{
+		if (!VirtualFree(base, committed.load(std::memory_order_relaxed), MEM_DECOMMIT))
 		{
 			OutputDebugString(L"Failed to reset Memory Arena!!");
 		}
-		committed = 0;
+		committed.store(0, std::memory_order_relaxed);
+		commitAhead = allocationGranularity;
+		decommitCount.fetch_add(1, std::memory_order_relaxed);
 	}
-	used = 0;
+	used.store(0, std::memory_order_relaxed);
+}
+
+void MemoryArena::Rewind(ArenaMarker marker)
+{
+	assert(marker.used <= used.load(std::memory_order_relaxed));
+	UpdateHighWaterMark();
+	used.store(marker.used, std::memory_order_relaxed);
+}
+
+void MemoryArena::TakeSnapshot(ArenaSnapshot& snapshot, MemoryArena& storage)
+{
+	assert(&storage != this);
+	snapshot.used = used.load(std::memory_order_relaxed);
+	snapshot.data = storage.Allocate<uint8_t>(snapshot.used);
+	memcpy(snapshot.data, base, snapshot.used);
+	snapshot.decommitCount = decommitCount.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < static_cast<size_t>(AllocationTag::Count); i++)
+	{
+		snapshot.taggedBytes[i] = taggedBytes[i].load(std::memory_order_relaxed);
+	}
+
+	if (writeWatch)
+	{
+		ResetWriteWatch(base, committed.load(std::memory_order_relaxed));
+	}
+}
+
+void MemoryArena::RestoreSnapshot(const ArenaSnapshot& snapshot)
+{
+	UpdateHighWaterMark();
+
+	// Pages might have been freed by a Reset in the meantime, those lost their contents without being written to
+	bool fullCopy = !writeWatch || snapshot.decommitCount != decommitCount.load(std::memory_order_relaxed);
+	if (snapshot.used > committed.load(std::memory_order_relaxed))
+	{
+		Commit(snapshot.used);
+	}
+
+	if (!fullCopy)
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+
+		ArenaScope scratch{ GetScratchArena(this) };
+		ULONG_PTR pageCount = Align(snapshot.used, info.dwPageSize) / info.dwPageSize;
+		void** dirtyPages = NewArray(scratch.arena, void*, pageCount);
+		ULONG pageSize = 0;
+		if (GetWriteWatch(WRITE_WATCH_FLAG_RESET, base, snapshot.used, dirtyPages, &pageCount, &pageSize) == 0)
+		{
+			for (ULONG_PTR i = 0; i < pageCount; i++)
+			{
+				const size_t offset = static_cast<uint8_t*>(dirtyPages[i]) - base;
+				memcpy(base + offset, snapshot.data + offset, std::min<size_t>(pageSize, snapshot.used - offset));
+			}
+		}
+		else
+		{
+			fullCopy = true;
+		}
+	}
+
+	if (fullCopy)
+	{
+		memcpy(base, snapshot.data, snapshot.used);
+		if (writeWatch)
+		{
+			ResetWriteWatch(base, committed.load(std::memory_order_relaxed));
+		}
+	}
+
+	used.store(snapshot.used, std::memory_order_relaxed);
+	for (size_t i = 0; i < static_cast<size_t>(AllocationTag::Count); i++)
+	{
+		taggedBytes[i].store(snapshot.taggedBytes[i], std::memory_order_relaxed);
+	}
+}
+
+void* ReserveAddressSpace(size_t byteCount)
+{
+	void* address = VirtualAlloc(NULL, byteCount, MEM_RESERVE, PAGE_READWRITE);
+	assert(address != nullptr);
+	return address;
+}
+
+void CommitAddressSpace(void* address, size_t byteCount)
+{
+	if (VirtualAlloc(address, byteCount, MEM_COMMIT, PAGE_READWRITE) == nullptr)
+	{
+		OutputDebugString(L"Failed to commit address space!!");
+		assert(false);
+	}
+}
+
+void ReleaseAddressSpace(void* address)
+{
+	if (!VirtualFree(address, 0, MEM_RELEASE))
+	{
+		OutputDebugString(L"Failed to release address space!!");
+	}
+}
+
+MemoryArena& GetScratchArena(const MemoryArena* conflict)
+{
+	thread_local MemoryArena scratchArenas[SCRATCH_ARENA_COUNT]{ SCRATCH_ARENA_CAPACITY, SCRATCH_ARENA_CAPACITY };
+
+	for (MemoryArena& scratch : scratchArenas)
+	{
+		if (&scratch != conflict)
+		{
+			return scratch;
+		}
+	}
+
+	assert(false);
+	return scratchArenas[0];
 }
 
 MemoryArena::~MemoryArena()
@@ -56,3 +295,52 @@ MemoryArena::~MemoryArena()
 		OutputDebugString(L"Failed to free Memory Arena!!");
 	}
 }
+
+const char* GetAllocationTagName(AllocationTag tag)
+{
+	switch (tag)
+	{
+	case AllocationTag::Untagged: return "Untagged";
+	case AllocationTag::Mesh: return "Mesh";
+	case AllocationTag::Animation: return "Animation";
+	case AllocationTag::Material: return "Material";
+	case AllocationTag::Entity: return "Entity";
+	case AllocationTag::Physics: return "Physics";
+	case AllocationTag::Audio: return "Audio";
+	default: return "Unknown";
+	}
+}
+
+std::string GetArenaStatsJson(const MemoryArena* const* arenas, size_t arenaCount)
+{
+	std::string json = "{\n  \"arenas\": [";
+	for (size_t i = 0; i < arenaCount; i++)
+	{
+		const MemoryArena& arena = *arenas[i];
+		json += std::format("{}\n    {{\n      \"name\": \"{}\",\n      \"capacity\": {},\n      \"used\": {},\n      \"highWaterMark\": {},\n      \"committed\": {},\n      \"commits\": {},\n      \"decommits\": {},\n      \"tags\": {{ \"Untagged\": {}",
+			i == 0 ? "" : ",", arena.debugName, arena.capacity, arena.used.load(), arena.GetHighWaterMark(), arena.committed.load(),
+			arena.commitCount.load(), arena.decommitCount.load(), arena.GetUntaggedBytes());
+
+		for (size_t tag = 1; tag < static_cast<size_t>(AllocationTag::Count); tag++)
+		{
+			json += std::format(", \"{}\": {}", GetAllocationTagName(static_cast<AllocationTag>(tag)), arena.taggedBytes[tag].load());
+		}
+		json += " }\n    }";
+	}
+	json += "\n  ]\n}\n";
+	return json;
+}
+
+bool WriteArenaStatsJson(const char* path, const MemoryArena* const* arenas, size_t arenaCount)
+{
+	// fopen would read the path in the active code page
+	wchar_t widePath[MAX_PATH];
+	if (MultiByteToWideChar(CP_UTF8, 0, path, -1, widePath, MAX_PATH) == 0) return false;
+	FILE* fileHandle = _wfopen(widePath, L"wb");
+	if (fileHandle == nullptr) return false;
+
+	const std::string json = GetArenaStatsJson(arenas, arenaCount);
+	const bool success = fwrite(json.data(), json.size(), 1, fileHandle) == 1;
+	fclose(fileHandle);
+	return success;
+}
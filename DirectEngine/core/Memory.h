@@ -8,50 +8,148 @@
 #include <assert.h>
 #include <algorithm>
 #include <functional>
+#include <utility>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <memory_resource>
 
 #undef min
 #undef max
 
 #define MIN_ALIGN 16
+#define ARENA_DEFAULT_CAPACITY (1024ull * 1024 * 1024)
+#define ARENA_MAX_COMMIT_AHEAD (1024ull * 1024 * 64)
+#define SCRATCH_ARENA_COUNT 2
+#define SCRATCH_ARENA_CAPACITY (1024ull * 1024 * 256)
+#define ARENA_VECTOR_DEFAULT_CAPACITY (1024ull * 1024)
+#define ARENA_VECTOR_MIN_COMMIT (1024ull * 64)
 
 /// <summary>
 /// Takes the value and returns the next higher multiple of alignment.
 /// </summary>
 size_t Align(size_t value, size_t alignment);
 
+/// <summary>
+/// Thin wrappers around the virtual memory API for containers that manage their own address range.
+/// </summary>
+void* ReserveAddressSpace(size_t byteCount);
+void CommitAddressSpace(void* address, size_t byteCount);
+void ReleaseAddressSpace(void* address);
+
+/// <summary>
+/// Saved fill level of an arena, used to rewind it later.
+/// </summary>
+struct ArenaMarker
+{
+    size_t used = 0;
+};
+
+/// <summary>
+/// How an arena gets its physical memory.
+/// </summary>
+enum class ArenaBacking
+{
+    Default,     // Commit in allocationGranularity sized steps
+    CommitAhead, // Commit steps double in size up to ARENA_MAX_COMMIT_AHEAD, for arenas that fill up quickly
+    LargePages,  // Commit the whole capacity upfront with large pages, falls back to CommitAhead if that's not possible
+};
+
+/// <summary>
+/// Optional tag on allocations to see which subsystem owns the bytes in an arena.
+/// </summary>
+enum class AllocationTag : uint8_t
+{
+    Untagged,
+    Mesh,
+    Animation,
+    Material,
+    Entity,
+    Physics,
+    Audio,
+    Count,
+};
+
+const char* GetAllocationTagName(AllocationTag tag);
+
+/// <summary>
+/// Copy of the used part of an arena. Arenas never move, so copying the bytes back to the same address
+/// keeps every pointer into (and out of) the arena valid without any fixups.
+/// </summary>
+struct ArenaSnapshot
+{
+    uint8_t* data = nullptr;
+    size_t used = 0;
+    size_t decommitCount = 0;
+    size_t taggedBytes[static_cast<size_t>(AllocationTag::Count)]{};
+};
+
 /// <summary>
 /// Custom allocation, still figuring out how to use this best.
 /// WARNING: Anything allocated inside a memory arena won't get it's desctructor called (intentionally).
 /// Don't store std::string or similar in here!
+/// Concurrent arenas can be allocated from by multiple threads at once. Reset/Rewind still need to happen while no one else is allocating.
 /// </summary>
 class MemoryArena
 {
 public:
     const size_t capacity = 0;
+    const bool concurrent = false;
+    const bool writeWatch = false;
+    ArenaBacking backing = ArenaBacking::Default;
     size_t allocationGranularity = 1024 * 64;
+    size_t commitAhead = 1024 * 64;
 
     uint8_t* base;
-    size_t used = 0;
-    size_t committed = 0;
+    // Only concurrent arenas need these to be atomic, the others use relaxed loads/stores which are as cheap as plain ones.
+    std::atomic<size_t> used = 0;
+    std::atomic<size_t> committed = 0;
+
+    // Telemetry, tagged bytes count everything allocated since the last Reset (rewinds don't subtract)
+    const char* debugName = "Arena";
+    std::atomic<size_t> commitCount = 0;
+    std::atomic<size_t> decommitCount = 0;
+    std::atomic<size_t> taggedBytes[static_cast<size_t>(AllocationTag::Count)]{};
 
-    MemoryArena(size_t capacity = 1024 * 1024 * 1024);
+    // Write watched arenas remember which pages were touched, restoring a snapshot then only copies those back (not with large pages)
+    MemoryArena(size_t capacity = ARENA_DEFAULT_CAPACITY, bool concurrent = false, ArenaBacking backing = ArenaBacking::Default, bool writeWatch = false);
 
     template <typename T>
-    T* Allocate(size_t objectCount = 1)
+    T* Allocate(size_t objectCount = 1, AllocationTag tag = AllocationTag::Untagged)
     {
-        void* ptr = AllocateRaw(sizeof(T) * objectCount, alignof(T));
+        void* ptr = AllocateRaw(sizeof(T) * objectCount, alignof(T), tag);
         return reinterpret_cast<T*>(ptr);
     }
 
-    void* AllocateRaw(size_t byteCount, size_t alignment = MIN_ALIGN);
+    void* AllocateRaw(size_t byteCount, size_t alignment = MIN_ALIGN, AllocationTag tag = AllocationTag::Untagged);
     void Reset(bool freePages = false);
 
+    // Highest fill level since the arena was created, only updated on Reset/Rewind so it's free during allocation
+    size_t GetHighWaterMark() const { return std::max(highWaterMark.load(std::memory_order_relaxed), used.load(std::memory_order_relaxed)); }
+    size_t GetUntaggedBytes() const;
+
+    ArenaMarker GetMarker() const { return { used.load(std::memory_order_relaxed) }; }
+    void Rewind(ArenaMarker marker);
+
+    // Copies the used bytes into storage, restoring rewinds the arena to that point and puts the old contents back.
+    // Just like Reset this can't happen while someone else is allocating.
+    void TakeSnapshot(ArenaSnapshot& snapshot, MemoryArena& storage);
+    void RestoreSnapshot(const ArenaSnapshot& snapshot);
+
     // Copying this thing is probably a very bad idea (and moving it shouldn't be necessary).
     MemoryArena(const MemoryArena& other) = delete;
     MemoryArena(MemoryArena&& other) noexcept = delete;
     MemoryArena& operator=(const MemoryArena& other) = delete;
     MemoryArena& operator=(MemoryArena&& other) noexcept = delete;
     ~MemoryArena();
+
+private:
+    std::mutex commitMutex;
+    std::atomic<size_t> highWaterMark = 0;
+
+    void* AllocateRawConcurrent(size_t byteCount, size_t alignment);
+    void UpdateHighWaterMark();
+    void Commit(size_t newUsed);
 };
 
 template <typename T>
@@ -86,7 +184,141 @@ public:
 };
 
 #define NewObject(arena, type, ...) new((arena).Allocate<type>()) type(__VA_ARGS__)
+#define NewObjectAligned(arena, type, alignment, ...) new((arena).AllocateRaw(sizeof(type), alignment)) type(__VA_ARGS__)
 #define NewArray(arena, type, count, ...) new((arena).Allocate<type>(count)) type[count](__VA_ARGS__)
+#define NewObjectTagged(arena, tag, type, ...) new((arena).Allocate<type>(1, tag)) type(__VA_ARGS__)
+#define NewArrayTagged(arena, tag, type, count, ...) new((arena).Allocate<type>(count, tag)) type[count](__VA_ARGS__)
+
+/// <summary>
+/// Rewinds the arena to the state it had on construction once this goes out of scope.
+/// Everything allocated in between is gone after that, so don't let pointers to it escape the scope!
+/// </summary>
+class ArenaScope
+{
+public:
+    MemoryArena& arena;
+    const ArenaMarker marker;
+
+    ArenaScope(MemoryArena& arena) : arena(arena), marker(arena.GetMarker()) {}
+    ~ArenaScope() { arena.Rewind(marker); }
+
+    ArenaScope(const ArenaScope& other) = delete;
+    ArenaScope(ArenaScope&& other) noexcept = delete;
+    ArenaScope& operator=(const ArenaScope& other) = delete;
+    ArenaScope& operator=(ArenaScope&& other) noexcept = delete;
+};
+
+/// <summary>
+/// std::pmr adapter so standard containers can allocate from an arena. Deallocation does nothing,
+/// memory only comes back when the arena gets reset or rewound (monotonic, like std::pmr::monotonic_buffer_resource).
+/// </summary>
+class ArenaMemoryResource : public std::pmr::memory_resource
+{
+public:
+    MemoryArena& arena;
+    const AllocationTag tag;
+
+    ArenaMemoryResource(MemoryArena& arena, AllocationTag tag = AllocationTag::Untagged) : arena(arena), tag(tag) {}
+
+protected:
+    void* do_allocate(size_t byteCount, size_t alignment) override
+    {
+        return arena.AllocateRaw(byteCount, alignment, tag);
+    }
+
+    void do_deallocate(void* pointer, size_t byteCount, size_t alignment) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+/// <summary>
+/// Arena memory resource that rewinds the arena when it goes out of scope, like ArenaScope.
+/// Declare it before the containers that use it so they're gone before the rewind.
+/// </summary>
+class ScopedArenaMemoryResource : public ArenaMemoryResource
+{
+public:
+    ScopedArenaMemoryResource(MemoryArena& arena, AllocationTag tag = AllocationTag::Untagged) : ArenaMemoryResource(arena, tag), marker(arena.GetMarker()) {}
+    ~ScopedArenaMemoryResource() { arena.Rewind(marker); }
+
+    ScopedArenaMemoryResource(const ScopedArenaMemoryResource& other) = delete;
+    ScopedArenaMemoryResource& operator=(const ScopedArenaMemoryResource& other) = delete;
+
+private:
+    const ArenaMarker marker;
+};
+
+/// <summary>
+/// One arena per frame in flight for data the GPU (or a readback) still reads after the CPU moved on.
+/// An arena only gets reset once the fence value its frame signaled has been reached, until then everything in it stays valid.
+/// The ring doesn't know about D3D, the caller passes in the fence values.
+/// </summary>
+template <size_t FrameCount>
+class FrameArenaRing
+{
+public:
+    MemoryArena arenas[FrameCount];
+
+    MemoryArena& Current()
+    {
+        return arenas[frameIndex];
+    }
+
+    size_t GetFrameIndex() const
+    {
+        return frameIndex;
+    }
+
+    // The GPU signals fenceValue once it's done with everything recorded during the current frame
+    void EndFrame(uint64_t fenceValue)
+    {
+        fenceValues[frameIndex] = fenceValue;
+    }
+
+    // If the GPU isn't done with the next arena yet it's left alone and new allocations go on top
+    MemoryArena& BeginFrame(size_t nextFrameIndex, uint64_t completedFenceValue)
+    {
+        assert(nextFrameIndex < FrameCount);
+        frameIndex = nextFrameIndex;
+        if (completedFenceValue >= fenceValues[frameIndex])
+        {
+            arenas[frameIndex].Reset();
+        }
+        return arenas[frameIndex];
+    }
+
+private:
+    size_t frameIndex = 0;
+    uint64_t fenceValues[FrameCount]{};
+};
+
+/// <summary>
+/// Thread local arena for temporary allocations, always use it through an ArenaScope.
+/// If a function gets passed an arena to put its results in, pass that one as conflict. Otherwise the results could end up in the scratch memory we're about to rewind.
+/// </summary>
+MemoryArena& GetScratchArena(const MemoryArena* conflict = nullptr);
+
+/// <summary>
+/// Writes fill levels, high water marks, commit counters and tag breakdowns of the arenas as JSON, the path is UTF-8.
+/// </summary>
+std::string GetArenaStatsJson(const MemoryArena* const* arenas, size_t arenaCount);
+bool WriteArenaStatsJson(const char* path, const MemoryArena* const* arenas, size_t arenaCount);
+
+/// <summary>
+/// std::format into arena memory, returns a null terminated string.
+/// </summary>
+template <typename... Args>
+const char* ArenaFormat(MemoryArena& arena, std::format_string<Args...> fmt, Args&&... args)
+{
+    const size_t length = std::formatted_size(fmt, std::forward<Args>(args)...);
+    char* result = arena.Allocate<char>(length + 1);
+    std::format_to_n(result, length, fmt, std::forward<Args>(args)...);
+    result[length] = '\0';
+    return result;
+}
 
 namespace ArrayFunc
 {
@@ -388,48 +620,122 @@ public:
     IArray<T>::Iterator end() { return IArray<T>::Iterator(reinterpret_cast<T*>(base + size)); }
 };
 
-// Used for short strings, to avoid std. This might not be a great idea but i'm trying it for fun here.
-struct FixedStr
+/// <summary>
+/// Growable array, reserves address space for capacity elements on first use and commits pages as it grows.
+/// Elements never move, so pointers to them stay valid until the vector is destroyed.
+/// </summary>
+template <typename T>
+class ArenaVector : public IArray<T>
 {
-    constexpr static size_t SIZE = 128;
-    char str[SIZE]{};
+public:
+    ArenaVector(size_t capacity = ARENA_VECTOR_DEFAULT_CAPACITY) : capacity(capacity) {}
 
-    FixedStr& operator=(const char* other)
+    T& operator[](const size_t index)
     {
-        assert(other != nullptr);
-        assert(strnlen_s(other, SIZE) < SIZE);
-        strcpy_s((char*)str, SIZE, other);
-        return *this;
+        return ArrayFunc::OpArray(base, committedCount, index);
     }
 
-    FixedStr() = default;
+    const T& operator[](const size_t index) const
+    {
+        return ArrayFunc::OpArrayConst(base, committedCount, index);
+    }
 
-    // TODO: this isn't efficient, but we'll have to use std::move or something like that to make it better.
-    FixedStr(const char* other)
+    T& at(const size_t index)
     {
-        assert(other != nullptr);
-        assert(strnlen_s(other, SIZE) < SIZE);
-        strcpy_s((char*)str, SIZE, other);
+        return ArrayFunc::At(base, capacity, size, index);
     }
 
-    bool operator==(const FixedStr& other) const
+    const T& at(const size_t index) const
     {
-        return strcmp(str, other.str) == 0;
+        return ArrayFunc::AtConst(base, capacity, size, index);
     }
 
-    bool operator==(const char* other) const
+    template <typename... Args>
+    T& newElement(Args&&... args)
     {
-        return strcmp(str, other) == 0;
+        assert(size < capacity);
+        if (size == committedCount)
+        {
+            Grow();
+        }
+        return *new(reinterpret_cast<void*>(&base[size++])) T(std::forward<Args>(args)...);
+    }
+
+    bool contains(const T& element)
+    {
+        return ArrayFunc::Contains(base, size, element);
     }
-};
 
-template <>
-struct std::formatter<FixedStr> {
-    constexpr auto parse(std::format_parse_context& ctx) {
-        return ctx.begin();
+    void removeAt(const size_t removeIndex)
+    {
+        ArrayFunc::RemoveAt(base, capacity, size, removeIndex);
     }
 
-    auto format(const FixedStr& obj, std::format_context& ctx) {
-        return std::format_to(ctx.out(), "{}", obj.str);
+    void removeAllEqual(const T& element)
+    {
+        ArrayFunc::RemoveAllEqual(base, capacity, size, element);
+    }
+
+    bool anyMatch(std::function<bool(const T&)> matchFunc)
+    {
+        return ArrayFunc::AnyMatch(base, size, matchFunc);
+    }
+
+    bool allMatch(std::function<bool(const T&)> matchFunc)
+    {
+        return ArrayFunc::AllMatch(base, size, matchFunc);
+    }
+
+    // Keeps the committed pages around for reuse
+    void clear()
+    {
+        size = 0;
+    }
+
+    // Drops everything after the first newSize elements, also keeps the pages
+    void truncate(size_t newSize)
+    {
+        assert(newSize <= size);
+        size = newSize;
+    }
+
+    size_t getSize()
+    {
+        return size;
+    }
+
+    T* base = nullptr;
+    const size_t capacity = 0;
+    size_t size = 0;
+    size_t committedCount = 0;
+
+    typename IArray<T>::Iterator begin() { return typename IArray<T>::Iterator(base); }
+    typename IArray<T>::Iterator end() { return typename IArray<T>::Iterator(base + size); }
+
+    ArenaVector(const ArenaVector& other) = delete;
+    ArenaVector(ArenaVector&& other) noexcept = delete;
+    ArenaVector& operator=(const ArenaVector& other) = delete;
+    ArenaVector& operator=(ArenaVector&& other) noexcept = delete;
+
+    ~ArenaVector()
+    {
+        if (base != nullptr)
+        {
+            ReleaseAddressSpace(base);
+        }
+    }
+
+private:
+    void Grow()
+    {
+        if (base == nullptr)
+        {
+            base = static_cast<T*>(ReserveAddressSpace(capacity * sizeof(T)));
+        }
+
+        const size_t committedBytes = committedCount * sizeof(T);
+        const size_t newCommittedBytes = std::min(std::max<size_t>(committedBytes * 2, ARENA_VECTOR_MIN_COMMIT), capacity * sizeof(T));
+        CommitAddressSpace(reinterpret_cast<uint8_t*>(base) + committedBytes, newCommittedBytes - committedBytes);
+        committedCount = newCommittedBytes / sizeof(T);
     }
 };
@@ -2,18 +2,17 @@
 #include "../Helpers.h"
 #include "../core/Log.h"
 #include "../core/Vertex.h"
+#include "../core/MeshOptimizer.h"
+#include "../core/Meshlet.h"
+#include "../core/MeshSimplifier.h"
+#include "../core/GlbReader.h"
+#include "../core/Animation.h"
 using namespace VertexData;
 
 #include <format>
-#include <regex>
+#include <limits>
+#include <type_traits>
 
-#define TINYGLTF_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#define TINYGLTF_USE_CPP14
-#include "../import/tiny_gltf.h"
-
-using namespace tinygltf;
 using namespace std::chrono;
 
 MeshData CreateQuad(float width, float height, MemoryArena& arena)
@@ -33,7 +32,7 @@ MeshData CreateQuad(float width, float height, MemoryArena& arena)
 	indices[4] = 2;
 	indices[5] = 3;
 
-	return MeshData{ vertices, 4, indices, 6 };
+	return MeshData{ vertices, nullptr, 4, indices, 6 };
 }
 
 MeshData CreateQuadY(float width, float height, MemoryArena& arena)
@@ -53,53 +52,23 @@ MeshData CreateQuadY(float width, float height, MemoryArena& arena)
 	indices[4] = 2;
 	indices[5] = 3;
 
-	return MeshData{ vertices, 4, indices, 6 };
-}
-
-template <typename T>
-const T* ReadBuffer(Model& model, Accessor& accessor)
-{
-	BufferView& bufferView = model.bufferViews[accessor.bufferView];
-	Buffer& buffer = model.buffers[bufferView.buffer];
-	return reinterpret_cast<T*>(&buffer.data[bufferView.byteOffset + accessor.byteOffset]);
-}
-
-XMVECTOR LoadTranslation(std::vector<double>& translationVec)
-{
-	if (translationVec.size() == 0) return { 1.f, 1.f, 1.f };
-	return { static_cast<float>(translationVec[0]), static_cast<float>(translationVec[1]), static_cast<float>(translationVec[2]) };
-}
-
-XMVECTOR LoadRotation(std::vector<double>& quaternionVec)
-{
-	if (quaternionVec.size() == 0) return XMQuaternionIdentity();
-	return { static_cast<float>(quaternionVec[0]), static_cast<float>(quaternionVec[1]), static_cast<float>(quaternionVec[2]), static_cast<float>(quaternionVec[3]) };
-}
-
-XMVECTOR LoadScale(std::vector<double>& scaleVec)
-{
-	if (scaleVec.size() == 0) return { 1.f, 1.f, 1.f };
-	return { static_cast<float>(scaleVec[0]), static_cast<float>(scaleVec[1]), static_cast<float>(scaleVec[2]) };
+	return MeshData{ vertices, nullptr, 4, indices, 6 };
 }
 
-TransformNode* CreateMatrices(Model& model, int jointIndex, TransformNode* parent, TransformNode* nodeList, const float* inverseBindMatrixData)
+TransformNode* CreateMatrices(const GlbFile& file, const GltfSkin& skin, size_t jointIndex, TransformNode* parent, TransformNode* nodeList, const float* inverseBindMatrixData)
 {
-	size_t nodeIndex = model.skins[0].joints[jointIndex];
-	Node& node = model.nodes[nodeIndex];
+	const GltfNode& node = file.nodes[skin.joints[jointIndex]];
 
 	TransformNode& transformNode = nodeList[jointIndex];
-	transformNode.baseLocal = DirectX::XMMatrixAffineTransformation(LoadScale(node.scale), XMVECTOR{}, LoadRotation(node.rotation), LoadTranslation(node.translation));
+	const XMVECTOR scale = XMVectorSet(node.scale[0], node.scale[1], node.scale[2], 0.f);
+	const XMVECTOR rotation = XMVectorSet(node.rotation[0], node.rotation[1], node.rotation[2], node.rotation[3]);
+	const XMVECTOR translation = XMVectorSet(node.translation[0], node.translation[1], node.translation[2], 0.f);
+	transformNode.baseLocal = DirectX::XMMatrixAffineTransformation(scale, XMVECTOR{}, rotation, translation);
 	transformNode.currentLocal = transformNode.baseLocal;
 	transformNode.parent = parent;
-	transformNode.name = node.name;
+	transformNode.name = Name::Intern(node.name);
 
-	const float* ibmData = &inverseBindMatrixData[jointIndex * 16];
-	transformNode.inverseBind = XMMATRIX(
-		static_cast<float>(ibmData[0]), static_cast<float>(ibmData[1]), static_cast<float>(ibmData[2]), static_cast<float>(ibmData[3]),
-		static_cast<float>(ibmData[4]), static_cast<float>(ibmData[5]), static_cast<float>(ibmData[6]), static_cast<float>(ibmData[7]),
-		static_cast<float>(ibmData[8]), static_cast<float>(ibmData[9]), static_cast<float>(ibmData[10]), static_cast<float>(ibmData[11]),
-		static_cast<float>(ibmData[12]), static_cast<float>(ibmData[13]), static_cast<float>(ibmData[14]), static_cast<float>(ibmData[15])
-	);
+	transformNode.inverseBind = XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(&inverseBindMatrixData[jointIndex * 16]));
 
 	if (parent != nullptr)
 	{
@@ -110,108 +79,292 @@ TransformNode* CreateMatrices(Model& model, int jointIndex, TransformNode* paren
 		transformNode.global = transformNode.currentLocal;
 	}
 
-	for (int childNodeIndex : node.children)
+	for (size_t i = 0; i < node.childCount; i++)
 	{
 		assert(transformNode.childCount < MAX_CHILDREN);
 
-		auto& jointVec = model.skins[0].joints;
-		auto childJoint = std::find(jointVec.begin(), jointVec.end(), childNodeIndex);
-		if (childJoint != jointVec.end())
+		const int32_t* joints = skin.joints;
+		const int32_t* childJoint = std::find(joints, joints + skin.jointCount, node.children[i]);
+		if (childJoint != joints + skin.jointCount)
 		{
-			size_t childJointIndex = childJoint - jointVec.begin();
-			transformNode.children[transformNode.childCount] = CreateMatrices(model, childJointIndex, &transformNode, nodeList, inverseBindMatrixData);
+			const size_t childJointIndex = childJoint - joints;
+			transformNode.children[transformNode.childCount] = CreateMatrices(file, skin, childJointIndex, &transformNode, nodeList, inverseBindMatrixData);
 			transformNode.childCount++;
 		}
 	}
 	return &nodeList[jointIndex];
 }
 
-Accessor& CheckAccessor(tinygltf::Model& model, Primitive& primitive, const char* attribute, int type)
+// Unnamed materials come out of Blender as Material_<n>, returns the n (or nothing)
+std::string_view FindMaterialNumber(std::string_view materialName)
 {
-	assert(primitive.attributes.contains(attribute));
-	Accessor& accessor = model.accessors[primitive.attributes[attribute]];
-	assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-	assert(accessor.type == type);
+	const std::string_view prefix = "Material_";
+	for (size_t start = materialName.find(prefix); start != std::string_view::npos; start = materialName.find(prefix, start + 1))
+	{
+		const size_t numberStart = start + prefix.size();
+		size_t numberEnd = numberStart;
+		while (numberEnd < materialName.size() && isdigit(static_cast<unsigned char>(materialName[numberEnd])))
+		{
+			numberEnd++;
+		}
+		if (numberEnd > numberStart)
+		{
+			return materialName.substr(numberStart, numberEnd - numberStart);
+		}
+	}
+	return {};
+}
+
+// KHR_mesh_quantization allows integer components next to FLOAT, normals, tangents and weights have to be normalized then
+bool IsValidAttributeType(GltfAttribute attribute, const GltfAccessor& accessor)
+{
+	const uint32_t type = accessor.componentType;
+	switch (attribute)
+	{
+	case GltfAttribute::Position:
+	case GltfAttribute::TexCoord0:
+		return type == GLTF_FLOAT || type == GLTF_BYTE || type == GLTF_UNSIGNED_BYTE || type == GLTF_SHORT || type == GLTF_UNSIGNED_SHORT;
+	case GltfAttribute::Normal:
+	case GltfAttribute::Tangent:
+		return type == GLTF_FLOAT || (accessor.normalized && (type == GLTF_BYTE || type == GLTF_SHORT));
+	case GltfAttribute::Joints0:
+		return type == GLTF_UNSIGNED_BYTE || type == GLTF_UNSIGNED_SHORT;
+	case GltfAttribute::Weights0:
+		return type == GLTF_FLOAT || (accessor.normalized && (type == GLTF_UNSIGNED_BYTE || type == GLTF_UNSIGNED_SHORT));
+	default:
+		return false;
+	}
+}
+
+const GltfAccessor& CheckAccessor(const GlbFile& file, const GltfPrimitive& primitive, GltfAttribute attribute, uint32_t componentCount)
+{
+	const int32_t index = primitive.attributes[static_cast<size_t>(attribute)];
+	assert(index >= 0);
+	const GltfAccessor& accessor = file.accessors[index];
+	assert(IsValidAttributeType(attribute, accessor));
+	assert(accessor.componentCount == componentCount);
 	return accessor;
 }
 
-GltfResult* LoadGltfFromFile(const std::string& filePath, MemoryArena& arena)
+bool IsTightFloatAccessor(const GltfAccessor& accessor)
 {
-	INIT_TIMER(timer);
+	return accessor.componentType == GLTF_FLOAT && accessor.byteStride == GetAccessorElementSize(accessor);
+}
 
-	GltfResult* result = NewObject(arena, GltfResult, arena);
-	result->success = true;
+// An attribute that isn't tightly packed floats, every batch gets turned into floats in its own stream before the vertex conversion
+struct QuantizedStream
+{
+	const GltfAccessor* accessor = nullptr;
+	float* destination = nullptr;
+	// Applied after normalization, integer positions are dequantized by the transform of their node
+	float scale[4] = { 1.f, 1.f, 1.f, 1.f };
+	float offset[4] = { 0.f, 0.f, 0.f, 0.f };
+};
+
+// Pointers into the mapped file for one primitive, resolved up front so decoding never touches the JSON
+struct PrimitiveSource
+{
+	MeshData* mesh;
+	const uint16_t* indices16;
+	const uint32_t* indices32;
+	VertexStreams streams;
+	QuantizedStream positions;
+	QuantizedStream normals;
+	QuantizedStream tangents;
+	QuantizedStream uvs;
+	QuantizedStream weights;
+	// Joints that aren't tightly packed bytes get narrowed into this stream
+	const GltfAccessor* jointAccessor;
+	uint8_t* joints;
+};
+
+// Tightly packed floats are read straight from the file, anything else gets a stream in scratch memory the workers dequantize into
+const float* ResolveFloatStream(const GltfAccessor& accessor, size_t vertexCount, QuantizedStream& quantized, MemoryArena& scratch)
+{
+	if (IsTightFloatAccessor(accessor))
+	{
+		return GetAccessorData<float>(accessor);
+	}
+	quantized.accessor = &accessor;
+	quantized.destination = scratch.Allocate<float>(vertexCount * accessor.componentCount);
+	return quantized.destination;
+}
+
+// glTF's normalized integers, the signed ones clamp at -1 so the smallest value and the one above it both decode to -1
+template <typename T>
+void DequantizeComponents(const QuantizedStream& stream, size_t first, size_t count)
+{
+	const GltfAccessor& accessor = *stream.accessor;
+	const uint32_t componentCount = accessor.componentCount;
+	for (size_t i = first; i < first + count; i++)
+	{
+		const uint8_t* element = accessor.data + i * accessor.byteStride;
+		for (uint32_t c = 0; c < componentCount; c++)
+		{
+			T component;
+			memcpy(&component, &element[c * sizeof(T)], sizeof(T));
+			float value = static_cast<float>(component);
+			if constexpr (std::is_integral_v<T>)
+			{
+				if (accessor.normalized)
+				{
+					value = std::max(value / static_cast<float>(std::numeric_limits<T>::max()), -1.f);
+				}
+			}
+			stream.destination[i * componentCount + c] = value * stream.scale[c] + stream.offset[c];
+		}
+	}
+}
 
-	Model model;
-	TinyGLTF loader;
-	std::string err;
-	std::string warn;
+void DequantizeStream(const QuantizedStream& stream, size_t first, size_t count)
+{
+	if (stream.accessor == nullptr)
+	{
+		return;
+	}
 
-	bool ret = loader.LoadBinaryFromFile(&model, &err, &warn, filePath);
+	switch (stream.accessor->componentType)
+	{
+	case GLTF_FLOAT: DequantizeComponents<float>(stream, first, count); break;
+	case GLTF_BYTE: DequantizeComponents<int8_t>(stream, first, count); break;
+	case GLTF_UNSIGNED_BYTE: DequantizeComponents<uint8_t>(stream, first, count); break;
+	case GLTF_SHORT: DequantizeComponents<int16_t>(stream, first, count); break;
+	case GLTF_UNSIGNED_SHORT: DequantizeComponents<uint16_t>(stream, first, count); break;
+	default: assert(false); break;
+	}
+}
 
-	if (!warn.empty())
+// Bone indices end up as bytes on the GPU anyway, so 16 bit joints have to fit into 8
+void NarrowJoints(const PrimitiveSource& source, size_t first, size_t count)
+{
+	const GltfAccessor& accessor = *source.jointAccessor;
+	for (size_t i = first; i < first + count; i++)
 	{
-		WARN(warn);
+		const uint8_t* element = accessor.data + i * accessor.byteStride;
+		for (size_t c = 0; c < 4; c++)
+		{
+			uint16_t joint = element[c];
+			if (accessor.componentType == GLTF_UNSIGNED_SHORT)
+			{
+				memcpy(&joint, &element[c * 2], sizeof(joint));
+			}
+			assert(joint <= UINT8_MAX);
+			source.joints[i * 4 + c] = static_cast<uint8_t>(joint);
+		}
 	}
+}
 
-	if (!err.empty())
+struct DecodeBatch
+{
+	size_t primitive;
+	size_t first;
+	size_t count;
+	bool indices;
+};
+
+size_t GetBatchCount(size_t elementCount)
+{
+	return (elementCount + GLTF_DECODE_BATCH_SIZE - 1) / GLTF_DECODE_BATCH_SIZE;
+}
+
+void DecodeIndices(const PrimitiveSource& source, size_t first, size_t count)
+{
+	static_assert(sizeof(INDEX_BUFFER_TYPE) == sizeof(uint32_t));
+	INDEX_BUFFER_TYPE* indices = source.mesh->indices;
+	if (source.indices16 != nullptr)
+	{
+		WidenIndices(&source.indices16[first], &indices[first], count);
+	}
+	else
 	{
-		ERR(err);
-		result->success = false;
+		memcpy(&indices[first], &source.indices32[first], sizeof(INDEX_BUFFER_TYPE) * count);
 	}
+}
 
-	if (!ret)
+void DecodeVertices(const PrimitiveSource& source, size_t first, size_t count)
+{
+	DequantizeStream(source.positions, first, count);
+	DequantizeStream(source.normals, first, count);
+	DequantizeStream(source.tangents, first, count);
+	DequantizeStream(source.uvs, first, count);
+	DequantizeStream(source.weights, first, count);
+	if (source.jointAccessor != nullptr)
+	{
+		NarrowJoints(source, first, count);
+	}
+	ConvertVertexStreams(source.streams, source.mesh->vertices, first, count);
+}
+
+GltfResult* LoadGltfFromFile(const char* filePath, MemoryArena& arena, WorkerPool& pool, bool optimizeMeshes, float animationSampleRate, bool compressAnimations)
+{
+	INIT_TIMER(timer);
+
+	GltfResult* result = NewObject(arena, GltfResult, arena);
+
+	// Everything that reads the file or allocates happens on this thread,
+	// the workers only convert into arrays that are already in place so the result doesn't depend on scheduling
+	ArenaScope scratch{ GetScratchArena(&arena) };
+	GlbFile file;
+	if (!ReadGlbFile(filePath, file, scratch.arena))
 	{
 		ERR("Failed to parse glTF");
+		return result;
 	}
+	result->success = true;
 
 	LOG_TIMER(timer, "Load Model Binary");
 	RESET_TIMER(timer);
 
-	if (model.skins.size() > 0)
+	if (file.skinCount > 0)
 	{
-		Accessor& inverseBindAccessor = model.accessors[model.skins[0].inverseBindMatrices];
-		assert(inverseBindAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-		assert(inverseBindAccessor.type == TINYGLTF_TYPE_MAT4);
-		const float* inverseBindMatrices = ReadBuffer<float>(model, inverseBindAccessor);
-
-		result->transformHierachy = NewObject(arena, TransformHierachy);
-		result->transformHierachy->nodeCount = model.skins[0].joints.size();
-		for (int i = 0; i < model.skins[0].joints.size(); i++)
+		const GltfSkin& skin = file.skins[0];
+		const GltfAccessor& inverseBindAccessor = file.accessors[skin.inverseBindMatrices];
+		assert(inverseBindAccessor.componentType == GLTF_FLOAT);
+		assert(inverseBindAccessor.componentCount == 16);
+		const float* inverseBindMatrices = GetAccessorData<float>(inverseBindAccessor);
+
+		result->transformHierachy = NewObjectTagged(arena, AllocationTag::Animation, TransformHierachy, arena);
+		result->transformHierachy->nodeCount = skin.jointCount;
+		for (size_t i = 0; i < skin.jointCount; i++)
 		{
-			result->transformHierachy->jointToNodeIndex[i] = model.skins[0].joints[i];
+			result->transformHierachy->jointToNodeIndex[i] = skin.joints[i];
 		}
-		for (int i = 0; i < model.nodes.size(); i++)
+		for (size_t i = 0; i < file.nodeCount; i++)
 		{
-			for (int j = 0; j < model.skins[0].joints.size(); j++)
+			for (size_t j = 0; j < skin.jointCount; j++)
 			{
-				if (model.skins[0].joints[j] == i)
+				if (static_cast<size_t>(skin.joints[j]) == i)
 				{
 					result->transformHierachy->nodeToJointIndex[i] = j;
 					break;
 				}
 			}
 		}
-		result->transformHierachy->root = CreateMatrices(model, 0, nullptr, result->transformHierachy->nodes, inverseBindMatrices);
+		result->transformHierachy->root = CreateMatrices(file, skin, 0, nullptr, result->transformHierachy->nodes, inverseBindMatrices);
+		InitializeBasePose(*result->transformHierachy);
 
 		LOG_TIMER(timer, "Load Hierachy");
 		RESET_TIMER(timer);
 
-		for (Animation& animation : model.animations)
+		size_t keyedCount = 0;
+		size_t resampledCount = 0;
+		size_t compressedCount = 0;
+		for (size_t animationIndex = 0; animationIndex < file.animationCount; animationIndex++)
 		{
+			const GltfAnimation& animation = file.animations[animationIndex];
 			assert(result->transformHierachy->animationCount < MAX_ANIMATIONS);
 			TransformAnimation& transformAnimation = result->transformHierachy->animations[result->transformHierachy->animationCount] = {};
-			transformAnimation.name = animation.name;
+			transformAnimation.name = Name::Intern(animation.name);
 
-			result->transformHierachy->animationNameToIndex.insert({ animation.name, result->transformHierachy->animationCount });
+			result->transformHierachy->animationNameToIndex.insert(transformAnimation.name, result->transformHierachy->animationCount);
 			result->transformHierachy->animationCount++;
 
-			std::vector<std::string> maskedChannels{};
-			if (animation.extras.Has("mask"))
+			ArenaArray<Name> maskedChannels{ scratch.arena, 1 };
+			if (!animation.mask.empty())
 			{
-				maskedChannels.push_back(animation.extras.Get("mask").Get<std::string>());
+				maskedChannels.newElement() = Name::Intern(animation.mask);
 			}
-			if (animation.extras.Has("mainrender"))
+			if (animation.mainRender)
 			{
 				transformAnimation.onlyInMainCamera = true;
 			}
@@ -219,71 +372,58 @@ GltfResult* LoadGltfFromFile(const std::string& filePath, MemoryArena& arena)
 
 			float maxTime = 0.f;
 
-			for (AnimationChannel& channel : animation.channels)
+			for (size_t channelIndex = 0; channelIndex < animation.channelCount; channelIndex++)
 			{
-				// Skip if channel is not in our mask
-				bool& channelActive = transformAnimation.activeChannels[channel.target_node];
-				if (maskedChannels.size() > 0)
+				const GltfAnimationChannel& channel = animation.channels[channelIndex];
+				// Channels target nodes, everything after this works with joint indices
+				const int32_t* joints = skin.joints;
+				const int32_t* joint = std::find(joints, joints + skin.jointCount, channel.targetNode);
+				if (joint == joints + skin.jointCount)
 				{
-					std::string& channelNodeName = result->transformHierachy->nodes[channel.target_node].name;
-					if (std::find(maskedChannels.begin(), maskedChannels.end(), channelNodeName) == maskedChannels.end())
-					{
-						channelActive = false;
-						//continue; //TODO: Why does this break things?
-					}
-					else
-					{
-						channelActive = true;
-					}
+					continue;
 				}
-				else
+				const size_t jointIdx = joint - joints;
+
+				// Channels of joints outside of the mask don't get loaded at all
+				if (maskedChannels.size > 0)
 				{
-					channelActive = true;
+					const Name channelNodeName = result->transformHierachy->nodes[jointIdx].name;
+					if (!maskedChannels.anyMatch([&](const Name& mask) { return channelNodeName == mask; }))
+					{
+						continue;
+					}
 				}
 
-				assert(animation.samplers.size() > channel.sampler);
-				AnimationSampler& animSampler = animation.samplers[channel.sampler];
+				const GltfAnimationSampler& animSampler = animation.samplers[channel.sampler];
 				assert(animSampler.interpolation == "LINEAR");
 
-				assert(model.accessors.size() > animSampler.input);
-				Accessor& timeAccessor = model.accessors[animSampler.input];
-				assert(timeAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-				assert(timeAccessor.type == TINYGLTF_TYPE_SCALAR);
+				const GltfAccessor& timeAccessor = file.accessors[animSampler.input];
+				assert(timeAccessor.componentType == GLTF_FLOAT);
+				assert(timeAccessor.componentCount == 1);
 
-				const float* times = ReadBuffer<float>(model, timeAccessor);
+				const float* times = GetAccessorData<float>(timeAccessor);
 
-				const XMFLOAT3* translations = nullptr;
-				const XMVECTOR* rotations = nullptr;
-				const XMFLOAT3* scales = nullptr;
+				const GltfAccessor& valueAccessor = file.accessors[animSampler.output];
+				assert(valueAccessor.componentType == GLTF_FLOAT);
+				assert(valueAccessor.count >= timeAccessor.count);
+				const float* values = GetAccessorData<float>(valueAccessor);
 
 				AnimationData* animData = nullptr;
-				AnimationJointData& animJointData = transformAnimation.jointChannels[result->transformHierachy->nodeToJointIndex[channel.target_node]];
+				AnimationJointData& animJointData = transformAnimation.jointChannels[jointIdx];
 
-				if (channel.target_path == "translation")
+				if (channel.path == GltfAnimationPath::Translation)
 				{
-					assert(model.accessors.size() > animSampler.output);
-					Accessor& valueAccessor = model.accessors[animSampler.output];
-					assert(valueAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-					assert(valueAccessor.type == TINYGLTF_TYPE_VEC3);
-					translations = ReadBuffer<XMFLOAT3>(model, valueAccessor);
+					assert(valueAccessor.componentCount == 3);
 					animData = &animJointData.translations;
 				}
-				else if (channel.target_path == "rotation")
+				else if (channel.path == GltfAnimationPath::Rotation)
 				{
-					assert(model.accessors.size() > animSampler.output);
-					Accessor& valueAccessor = model.accessors[animSampler.output];
-					assert(valueAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-					assert(valueAccessor.type == TINYGLTF_TYPE_VEC4);
-					rotations = ReadBuffer<XMVECTOR>(model, valueAccessor);
+					assert(valueAccessor.componentCount == 4);
 					animData = &animJointData.rotations;
 				}
-				else if (channel.target_path == "scale")
+				else if (channel.path == GltfAnimationPath::Scale)
 				{
-					assert(model.accessors.size() > animSampler.output);
-					Accessor& valueAccessor = model.accessors[animSampler.output];
-					assert(valueAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-					assert(valueAccessor.type == TINYGLTF_TYPE_VEC3);
-					scales = ReadBuffer<XMFLOAT3>(model, valueAccessor);
+					assert(valueAccessor.componentCount == 3);
 					animData = &animJointData.scales;
 				}
 				else
@@ -292,183 +432,269 @@ GltfResult* LoadGltfFromFile(const std::string& filePath, MemoryArena& arena)
 					continue;
 				}
 
-				animData->times = NewArray(arena, float, timeAccessor.count);
-				animData->data = NewArray(arena, XMVECTOR, timeAccessor.count);
-
-				// TODO: resample animation?
-				for (int i = 0; i < timeAccessor.count; i++)
+				// Keys are read into scratch memory first, they only end up in the arena if the channel can't be compressed or resampled
+				ArenaScope keyScratch{ scratch.arena };
+				AnimationData keys{};
+				keys.times = NewArray(keyScratch.arena, float, timeAccessor.count);
+				keys.data = NewArray(keyScratch.arena, XMVECTOR, timeAccessor.count);
+				for (size_t i = 0; i < timeAccessor.count; i++)
 				{
-					if (translations != nullptr)
-					{
-						animData->data[animData->frameCount] = XMLoadFloat3(&translations[i]);
-					}
-					else if (rotations != nullptr)
-					{
-						animData->data[animData->frameCount] = rotations[i];
-					}
-					else if (scales != nullptr)
+					// The BIN chunk is only 4 byte aligned, so the values can't be read as XMVECTOR directly
+					if (valueAccessor.componentCount == 4)
 					{
-						animData->data[animData->frameCount] = XMLoadFloat3(&scales[i]);
+						keys.data[keys.frameCount] = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&values[i * 4]));
 					}
 					else
 					{
-						assert(false);
+						keys.data[keys.frameCount] = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&values[i * 3]));
 					}
 
-					animData->times[animData->frameCount] = times[i];
-					animData->frameCount++;
+					keys.times[keys.frameCount] = times[i];
+					keys.frameCount++;
 
 					maxTime = std::max(maxTime, times[i]);
 				}
+
+				if (keys.frameCount == 0)
+				{
+					continue;
+				}
+				keyedCount++;
+				transformAnimation.jointMask.Set(jointIdx, true);
+				const bool rotation = channel.path == GltfAnimationPath::Rotation;
+				// Compressing resampled keys would only bring back the error of resampling, the original keys are just as easy to thin out
+				if (compressAnimations && CompressAnimationData(keys, rotation, ANIMATION_COMPRESSION_TOLERANCE, *animData, arena))
+				{
+					compressedCount++;
+					continue;
+				}
+				if (animationSampleRate > 0.f && ResampleAnimationData(keys, rotation, animationSampleRate, ANIMATION_RESAMPLE_TOLERANCE, *animData, arena))
+				{
+					resampledCount++;
+					continue;
+				}
+
+				*animData = keys;
+				animData->times = NewArrayTagged(arena, AllocationTag::Animation, float, keys.frameCount);
+				animData->data = NewArrayTagged(arena, AllocationTag::Animation, XMVECTOR, keys.frameCount);
+				memcpy(animData->times, keys.times, sizeof(float) * keys.frameCount);
+				memcpy(animData->data, keys.data, sizeof(XMVECTOR) * keys.frameCount);
 			}
 
 			transformAnimation.duration = maxTime;
 		}
+		if (keyedCount > 0)
+		{
+			LOG("Resampled {} and compressed {} of {} animation channels in {}", resampledCount, compressedCount, keyedCount, filePath);
+		}
 
 		LOG_TIMER(timer, "Animations");
 	}
 	
 	RESET_TIMER(timer);
 
+	size_t primitiveCount = 0;
+	for (size_t i = 0; i < file.meshCount; i++)
+	{
+		primitiveCount += file.meshes[i].primitiveCount;
+	}
+	PrimitiveSource* sources = NewArray(scratch.arena, PrimitiveSource, primitiveCount);
+	size_t batchCount = 0;
+
 	// this is for auto material naming. TODO: this might not match the way the material.txt names were generated from the gltf file
 	int meshIndex = 0;
 
-	for (Mesh& mesh : model.meshes)
+	for (size_t i = 0; i < file.meshCount; i++)
 	{
-		for (Primitive& primitive : mesh.primitives)
+		for (size_t j = 0; j < file.meshes[i].primitiveCount; j++)
 		{
+			const GltfPrimitive& primitive = file.meshes[i].primitives[j];
 			MeshFile& meshFile = result->meshes.newElement();
+			PrimitiveSource& source = sources[meshIndex];
+			source.mesh = &meshFile.mesh;
 
-			Accessor& indexAccessor = model.accessors[primitive.indices];
-			assert(indexAccessor.type == TINYGLTF_TYPE_SCALAR);
+			assert(primitive.indices >= 0);
+			const GltfAccessor& indexAccessor = file.accessors[primitive.indices];
+			assert(indexAccessor.componentCount == 1);
+			assert(indexAccessor.byteStride == GetAccessorElementSize(indexAccessor));
 
-			meshFile.mesh.indices = NewArray(arena, INDEX_BUFFER_TYPE, indexAccessor.count);
+			meshFile.mesh.indices = NewArrayTagged(arena, AllocationTag::Mesh, INDEX_BUFFER_TYPE, indexAccessor.count);
 			meshFile.mesh.indexCount = indexAccessor.count;
-			
-			if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+
+			if (indexAccessor.componentType == GLTF_UNSIGNED_SHORT)
 			{
-				const uint16_t* indexData = ReadBuffer<uint16_t>(model, indexAccessor);
-				for (int i = 0; i < meshFile.mesh.indexCount; i++)
-				{
-					meshFile.mesh.indices[i] = indexData[i];
-				}
+				source.indices16 = GetAccessorData<uint16_t>(indexAccessor);
 			}
-			else if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
+			else if (indexAccessor.componentType == GLTF_UNSIGNED_INT)
 			{
-				const uint32_t* indexData = ReadBuffer<uint32_t>(model, indexAccessor);
-				memcpy_s(meshFile.mesh.indices, sizeof(INDEX_BUFFER_TYPE) * meshFile.mesh.indexCount, indexData, sizeof(INDEX_BUFFER_TYPE)* indexAccessor.count);
+				source.indices32 = GetAccessorData<uint32_t>(indexAccessor);
 			}
 			else
 			{
 				assert(false);
 			}
 
-			Accessor& positionAccessor = CheckAccessor(model, primitive, GLTF_POSITION, TINYGLTF_TYPE_VEC3);
-			const float* positionData = ReadBuffer<float>(model, positionAccessor);
-			Accessor& normalAccessor = CheckAccessor(model, primitive, GLTF_NORMAL, TINYGLTF_TYPE_VEC3);
-			const float* normalData = ReadBuffer<float>(model, normalAccessor);
-			Accessor& tangentAccessor = CheckAccessor(model, primitive, GLTF_TANGENT, TINYGLTF_TYPE_VEC4);
-			const float* tangentData = ReadBuffer<float>(model, tangentAccessor);
-			Accessor& uvAccessor = CheckAccessor(model, primitive, GLTF_TEXCOORD0, TINYGLTF_TYPE_VEC2);
-			const float* uvData = ReadBuffer<float>(model, uvAccessor);
+			const GltfAccessor& positionAccessor = CheckAccessor(file, primitive, GltfAttribute::Position, 3);
+			const GltfAccessor& normalAccessor = CheckAccessor(file, primitive, GltfAttribute::Normal, 3);
+			const GltfAccessor& tangentAccessor = CheckAccessor(file, primitive, GltfAttribute::Tangent, 4);
+			const GltfAccessor& uvAccessor = CheckAccessor(file, primitive, GltfAttribute::TexCoord0, 2);
+			assert(normalAccessor.count >= positionAccessor.count);
+			assert(tangentAccessor.count >= positionAccessor.count);
+			assert(uvAccessor.count >= positionAccessor.count);
 
-			meshFile.mesh.vertices = NewArray(arena, Vertex, positionAccessor.count);
-			meshFile.mesh.vertexCount = positionAccessor.count;
+			const size_t vertexCount = positionAccessor.count;
+			meshFile.mesh.vertices = NewArrayTagged(arena, AllocationTag::Mesh, Vertex, vertexCount);
+			meshFile.mesh.vertexCount = vertexCount;
 
-			for (int i = 0; i < meshFile.mesh.vertexCount; i++)
+			if (positionAccessor.componentType != GLTF_FLOAT)
 			{
-				assert(i < positionAccessor.count);
-				assert(i < normalAccessor.count);
-				assert(i < tangentAccessor.count);
-				assert(i < uvAccessor.count);
-				Vertex& vert = meshFile.mesh.vertices[i];
-
-				vert.position.x = positionData[i * 3 + 0];
-				vert.position.y = positionData[i * 3 + 1];
-				vert.position.z = positionData[i * 3 + 2];
-
-				vert.normal.x = normalData[i * 3 + 0];
-				vert.normal.y = normalData[i * 3 + 1];
-				vert.normal.z = normalData[i * 3 + 2];
-
-				vert.tangent.x = tangentData[i * 4 + 0];
-				vert.tangent.y = tangentData[i * 4 + 1];
-				vert.tangent.z = tangentData[i * 4 + 2];
-
-				XMVECTOR bitangent = XMVectorScale(XMVector3Cross(XMLoadFloat3(&vert.normal), XMLoadFloat3(&vert.tangent)), tangentData[i * 4 + 3]);
-				XMStoreFloat3(&vert.bitangent, bitangent);
-
-				vert.uv.x = uvData[i * 2 + 0];
-				vert.uv.y = uvData[i * 2 + 1];
+				// Quantized positions are only meaningful with the scale and offset the node that instances the mesh puts on them.
+				// Float meshes ignore node transforms, so only those two parts are applied and rotations stay ignored like before.
+				// Skinned meshes ignore their node, their dequantization is part of the inverse bind matrices
+				const GltfNode* meshNode = std::find_if(file.nodes, file.nodes + file.nodeCount, [&](const GltfNode& node) { return node.mesh == static_cast<int32_t>(i); });
+				if (meshNode != file.nodes + file.nodeCount && meshNode->skin < 0)
+				{
+					memcpy(source.positions.scale, meshNode->scale, sizeof(meshNode->scale));
+					memcpy(source.positions.offset, meshNode->translation, sizeof(meshNode->translation));
+				}
 			}
+			source.streams.positions = ResolveFloatStream(positionAccessor, vertexCount, source.positions, scratch.arena);
+			source.streams.normals = ResolveFloatStream(normalAccessor, vertexCount, source.normals, scratch.arena);
+			source.streams.tangents = ResolveFloatStream(tangentAccessor, vertexCount, source.tangents, scratch.arena);
+			source.streams.uvs = ResolveFloatStream(uvAccessor, vertexCount, source.uvs, scratch.arena);
 
 			if (result->transformHierachy != nullptr)
 			{
-				Accessor& jointAccessor = model.accessors[primitive.attributes[GLTF_JOINTS]];
-				assert(jointAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE);
-				assert(jointAccessor.type == TINYGLTF_TYPE_VEC4);
-				const uint8_t* jointData = ReadBuffer<uint8_t>(model, jointAccessor);
-
-				Accessor& weightAccessor = model.accessors[primitive.attributes[GLTF_WEIGHTS]];
-				assert(weightAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-				assert(weightAccessor.type == TINYGLTF_TYPE_VEC4);
-				const float* weightData = ReadBuffer<float>(model, weightAccessor);
-
-				for (int i = 0; i < meshFile.mesh.vertexCount; i++)
+				const GltfAccessor& jointAccessor = CheckAccessor(file, primitive, GltfAttribute::Joints0, 4);
+				assert(jointAccessor.count >= vertexCount);
+				if (jointAccessor.componentType == GLTF_UNSIGNED_BYTE && jointAccessor.byteStride == 4)
+				{
+					source.streams.joints = GetAccessorData<uint8_t>(jointAccessor);
+				}
+				else
 				{
-					assert(i < jointAccessor.count);
-					assert(i < weightAccessor.count);
-					Vertex& vert = meshFile.mesh.vertices[i];
-
-					vert.boneIndices.x = jointData[i * 4 + 0];
-					vert.boneIndices.y = jointData[i * 4 + 1];
-					vert.boneIndices.z = jointData[i * 4 + 2];
-					vert.boneIndices.w = jointData[i * 4 + 3];
-
-					float w0 = weightData[i * 4 + 0];
-					float w1 = weightData[i * 4 + 1];
-					float w2 = weightData[i * 4 + 2];
-					float w3 = weightData[i * 4 + 3];
-					assert(abs(1. - (w0 + w1 + w2 + w3)) < 0.01);
-
-					vert.boneWeights.x = w0;
-					vert.boneWeights.y = w1;
-					vert.boneWeights.z = w2;
-					vert.boneWeights.w = w3;
+					source.jointAccessor = &jointAccessor;
+					source.joints = scratch.arena.Allocate<uint8_t>(vertexCount * 4);
+					source.streams.joints = source.joints;
 				}
+
+				const GltfAccessor& weightAccessor = CheckAccessor(file, primitive, GltfAttribute::Weights0, 4);
+				assert(weightAccessor.count >= vertexCount);
+				source.streams.weights = ResolveFloatStream(weightAccessor, vertexCount, source.weights, scratch.arena);
 			}
 
+			batchCount += GetBatchCount(meshFile.mesh.vertexCount) + GetBatchCount(meshFile.mesh.indexCount);
+
 			if (primitive.material >= 0)
 			{
-				assert(model.materials.size() > primitive.material);
-				std::string matName = model.materials[primitive.material].name;
-				std::string fileNameWithoutExtension = std::filesystem::path(filePath).filename().replace_extension("").string();
-
-				std::regex matRegex("Material_(\\d+)");
-				auto regexBegin = std::sregex_iterator(matName.begin(), matName.end(), matRegex);
-				auto regexEnd = std::sregex_iterator();
-				
-				if (std::distance(regexBegin, regexEnd) > 0)
+				const std::string_view matName = file.materialNames[primitive.material];
+				const std::string_view materialNumber = FindMaterialNumber(matName);
+				if (!materialNumber.empty())
 				{
-					std::string matchedGroup = (*regexBegin)[1].str();
-					matName = std::format("{}_{}", fileNameWithoutExtension, matchedGroup);
-				}
+					std::string_view fileNameWithoutExtension = filePath;
+					fileNameWithoutExtension.remove_prefix(std::min(fileNameWithoutExtension.find_last_of("/\\") + 1, fileNameWithoutExtension.size()));
+					fileNameWithoutExtension = fileNameWithoutExtension.substr(0, fileNameWithoutExtension.rfind('.'));
 
-				meshFile.materialName = matName.c_str();
-				meshFile.materialHash = std::hash<std::string>{}(meshFile.materialName.str);
+					char nameBuffer[256];
+					const auto formatted = std::format_to_n(nameBuffer, sizeof(nameBuffer), "{}_{}", fileNameWithoutExtension, materialNumber);
+					meshFile.materialName = Name::Intern({ nameBuffer, std::min<size_t>(formatted.size, sizeof(nameBuffer)) });
+				}
+				else
+				{
+					meshFile.materialName = Name::Intern(matName);
+				}
 			}
 			else
 			{
 				meshFile.materialName = "default";
-				meshFile.materialHash = std::hash<std::string>{}(meshFile.materialName.str);
 			}
 
 			meshIndex++;
 		}
 	}
 
+	DecodeBatch* batches = NewArray(scratch.arena, DecodeBatch, batchCount);
+	size_t batchIndex = 0;
+	for (size_t i = 0; i < primitiveCount; i++)
+	{
+		const MeshData& mesh = *sources[i].mesh;
+		for (size_t first = 0; first < mesh.vertexCount; first += GLTF_DECODE_BATCH_SIZE)
+		{
+			batches[batchIndex++] = { i, first, std::min<size_t>(GLTF_DECODE_BATCH_SIZE, mesh.vertexCount - first), false };
+		}
+		for (size_t first = 0; first < mesh.indexCount; first += GLTF_DECODE_BATCH_SIZE)
+		{
+			batches[batchIndex++] = { i, first, std::min<size_t>(GLTF_DECODE_BATCH_SIZE, mesh.indexCount - first), true };
+		}
+	}
+	assert(batchIndex == batchCount);
+
+	pool.ParallelFor(batchCount, [&](size_t i)
+	{
+		const DecodeBatch& batch = batches[i];
+		if (batch.indices)
+		{
+			DecodeIndices(sources[batch.primitive], batch.first, batch.count);
+		}
+		else
+		{
+			DecodeVertices(sources[batch.primitive], batch.first, batch.count);
+		}
+	});
+
 	LOG_TIMER(timer, "Meshes");
 	RESET_TIMER(timer);
+
+	// Meshlets and LODs get built into scratch memory by the workers and copied into the arena here, the arena might not be thread safe
+	size_t* weldedCounts = NewArray(scratch.arena, size_t, primitiveCount);
+	size_t* meshletCounts = NewArray(scratch.arena, size_t, primitiveCount);
+	Meshlet** meshlets = NewArray(scratch.arena, Meshlet*, primitiveCount);
+	INDEX_BUFFER_TYPE** lodIndices = NewArray(scratch.arena, INDEX_BUFFER_TYPE*, primitiveCount);
+	for (size_t i = 0; i < primitiveCount; i++)
+	{
+		meshlets[i] = NewArray(scratch.arena, Meshlet, GetMaxMeshletCount(sources[i].mesh->indexCount));
+		if (optimizeMeshes)
+		{
+			lodIndices[i] = NewArray(scratch.arena, INDEX_BUFFER_TYPE, GetMaxLodIndexCount(sources[i].mesh->indexCount));
+		}
+	}
+
+	pool.ParallelFor(primitiveCount, [&](size_t i)
+	{
+		ArenaScope meshScratch{ GetScratchArena(&arena) };
+		if (optimizeMeshes)
+		{
+			weldedCounts[i] = OptimizeMesh(*sources[i].mesh, meshScratch.arena);
+			GenerateLods(*sources[i].mesh, lodIndices[i], meshScratch.arena);
+		}
+		meshletCounts[i] = BuildMeshlets(*sources[i].mesh, meshlets[i], meshScratch.arena);
+	});
+
+	size_t weldedCount = 0;
+	for (size_t i = 0; i < primitiveCount; i++)
+	{
+		MeshData& mesh = *sources[i].mesh;
+		mesh.meshletCount = meshletCounts[i];
+		mesh.meshlets = NewArrayTagged(arena, AllocationTag::Mesh, Meshlet, mesh.meshletCount);
+		memcpy(mesh.meshlets, meshlets[i], sizeof(Meshlet) * mesh.meshletCount);
+
+		for (size_t level = 0; level < mesh.lodCount; level++)
+		{
+			MeshLod& lod = mesh.lods[level];
+			INDEX_BUFFER_TYPE* indices = NewArrayTagged(arena, AllocationTag::Mesh, INDEX_BUFFER_TYPE, lod.indexCount);
+			memcpy(indices, lod.indices, sizeof(INDEX_BUFFER_TYPE) * lod.indexCount);
+			lod.indices = indices;
+		}
+
+		weldedCount += weldedCounts[i];
+	}
+	if (weldedCount > 0)
+	{
+		LOG("Welded {} duplicate vertices in {}", weldedCount, filePath);
+	}
+
+	LOG_TIMER(timer, "Mesh Optimization, LODs and Meshlets");
+	RESET_TIMER(timer);
 	
 	return result;
 }
@@ -491,7 +717,17 @@ void TransformHierachy::UpdateNode(TransformNode* node)
 	}
 }
 
-void TransformHierachy::SetAnimationActive(std::string name, bool state)
+void TransformHierachy::SetAnimationActive(Name name, bool state)
+{
+	size_t* animationIndex = animationNameToIndex.find(name);
+	assert(animationIndex != nullptr);
+	animations[*animationIndex].active = state;
+}
+
+void TransformHierachy::SetAnimationWeight(Name name, float weight, AnimationBlendMode blendMode)
 {
-	animations[animationNameToIndex[name]].active = state;
+	size_t* animationIndex = animationNameToIndex.find(name);
+	assert(animationIndex != nullptr);
+	animations[*animationIndex].weight = weight;
+	animations[*animationIndex].blendMode = blendMode;
 }
\ No newline at end of file
@@ -1,15 +1,22 @@
 #pragma once
 
-#define GLTF_POSITION "POSITION"
-#define GLTF_NORMAL "NORMAL"
-#define GLTF_TANGENT "TANGENT"
-#define GLTF_TEXCOORD0 "TEXCOORD_0"
-#define GLTF_JOINTS "JOINTS_0"
-#define GLTF_WEIGHTS "WEIGHTS_0"
+// Vertices/indices per parallel decode job, big primitives get split so the work spreads evenly
+#define GLTF_DECODE_BATCH_SIZE 16384
+// Animation channels get resampled to at least this many evenly spaced keys per second while importing
+#define ANIMATION_SAMPLE_RATE 30.f
+// Largest difference a resampled channel may have to its keys in any component, radians are about twice that for rotations
+#define ANIMATION_RESAMPLE_TOLERANCE 0.001f
+// Same for compressed channels, they keep only the keys they need to stay within it
+#define ANIMATION_COMPRESSION_TOLERANCE 0.001f
+// Joints of an AnimationPose share a vector, one joint per lane
+#define POSE_LANES 4
+#define POSE_GROUPS (MAX_BONES / POSE_LANES)
 
 #include "../core/Memory.h"
+#include "../core/HashMap.h"
 #include "../core/Materials.h"
 #include "../core/Vertex.h"
+#include "../core/WorkerPool.h"
 using namespace VertexData;
 
 #include <string>
@@ -27,7 +34,19 @@ struct TransformNode
 	TransformNode* parent;
 	TransformNode* children[MAX_CHILDREN];
 	size_t childCount;
-	std::string name;
+	Name name;
+};
+
+/// <summary>
+/// Keys of a channel after CompressAnimationData, every component is 16 bits relative to the range of the channel.
+/// Rotations keep their three smallest components in x, y and z and the index of the largest one in w.
+/// </summary>
+struct CompressedAnimationData
+{
+	XMUSHORTN4* keys;
+	XMFLOAT4 rangeMin;
+	XMFLOAT4 rangeExtent;
+	bool rotation;
 };
 
 struct AnimationData
@@ -35,6 +54,74 @@ struct AnimationData
 	size_t frameCount;
 	float* times;
 	XMVECTOR* data;
+	// First key after the time last sampled, playback moving forward only has to look at the keys from here on
+	size_t cursor = 0;
+	// Non zero for resampled channels, key i is at startTime + i / sampleRate and times is null
+	float sampleRate = 0.f;
+	float startTime = 0.f;
+	// Set for compressed channels, data is null for them
+	const CompressedAnimationData* compressed = nullptr;
+};
+
+/// <summary>
+/// Local transforms of POSE_LANES joints as structure of arrays, lane i of every vector belongs to the same joint.
+/// </summary>
+struct PoseGroup
+{
+	XMVECTOR translation[3];
+	XMVECTOR rotation[4];
+	XMVECTOR scale[3];
+};
+
+/// <summary>
+/// Translation, rotation and scale of every joint, joint i is in lane i % POSE_LANES of group i / POSE_LANES.
+/// </summary>
+struct AnimationPose
+{
+	PoseGroup groups[POSE_GROUPS];
+};
+
+/// <summary>
+/// One bit per joint, bit i % 64 of word i / 64 is joint i.
+/// </summary>
+struct JointMask
+{
+	uint64_t words[(MAX_BONES + 63) / 64] = {};
+
+	bool Get(size_t joint) const
+	{
+		return (words[joint / 64] >> (joint % 64)) & 1;
+	}
+
+	void Set(size_t joint, bool state)
+	{
+		const uint64_t bit = uint64_t{ 1 } << (joint % 64);
+		words[joint / 64] = state ? words[joint / 64] | bit : words[joint / 64] & ~bit;
+	}
+
+	// Bit i is lane i of the PoseGroup
+	uint32_t GetGroup(size_t group) const
+	{
+		const size_t firstJoint = group * POSE_LANES;
+		return static_cast<uint32_t>(words[firstJoint / 64] >> (firstJoint % 64)) & ((1u << POSE_LANES) - 1);
+	}
+
+	JointMask& operator|=(const JointMask& other)
+	{
+		for (size_t i = 0; i < _countof(words); i++)
+		{
+			words[i] |= other.words[i];
+		}
+		return *this;
+	}
+};
+
+enum class AnimationBlendMode
+{
+	// Blends from the pose so far towards the animation by its weight
+	Override,
+	// Adds the difference between the animation and the base pose, scaled by its weight
+	Additive,
 };
 
 struct AnimationJointData
@@ -47,13 +134,17 @@ struct AnimationJointData
 struct TransformAnimation
 {
 	AnimationJointData jointChannels[MAX_BONES];
-	bool activeChannels[MAX_BONES];
+	// Joints with channels, importing leaves out the ones outside of the mask the animation has in its extras
+	JointMask jointMask{};
 	size_t channelCount = 0;
-	std::string name{};
+	Name name{};
 
 	bool active = false;
 	bool loop = true;
 	bool onlyInMainCamera = false;
+	// How this layer combines with the active animations before it, see BlendAnimationLayers
+	float weight = 1.f;
+	AnimationBlendMode blendMode = AnimationBlendMode::Override;
 
 	float time = 0.f;
 	float duration = 0.f;
@@ -65,8 +156,10 @@ struct TransformHierachy
 	TransformNode nodes[MAX_BONES];
 	size_t nodeCount;
 	TransformNode* root;
+	// baseLocal of every joint taken apart once by InitializeBasePose, unused lanes hold the identity
+	AnimationPose basePose;
 	TransformAnimation animations[MAX_ANIMATIONS];
-	std::unordered_map<std::string, size_t> animationNameToIndex{};
+	ArenaHashMap<Name, size_t> animationNameToIndex;
 
 	size_t animationCount;
 	// nodeIdx = jointToNodeIndex[jointIdx]
@@ -74,15 +167,17 @@ struct TransformHierachy
 	// jointIdx = nodeToJointIndex[nodeIdx]
 	size_t nodeToJointIndex[MAX_BONES];
 
+	TransformHierachy(MemoryArena& arena) : animationNameToIndex(arena, MAX_ANIMATIONS) {}
+
 	void UpdateNode(TransformNode* node);
-	void SetAnimationActive(std::string name, bool state);
+	void SetAnimationActive(Name name, bool state);
+	void SetAnimationWeight(Name name, float weight, AnimationBlendMode blendMode = AnimationBlendMode::Override);
 };
 
 struct MeshFile
 {
 	MeshData mesh = {};
-	FixedStr materialName = "";
-	uint64_t materialHash = 0;
+	Name materialName = "";
 };
 
 struct GltfResult
@@ -96,4 +191,12 @@ struct GltfResult
 
 MeshData CreateQuad(float width, float height, MemoryArena& arena);
 MeshData CreateQuadY(float width, float height, MemoryArena& arena);
-GltfResult* LoadGltfFromFile(const std::string& filePath, MemoryArena& arena);
+/// <summary>
+/// Parses a binary glTF file with ReadGlbFile, the file stays mapped only while loading. Primitives get decoded in parallel on the pool, the order of GltfResult::meshes doesn't depend on the thread count.
+/// Meshes get reordered by OptimizeMesh and get LODs unless optimizeMeshes is false, meshlets get built either way.
+/// Attributes can be quantized (KHR_mesh_quantization) and compressed (EXT_meshopt_compression), integer positions of unskinned meshes get the scale and translation of their node.
+/// Animation channels get resampled with ResampleAnimationData at animationSampleRate, channels that can't be within ANIMATION_RESAMPLE_TOLERANCE and a rate of 0 keep their keys.
+/// compressAnimations stores channels with CompressAnimationData instead where it can, that trades the search free sampling for less memory.
+/// </summary>
+GltfResult* LoadGltfFromFile(const char* filePath, MemoryArena& arena, WorkerPool& pool = GetWorkerPool(), bool optimizeMeshes = true, float animationSampleRate = ANIMATION_SAMPLE_RATE,
+	bool compressAnimations = false);
@@ -0,0 +1,376 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cassert>
+
+VertexCacheStats AnalyzeVertexCache(const INDEX_BUFFER_TYPE* indices, size_t indexCount, size_t vertexCount, size_t cacheSize)
+{
+	VertexCacheStats stats{};
+	if (indexCount == 0 || vertexCount == 0) return stats;
+
+	ArenaScope scratch{ GetScratchArena() };
+
+	// A vertex is cached as long as less than cacheSize misses happened after its own, that is exactly FIFO
+	uint32_t* cacheTime = NewArray(scratch.arena, uint32_t, vertexCount);
+	uint32_t timestamp = static_cast<uint32_t>(cacheSize) + 1;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		INDEX_BUFFER_TYPE vertex = indices[i];
+		assert(vertex < vertexCount);
+		if (timestamp - cacheTime[vertex] > cacheSize)
+		{
+			cacheTime[vertex] = timestamp++;
+			stats.transformCount++;
+		}
+	}
+
+	stats.acmr = static_cast<float>(stats.transformCount) / (indexCount / 3);
+	stats.atvr = static_cast<float>(stats.transformCount) / vertexCount;
+	return stats;
+}
+
+namespace
+{
+	// Compares the whole vertex bytewise, so -0 and 0 or different NaNs stay separate vertices
+	struct VertexBytes
+	{
+		const Vertex* vertex;
+
+		bool operator==(const VertexBytes& other) const
+		{
+			return memcmp(vertex, other.vertex, sizeof(Vertex)) == 0;
+		}
+	};
+
+	struct VertexBytesHash
+	{
+		uint64_t operator()(const VertexBytes& key) const
+		{
+			return HashBytes(key.vertex, sizeof(Vertex));
+		}
+	};
+}
+
+size_t WeldVertices(MeshData& mesh, MemoryArena& scratch)
+{
+	ArenaScope scope{ scratch };
+	ArenaHashMap<VertexBytes, uint32_t, VertexBytesHash> uniqueVertices{ scope.arena, mesh.vertexCount };
+	uint32_t* remap = NewArray(scope.arena, uint32_t, mesh.vertexCount);
+	uint32_t uniqueCount = 0;
+
+	for (size_t vertex = 0; vertex < mesh.vertexCount; vertex++)
+	{
+		const uint32_t* existing = uniqueVertices.find({ &mesh.vertices[vertex] });
+		if (existing != nullptr)
+		{
+			remap[vertex] = *existing;
+			continue;
+		}
+
+		// Keys point at the compacted copy, the original slot can get overwritten later on
+		mesh.vertices[uniqueCount] = mesh.vertices[vertex];
+		uniqueVertices.insert({ &mesh.vertices[uniqueCount] }, uniqueCount);
+		remap[vertex] = uniqueCount++;
+	}
+
+	for (size_t i = 0; i < mesh.indexCount; i++)
+	{
+		assert(mesh.indices[i] < mesh.vertexCount);
+		mesh.indices[i] = remap[mesh.indices[i]];
+	}
+
+	const size_t weldedCount = mesh.vertexCount - uniqueCount;
+	mesh.vertexCount = uniqueCount;
+	return weldedCount;
+}
+
+uint64_t HashMeshContent(const MeshData& mesh)
+{
+	uint64_t hash = mesh.packedVertices != nullptr
+		? HashBytes(mesh.packedVertices, sizeof(PackedVertex) * mesh.vertexCount)
+		: HashBytes(mesh.vertices, sizeof(Vertex) * mesh.vertexCount);
+	return HashBytes(mesh.indices, sizeof(INDEX_BUFFER_TYPE) * mesh.indexCount, hash);
+}
+
+size_t OptimizeVertexCache(INDEX_BUFFER_TYPE* indices, size_t indexCount, size_t vertexCount, MemoryArena& scratch, size_t* clusterStarts)
+{
+	assert(indexCount % 3 == 0);
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) return 0;
+
+	ArenaScope scope{ scratch };
+
+	// Triangles using each vertex, liveCount drops as they get emitted
+	uint32_t* liveCount = NewArray(scope.arena, uint32_t, vertexCount);
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		assert(indices[i] < vertexCount);
+		liveCount[indices[i]]++;
+	}
+
+	uint32_t* adjacencyOffsets = NewArray(scope.arena, uint32_t, vertexCount + 1);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveCount[vertex];
+	}
+
+	uint32_t* adjacencyFill = NewArray(scope.arena, uint32_t, vertexCount);
+	uint32_t* adjacency = NewArray(scope.arena, uint32_t, indexCount);
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		INDEX_BUFFER_TYPE vertex = indices[i];
+		adjacency[adjacencyOffsets[vertex] + adjacencyFill[vertex]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	uint32_t* cacheTime = NewArray(scope.arena, uint32_t, vertexCount);
+	bool* emitted = NewArray(scope.arena, bool, triangleCount);
+	// Vertices of recently emitted triangles, the first place to look for a new fan after a dead end
+	uint32_t* deadEndStack = NewArray(scope.arena, uint32_t, indexCount);
+	size_t deadEndSize = 0;
+	INDEX_BUFFER_TYPE* output = NewArray(scope.arena, INDEX_BUFFER_TYPE, indexCount);
+	size_t outputCount = 0;
+
+	uint32_t timestamp = VERTEX_CACHE_SIZE + 1;
+	size_t inputCursor = 0;
+	size_t clusterCount = 0;
+	if (clusterStarts != nullptr)
+	{
+		clusterStarts[clusterCount] = 0;
+	}
+	clusterCount++;
+
+	int64_t fanVertex = indices[0];
+	while (fanVertex >= 0)
+	{
+		// Emit every remaining triangle around the fan vertex, their vertices are the candidates for the next fan
+		const size_t candidatesBegin = deadEndSize;
+		for (uint32_t a = adjacencyOffsets[fanVertex]; a < adjacencyOffsets[fanVertex + 1]; a++)
+		{
+			uint32_t triangle = adjacency[a];
+			if (emitted[triangle]) continue;
+
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				INDEX_BUFFER_TYPE vertex = indices[triangle * 3 + corner];
+				output[outputCount++] = vertex;
+				deadEndStack[deadEndSize++] = vertex;
+				liveCount[vertex]--;
+				if (timestamp - cacheTime[vertex] > VERTEX_CACHE_SIZE)
+				{
+					cacheTime[vertex] = timestamp++;
+				}
+			}
+			emitted[triangle] = true;
+		}
+
+		// Prefer the oldest candidate that is still going to be cached after its own fan got emitted
+		int64_t nextVertex = -1;
+		int64_t bestPriority = -1;
+		for (size_t c = candidatesBegin; c < deadEndSize; c++)
+		{
+			uint32_t candidate = deadEndStack[c];
+			if (liveCount[candidate] == 0) continue;
+
+			int64_t priority = 0;
+			uint32_t age = timestamp - cacheTime[candidate];
+			if (age + 2 * liveCount[candidate] <= VERTEX_CACHE_SIZE)
+			{
+				priority = age;
+			}
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				nextVertex = candidate;
+			}
+		}
+
+		if (nextVertex < 0)
+		{
+			while (deadEndSize > 0 && nextVertex < 0)
+			{
+				uint32_t vertex = deadEndStack[--deadEndSize];
+				if (liveCount[vertex] > 0) nextVertex = vertex;
+			}
+			while (inputCursor < vertexCount && nextVertex < 0)
+			{
+				if (liveCount[inputCursor] > 0) nextVertex = inputCursor;
+				inputCursor++;
+			}
+
+			if (nextVertex >= 0)
+			{
+				if (clusterStarts != nullptr)
+				{
+					clusterStarts[clusterCount] = outputCount / 3;
+				}
+				clusterCount++;
+			}
+		}
+
+		fanVertex = nextVertex;
+	}
+
+	assert(outputCount == indexCount);
+	assert(clusterCount <= triangleCount);
+	memcpy(indices, output, sizeof(INDEX_BUFFER_TYPE) * indexCount);
+	return clusterCount;
+}
+
+namespace
+{
+	struct OverdrawCluster
+	{
+		size_t start;
+		size_t end;
+		float sortKey;
+	};
+
+	// Area weighted, the triangle normal is the unnormalized cross product
+	void AccumulateTriangles(const INDEX_BUFFER_TYPE* indices, const Vertex* vertices, size_t firstTriangle, size_t endTriangle, XMVECTOR& centroid, XMVECTOR& normal, float& area)
+	{
+		for (size_t triangle = firstTriangle; triangle < endTriangle; triangle++)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&vertices[indices[triangle * 3 + 0]].position);
+			XMVECTOR p1 = XMLoadFloat3(&vertices[indices[triangle * 3 + 1]].position);
+			XMVECTOR p2 = XMLoadFloat3(&vertices[indices[triangle * 3 + 2]].position);
+			XMVECTOR cross = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+			float triangleArea = XMVectorGetX(XMVector3Length(cross));
+
+			XMVECTOR triangleCenter = XMVectorScale(XMVectorAdd(XMVectorAdd(p0, p1), p2), 1.f / 3.f);
+			centroid = XMVectorMultiplyAdd(triangleCenter, XMVectorReplicate(triangleArea), centroid);
+			normal = XMVectorAdd(normal, cross);
+			area += triangleArea;
+		}
+	}
+}
+
+void OptimizeOverdraw(INDEX_BUFFER_TYPE* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, const size_t* clusterStarts, size_t clusterCount, MemoryArena& scratch)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || clusterCount == 0) return;
+
+	const float targetAcmr = AnalyzeVertexCache(indices, indexCount, vertexCount).acmr * OVERDRAW_ACMR_THRESHOLD;
+
+	ArenaScope scope{ scratch };
+	OverdrawCluster* clusters = NewArray(scope.arena, OverdrawCluster, triangleCount);
+	size_t splitCount = 0;
+
+	// Every cluster starts with a cold cache, cut as soon as the current one is about as efficient as the whole mesh
+	uint32_t* cacheTime = NewArray(scope.arena, uint32_t, vertexCount);
+	uint32_t timestamp = VERTEX_CACHE_SIZE + 1;
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		const size_t clusterEnd = c + 1 < clusterCount ? clusterStarts[c + 1] : triangleCount;
+		size_t start = clusterStarts[c];
+		size_t misses = 0;
+		timestamp += VERTEX_CACHE_SIZE + 1;
+
+		for (size_t triangle = start; triangle < clusterEnd; triangle++)
+		{
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				INDEX_BUFFER_TYPE vertex = indices[triangle * 3 + corner];
+				if (timestamp - cacheTime[vertex] > VERTEX_CACHE_SIZE)
+				{
+					cacheTime[vertex] = timestamp++;
+					misses++;
+				}
+			}
+
+			const size_t clusterTriangles = triangle + 1 - start;
+			if (triangle + 1 == clusterEnd || misses <= targetAcmr * clusterTriangles)
+			{
+				clusters[splitCount++] = { start, triangle + 1, 0.f };
+				start = triangle + 1;
+				misses = 0;
+				timestamp += VERTEX_CACHE_SIZE + 1;
+			}
+		}
+	}
+
+	XMVECTOR meshCentroid = XMVectorZero();
+	XMVECTOR meshNormal = XMVectorZero();
+	float meshArea = 0.f;
+	AccumulateTriangles(indices, vertices, 0, triangleCount, meshCentroid, meshNormal, meshArea);
+	if (meshArea > 0.f)
+	{
+		meshCentroid = XMVectorScale(meshCentroid, 1.f / meshArea);
+	}
+
+	for (size_t c = 0; c < splitCount; c++)
+	{
+		OverdrawCluster& cluster = clusters[c];
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.f;
+		AccumulateTriangles(indices, vertices, cluster.start, cluster.end, centroid, normal, area);
+		if (area <= 0.f) continue;
+
+		centroid = XMVectorScale(centroid, 1.f / area);
+		normal = XMVectorScale(normal, 1.f / XMVectorGetX(XMVector3Length(normal)));
+		cluster.sortKey = XMVectorGetX(XMVector3Dot(XMVectorSubtract(centroid, meshCentroid), normal));
+	}
+
+	// Ties keep their cache order so the result doesn't depend on the sort implementation
+	std::sort(clusters, clusters + splitCount, [](const OverdrawCluster& a, const OverdrawCluster& b)
+	{
+		return a.sortKey != b.sortKey ? a.sortKey > b.sortKey : a.start < b.start;
+	});
+
+	INDEX_BUFFER_TYPE* output = NewArray(scope.arena, INDEX_BUFFER_TYPE, indexCount);
+	size_t outputCount = 0;
+	for (size_t c = 0; c < splitCount; c++)
+	{
+		const size_t clusterIndexCount = (clusters[c].end - clusters[c].start) * 3;
+		memcpy(output + outputCount, indices + clusters[c].start * 3, sizeof(INDEX_BUFFER_TYPE) * clusterIndexCount);
+		outputCount += clusterIndexCount;
+	}
+
+	assert(outputCount == indexCount);
+	memcpy(indices, output, sizeof(INDEX_BUFFER_TYPE) * indexCount);
+}
+
+void OptimizeVertexFetch(MeshData& mesh, MemoryArena& scratch)
+{
+	ArenaScope scope{ scratch };
+
+	const uint32_t unassigned = UINT32_MAX;
+	uint32_t* remap = NewArray(scope.arena, uint32_t, mesh.vertexCount);
+	std::fill(remap, remap + mesh.vertexCount, unassigned);
+	Vertex* reordered = NewArray(scope.arena, Vertex, mesh.vertexCount);
+	uint32_t nextVertex = 0;
+
+	for (size_t i = 0; i < mesh.indexCount; i++)
+	{
+		INDEX_BUFFER_TYPE vertex = mesh.indices[i];
+		assert(vertex < mesh.vertexCount);
+		if (remap[vertex] == unassigned)
+		{
+			reordered[nextVertex] = mesh.vertices[vertex];
+			remap[vertex] = nextVertex++;
+		}
+		mesh.indices[i] = remap[vertex];
+	}
+
+	for (size_t vertex = 0; vertex < mesh.vertexCount; vertex++)
+	{
+		if (remap[vertex] == unassigned)
+		{
+			reordered[nextVertex++] = mesh.vertices[vertex];
+		}
+	}
+
+	assert(nextVertex == mesh.vertexCount);
+	memcpy(mesh.vertices, reordered, sizeof(Vertex) * mesh.vertexCount);
+}
+
+size_t OptimizeMesh(MeshData& mesh, MemoryArena& scratch)
+{
+	ArenaScope scope{ scratch };
+	size_t weldedCount = WeldVertices(mesh, scope.arena);
+	size_t* clusterStarts = NewArray(scope.arena, size_t, mesh.indexCount / 3);
+	size_t clusterCount = OptimizeVertexCache(mesh.indices, mesh.indexCount, mesh.vertexCount, scope.arena, clusterStarts);
+	OptimizeOverdraw(mesh.indices, mesh.indexCount, mesh.vertices, mesh.vertexCount, clusterStarts, clusterCount, scope.arena);
+	OptimizeVertexFetch(mesh, scope.arena);
+	return weldedCount;
+}
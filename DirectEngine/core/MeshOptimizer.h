@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Memory.h"
+#include "HashMap.h"
+#include "Vertex.h"
+using namespace VertexData;
+
+// Entries of the FIFO post transform cache the optimizer targets and the simulator models
+#define VERTEX_CACHE_SIZE 16
+// Overdraw clusters get split once their own cache miss ratio is within this factor of the whole mesh
+#define OVERDRAW_ACMR_THRESHOLD 1.05f
+
+struct VertexCacheStats
+{
+	size_t transformCount = 0;
+	// Average cache miss ratio, transformed vertices per triangle. Lower is better, 0.5 is the limit for big regular meshes
+	float acmr = 0.f;
+	// Average transform to vertex ratio, 1 means every vertex got transformed exactly once
+	float atvr = 0.f;
+};
+
+/// <summary>
+/// Runs the index buffer through a simulated FIFO post transform cache and counts the vertex shader invocations.
+/// </summary>
+VertexCacheStats AnalyzeVertexCache(const INDEX_BUFFER_TYPE* indices, size_t indexCount, size_t vertexCount, size_t cacheSize = VERTEX_CACHE_SIZE);
+
+/// <summary>
+/// Merges bit identical vertices and remaps the indices, returns how many vertices got removed.
+/// The vertex array is compacted in place, the memory behind the new vertexCount stays allocated.
+/// </summary>
+size_t WeldVertices(MeshData& mesh, MemoryArena& scratch);
+
+/// <summary>
+/// Hash of the vertex and index data, meshes with the same hash can share their GPU buffers.
+/// Uses the packed vertices if the mesh has them, so only hash meshes in the same layout against each other.
+/// </summary>
+uint64_t HashMeshContent(const MeshData& mesh);
+
+/// <summary>
+/// Reorders triangles for the post transform cache with Tipsify (Sander et al. 2007), winding stays the same.
+/// If clusterStarts isn't null it receives the first triangle of every run between two dead end jumps, it needs room for indexCount / 3 entries.
+/// Returns the number of clusters.
+/// </summary>
+size_t OptimizeVertexCache(INDEX_BUFFER_TYPE* indices, size_t indexCount, size_t vertexCount, MemoryArena& scratch, size_t* clusterStarts = nullptr);
+
+/// <summary>
+/// Splits the clusters from OptimizeVertexCache further where that barely costs cache efficiency and sorts them so
+/// the ones facing away from the mesh center get drawn first, those are the most likely to occlude the rest.
+/// </summary>
+void OptimizeOverdraw(INDEX_BUFFER_TYPE* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, const size_t* clusterStarts, size_t clusterCount, MemoryArena& scratch);
+
+/// <summary>
+/// Renumbers vertices in the order the index buffer first uses them so vertex fetches walk memory linearly.
+/// Unreferenced vertices move to the end, the vertex count doesn't change.
+/// </summary>
+void OptimizeVertexFetch(MeshData& mesh, MemoryArena& scratch);
+
+/// <summary>
+/// Welding, vertex cache, overdraw and vertex fetch optimization in that order, runs on every mesh at import.
+/// Returns the number of welded vertices.
+/// </summary>
+size_t OptimizeMesh(MeshData& mesh, MemoryArena& scratch);
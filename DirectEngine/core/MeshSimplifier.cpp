@@ -0,0 +1,556 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "HashMap.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+// Open edges get a plane through them perpendicular to their triangle, scaled by this and the squared edge length, so they can't drift sideways
+#define SIMPLIFY_EDGE_WEIGHT 10.
+// Cost of collapsing onto a vertex with completely different bone influences, in squared edge lengths
+#define SIMPLIFY_SKIN_WEIGHT 1.
+// Triangles whose normal turns by more than ~75 degrees count as flipped
+#define SIMPLIFY_FLIP_DOT 0.25
+
+namespace
+{
+	constexpr uint32_t NO_VERTEX = UINT32_MAX;
+	constexpr uint32_t MANY_VERTICES = UINT32_MAX - 1;
+
+	enum class VertexKind : uint8_t
+	{
+		Manifold,
+		// Single open edge in and out
+		Border,
+		// Two vertices at the same position with matching open edges, one on each side of a UV seam
+		Seam,
+		Locked,
+	};
+
+	// Sum of squared distances to planes weighted by triangle area, divided by the weight it's the average squared distance.
+	// Doubles because the constant term cancels out almost completely for positions far from the origin.
+	struct Quadric
+	{
+		double a00, a11, a22, a01, a02, a12;
+		double b0, b1, b2;
+		double c;
+		double weight;
+
+		void AddPlane(XMVECTOR normal, XMVECTOR point, double planeWeight)
+		{
+			XMFLOAT3 n;
+			XMStoreFloat3(&n, normal);
+			const double d = -XMVectorGetX(XMVector3Dot(normal, point));
+			a00 += planeWeight * n.x * n.x;
+			a11 += planeWeight * n.y * n.y;
+			a22 += planeWeight * n.z * n.z;
+			a01 += planeWeight * n.x * n.y;
+			a02 += planeWeight * n.x * n.z;
+			a12 += planeWeight * n.y * n.z;
+			b0 += planeWeight * n.x * d;
+			b1 += planeWeight * n.y * d;
+			b2 += planeWeight * n.z * d;
+			c += planeWeight * d * d;
+			weight += planeWeight;
+		}
+
+		void Add(const Quadric& other)
+		{
+			a00 += other.a00; a11 += other.a11; a22 += other.a22;
+			a01 += other.a01; a02 += other.a02; a12 += other.a12;
+			b0 += other.b0; b1 += other.b1; b2 += other.b2;
+			c += other.c;
+			weight += other.weight;
+		}
+
+		double Error(const XMFLOAT3& p) const
+		{
+			const double x = p.x, y = p.y, z = p.z;
+			const double rx = a00 * x + a01 * y + a02 * z + 2. * b0;
+			const double ry = a01 * x + a11 * y + a12 * z + 2. * b1;
+			const double rz = a02 * x + a12 * y + a22 * z + 2. * b2;
+			const double error = x * rx + y * ry + z * rz + c;
+			return weight > 0. ? std::abs(error) / weight : 0.;
+		}
+	};
+
+	struct PositionKey
+	{
+		const XMFLOAT3* position;
+
+		bool operator==(const PositionKey& other) const
+		{
+			return memcmp(position, other.position, sizeof(XMFLOAT3)) == 0;
+		}
+	};
+
+	struct PositionKeyHash
+	{
+		uint64_t operator()(const PositionKey& key) const
+		{
+			return HashBytes(key.position, sizeof(XMFLOAT3));
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double cost;
+		double error;
+	};
+
+	// Half the L1 distance between the bone weights, 0 for identical influences and 1 for disjoint bones
+	double GetSkinDistance(const Vertex& a, const Vertex& b)
+	{
+		auto weightOf = [](const Vertex& vertex, uint32_t bone)
+		{
+			const uint32_t* bones = &vertex.boneIndices.x;
+			const float* weights = &vertex.boneWeights.x;
+			float weight = 0.f;
+			for (size_t i = 0; i < 4; i++)
+			{
+				if (bones[i] == bone) weight += weights[i];
+			}
+			return weight;
+		};
+
+		double distance = 0.;
+		const uint32_t* bonesA = &a.boneIndices.x;
+		const uint32_t* bonesB = &b.boneIndices.x;
+		for (size_t i = 0; i < 4; i++)
+		{
+			if (std::find(bonesA, bonesA + i, bonesA[i]) == bonesA + i)
+			{
+				distance += std::abs(weightOf(a, bonesA[i]) - weightOf(b, bonesA[i]));
+			}
+			if (std::find(bonesB, bonesB + i, bonesB[i]) == bonesB + i && std::find(bonesA, bonesA + 4, bonesB[i]) == bonesA + 4)
+			{
+				distance += weightOf(b, bonesB[i]);
+			}
+		}
+		return distance * 0.5;
+	}
+
+	XMVECTOR GetTriangleNormal(XMVECTOR p0, XMVECTOR p1, XMVECTOR p2)
+	{
+		return XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+	}
+}
+
+// Simplifies in one go and calls onLevel(level, indexCount, error) with destination holding the result every time it gets down to the next
+// of the descending targets, or with whatever it got to if the mesh doesn't simplify that far.
+template <typename OnLevel>
+static void SimplifyLevels(INDEX_BUFFER_TYPE* destination, const INDEX_BUFFER_TYPE* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+	const size_t* targetIndexCounts, size_t levelCount, MemoryArena& scratch, const OnLevel& onLevel)
+{
+	assert(indexCount % 3 == 0);
+	assert(destination + indexCount <= indices || indices + indexCount <= destination);
+	memcpy(destination, indices, sizeof(INDEX_BUFFER_TYPE) * indexCount);
+
+	ArenaScope scope{ scratch };
+
+	// Vertices that only differ in attributes share a position id and are linked in a ring through wedges.
+	// Unused vertices stay out of the rings, they would look like seams that never close
+	uint32_t* positionIds = NewArray(scope.arena, uint32_t, vertexCount);
+	uint32_t* wedges = NewArray(scope.arena, uint32_t, vertexCount);
+	{
+		uint8_t* used = NewArray(scope.arena, uint8_t, vertexCount);
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			used[indices[i]] = 1;
+		}
+
+		ArenaHashMap<PositionKey, uint32_t, PositionKeyHash> firstAtPosition{ scope.arena, vertexCount };
+		for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			wedges[vertex] = vertex;
+			positionIds[vertex] = vertex;
+			if (!used[vertex]) continue;
+
+			const uint32_t* first = firstAtPosition.find({ &vertices[vertex].position });
+			if (first == nullptr)
+			{
+				firstAtPosition.insert({ &vertices[vertex].position }, vertex);
+			}
+			else
+			{
+				positionIds[vertex] = *first;
+				wedges[vertex] = wedges[*first];
+				wedges[*first] = vertex;
+			}
+		}
+	}
+
+	auto position = [&](uint32_t vertex) { return XMLoadFloat3(&vertices[vertex].position); };
+
+	// One quadric per position, seams must not make both sides simplify differently
+	Quadric* quadrics = NewArray(scope.arena, Quadric, vertexCount);
+	for (size_t i = 0; i < indexCount; i += 3)
+	{
+		const INDEX_BUFFER_TYPE* triangle = indices + i;
+		XMVECTOR normal = GetTriangleNormal(position(triangle[0]), position(triangle[1]), position(triangle[2]));
+		float doubleArea = XMVectorGetX(XMVector3Length(normal));
+		if (doubleArea <= 0.f) continue;
+
+		Quadric planeQuadric{};
+		planeQuadric.AddPlane(XMVectorScale(normal, 1.f / doubleArea), position(triangle[0]), doubleArea * 0.5);
+		for (size_t corner = 0; corner < 3; corner++)
+		{
+			quadrics[positionIds[triangle[corner]]].Add(planeQuadric);
+		}
+	}
+
+	size_t currentIndexCount = indexCount;
+	double maxError = 0.;
+	bool edgeQuadricsAdded = false;
+	size_t level = 0;
+
+	while (level < levelCount)
+	{
+		if (currentIndexCount <= targetIndexCounts[level])
+		{
+			onLevel(level++, currentIndexCount, static_cast<float>(std::sqrt(maxError)));
+			continue;
+		}
+
+		ArenaScope passScope{ scope.arena };
+
+		// Triangles around every vertex
+		uint32_t* triangleOffsets = NewArray(passScope.arena, uint32_t, vertexCount + 1);
+		uint32_t* adjacentTriangles = NewArray(passScope.arena, uint32_t, currentIndexCount);
+		for (size_t i = 0; i < currentIndexCount; i++)
+		{
+			triangleOffsets[destination[i] + 1]++;
+		}
+		for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			triangleOffsets[vertex + 1] += triangleOffsets[vertex];
+		}
+		uint32_t* fill = NewArray(passScope.arena, uint32_t, vertexCount);
+		for (size_t i = 0; i < currentIndexCount; i++)
+		{
+			INDEX_BUFFER_TYPE vertex = destination[i];
+			adjacentTriangles[triangleOffsets[vertex] + fill[vertex]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		// Half edges without a twin are borders or seams, remember where every vertex has one
+		auto countHalfEdges = [&](uint32_t from, uint32_t to)
+		{
+			uint32_t count = 0;
+			for (uint32_t t = triangleOffsets[from]; t < triangleOffsets[from + 1]; t++)
+			{
+				const INDEX_BUFFER_TYPE* triangle = destination + adjacentTriangles[t] * 3;
+				count += (triangle[0] == from && triangle[1] == to) + (triangle[1] == from && triangle[2] == to) + (triangle[2] == from && triangle[0] == to);
+			}
+			return count;
+		};
+
+		uint32_t* openOut = NewArray(passScope.arena, uint32_t, vertexCount);
+		uint32_t* openIn = NewArray(passScope.arena, uint32_t, vertexCount);
+		VertexKind* kinds = NewArray(passScope.arena, VertexKind, vertexCount);
+		std::fill_n(openOut, vertexCount, NO_VERTEX);
+		std::fill_n(openIn, vertexCount, NO_VERTEX);
+		for (size_t i = 0; i < currentIndexCount; i += 3)
+		{
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				uint32_t from = destination[i + corner];
+				uint32_t to = destination[i + (corner + 1) % 3];
+				if (countHalfEdges(from, to) > 1)
+				{
+					// Non manifold edge, both ends stay where they are
+					kinds[from] = kinds[to] = VertexKind::Locked;
+				}
+				if (countHalfEdges(to, from) > 0) continue;
+
+				openOut[from] = openOut[from] == NO_VERTEX ? to : MANY_VERTICES;
+				openIn[to] = openIn[to] == NO_VERTEX ? from : MANY_VERTICES;
+
+				if (!edgeQuadricsAdded)
+				{
+					XMVECTOR edge = XMVectorSubtract(position(to), position(from));
+					XMVECTOR faceNormal = GetTriangleNormal(position(destination[i]), position(destination[i + 1]), position(destination[i + 2]));
+					XMVECTOR planeNormal = XMVector3Cross(edge, faceNormal);
+					float planeLength = XMVectorGetX(XMVector3Length(planeNormal));
+					if (planeLength <= 0.f) continue;
+
+					Quadric edgeQuadric{};
+					edgeQuadric.AddPlane(XMVectorScale(planeNormal, 1.f / planeLength), position(from), SIMPLIFY_EDGE_WEIGHT * XMVectorGetX(XMVector3LengthSq(edge)));
+					quadrics[positionIds[from]].Add(edgeQuadric);
+					quadrics[positionIds[to]].Add(edgeQuadric);
+				}
+			}
+		}
+		edgeQuadricsAdded = true;
+
+		auto isSingle = [](uint32_t vertex) { return vertex != NO_VERTEX && vertex != MANY_VERTICES; };
+		for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			if (kinds[vertex] == VertexKind::Locked) continue;
+
+			const uint32_t wedge = wedges[vertex];
+			if (wedge == vertex)
+			{
+				if (openOut[vertex] == NO_VERTEX && openIn[vertex] == NO_VERTEX)
+				{
+					kinds[vertex] = VertexKind::Manifold;
+				}
+				else
+				{
+					kinds[vertex] = isSingle(openOut[vertex]) && isSingle(openIn[vertex]) ? VertexKind::Border : VertexKind::Locked;
+				}
+			}
+			else
+			{
+				// Both sides of the seam have to run along the same positions in opposite directions
+				bool simpleSeam = wedges[wedge] == vertex && kinds[wedge] != VertexKind::Locked &&
+					isSingle(openOut[vertex]) && isSingle(openIn[vertex]) && isSingle(openOut[wedge]) && isSingle(openIn[wedge]) &&
+					positionIds[openOut[vertex]] == positionIds[openIn[wedge]] && positionIds[openIn[vertex]] == positionIds[openOut[wedge]];
+				kinds[vertex] = simpleSeam ? VertexKind::Seam : VertexKind::Locked;
+			}
+		}
+
+		auto canCollapse = [&](uint32_t from, uint32_t to)
+		{
+			if (positionIds[from] == positionIds[to]) return false;
+			switch (kinds[from])
+			{
+			case VertexKind::Manifold:
+				return true;
+			case VertexKind::Border:
+			case VertexKind::Seam:
+				return to == openOut[from] || to == openIn[from];
+			default:
+				return false;
+			}
+		};
+
+		Collapse* collapses = NewArray(passScope.arena, Collapse, currentIndexCount * 2);
+		size_t collapseCount = 0;
+		auto addCollapse = [&](uint32_t from, uint32_t to)
+		{
+			if (!canCollapse(from, to)) return;
+
+			double geometricError = quadrics[positionIds[from]].Error(vertices[to].position);
+			if (kinds[from] == VertexKind::Seam)
+			{
+				// The other side moves too, its quadric is the same one since both share a position
+				geometricError = std::max(geometricError, quadrics[positionIds[wedges[from]]].Error(vertices[to].position));
+			}
+			double edgeLengthSq = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(position(to), position(from))));
+			double cost = geometricError + SIMPLIFY_SKIN_WEIGHT * edgeLengthSq * GetSkinDistance(vertices[from], vertices[to]);
+			collapses[collapseCount++] = { from, to, cost, geometricError };
+		};
+
+		for (size_t i = 0; i < currentIndexCount; i += 3)
+		{
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				uint32_t from = destination[i + corner];
+				uint32_t to = destination[i + (corner + 1) % 3];
+				addCollapse(from, to);
+				// Interior edges show up once per direction, open ones only once
+				if (countHalfEdges(to, from) == 0)
+				{
+					addCollapse(to, from);
+				}
+			}
+		}
+
+		// Cheapest first, ties broken by index so the result doesn't depend on the sort implementation
+		std::sort(collapses, collapses + collapseCount, [](const Collapse& a, const Collapse& b)
+		{
+			if (a.cost != b.cost) return a.cost < b.cost;
+			if (a.from != b.from) return a.from < b.from;
+			return a.to < b.to;
+		});
+
+		uint32_t* remap = NewArray(passScope.arena, uint32_t, vertexCount);
+		for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			remap[vertex] = vertex;
+		}
+
+		// Collapses only touch triangles whose vertices didn't move yet in this pass, so the flip checks see the real geometry
+		uint8_t* positionLocked = NewArray(passScope.arena, uint8_t, vertexCount);
+		const size_t triangleGoal = (currentIndexCount - targetIndexCounts[level]) / 3;
+		size_t removedTriangles = 0;
+
+		for (size_t c = 0; c < collapseCount && removedTriangles < triangleGoal; c++)
+		{
+			const Collapse& collapse = collapses[c];
+			const uint32_t fromPosition = positionIds[collapse.from];
+			const uint32_t toPosition = positionIds[collapse.to];
+			if (positionLocked[fromPosition] || positionLocked[toPosition]) continue;
+
+			// Triangles that survive the collapse must not flip
+			bool flipped = false;
+			size_t collapsedTriangles = 0;
+			uint32_t wedge = collapse.from;
+			do
+			{
+				for (uint32_t t = triangleOffsets[wedge]; t < triangleOffsets[wedge + 1] && !flipped; t++)
+				{
+					const INDEX_BUFFER_TYPE* triangle = destination + adjacentTriangles[t] * 3;
+					if (positionIds[triangle[0]] == toPosition || positionIds[triangle[1]] == toPosition || positionIds[triangle[2]] == toPosition)
+					{
+						collapsedTriangles++;
+						continue;
+					}
+
+					XMVECTOR corners[3] = { position(triangle[0]), position(triangle[1]), position(triangle[2]) };
+					XMVECTOR before = GetTriangleNormal(corners[0], corners[1], corners[2]);
+					for (size_t corner = 0; corner < 3; corner++)
+					{
+						if (triangle[corner] == wedge) corners[corner] = position(collapse.to);
+					}
+					XMVECTOR after = GetTriangleNormal(corners[0], corners[1], corners[2]);
+					float dot = XMVectorGetX(XMVector3Dot(before, after));
+					float lengths = XMVectorGetX(XMVector3Length(before)) * XMVectorGetX(XMVector3Length(after));
+					flipped = dot <= SIMPLIFY_FLIP_DOT * lengths;
+				}
+				wedge = wedges[wedge];
+			} while (wedge != collapse.from && !flipped);
+			if (flipped) continue;
+
+			wedge = collapse.from;
+			do
+			{
+				if (wedge == collapse.from)
+				{
+					remap[wedge] = collapse.to;
+				}
+				else
+				{
+					// The other side of a seam follows along its own open edge to the same position
+					remap[wedge] = collapse.to == openOut[collapse.from] ? openIn[wedge] : openOut[wedge];
+					assert(positionIds[remap[wedge]] == toPosition);
+				}
+
+				for (uint32_t t = triangleOffsets[wedge]; t < triangleOffsets[wedge + 1]; t++)
+				{
+					const INDEX_BUFFER_TYPE* triangle = destination + adjacentTriangles[t] * 3;
+					positionLocked[positionIds[triangle[0]]] = positionLocked[positionIds[triangle[1]]] = positionLocked[positionIds[triangle[2]]] = 1;
+				}
+				wedge = wedges[wedge];
+			} while (wedge != collapse.from);
+
+			wedge = collapse.to;
+			do
+			{
+				for (uint32_t t = triangleOffsets[wedge]; t < triangleOffsets[wedge + 1]; t++)
+				{
+					const INDEX_BUFFER_TYPE* triangle = destination + adjacentTriangles[t] * 3;
+					positionLocked[positionIds[triangle[0]]] = positionLocked[positionIds[triangle[1]]] = positionLocked[positionIds[triangle[2]]] = 1;
+				}
+				wedge = wedges[wedge];
+			} while (wedge != collapse.to);
+
+			quadrics[toPosition].Add(quadrics[fromPosition]);
+			maxError = std::max(maxError, collapse.error);
+			removedTriangles += collapsedTriangles;
+		}
+
+		if (removedTriangles == 0)
+		{
+			break;
+		}
+
+		size_t writeIndex = 0;
+		for (size_t i = 0; i < currentIndexCount; i += 3)
+		{
+			INDEX_BUFFER_TYPE a = remap[destination[i + 0]];
+			INDEX_BUFFER_TYPE b = remap[destination[i + 1]];
+			INDEX_BUFFER_TYPE c = remap[destination[i + 2]];
+			if (positionIds[a] == positionIds[b] || positionIds[b] == positionIds[c] || positionIds[c] == positionIds[a]) continue;
+
+			destination[writeIndex++] = a;
+			destination[writeIndex++] = b;
+			destination[writeIndex++] = c;
+		}
+		assert(writeIndex < currentIndexCount);
+		currentIndexCount = writeIndex;
+	}
+
+	for (; level < levelCount; level++)
+	{
+		onLevel(level, currentIndexCount, static_cast<float>(std::sqrt(maxError)));
+	}
+}
+
+size_t SimplifyMesh(INDEX_BUFFER_TYPE* destination, const INDEX_BUFFER_TYPE* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+	size_t targetIndexCount, float* error, MemoryArena& scratch)
+{
+	size_t resultIndexCount = indexCount;
+	SimplifyLevels(destination, indices, indexCount, vertices, vertexCount, &targetIndexCount, 1, scratch, [&](size_t, size_t levelIndexCount, float levelError)
+	{
+		resultIndexCount = levelIndexCount;
+		*error = levelError;
+	});
+	return resultIndexCount;
+}
+
+size_t GetMaxLodIndexCount(size_t indexCount)
+{
+	size_t total = 0;
+	for (size_t level = 1; level < MAX_MESH_LODS; level++)
+	{
+		indexCount = static_cast<size_t>(indexCount * LOD_MIN_REDUCTION);
+		total += indexCount;
+	}
+	return total;
+}
+
+void GenerateLods(MeshData& mesh, INDEX_BUFFER_TYPE* lodIndices, MemoryArena& scratch)
+{
+	mesh.lodCount = 0;
+
+	// One simplification run that drops a copy at every level, so errors are measured against the full mesh and the
+	// early passes over the full index buffer only happen once
+	size_t targetIndexCounts[MAX_MESH_LODS - 1];
+	float ratio = 1.f;
+	for (size_t level = 0; level < MAX_MESH_LODS - 1; level++)
+	{
+		ratio *= LOD_TRIANGLE_RATIO;
+		targetIndexCounts[level] = static_cast<size_t>(mesh.indexCount / 3 * ratio) * 3;
+	}
+
+	ArenaScope scope{ scratch };
+	INDEX_BUFFER_TYPE* simplified = NewArray(scope.arena, INDEX_BUFFER_TYPE, mesh.indexCount);
+	size_t previousIndexCount = mesh.indexCount;
+	bool done = false;
+	SimplifyLevels(simplified, mesh.indices, mesh.indexCount, mesh.vertices, mesh.vertexCount, targetIndexCounts, MAX_MESH_LODS - 1, scope.arena,
+		[&](size_t level, size_t indexCount, float error)
+	{
+		done |= indexCount == 0 || indexCount > static_cast<size_t>(previousIndexCount * LOD_MIN_REDUCTION);
+		if (done) return;
+
+		memcpy(lodIndices, simplified, sizeof(INDEX_BUFFER_TYPE) * indexCount);
+		OptimizeVertexCache(lodIndices, indexCount, mesh.vertexCount, scope.arena);
+
+		MeshLod& lod = mesh.lods[mesh.lodCount++];
+		lod.indices = lodIndices;
+		lod.indexCount = indexCount;
+		lod.error = error;
+
+		lodIndices += indexCount;
+		previousIndexCount = indexCount;
+	});
+}
+
+float GetLodPixelsPerUnit(float distance, float projectionScaleY, float viewportHeight)
+{
+	return projectionScaleY * viewportHeight * 0.5f / std::max<float>(distance, 1e-4f);
+}
+
+size_t SelectLod(const float* errors, size_t lodCount, float pixelsPerUnit, float maxPixelError)
+{
+	size_t lod = 0;
+	while (lod + 1 < lodCount && errors[lod + 1] * pixelsPerUnit <= maxPixelError)
+	{
+		lod++;
+	}
+	return lod;
+}
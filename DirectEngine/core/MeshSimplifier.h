@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Memory.h"
+#include "Vertex.h"
+using namespace VertexData;
+
+// Every LOD aims for this fraction of the triangles of the level before it
+#define LOD_TRIANGLE_RATIO 0.5f
+// The chain ends once a level keeps more than this fraction of the triangles of the one before, it wouldn't save enough to be worth it
+#define LOD_MIN_REDUCTION 0.8f
+// A LOD gets drawn once its error covers less than this many pixels on screen
+#define LOD_MAX_PIXEL_ERROR 1.f
+
+/// <summary>
+/// Quadric error edge collapse simplification (Garland and Heckbert 1997) down to at most targetIndexCount indices if the mesh allows it.
+/// Vertices only ever collapse onto other vertices, so the result indexes the same vertex array and skinning data stays intact.
+/// Borders and UV seams can only collapse along themselves, non manifold vertices never move.
+/// destination needs room for indexCount entries and may not overlap indices. error receives the largest distance to the input in mesh units.
+/// </summary>
+size_t SimplifyMesh(INDEX_BUFFER_TYPE* destination, const INDEX_BUFFER_TYPE* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+	size_t targetIndexCount, float* error, MemoryArena& scratch);
+
+/// <summary>
+/// Upper bound for the indices of all LODs GenerateLods creates for a mesh.
+/// </summary>
+size_t GetMaxLodIndexCount(size_t indexCount);
+
+/// <summary>
+/// Fills mesh.lods with up to MAX_MESH_LODS - 1 levels, each one simplified from the full mesh and optimized for the vertex cache.
+/// lodIndices needs room for GetMaxLodIndexCount entries, the levels point into it.
+/// </summary>
+void GenerateLods(MeshData& mesh, INDEX_BUFFER_TYPE* lodIndices, MemoryArena& scratch);
+
+/// <summary>
+/// Pixels one mesh space unit covers at the given distance, projectionScaleY is element [1][1] of the projection matrix.
+/// </summary>
+float GetLodPixelsPerUnit(float distance, float projectionScaleY, float viewportHeight);
+
+/// <summary>
+/// Coarsest LOD with an error below maxPixelError on screen, errors[0] is the full mesh.
+/// </summary>
+size_t SelectLod(const float* errors, size_t lodCount, float pixelsPerUnit, float maxPixelError = LOD_MAX_PIXEL_ERROR);
@@ -0,0 +1,139 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+static XMVECTOR GetTriangleNormal(const MeshData& mesh, size_t firstIndex)
+{
+	XMVECTOR p0 = XMLoadFloat3(&mesh.vertices[mesh.indices[firstIndex + 0]].position);
+	XMVECTOR p1 = XMLoadFloat3(&mesh.vertices[mesh.indices[firstIndex + 1]].position);
+	XMVECTOR p2 = XMLoadFloat3(&mesh.vertices[mesh.indices[firstIndex + 2]].position);
+	return XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+}
+
+static void ComputeMeshletBounds(const MeshData& mesh, Meshlet& meshlet)
+{
+	const INDEX_BUFFER_TYPE* indices = mesh.indices + meshlet.firstIndex;
+
+	XMVECTOR aabbMin = XMLoadFloat3(&mesh.vertices[indices[0]].position);
+	XMVECTOR aabbMax = aabbMin;
+	for (size_t i = 1; i < meshlet.indexCount; i++)
+	{
+		XMVECTOR position = XMLoadFloat3(&mesh.vertices[indices[i]].position);
+		aabbMin = XMVectorMin(aabbMin, position);
+		aabbMax = XMVectorMax(aabbMax, position);
+	}
+	XMStoreFloat3(&meshlet.aabbMin, aabbMin);
+	XMStoreFloat3(&meshlet.aabbMax, aabbMax);
+
+	// Box center instead of a minimal sphere, it's deterministic and close enough for clusters this small
+	XMVECTOR center = XMVectorScale(XMVectorAdd(aabbMin, aabbMax), 0.5f);
+	XMVECTOR radiusSquared = XMVectorZero();
+	for (size_t i = 0; i < meshlet.indexCount; i++)
+	{
+		XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&mesh.vertices[indices[i]].position), center);
+		radiusSquared = XMVectorMax(radiusSquared, XMVector3LengthSq(offset));
+	}
+	XMStoreFloat3(&meshlet.center, center);
+	meshlet.radius = XMVectorGetX(XMVectorSqrt(radiusSquared));
+
+	// Cone around the average face normal, degenerate triangles have no facing and are skipped
+	XMVECTOR axis = XMVectorZero();
+	for (size_t i = 0; i < meshlet.indexCount; i += 3)
+	{
+		XMVECTOR normal = GetTriangleNormal(mesh, meshlet.firstIndex + i);
+		if (XMVectorGetX(XMVector3LengthSq(normal)) > 0.f)
+		{
+			axis = XMVectorAdd(axis, XMVector3Normalize(normal));
+		}
+	}
+
+	meshlet.coneAxis = { 0.f, 0.f, 0.f };
+	meshlet.coneCutoff = 1.f;
+	if (XMVectorGetX(XMVector3LengthSq(axis)) < 1e-12f)
+	{
+		return;
+	}
+	axis = XMVector3Normalize(axis);
+
+	float minDot = 1.f;
+	for (size_t i = 0; i < meshlet.indexCount; i += 3)
+	{
+		XMVECTOR normal = GetTriangleNormal(mesh, meshlet.firstIndex + i);
+		if (XMVectorGetX(XMVector3LengthSq(normal)) > 0.f)
+		{
+			minDot = std::min<float>(minDot, XMVectorGetX(XMVector3Dot(axis, XMVector3Normalize(normal))));
+		}
+	}
+	if (minDot > MESHLET_MIN_CONE_DOT)
+	{
+		XMStoreFloat3(&meshlet.coneAxis, axis);
+		meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+	}
+}
+
+size_t GetMaxMeshletCount(size_t indexCount)
+{
+	// Every meshlet except the last holds at least MESHLET_MAX_VERTICES / 3 triangles
+	size_t minTriangles = std::min<size_t>(MESHLET_MAX_VERTICES / 3, MESHLET_MAX_TRIANGLES);
+	return indexCount / 3 / minTriangles + 1;
+}
+
+size_t BuildMeshlets(const MeshData& mesh, Meshlet* meshlets, MemoryArena& scratch)
+{
+	assert(mesh.indexCount % 3 == 0);
+	if (mesh.indexCount == 0)
+	{
+		return 0;
+	}
+
+	// Stamp of the meshlet that last used a vertex, saves clearing a set for every meshlet
+	uint32_t* vertexStamps = NewArray(scratch, uint32_t, mesh.vertexCount);
+
+	size_t meshletCount = 0;
+	Meshlet* current = &meshlets[meshletCount++];
+	*current = {};
+	uint32_t stamp = 1;
+
+	for (size_t i = 0; i < mesh.indexCount; i += 3)
+	{
+		INDEX_BUFFER_TYPE a = mesh.indices[i + 0];
+		INDEX_BUFFER_TYPE b = mesh.indices[i + 1];
+		INDEX_BUFFER_TYPE c = mesh.indices[i + 2];
+
+		uint32_t newVertices = (vertexStamps[a] != stamp) + (vertexStamps[b] != stamp && b != a) + (vertexStamps[c] != stamp && c != a && c != b);
+		if (current->vertexCount + newVertices > MESHLET_MAX_VERTICES || current->indexCount / 3 + 1 > MESHLET_MAX_TRIANGLES)
+		{
+			ComputeMeshletBounds(mesh, *current);
+			assert(meshletCount < GetMaxMeshletCount(mesh.indexCount));
+			current = &meshlets[meshletCount++];
+			*current = {};
+			current->firstIndex = static_cast<uint32_t>(i);
+			stamp++;
+			newVertices = 1 + (b != a) + (c != a && c != b);
+		}
+
+		vertexStamps[a] = stamp;
+		vertexStamps[b] = stamp;
+		vertexStamps[c] = stamp;
+		current->vertexCount += static_cast<uint16_t>(newVertices);
+		current->indexCount += 3;
+	}
+	ComputeMeshletBounds(mesh, *current);
+
+	return meshletCount;
+}
+
+bool IsMeshletBackfacing(const Meshlet& meshlet, FXMVECTOR cameraPosition)
+{
+	if (meshlet.coneCutoff >= 1.f)
+	{
+		return false;
+	}
+
+	// The cone apex could be anywhere in the sphere, widening the cone by the angle the sphere covers accounts for that
+	XMVECTOR view = XMVectorSubtract(XMLoadFloat3(&meshlet.center), cameraPosition);
+	float distance = XMVectorGetX(XMVector3Length(view));
+	return XMVectorGetX(XMVector3Dot(view, XMLoadFloat3(&meshlet.coneAxis))) >= meshlet.coneCutoff * distance + meshlet.radius;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Memory.h"
+#include "Vertex.h"
+using namespace VertexData;
+
+// Limits of a single meshlet, the usual mesh shader sizes so the data can feed amplification shaders later
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+// Cones wider than this get no culling data, their normals spread over more than ~84 degrees from the axis
+#define MESHLET_MIN_CONE_DOT 0.1f
+
+/// <summary>
+/// Upper bound for the number of meshlets BuildMeshlets creates for an index buffer.
+/// </summary>
+size_t GetMaxMeshletCount(size_t indexCount);
+
+/// <summary>
+/// Splits the index buffer into meshlets without reordering it, so it should already be optimized for the vertex cache.
+/// A meshlet gets closed as soon as the next triangle would exceed the vertex or triangle limit.
+/// meshlets needs room for GetMaxMeshletCount entries, returns how many got written. The result only depends on the mesh.
+/// </summary>
+size_t BuildMeshlets(const MeshData& mesh, Meshlet* meshlets, MemoryArena& scratch);
+
+/// <summary>
+/// Conservative test if every triangle of the meshlet faces away from a camera at the given mesh space position.
+/// </summary>
+bool IsMeshletBackfacing(const Meshlet& meshlet, FXMVECTOR cameraPosition);
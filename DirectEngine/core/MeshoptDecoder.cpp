@@ -0,0 +1,652 @@
+#include "MeshoptDecoder.h"
+
+#include <DirectXMath.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// Attribute bytes are coded in groups of 16, a group never reads more than 8 packed bytes plus 16 sentinel bytes
+	constexpr size_t BYTE_GROUP_SIZE = 16;
+	constexpr size_t BYTE_GROUP_DECODE_LIMIT = 24;
+	// Triangle codes can look back this far into the edge and vertex FIFOs
+	constexpr size_t INDEX_FIFO_SIZE = 16;
+	// The code aux table at the end of a triangle stream, it's also the padding that lets a triangle read 16 bytes unchecked
+	constexpr size_t CODE_AUX_TABLE_SIZE = 16;
+
+	uint8_t Unzigzag8(uint8_t v)
+	{
+		return static_cast<uint8_t>(-(v & 1) ^ (v >> 1));
+	}
+
+	uint32_t Unzigzag32(uint32_t v)
+	{
+		return (v >> 1) ^ (0u - (v & 1));
+	}
+
+	// 2 or 4 bit values, most significant first. The all ones value is a sentinel for a full byte that follows the packed bits
+	template <size_t Bits>
+	const uint8_t* DecodePackedGroup(const uint8_t* data, uint8_t* destination)
+	{
+		constexpr uint8_t sentinel = (1 << Bits) - 1;
+		const uint8_t* extra = data + BYTE_GROUP_SIZE * Bits / 8;
+		for (size_t i = 0; i < BYTE_GROUP_SIZE; i++)
+		{
+			const uint8_t value = (data[i * Bits / 8] >> (8 - Bits - i * Bits % 8)) & sentinel;
+			destination[i] = value == sentinel ? *extra : value;
+			extra += value == sentinel;
+		}
+		return extra;
+	}
+
+	const uint8_t* DecodeBytesGroup(const uint8_t* data, uint8_t* destination, int bitsLog2)
+	{
+		switch (bitsLog2)
+		{
+		case 0:
+			memset(destination, 0, BYTE_GROUP_SIZE);
+			return data;
+		case 1:
+			return DecodePackedGroup<2>(data, destination);
+		case 2:
+			return DecodePackedGroup<4>(data, destination);
+		default:
+			memcpy(destination, data, BYTE_GROUP_SIZE);
+			return data + BYTE_GROUP_SIZE;
+		}
+	}
+
+	// One byte of every element in a block, headed by 2 bits per group that say how wide its values are
+	const uint8_t* DecodeBytes(const uint8_t* data, const uint8_t* dataEnd, uint8_t* destination, size_t size)
+	{
+		assert(size % BYTE_GROUP_SIZE == 0);
+		const uint8_t* header = data;
+		const size_t headerSize = (size / BYTE_GROUP_SIZE + 3) / 4;
+		if (static_cast<size_t>(dataEnd - data) < headerSize)
+		{
+			return nullptr;
+		}
+		data += headerSize;
+
+		for (size_t i = 0; i < size; i += BYTE_GROUP_SIZE)
+		{
+			// Valid streams always end with the tail, so a group can be decoded without checking every byte
+			if (static_cast<size_t>(dataEnd - data) < BYTE_GROUP_DECODE_LIMIT)
+			{
+				return nullptr;
+			}
+			const size_t group = i / BYTE_GROUP_SIZE;
+			data = DecodeBytesGroup(data, destination + i, (header[group / 4] >> ((group % 4) * 2)) & 3);
+		}
+		return data;
+	}
+
+	// Every byte column holds zigzag deltas to the same byte of the element before, the first element of a block uses the last one of the block before
+	const uint8_t* DecodeVertexBlockScalar(const uint8_t* data, const uint8_t* dataEnd, uint8_t* destination, size_t count, size_t byteStride, uint8_t* lastElement)
+	{
+		uint8_t deltas[MESHOPT_VERTEX_BLOCK_MAX];
+		const size_t alignedCount = (count + BYTE_GROUP_SIZE - 1) & ~(BYTE_GROUP_SIZE - 1);
+		for (size_t k = 0; k < byteStride; k++)
+		{
+			data = DecodeBytes(data, dataEnd, deltas, alignedCount);
+			if (data == nullptr)
+			{
+				return nullptr;
+			}
+
+			uint8_t previous = lastElement[k];
+			for (size_t i = 0; i < count; i++)
+			{
+				previous = static_cast<uint8_t>(previous + Unzigzag8(deltas[i]));
+				destination[i * byteStride + k] = previous;
+			}
+		}
+		memcpy(lastElement, &destination[(count - 1) * byteStride], byteStride);
+		return data;
+	}
+
+#if defined(_XM_SSE_INTRINSICS_)
+	// Four byte columns at once, transposed so every 32 bit lane holds those four bytes of one element.
+	// The prefix sum then runs over four elements per register and carries the last one into the next register
+	const uint8_t* DecodeVertexBlock(const uint8_t* data, const uint8_t* dataEnd, uint8_t* destination, size_t count, size_t byteStride, uint8_t* lastElement)
+	{
+		assert(byteStride % 4 == 0);
+		uint8_t deltas[4][MESHOPT_VERTEX_BLOCK_MAX];
+		const size_t alignedCount = (count + BYTE_GROUP_SIZE - 1) & ~(BYTE_GROUP_SIZE - 1);
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i one = _mm_set1_epi8(1);
+		const __m128i low7 = _mm_set1_epi8(0x7f);
+		for (size_t k = 0; k < byteStride; k += 4)
+		{
+			for (size_t j = 0; j < 4; j++)
+			{
+				data = DecodeBytes(data, dataEnd, deltas[j], alignedCount);
+				if (data == nullptr)
+				{
+					return nullptr;
+				}
+			}
+
+			uint32_t last;
+			memcpy(&last, &lastElement[k], sizeof(last));
+			__m128i previous = _mm_set1_epi32(static_cast<int>(last));
+			for (size_t i = 0; i < alignedCount; i += BYTE_GROUP_SIZE)
+			{
+				__m128i d0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&deltas[0][i]));
+				__m128i d1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&deltas[1][i]));
+				__m128i d2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&deltas[2][i]));
+				__m128i d3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&deltas[3][i]));
+				__m128i d01Low = _mm_unpacklo_epi8(d0, d1);
+				__m128i d01High = _mm_unpackhi_epi8(d0, d1);
+				__m128i d23Low = _mm_unpacklo_epi8(d2, d3);
+				__m128i d23High = _mm_unpackhi_epi8(d2, d3);
+				__m128i elements[4] = { _mm_unpacklo_epi16(d01Low, d23Low), _mm_unpackhi_epi16(d01Low, d23Low), _mm_unpacklo_epi16(d01High, d23High), _mm_unpackhi_epi16(d01High, d23High) };
+
+				for (size_t j = 0; j < 4; j++)
+				{
+					// There are no byte shifts, the bit the 16 bit shift pulls in from the neighbouring byte gets masked off
+					__m128i v = elements[j];
+					v = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(v, 1), low7), _mm_sub_epi8(zero, _mm_and_si128(v, one)));
+					v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+					v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+					v = _mm_add_epi8(v, previous);
+					previous = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+
+					const size_t first = i + j * 4;
+					for (size_t e = 0; e < 4 && first + e < count; e++)
+					{
+						const uint32_t bytes = static_cast<uint32_t>(_mm_cvtsi128_si32(v));
+						memcpy(&destination[(first + e) * byteStride + k], &bytes, sizeof(bytes));
+						v = _mm_srli_si128(v, 4);
+					}
+				}
+			}
+		}
+		memcpy(lastElement, &destination[(count - 1) * byteStride], byteStride);
+		return data;
+	}
+#endif
+
+	bool DecodeVertexBuffer(uint8_t* destination, size_t count, size_t byteStride, const uint8_t* source, size_t sourceSize, bool simd)
+	{
+		const size_t tailSize = std::max<size_t>(byteStride, MESHOPT_VERTEX_TAIL_MIN);
+		if (sourceSize < 1 + tailSize || (source[0] & 0xf0) != MESHOPT_VERTEX_HEADER || (source[0] & 0x0f) != 0)
+		{
+			return false;
+		}
+
+		// The tail ends with the first element, so the first deltas are relative to itself
+		uint8_t lastElement[MESHOPT_VERTEX_BLOCK_MAX];
+		memcpy(lastElement, source + sourceSize - byteStride, byteStride);
+
+		const uint8_t* data = source + 1;
+		const uint8_t* dataEnd = source + sourceSize;
+		const size_t blockSize = GetMeshoptVertexBlockSize(byteStride);
+		for (size_t first = 0; first < count; first += blockSize)
+		{
+			const size_t blockCount = std::min(blockSize, count - first);
+#if defined(_XM_SSE_INTRINSICS_)
+			if (simd)
+			{
+				data = DecodeVertexBlock(data, dataEnd, &destination[first * byteStride], blockCount, byteStride, lastElement);
+			}
+			else
+#endif
+			{
+				data = DecodeVertexBlockScalar(data, dataEnd, &destination[first * byteStride], blockCount, byteStride, lastElement);
+			}
+			if (data == nullptr)
+			{
+				return false;
+			}
+		}
+		return static_cast<size_t>(dataEnd - data) == tailSize;
+	}
+
+	void WriteIndex(uint8_t* destination, size_t index, size_t indexSize, uint32_t value)
+	{
+		if (indexSize == 2)
+		{
+			const uint16_t value16 = static_cast<uint16_t>(value);
+			memcpy(&destination[index * 2], &value16, sizeof(value16));
+		}
+		else
+		{
+			memcpy(&destination[index * 4], &value, sizeof(value));
+		}
+	}
+
+	void WriteTriangle(uint8_t* destination, size_t index, size_t indexSize, uint32_t a, uint32_t b, uint32_t c)
+	{
+		WriteIndex(destination, index + 0, indexSize, a);
+		WriteIndex(destination, index + 1, indexSize, b);
+		WriteIndex(destination, index + 2, indexSize, c);
+	}
+
+	// 7 bits per byte, least significant first, at most 5 bytes
+	uint32_t DecodeVByte(const uint8_t*& data)
+	{
+		const uint8_t lead = *data++;
+		if (lead < 128)
+		{
+			return lead;
+		}
+
+		uint32_t result = lead & 127;
+		uint32_t shift = 7;
+		for (size_t i = 0; i < 4; i++)
+		{
+			const uint8_t group = *data++;
+			result |= static_cast<uint32_t>(group & 127) << shift;
+			shift += 7;
+			if (group < 128)
+			{
+				break;
+			}
+		}
+		return result;
+	}
+
+	struct IndexFifos
+	{
+		uint32_t edges[INDEX_FIFO_SIZE][2];
+		uint32_t vertices[INDEX_FIFO_SIZE];
+		size_t edgeOffset = 0;
+		size_t vertexOffset = 0;
+
+		IndexFifos()
+		{
+			memset(edges, -1, sizeof(edges));
+			memset(vertices, -1, sizeof(vertices));
+		}
+
+		void PushEdge(uint32_t a, uint32_t b)
+		{
+			edges[edgeOffset][0] = a;
+			edges[edgeOffset][1] = b;
+			edgeOffset = (edgeOffset + 1) % INDEX_FIFO_SIZE;
+		}
+
+		void PushVertex(uint32_t v, bool condition = true)
+		{
+			vertices[vertexOffset] = v;
+			vertexOffset = (vertexOffset + condition) % INDEX_FIFO_SIZE;
+		}
+
+		// Entries counted back from the most recent one
+		const uint32_t* Edge(size_t back) const { return edges[(edgeOffset - 1 - back) % INDEX_FIFO_SIZE]; }
+		uint32_t Vertex(size_t back) const { return vertices[(vertexOffset - 1 - back) % INDEX_FIFO_SIZE]; }
+	};
+
+	// Triangles are coded relative to an edge and vertex FIFO of the ones before, new vertices as the next unused index and the rest as deltas to the last free index
+	bool DecodeIndexBuffer(uint8_t* destination, size_t count, size_t indexSize, const uint8_t* source, size_t sourceSize)
+	{
+		if (count % 3 != 0 || (indexSize != 2 && indexSize != 4))
+		{
+			return false;
+		}
+		// Header, one code byte per triangle and the code aux table
+		if (sourceSize < 1 + count / 3 + CODE_AUX_TABLE_SIZE || (source[0] & 0xf0) != MESHOPT_INDEX_HEADER || (source[0] & 0x0f) > 1)
+		{
+			return false;
+		}
+		const int version = source[0] & 0x0f;
+		// Version 1 codes the free index one before and after the last one as 13 and 14
+		const uint32_t fecMax = version >= 1 ? 13 : 15;
+
+		IndexFifos fifos;
+		uint32_t next = 0;
+		uint32_t last = 0;
+		const uint8_t* code = source + 1;
+		const uint8_t* data = code + count / 3;
+		const uint8_t* dataSafeEnd = source + sourceSize - CODE_AUX_TABLE_SIZE;
+		const uint8_t* codeAuxTable = dataSafeEnd;
+
+		for (size_t i = 0; i < count; i += 3)
+		{
+			// A triangle reads at most 16 bytes, a code aux byte and three 5 byte indices, and the table is 16 bytes
+			if (data > dataSafeEnd)
+			{
+				return false;
+			}
+
+			const uint8_t codeTri = *code++;
+			if (codeTri < 0xf0)
+			{
+				// Shares an edge with a recent triangle, the third vertex comes from the FIFO, is the next one or free
+				const uint32_t* edge = fifos.Edge(codeTri >> 4);
+				const uint32_t a = edge[0];
+				const uint32_t b = edge[1];
+				const uint32_t fec = codeTri & 15;
+				if (fec < fecMax)
+				{
+					const uint32_t c = fec == 0 ? next : fifos.Vertex(fec);
+					next += fec == 0;
+					WriteTriangle(destination, i, indexSize, a, b, c);
+					fifos.PushVertex(c, fec == 0);
+					fifos.PushEdge(c, b);
+					fifos.PushEdge(a, c);
+				}
+				else
+				{
+					// fec - (fec ^ 3) turns 13 and 14 into -1 and 1
+					const uint32_t c = last = fec != 15 ? last + (fec - (fec ^ 3)) : last + Unzigzag32(DecodeVByte(data));
+					WriteTriangle(destination, i, indexSize, a, b, c);
+					fifos.PushVertex(c);
+					fifos.PushEdge(c, b);
+					fifos.PushEdge(a, c);
+				}
+			}
+			else if (codeTri < 0xfe)
+			{
+				// New triangle with a as the next index, b and c from a table of common FIFO and next combinations
+				const uint8_t codeAux = codeAuxTable[codeTri & 15];
+				const uint32_t feb = codeAux >> 4;
+				const uint32_t fec = codeAux & 15;
+				const uint32_t a = next++;
+				const uint32_t b = feb == 0 ? next : fifos.Vertex(feb - 1);
+				next += feb == 0;
+				const uint32_t c = fec == 0 ? next : fifos.Vertex(fec - 1);
+				next += fec == 0;
+				WriteTriangle(destination, i, indexSize, a, b, c);
+				fifos.PushVertex(a);
+				fifos.PushVertex(b, feb == 0);
+				fifos.PushVertex(c, fec == 0);
+				fifos.PushEdge(b, a);
+				fifos.PushEdge(c, b);
+				fifos.PushEdge(a, c);
+			}
+			else
+			{
+				// Same but with the code aux byte in the data, 0xff also makes a free
+				const uint8_t codeAux = *data++;
+				const uint32_t fea = codeTri == 0xfe ? 0 : 15;
+				const uint32_t feb = codeAux >> 4;
+				const uint32_t fec = codeAux & 15;
+				// A zero code aux here would have come from the table, the encoder uses it to restart at index 0
+				if (codeAux == 0)
+				{
+					next = 0;
+				}
+
+				uint32_t a = fea == 0 ? next++ : 0;
+				uint32_t b = feb == 0 ? next++ : fifos.Vertex(feb - 1);
+				uint32_t c = fec == 0 ? next++ : fifos.Vertex(fec - 1);
+				if (fea == 15) last = a = last + Unzigzag32(DecodeVByte(data));
+				if (feb == 15) last = b = last + Unzigzag32(DecodeVByte(data));
+				if (fec == 15) last = c = last + Unzigzag32(DecodeVByte(data));
+				WriteTriangle(destination, i, indexSize, a, b, c);
+				fifos.PushVertex(a);
+				fifos.PushVertex(b, feb == 0 || feb == 15);
+				fifos.PushVertex(c, fec == 0 || fec == 15);
+				fifos.PushEdge(b, a);
+				fifos.PushEdge(c, b);
+				fifos.PushEdge(a, c);
+			}
+		}
+		return data == dataSafeEnd;
+	}
+
+	// Deltas to one of two running baselines, the low bit of every value picks the baseline
+	bool DecodeIndexSequence(uint8_t* destination, size_t count, size_t indexSize, const uint8_t* source, size_t sourceSize)
+	{
+		if (indexSize != 2 && indexSize != 4)
+		{
+			return false;
+		}
+		// Header, at least a byte per index and a 4 byte tail so a value can be read unchecked
+		if (sourceSize < 1 + count + 4 || (source[0] & 0xf0) != MESHOPT_SEQUENCE_HEADER || (source[0] & 0x0f) > 1)
+		{
+			return false;
+		}
+
+		const uint8_t* data = source + 1;
+		const uint8_t* dataSafeEnd = source + sourceSize - 4;
+		uint32_t last[2] = {};
+		for (size_t i = 0; i < count; i++)
+		{
+			if (data >= dataSafeEnd)
+			{
+				return false;
+			}
+			const uint32_t v = DecodeVByte(data);
+			const uint32_t baseline = v & 1;
+			last[baseline] += Unzigzag32(v >> 1);
+			WriteIndex(destination, i, indexSize, last[baseline]);
+		}
+		return data == dataSafeEnd;
+	}
+
+	// x and y are the octahedral coordinates and z holds what 1.0 was quantized to, the result is the unit vector at the same scale. w is left alone
+	template <typename T>
+	void DecodeOctahedralScalar(T* data, size_t count)
+	{
+		const float max = static_cast<float>((1 << (sizeof(T) * 8 - 1)) - 1);
+		for (size_t i = 0; i < count; i++)
+		{
+			float x = static_cast<float>(data[i * 4 + 0]);
+			float y = static_cast<float>(data[i * 4 + 1]);
+			float z = static_cast<float>(data[i * 4 + 2]) - fabsf(x) - fabsf(y);
+
+			// Unfold the lower hemisphere
+			const float t = z < 0.f ? z : 0.f;
+			x += x >= 0.f ? t : -t;
+			y += y >= 0.f ? t : -t;
+
+			const float l = sqrtf(x * x + y * y + z * z);
+			const float s = max / l;
+			data[i * 4 + 0] = static_cast<T>(static_cast<int>(x * s + (x >= 0.f ? 0.5f : -0.5f)));
+			data[i * 4 + 1] = static_cast<T>(static_cast<int>(y * s + (y >= 0.f ? 0.5f : -0.5f)));
+			data[i * 4 + 2] = static_cast<T>(static_cast<int>(z * s + (z >= 0.f ? 0.5f : -0.5f)));
+		}
+	}
+
+	// Three components scaled by 1 / sqrt(2) and the largest one's index plus its quantization scale in the low and high bits of the fourth.
+	// Quaternions only come with animation tracks, which are small, so they stay scalar
+	void DecodeQuaternion(int16_t* data, size_t count)
+	{
+		const float scale = 1.f / sqrtf(2.f);
+		for (size_t i = 0; i < count; i++)
+		{
+			int16_t* q = &data[i * 4];
+			const float s = scale / static_cast<float>(q[3] | 3);
+			const float x = static_cast<float>(q[0]) * s;
+			const float y = static_cast<float>(q[1]) * s;
+			const float z = static_cast<float>(q[2]) * s;
+			const float ww = 1.f - x * x - y * y - z * z;
+			const float w = sqrtf(ww >= 0.f ? ww : 0.f);
+
+			const int largest = q[3] & 3;
+			q[(largest + 1) & 3] = static_cast<int16_t>(x * 32767.f + (x >= 0.f ? 0.5f : -0.5f));
+			q[(largest + 2) & 3] = static_cast<int16_t>(y * 32767.f + (y >= 0.f ? 0.5f : -0.5f));
+			q[(largest + 3) & 3] = static_cast<int16_t>(z * 32767.f + (z >= 0.f ? 0.5f : -0.5f));
+			q[(largest + 0) & 3] = static_cast<int16_t>(w * 32767.f + 0.5f);
+		}
+	}
+
+	// A 24 bit signed mantissa and an 8 bit signed exponent per float, built as 2^e * m without calling ldexp
+	void DecodeExponentialScalar(uint32_t* data, size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			const int32_t mantissa = static_cast<int32_t>(data[i] << 8) >> 8;
+			const int32_t exponent = static_cast<int32_t>(data[i]) >> 24;
+			const uint32_t scaleBits = static_cast<uint32_t>(exponent + 127) << 23;
+			float value;
+			memcpy(&value, &scaleBits, sizeof(value));
+			value *= static_cast<float>(mantissa);
+			memcpy(&data[i], &value, sizeof(value));
+		}
+	}
+
+#if defined(_XM_SSE_INTRINSICS_)
+	void Transpose4(__m128i& a, __m128i& b, __m128i& c, __m128i& d)
+	{
+		__m128i ab01 = _mm_unpacklo_epi32(a, b);
+		__m128i cd01 = _mm_unpacklo_epi32(c, d);
+		__m128i ab23 = _mm_unpackhi_epi32(a, b);
+		__m128i cd23 = _mm_unpackhi_epi32(c, d);
+		a = _mm_unpacklo_epi64(ab01, cd01);
+		b = _mm_unpackhi_epi64(ab01, cd01);
+		c = _mm_unpacklo_epi64(ab23, cd23);
+		d = _mm_unpackhi_epi64(ab23, cd23);
+	}
+
+	// The scalar octahedral decode for four vectors with one component per register, the same operations in the same order so both round the same way
+	void DecodeOctahedral4(__m128i& x, __m128i& y, __m128i& z, float max)
+	{
+		const __m128 sign = _mm_set1_ps(-0.f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 half = _mm_set1_ps(0.5f);
+		__m128 fx = _mm_cvtepi32_ps(x);
+		__m128 fy = _mm_cvtepi32_ps(y);
+		__m128 fz = _mm_sub_ps(_mm_sub_ps(_mm_cvtepi32_ps(z), _mm_andnot_ps(sign, fx)), _mm_andnot_ps(sign, fy));
+
+		__m128 t = _mm_min_ps(fz, zero);
+		fx = _mm_add_ps(fx, _mm_xor_ps(t, _mm_andnot_ps(_mm_cmpge_ps(fx, zero), sign)));
+		fy = _mm_add_ps(fy, _mm_xor_ps(t, _mm_andnot_ps(_mm_cmpge_ps(fy, zero), sign)));
+
+		__m128 l = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(fx, fx), _mm_mul_ps(fy, fy)), _mm_mul_ps(fz, fz)));
+		__m128 s = _mm_div_ps(_mm_set1_ps(max), l);
+		x = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(fx, s), _mm_xor_ps(half, _mm_andnot_ps(_mm_cmpge_ps(fx, zero), sign))));
+		y = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(fy, s), _mm_xor_ps(half, _mm_andnot_ps(_mm_cmpge_ps(fy, zero), sign))));
+		z = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(fz, s), _mm_xor_ps(half, _mm_andnot_ps(_mm_cmpge_ps(fz, zero), sign))));
+	}
+
+	void DecodeOctahedral8(int8_t* data, size_t count)
+	{
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			// Every byte duplicated into all four bytes of a lane and shifted back down for the sign extension
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[i * 4]));
+			__m128i low = _mm_unpacklo_epi8(v, v);
+			__m128i high = _mm_unpackhi_epi8(v, v);
+			__m128i x = _mm_srai_epi32(_mm_unpacklo_epi16(low, low), 24);
+			__m128i y = _mm_srai_epi32(_mm_unpackhi_epi16(low, low), 24);
+			__m128i z = _mm_srai_epi32(_mm_unpacklo_epi16(high, high), 24);
+			__m128i w = _mm_srai_epi32(_mm_unpackhi_epi16(high, high), 24);
+			Transpose4(x, y, z, w);
+			DecodeOctahedral4(x, y, z, 127.f);
+			Transpose4(x, y, z, w);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&data[i * 4]), _mm_packs_epi16(_mm_packs_epi32(x, y), _mm_packs_epi32(z, w)));
+		}
+		DecodeOctahedralScalar(&data[i * 4], count - i);
+	}
+
+	void DecodeOctahedral16(int16_t* data, size_t count)
+	{
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i v01 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[i * 4]));
+			__m128i v23 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[i * 4 + 8]));
+			__m128i x = _mm_srai_epi32(_mm_unpacklo_epi16(v01, v01), 16);
+			__m128i y = _mm_srai_epi32(_mm_unpackhi_epi16(v01, v01), 16);
+			__m128i z = _mm_srai_epi32(_mm_unpacklo_epi16(v23, v23), 16);
+			__m128i w = _mm_srai_epi32(_mm_unpackhi_epi16(v23, v23), 16);
+			Transpose4(x, y, z, w);
+			DecodeOctahedral4(x, y, z, 32767.f);
+			Transpose4(x, y, z, w);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&data[i * 4]), _mm_packs_epi32(x, y));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&data[i * 4 + 8]), _mm_packs_epi32(z, w));
+		}
+		DecodeOctahedralScalar(&data[i * 4], count - i);
+	}
+
+	void DecodeExponential(uint32_t* data, size_t count)
+	{
+		size_t i = 0;
+		const __m128i bias = _mm_set1_epi32(127);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[i]));
+			__m128i mantissa = _mm_srai_epi32(_mm_slli_epi32(v, 8), 8);
+			__m128i exponent = _mm_srai_epi32(v, 24);
+			__m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(exponent, bias), 23));
+			_mm_storeu_ps(reinterpret_cast<float*>(&data[i]), _mm_mul_ps(scale, _mm_cvtepi32_ps(mantissa)));
+		}
+		DecodeExponentialScalar(&data[i], count - i);
+	}
+#endif
+
+	bool DecodeFilter(uint8_t* data, size_t count, size_t byteStride, MeshoptFilter filter, bool simd)
+	{
+		switch (filter)
+		{
+		case MeshoptFilter::None:
+			return true;
+		case MeshoptFilter::Octahedral:
+			if (byteStride != 4 && byteStride != 8)
+			{
+				return false;
+			}
+#if defined(_XM_SSE_INTRINSICS_)
+			if (simd)
+			{
+				byteStride == 4 ? DecodeOctahedral8(reinterpret_cast<int8_t*>(data), count) : DecodeOctahedral16(reinterpret_cast<int16_t*>(data), count);
+				return true;
+			}
+#endif
+			byteStride == 4 ? DecodeOctahedralScalar(reinterpret_cast<int8_t*>(data), count) : DecodeOctahedralScalar(reinterpret_cast<int16_t*>(data), count);
+			return true;
+		case MeshoptFilter::Quaternion:
+			if (byteStride != 8)
+			{
+				return false;
+			}
+			DecodeQuaternion(reinterpret_cast<int16_t*>(data), count);
+			return true;
+		case MeshoptFilter::Exponential:
+#if defined(_XM_SSE_INTRINSICS_)
+			if (simd)
+			{
+				DecodeExponential(reinterpret_cast<uint32_t*>(data), count * byteStride / 4);
+				return true;
+			}
+#endif
+			DecodeExponentialScalar(reinterpret_cast<uint32_t*>(data), count * byteStride / 4);
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	bool DecodeMeshopt(uint8_t* destination, size_t count, size_t byteStride, const uint8_t* source, size_t sourceSize, MeshoptMode mode, MeshoptFilter filter, bool simd)
+	{
+		switch (mode)
+		{
+		case MeshoptMode::Attributes:
+			// The extension only allows strides that are whole 32 bit words
+			if (byteStride == 0 || byteStride > MESHOPT_VERTEX_BLOCK_MAX || byteStride % 4 != 0)
+			{
+				return false;
+			}
+			return DecodeVertexBuffer(destination, count, byteStride, source, sourceSize, simd) && DecodeFilter(destination, count, byteStride, filter, simd);
+		case MeshoptMode::Triangles:
+			return filter == MeshoptFilter::None && DecodeIndexBuffer(destination, count, byteStride, source, sourceSize);
+		case MeshoptMode::Indices:
+			return filter == MeshoptFilter::None && DecodeIndexSequence(destination, count, byteStride, source, sourceSize);
+		default:
+			return false;
+		}
+	}
+}
+
+size_t GetMeshoptVertexBlockSize(size_t byteStride)
+{
+	return std::min<size_t>((MESHOPT_VERTEX_BLOCK_BYTES / byteStride) & ~(BYTE_GROUP_SIZE - 1), MESHOPT_VERTEX_BLOCK_MAX);
+}
+
+bool DecodeMeshoptBuffer(uint8_t* destination, size_t count, size_t byteStride, const uint8_t* source, size_t sourceSize, MeshoptMode mode, MeshoptFilter filter)
+{
+	return DecodeMeshopt(destination, count, byteStride, source, sourceSize, mode, filter, true);
+}
+
+bool DecodeMeshoptBufferScalar(uint8_t* destination, size_t count, size_t byteStride, const uint8_t* source, size_t sourceSize, MeshoptMode mode, MeshoptFilter filter)
+{
+	return DecodeMeshopt(destination, count, byteStride, source, sourceSize, mode, filter, false);
+}
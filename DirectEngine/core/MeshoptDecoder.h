@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Header bytes of the EXT_meshopt_compression bitstreams, the low nibble is the version
+#define MESHOPT_VERTEX_HEADER 0xa0
+#define MESHOPT_INDEX_HEADER 0xe0
+#define MESHOPT_SEQUENCE_HEADER 0xd0
+// Attribute streams are split into blocks of at most this many bytes and 256 elements
+#define MESHOPT_VERTEX_BLOCK_BYTES 8192
+#define MESHOPT_VERTEX_BLOCK_MAX 256
+// Every attribute stream ends with the first element padded to at least this many bytes
+#define MESHOPT_VERTEX_TAIL_MIN 32
+
+enum class MeshoptMode
+{
+	Attributes,
+	Triangles,
+	Indices,
+};
+
+enum class MeshoptFilter
+{
+	None,
+	Octahedral,
+	Quaternion,
+	Exponential,
+};
+
+/// <summary>
+/// Decodes an EXT_meshopt_compression buffer view of count elements byteStride bytes each into destination, which needs count * byteStride bytes.
+/// Attributes get their delta decoding and filters done with SSE2. Returns false if the data is malformed or doesn't fit the mode,
+/// destination is left half written in that case.
+/// </summary>
+bool DecodeMeshoptBuffer(uint8_t* destination, size_t count, size_t byteStride, const uint8_t* source, size_t sourceSize, MeshoptMode mode, MeshoptFilter filter);
+bool DecodeMeshoptBufferScalar(uint8_t* destination, size_t count, size_t byteStride, const uint8_t* source, size_t sourceSize, MeshoptMode mode, MeshoptFilter filter);
+
+/// <summary>
+/// Elements per attribute block for a stride, a multiple of 16 so every block is made of whole byte groups.
+/// </summary>
+size_t GetMeshoptVertexBlockSize(size_t byteStride);
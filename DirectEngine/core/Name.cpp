@@ -0,0 +1,40 @@
+#include "Name.h"
+
+#include <mutex>
+
+namespace
+{
+	struct NameTable
+	{
+		MemoryArena arena{ NAME_TABLE_CAPACITY };
+		ArenaHashMap<uint64_t, const char*> strings{ arena, 4096 };
+		std::mutex mutex;
+	};
+
+	// Function local so names can be interned during static initialization
+	NameTable& GetNameTable()
+	{
+		static NameTable table{};
+		return table;
+	}
+}
+
+Name Name::Intern(std::string_view str)
+{
+	const uint64_t id = HashName(str);
+	NameTable& table = GetNameTable();
+	std::lock_guard<std::mutex> lock(table.mutex);
+
+	const char** existing = table.strings.find(id);
+	if (existing != nullptr)
+	{
+		assert(str == *existing && "Name hash collision!");
+		return Name{ id, *existing };
+	}
+
+	char* copy = table.arena.Allocate<char>(str.size() + 1);
+	memcpy(copy, str.data(), str.size());
+	copy[str.size()] = '\0';
+	table.strings.insert(id, copy);
+	return Name{ id, copy };
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "HashMap.h"
+#include <string_view>
+
+#define NAME_TABLE_CAPACITY (1024ull * 1024 * 64)
+
+/// <summary>
+/// 64 bit FNV-1a, usable at compile time so literal names never need to be hashed at runtime.
+/// </summary>
+constexpr uint64_t HashName(std::string_view str)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : str)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/// <summary>
+/// Immutable interned string. The id is the hash of the string, so it's stable between runs and comparisons are integer compares.
+/// Literals point at themselves, everything else has to go through Name::Intern which copies the string into a global table.
+/// </summary>
+struct Name
+{
+    uint64_t id = HashName("");
+    const char* str = "";
+
+    constexpr Name() = default;
+
+    template <size_t N>
+    consteval Name(const char(&literal)[N]) : id(HashName(literal)), str(literal) {}
+
+    static Name Intern(std::string_view str);
+
+    const char* c_str() const { return str; }
+    constexpr bool operator==(const Name& other) const { return id == other.id; }
+
+private:
+    constexpr Name(uint64_t id, const char* str) : id(id), str(str) {}
+};
+
+template <>
+struct ArenaHash<Name>
+{
+    uint64_t operator()(const Name& name) const
+    {
+        return ArenaHash<uint64_t>{}(name.id);
+    }
+};
+
+template <>
+struct std::formatter<Name> {
+    constexpr auto parse(std::format_parse_context& ctx) {
+        return ctx.begin();
+    }
+
+    auto format(const Name& obj, std::format_context& ctx) const {
+        return std::format_to(ctx.out(), "{}", obj.str);
+    }
+};
@@ -0,0 +1,256 @@
+#include "Vertex.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+
+namespace VertexData
+{
+	XMVECTOR EncodeOctahedral(FXMVECTOR direction)
+	{
+		// Project onto the octahedron |x| + |y| + |z| = 1, zero vectors end up at the origin and decode to +z
+		XMVECTOR l1 = XMVector3Dot(XMVectorAbs(direction), g_XMOne);
+		XMVECTOR n = XMVectorDivide(direction, XMVectorMax(l1, g_XMEpsilon));
+
+		XMVECTOR sign = XMVectorSelect(g_XMNegativeOne, g_XMOne, XMVectorGreaterOrEqual(n, XMVectorZero()));
+		XMVECTOR folded = XMVectorMultiply(XMVectorSubtract(g_XMOne, XMVectorAbs(XMVectorSwizzle<1, 0, 2, 3>(n))), sign);
+		XMVECTOR encoded = XMVectorSelect(n, folded, XMVectorLess(XMVectorSplatZ(n), XMVectorZero()));
+		return XMVectorSelect(XMVectorZero(), encoded, g_XMSelect1100);
+	}
+
+	XMVECTOR DecodeOctahedral(FXMVECTOR encoded)
+	{
+		XMVECTOR absEncoded = XMVectorAbs(encoded);
+		XMVECTOR z = XMVectorSubtract(g_XMOne, XMVectorAdd(XMVectorSplatX(absEncoded), XMVectorSplatY(absEncoded)));
+		XMVECTOR t = XMVectorSaturate(XMVectorNegate(z));
+		XMVECTOR xy = XMVectorAdd(encoded, XMVectorSelect(t, XMVectorNegate(t), XMVectorGreaterOrEqual(encoded, XMVectorZero())));
+		return XMVector3Normalize(XMVectorSelect(XMVectorSelect(XMVectorZero(), xy, g_XMSelect1100), z, g_XMSelect0010));
+	}
+
+	void PackVertices(const Vertex* vertices, PackedVertex* packed, size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			const Vertex& vertex = vertices[i];
+			PackedVertex result;
+
+			result.position = vertex.position;
+
+			XMVECTOR normal = XMLoadFloat3(&vertex.normal);
+			XMVECTOR tangent = XMLoadFloat3(&vertex.tangent);
+			XMStoreShortN2(&result.normal, EncodeOctahedral(normal));
+
+			// Shaders rebuild the bitangent as cross(normal, tangent), w only says if that has to be flipped
+			float handedness = XMVectorGetX(XMVector3Dot(XMVector3Cross(normal, tangent), XMLoadFloat3(&vertex.bitangent)));
+			XMVECTOR unormTangent = XMVectorMultiplyAdd(EncodeOctahedral(tangent), g_XMOneHalf, g_XMOneHalf);
+			XMStoreUDecN4(&result.tangent, XMVectorSetW(unormTangent, handedness < 0.0f ? 0.0f : 1.0f));
+
+			XMStoreHalf2(&result.uv, XMLoadFloat2(&vertex.uv));
+
+			// Rounding each weight on its own can make the sum drift from 255, give the difference to the largest one
+			XMVECTOR weights = XMVectorRound(XMVectorScale(XMVectorSaturate(XMLoadFloat4(&vertex.boneWeights)), 255.0f));
+			XMFLOAT4 rounded;
+			XMStoreFloat4(&rounded, weights);
+			float* weightValues = &rounded.x;
+			float sum = weightValues[0] + weightValues[1] + weightValues[2] + weightValues[3];
+			if (sum > 0.0f && sum != 255.0f)
+			{
+				size_t largest = 0;
+				for (size_t w = 1; w < 4; w++)
+				{
+					if (weightValues[w] > weightValues[largest]) largest = w;
+				}
+				weightValues[largest] += 255.0f - sum;
+			}
+			result.boneWeights = XMUBYTEN4{ (uint8_t)weightValues[0], (uint8_t)weightValues[1], (uint8_t)weightValues[2], (uint8_t)weightValues[3] };
+
+			assert(vertex.boneIndices.x < 256 && vertex.boneIndices.y < 256 && vertex.boneIndices.z < 256 && vertex.boneIndices.w < 256);
+			result.boneIndices = XMUBYTE4{ (uint8_t)vertex.boneIndices.x, (uint8_t)vertex.boneIndices.y, (uint8_t)vertex.boneIndices.z, (uint8_t)vertex.boneIndices.w };
+
+			packed[i] = result;
+		}
+	}
+
+	Vertex UnpackVertex(const PackedVertex& packed)
+	{
+		Vertex vertex{};
+		vertex.position = packed.position;
+
+		XMVECTOR normal = DecodeOctahedral(XMLoadShortN2(&packed.normal));
+		XMVECTOR packedTangent = XMLoadUDecN4(&packed.tangent);
+		XMVECTOR tangent = DecodeOctahedral(XMVectorMultiplyAdd(packedTangent, g_XMTwo, g_XMNegativeOne));
+		float handedness = XMVectorGetW(packedTangent) > 0.5f ? 1.0f : -1.0f;
+		XMStoreFloat3(&vertex.normal, normal);
+		XMStoreFloat3(&vertex.tangent, tangent);
+		XMStoreFloat3(&vertex.bitangent, XMVectorScale(XMVector3Cross(normal, tangent), handedness));
+
+		XMStoreFloat2(&vertex.uv, XMLoadHalf2(&packed.uv));
+		XMStoreFloat4(&vertex.boneWeights, XMLoadUByteN4(&packed.boneWeights));
+		vertex.boneIndices = XMUINT4{ packed.boneIndices.x, packed.boneIndices.y, packed.boneIndices.z, packed.boneIndices.w };
+		return vertex;
+	}
+
+	void ConvertVertexScalar(const VertexStreams& streams, Vertex& vertex, size_t i)
+	{
+		const float* position = &streams.positions[i * 3];
+		const float* normal = &streams.normals[i * 3];
+		const float* tangent = &streams.tangents[i * 4];
+		vertex.position = { position[0], position[1], position[2] };
+		vertex.normal = { normal[0], normal[1], normal[2] };
+		vertex.tangent = { tangent[0], tangent[1], tangent[2] };
+
+		// Same operations in the same order as the SIMD path, so both round the same way
+		vertex.bitangent.x = (normal[1] * tangent[2] - normal[2] * tangent[1]) * tangent[3];
+		vertex.bitangent.y = (normal[2] * tangent[0] - normal[0] * tangent[2]) * tangent[3];
+		vertex.bitangent.z = (normal[0] * tangent[1] - normal[1] * tangent[0]) * tangent[3];
+
+		vertex.uv = { streams.uvs[i * 2 + 0], streams.uvs[i * 2 + 1] };
+
+		if (streams.joints != nullptr)
+		{
+			const uint8_t* joints = &streams.joints[i * 4];
+			const float* weights = &streams.weights[i * 4];
+			assert(abs(1. - (weights[0] + weights[1] + weights[2] + weights[3])) < 0.01);
+			vertex.boneIndices = { joints[0], joints[1], joints[2], joints[3] };
+			vertex.boneWeights = { weights[0], weights[1], weights[2], weights[3] };
+		}
+	}
+
+	void ConvertVertexStreamsScalar(const VertexStreams& streams, Vertex* vertices, size_t first, size_t count)
+	{
+		for (size_t i = first; i < first + count; i++)
+		{
+			ConvertVertexScalar(streams, vertices[i], i);
+		}
+	}
+
+#if defined(_XM_SSE_INTRINSICS_)
+	// Splits four tightly packed float3 into one register each, the w lanes are garbage.
+	// Only reads the 12 floats that belong to the four vectors, so it's safe at the end of a buffer
+	void LoadFloat3x4(const float* source, __m128& v0, __m128& v1, __m128& v2, __m128& v3)
+	{
+		__m128 a = _mm_loadu_ps(source + 0);
+		__m128 b = _mm_loadu_ps(source + 4);
+		__m128 c = _mm_loadu_ps(source + 8);
+		v0 = a;
+		v1 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 3, 3));
+		v1 = _mm_shuffle_ps(v1, v1, _MM_SHUFFLE(3, 3, 2, 1));
+		v2 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(0, 0, 3, 2));
+		v3 = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 2, 1));
+	}
+
+	void StoreFloat3(float* destination, __m128 v)
+	{
+		_mm_storel_pi(reinterpret_cast<__m64*>(destination), v);
+		_mm_store_ss(destination + 2, _mm_movehl_ps(v, v));
+	}
+#endif
+
+	void ConvertVertexStreams(const VertexStreams& streams, Vertex* vertices, size_t first, size_t count)
+	{
+		size_t i = first;
+		const size_t end = first + count;
+
+#if defined(_XM_SSE_INTRINSICS_)
+		// normal, tangent, bitangent and uv are adjacent in Vertex, so they get written with 16 byte stores in that order
+		// where each one overwrites the garbage lane of the one before. Position is followed by color and gets an exact store
+		static_assert(offsetof(Vertex, tangent) == offsetof(Vertex, normal) + 12);
+		static_assert(offsetof(Vertex, bitangent) == offsetof(Vertex, tangent) + 12);
+		static_assert(offsetof(Vertex, uv) == offsetof(Vertex, bitangent) + 12);
+		const __m128i zero = _mm_setzero_si128();
+		for (; i + 4 <= end; i += 4)
+		{
+			Vertex* group = &vertices[i];
+
+			__m128 p[4];
+			LoadFloat3x4(&streams.positions[i * 3], p[0], p[1], p[2], p[3]);
+			__m128 n[4];
+			LoadFloat3x4(&streams.normals[i * 3], n[0], n[1], n[2], n[3]);
+			__m128 t[4];
+			for (size_t k = 0; k < 4; k++)
+			{
+				t[k] = _mm_loadu_ps(&streams.tangents[(i + k) * 4]);
+			}
+
+			// Bitangents of all four vertices at once with the vectors transposed to one component per register
+			__m128 nx = n[0], ny = n[1], nz = n[2], nw = n[3];
+			_MM_TRANSPOSE4_PS(nx, ny, nz, nw);
+			__m128 tx = t[0], ty = t[1], tz = t[2], tw = t[3];
+			_MM_TRANSPOSE4_PS(tx, ty, tz, tw);
+			__m128 b[4];
+			b[0] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(ny, tz), _mm_mul_ps(nz, ty)), tw);
+			b[1] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(nz, tx), _mm_mul_ps(nx, tz)), tw);
+			b[2] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(nx, ty), _mm_mul_ps(ny, tx)), tw);
+			b[3] = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(b[0], b[1], b[2], b[3]);
+
+			__m128 uv01 = _mm_loadu_ps(&streams.uvs[i * 2 + 0]);
+			__m128 uv23 = _mm_loadu_ps(&streams.uvs[i * 2 + 4]);
+			__m128 uv[4] = { uv01, _mm_movehl_ps(uv01, uv01), uv23, _mm_movehl_ps(uv23, uv23) };
+
+			for (size_t k = 0; k < 4; k++)
+			{
+				Vertex& vertex = group[k];
+				StoreFloat3(&vertex.position.x, p[k]);
+				_mm_storeu_ps(&vertex.normal.x, n[k]);
+				_mm_storeu_ps(&vertex.tangent.x, t[k]);
+				_mm_storeu_ps(&vertex.bitangent.x, b[k]);
+				_mm_storel_pi(reinterpret_cast<__m64*>(&vertex.uv.x), uv[k]);
+			}
+
+			if (streams.joints != nullptr)
+			{
+				// 16 joint bytes of four vertices widened to four XMUINT4
+				__m128i joints = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&streams.joints[i * 4]));
+				__m128i joints01 = _mm_unpacklo_epi8(joints, zero);
+				__m128i joints23 = _mm_unpackhi_epi8(joints, zero);
+				__m128i boneIndices[4] = { _mm_unpacklo_epi16(joints01, zero), _mm_unpackhi_epi16(joints01, zero), _mm_unpacklo_epi16(joints23, zero), _mm_unpackhi_epi16(joints23, zero) };
+
+				for (size_t k = 0; k < 4; k++)
+				{
+					const float* weights = &streams.weights[(i + k) * 4];
+					assert(abs(1. - (weights[0] + weights[1] + weights[2] + weights[3])) < 0.01);
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(&group[k].boneIndices), boneIndices[k]);
+					_mm_storeu_ps(&group[k].boneWeights.x, _mm_loadu_ps(weights));
+				}
+			}
+		}
+#endif
+
+		for (; i < end; i++)
+		{
+			ConvertVertexScalar(streams, vertices[i], i);
+		}
+	}
+
+	void WidenIndicesScalar(const uint16_t* source, uint32_t* destination, size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			destination[i] = source[i];
+		}
+	}
+
+	void WidenIndices(const uint16_t* source, uint32_t* destination, size_t count)
+	{
+		size_t i = 0;
+#if defined(_XM_AVX2_INTRINSICS_)
+		for (; i + 16 <= count; i += 16)
+		{
+			__m256i low = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&source[i])));
+			__m256i high = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&source[i + 8])));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(&destination[i]), low);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(&destination[i + 8]), high);
+		}
+#elif defined(_XM_SSE_INTRINSICS_)
+		const __m128i zero = _mm_setzero_si128();
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&source[i]));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&destination[i]), _mm_unpacklo_epi16(indices, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&destination[i + 4]), _mm_unpackhi_epi16(indices, zero));
+		}
+#endif
+		WidenIndicesScalar(&source[i], &destination[i], count - i);
+	}
+}
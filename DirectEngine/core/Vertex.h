@@ -1,12 +1,17 @@
 #pragma once
 #include <d3d12.h>
 #include <DirectXMath.h>
+#include <DirectXPackedVector.h>
 #include <string>
 #include "Constants.h"
 using namespace DirectX;
+using namespace DirectX::PackedVector;
 
 namespace VertexData
 {
+    /// <summary>
+    /// Full precision vertex. Importers produce it and CPU side code works with it, debug lines get drawn from it directly.
+    /// </summary>
     struct Vertex
     {
         XMFLOAT3 position;
@@ -19,15 +24,83 @@ namespace VertexData
         XMUINT4 boneIndices;
     };
 
+    /// <summary>
+    /// What meshes look like in the GPU vertex buffer, 32 instead of 104 bytes. Cooked files store it as is, CreateMesh packs glTF vertices into it.
+    /// Normals and tangents are octahedral encoded, the bitangent is rebuilt in the vertex shader from the sign in tangent.w.
+    /// DecodeTangentFrame in common.hlsl has to match PackVertices.
+    /// </summary>
+    struct PackedVertex
+    {
+        XMFLOAT3 position;
+        XMSHORTN2 normal;
+        XMUDECN4 tangent;
+        XMHALF2 uv;
+        XMUBYTEN4 boneWeights;
+        XMUBYTE4 boneIndices;
+    };
+    static_assert(sizeof(PackedVertex) == 32);
+
+    /// <summary>
+    /// Contiguous range of the index buffer touching at most MESHLET_MAX_VERTICES vertices, bounds are in mesh space.
+    /// The normal cone is tested against the bounding sphere, a coneCutoff of 1 means the meshlet can't be backface culled.
+    /// </summary>
+    struct Meshlet
+    {
+        XMFLOAT3 center;
+        float radius;
+        XMFLOAT3 aabbMin;
+        uint32_t firstIndex;
+        XMFLOAT3 aabbMax;
+        uint16_t indexCount;
+        uint16_t vertexCount;
+        XMFLOAT3 coneAxis;
+        float coneCutoff;
+    };
+    static_assert(sizeof(Meshlet) == 64);
+
+    struct MeshLod
+    {
+        INDEX_BUFFER_TYPE* indices = nullptr;
+        size_t indexCount = 0;
+        // Largest distance from the full mesh in mesh space units
+        float error = 0.f;
+    };
+
     struct MeshData
     {
+        // Null for meshes loaded from a cooked file, they only have packedVertices
         VertexData::Vertex* vertices = nullptr;
+        // Null for meshes straight from glTF
+        PackedVertex* packedVertices = nullptr;
         size_t vertexCount = 0;
         INDEX_BUFFER_TYPE* indices = nullptr;
         size_t indexCount = 0;
+        Meshlet* meshlets = nullptr;
+        size_t meshletCount = 0;
+        // Simplified index buffers for the same vertices, lods[0] is LOD 1 since LOD 0 is the mesh itself
+        MeshLod lods[MAX_MESH_LODS - 1] = {};
+        size_t lodCount = 0;
+
+        // Both layouts start with the full precision position
+        const XMFLOAT3& GetPosition(size_t index) const
+        {
+            return packedVertices != nullptr ? packedVertices[index].position : vertices[index].position;
+        }
     };
 
+    // Layout of PackedVertex, used by every mesh shader
     constexpr D3D12_INPUT_ELEMENT_DESC VERTEX_DESCS[] =
+    {
+        { "POSITION",     0, DXGI_FORMAT_R32G32B32_FLOAT,    0,  0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "NORMAL",       0, DXGI_FORMAT_R16G16_SNORM,       0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "TANGENT",      0, DXGI_FORMAT_R10G10B10A2_UNORM,  0, 16, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "UV",           0, DXGI_FORMAT_R16G16_FLOAT,       0, 20, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "BONE_WEIGHTS", 0, DXGI_FORMAT_R8G8B8A8_UNORM,     0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "BONE_INDICES", 0, DXGI_FORMAT_R8G8B8A8_UINT,      0, 28, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    };
+
+    // Layout of Vertex, only for debug lines
+    constexpr D3D12_INPUT_ELEMENT_DESC FULL_VERTEX_DESCS[] =
     {
         { "POSITION",     0, DXGI_FORMAT_R32G32B32_FLOAT,    0,  0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
         { "COLOR",        0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
@@ -38,4 +111,46 @@ namespace VertexData
         { "BONE_WEIGHTS", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 72, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
         { "BONE_INDICES", 0, DXGI_FORMAT_R32G32B32A32_UINT,  0, 88, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
     };
+
+    /// <summary>
+    /// Maps a unit vector onto the [-1, 1] square, the lower hemisphere gets folded over the diagonals.
+    /// </summary>
+    XMVECTOR EncodeOctahedral(FXMVECTOR direction);
+    XMVECTOR DecodeOctahedral(FXMVECTOR encoded);
+
+    /// <summary>
+    /// Quantizes count vertices, the output can be write combined upload memory since every byte gets written exactly once in order.
+    /// </summary>
+    void PackVertices(const Vertex* vertices, PackedVertex* packed, size_t count);
+
+    /// <summary>
+    /// Inverse of PackVertices like the vertex shaders do it, color is lost.
+    /// </summary>
+    Vertex UnpackVertex(const PackedVertex& packed);
+
+    /// <summary>
+    /// Tightly packed float attribute streams of a glTF primitive, joints and weights are null for static meshes.
+    /// </summary>
+    struct VertexStreams
+    {
+        const float* positions = nullptr;
+        const float* normals = nullptr;
+        const float* tangents = nullptr;
+        const float* uvs = nullptr;
+        const uint8_t* joints = nullptr;
+        const float* weights = nullptr;
+    };
+
+    /// <summary>
+    /// Fills vertices [first, first + count) from the same range of the streams and builds the bitangents from tangent.w.
+    /// Converts four vertices per iteration with SSE, the result is bit identical to ConvertVertexStreamsScalar. Color isn't touched.
+    /// </summary>
+    void ConvertVertexStreams(const VertexStreams& streams, Vertex* vertices, size_t first, size_t count);
+    void ConvertVertexStreamsScalar(const VertexStreams& streams, Vertex* vertices, size_t first, size_t count);
+
+    /// <summary>
+    /// 16 to 32 bit index conversion, 8 indices per iteration with SSE2 or 16 with AVX2.
+    /// </summary>
+    void WidenIndices(const uint16_t* source, uint32_t* destination, size_t count);
+    void WidenIndicesScalar(const uint16_t* source, uint32_t* destination, size_t count);
 }
@@ -0,0 +1,103 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(size_t workerCount)
+{
+	workers.reserve(workerCount);
+	for (size_t i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back(&WorkerPool::WorkerMain, this);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wakeCondition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void WorkerPool::ParallelFor(size_t count, LoopFunc func, const void* context)
+{
+	if (workers.empty() || count <= 1)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			func(context, i);
+		}
+		return;
+	}
+
+	std::lock_guard<std::mutex> loopLock(loopMutex);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		loopFunc = func;
+		loopContext = context;
+		loopCount = count;
+		nextIndex = 0;
+		busyWorkers = workers.size();
+		loopGeneration++;
+	}
+	wakeCondition.notify_all();
+
+	RunLoop();
+
+	// Workers still read loopContext until they checked in, so it has to stay valid until then
+	std::unique_lock<std::mutex> lock(mutex);
+	doneCondition.wait(lock, [&]() { return busyWorkers == 0; });
+	loopFunc = nullptr;
+	loopContext = nullptr;
+}
+
+void WorkerPool::WorkerMain()
+{
+	uint64_t seenGeneration = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeCondition.wait(lock, [&]() { return quit || loopGeneration != seenGeneration; });
+			if (quit)
+			{
+				return;
+			}
+			seenGeneration = loopGeneration;
+		}
+
+		RunLoop();
+
+		bool lastWorker = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busyWorkers--;
+			lastWorker = busyWorkers == 0;
+		}
+		if (lastWorker)
+		{
+			doneCondition.notify_one();
+		}
+	}
+}
+
+void WorkerPool::RunLoop()
+{
+	for (size_t i = nextIndex.fetch_add(1, std::memory_order_relaxed); i < loopCount; i = nextIndex.fetch_add(1, std::memory_order_relaxed))
+	{
+		loopFunc(loopContext, i);
+	}
+}
+
+WorkerPool& GetWorkerPool()
+{
+	// Never destroyed, joining threads from static destructors can deadlock while the process shuts down
+	static WorkerPool* pool = new WorkerPool{ std::max(std::thread::hardware_concurrency(), 2u) - 1 };
+	return *pool;
+}
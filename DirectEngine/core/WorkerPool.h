@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Fixed set of worker threads for data parallel loops. The calling thread works on the loop too,
+/// so a pool with 0 workers runs everything inline.
+/// ParallelFor is not reentrant, don't start a loop from inside a loop body.
+/// </summary>
+class WorkerPool
+{
+public:
+    WorkerPool(size_t workerCount);
+    ~WorkerPool();
+
+    typedef void (*LoopFunc)(const void* context, size_t index);
+
+    /// <summary>
+    /// Calls func for every index in [0, count) and returns once all of them finished. The order of the calls is unspecified.
+    /// The workers call func through a pointer instead of a std::function copy, so starting a loop never allocates.
+    /// </summary>
+    template <typename Func>
+    void ParallelFor(size_t count, const Func& func)
+    {
+        ParallelFor(count, [](const void* context, size_t index) { (*static_cast<const Func*>(context))(index); }, &func);
+    }
+
+    void ParallelFor(size_t count, LoopFunc func, const void* context);
+
+    /// <summary>
+    /// Workers plus the calling thread.
+    /// </summary>
+    size_t GetThreadCount() const { return workers.size() + 1; }
+
+    WorkerPool(const WorkerPool& other) = delete;
+    WorkerPool& operator=(const WorkerPool& other) = delete;
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex loopMutex;
+
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable doneCondition;
+    uint64_t loopGeneration = 0;
+    size_t busyWorkers = 0;
+    bool quit = false;
+
+    LoopFunc loopFunc = nullptr;
+    const void* loopContext = nullptr;
+    size_t loopCount = 0;
+    std::atomic<size_t> nextIndex = 0;
+
+    void WorkerMain();
+    void RunLoop();
+};
+
+/// <summary>
+/// Shared pool with one worker less than there are hardware threads, created on first use.
+/// </summary>
+WorkerPool& GetWorkerPool();
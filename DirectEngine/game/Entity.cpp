@@ -93,7 +93,7 @@ void Entity::AddRigidBody(MemoryArena& arena, btDynamicsWorld* world, btCollisio
 	}
 
 	btRigidBody::btRigidBodyConstructionInfo rigidBodyCI(physicsInit.mass, this, shape, inertiaTensor);
-	rigidBody = NewObject(arena, btRigidBody, rigidBodyCI);
+	rigidBody = NewObjectTagged(arena, AllocationTag::Physics, btRigidBody, rigidBodyCI);
 
 	if (physicsInit.type == PhysicsInitType::RigidBodyDynamic)
 	{
@@ -213,58 +213,30 @@ void Entity::UpdateAnimation(EngineCore& engine, bool isMainRender)
 {
 	if (isSkinnedRoot)
 	{
-		// Reset joints
-		for (int jointIdx = 0; jointIdx < transformHierachy->nodeCount; jointIdx++)
-		{
-			TransformNode& node = transformHierachy->nodes[jointIdx];
-			node.currentLocal = node.baseLocal;
-		}
-
-		// Apply animations
+		// Active animations are blended as layers in order, matrices only get built from the final pose
+		TransformAnimation* layers[MAX_ANIMATIONS];
+		size_t layerCount = 0;
 		for (int animIndex = 0; animIndex < transformHierachy->animationCount; animIndex++)
 		{
 			TransformAnimation& animation = transformHierachy->animations[animIndex];
 
-			if (animation.active && (isMainRender || !animation.onlyInMainCamera))
+			if (animation.active && animation.weight > 0.f && (isMainRender || !animation.onlyInMainCamera))
 			{
 				animation.time = fmodf(engine.TimeSinceStart(), animation.duration);
-
-				for (int jointIdx = 0; jointIdx < transformHierachy->nodeCount; jointIdx++)
-				{
-					if (animation.activeChannels[jointIdx])
-					{
-						TransformNode& node = transformHierachy->nodes[jointIdx];
-
-						XMVECTOR translation, rotation, scale;
-						XMMatrixDecompose(&scale, &rotation, &translation, node.currentLocal);
-
-						AnimationData& translationData = animation.jointChannels[jointIdx].translations;
-						AnimationData& rotationData = animation.jointChannels[jointIdx].rotations;
-						AnimationData& scaleData = animation.jointChannels[jointIdx].scales;
-
-						if (translationData.frameCount > 0)
-						{
-							translation = SampleAnimation(translationData, animation.time, &XMVectorLerp);
-						}
-						if (rotationData.frameCount > 0)
-						{
-							rotation = SampleAnimation(rotationData, animation.time, &XMQuaternionSlerp);
-						}
-						if (scaleData.frameCount > 0)
-						{
-							scale = SampleAnimation(scaleData, animation.time, &XMVectorLerp);
-						}
-
-						node.currentLocal = XMMatrixAffineTransformation(scale, V3_ZERO, rotation, translation);
-					}
-				}
+				layers[layerCount++] = &animation;
 			}
 		}
+		AnimationPose pose = transformHierachy->basePose;
+		BlendAnimationLayers(layers, layerCount, transformHierachy->basePose, transformHierachy->nodeCount, pose);
+		BuildPoseMatrices(pose, *transformHierachy);
 
-		// Update joint transforms
+		// Update joint transforms, UpdateNode covers the whole subtree so only roots need a call
 		for (int jointIdx = 0; jointIdx < transformHierachy->nodeCount; jointIdx++)
 		{
-			transformHierachy->UpdateNode(&transformHierachy->nodes[jointIdx]);
+			if (transformHierachy->nodes[jointIdx].parent == nullptr)
+			{
+				transformHierachy->UpdateNode(&transformHierachy->nodes[jointIdx]);
+			}
 		}
 
 		// Upload new transforms to children
@@ -319,28 +291,6 @@ bool Entity::IsActive()
 	return isParentActive && isSelfActive;
 }
 
-XMVECTOR SampleAnimation(AnimationData& animData, float animationTime, XMVECTOR(__vectorcall* interp)(XMVECTOR a, XMVECTOR b, float t))
-{
-	assert(animData.data != nullptr);
-	assert(animData.frameCount > 0);
-	for (int i = 0; i < animData.frameCount; i++)
-	{
-		if (animData.times[i] > animationTime)
-		{
-			if (i == 0)
-			{
-				return animData.data[0];
-			}
-			else
-			{
-				float t = (animationTime - animData.times[i - 1]) / (animData.times[i] - animData.times[i - 1]);
-				return interp(animData.data[i - 1], animData.data[i], t);
-			}
-		}
-	}
-	return animData.data[animData.frameCount - 1];
-}
-
 void Entity::SetLocalPosition(XMVECTOR localPos)
 {
 	localMatrix.SetMatrix(XMMatrixAffineTransformation(localMatrix.scale, XMVectorZero(), localMatrix.rotation, localPos));
@@ -4,6 +4,7 @@
 #include "../core/EngineCore.h"
 #include "../core/Audio.h"
 #include "../core/Mesh.h"
+#include "../core/Animation.h"
 #include "Physics.h"
 
 #include <DirectXMath.h>
@@ -32,7 +33,7 @@ public:
 	ExtendedMatrix worldMatrix{};
 	
 	uint64_t generation = 0;
-	FixedStr name = "Entity";
+	Name name = "Entity";
 
 	EngineCore* engine;
 
@@ -105,5 +106,3 @@ private:
 };
 
 extern uint64_t g_entityGeneration;
-
-XMVECTOR SampleAnimation(AnimationData& animData, float animationTime, XMVECTOR(__vectorcall* interp)(XMVECTOR a, XMVECTOR b, float t));
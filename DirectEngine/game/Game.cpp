@@ -12,7 +12,11 @@
 #include "../core/vkcodes.h"
 #include "remixicon.h"
 
-Game::Game(GAME_CREATION_PARAMS) : globalArena(globalArena), configArena(configArena), levelArena(levelArena) {}
+Game::Game(GAME_CREATION_PARAMS) : globalArena(globalArena), configArena(configArena), levelArena(levelArena)
+{
+	entityArena.debugName = "Entity";
+	physicsArena.debugName = "Physics";
+}
 
 void Game::RegisterLog(EngineLog::RingLog* log)
 {
@@ -23,6 +27,9 @@ void Game::StartGame(EngineCore& engine)
 {
 	INIT_TIMER(timer);
 
+	engine.RegisterArena(entityArena);
+	engine.RegisterArena(physicsArena);
+
 	// UI
 	ImGui::SetCurrentContext(engine.m_imgui.imGuiContext);
 	LoadUIStyle();
@@ -41,13 +48,26 @@ void Game::StartGame(EngineCore& engine)
 	ArenaArray<StandaloneShaderFile> standaloneShaders{ globalArena, 64 };
 	LoadMaterials("materials.txt", materials, textures, standaloneShaders);
 
-	for (TextureFile& textureFile : textures)
 	{
-		textureFile.textureGPU = engine.CreateTexture(textureFile.texturePath.str, textureFile.isSRGB);
+		// Materials can share texture files, only load each one once.
+		// sRGB and linear loads of one file are separate textures, mixing the id first keeps them from landing on other paths
+		ArenaScope scratch{ GetScratchArena() };
+		ArenaHashMap<uint64_t, TextureGPU*> loadedTextures{ scratch.arena, textures.size };
+		for (TextureFile& textureFile : textures)
+		{
+			TextureGPU*& textureGPU = loadedTextures[MixHash(textureFile.texturePath.id) + textureFile.isSRGB];
+			if (textureGPU == nullptr)
+			{
+				textureGPU = engine.CreateTexture(textureFile.texturePath.c_str(), textureFile.isSRGB);
+			}
+			textureFile.textureGPU = textureGPU;
+		}
 	}
 
 	for (MaterialFile& materialFile : materials)
 	{
+		materialsByName.insert(materialFile.materialName, &materialFile);
+
 		std::vector<TextureGPU*> materialTextures = {};
 		if (materialFile.diffuseTexture != nullptr) materialTextures.push_back(materialFile.diffuseTexture->textureGPU);
 		if (materialFile.normalTexture != nullptr) materialTextures.push_back(materialFile.normalTexture->textureGPU);
@@ -61,7 +81,7 @@ void Game::StartGame(EngineCore& engine)
 
 		CD3DX12_RASTERIZER_DESC rasterizerDesc(D3D12_DEFAULT);
 		rasterizerDesc.CullMode = materialFile.cullMode;
-		materialFile.data = engine.CreateMaterial(materialFile.materialName.str, materialTextures, rootConstants, rasterizerDesc);
+		materialFile.data = engine.CreateMaterial(materialFile.materialName.c_str(), materialTextures, rootConstants, rasterizerDesc);
 	}
 
 	defaultMaterial = engine.CreateMaterial("ground");
@@ -97,15 +117,17 @@ void Game::LoadLevel(EngineCore& engine)
 
 	// TODO: this (all) arena should be in the engine
 	entityArena.Reset();
+	physicsArena.Reset();
+	SetPhysicsAllocationArena(&physicsArena);
 
 	// Physics
-	collisionConfiguration = NewObject(levelArena, btDefaultCollisionConfiguration);
-	dispatcher = NewObject(levelArena, btCollisionDispatcher, collisionConfiguration);
-	broadphase = NewObject(levelArena, btDbvtBroadphase);
-	solver = NewObject(levelArena, btSequentialImpulseConstraintSolver);
+	collisionConfiguration = NewObjectTagged(levelArena, AllocationTag::Physics, btDefaultCollisionConfiguration);
+	dispatcher = NewObjectTagged(levelArena, AllocationTag::Physics, btCollisionDispatcher, collisionConfiguration);
+	broadphase = NewObjectTagged(levelArena, AllocationTag::Physics, btDbvtBroadphase);
+	solver = NewObjectTagged(levelArena, AllocationTag::Physics, btSequentialImpulseConstraintSolver);
 	physicsDebug.engine = &engine;
 
-	dynamicsWorld = NewObject(levelArena, btDiscreteDynamicsWorld, dispatcher, broadphase, solver, collisionConfiguration);
+	dynamicsWorld = NewObjectTagged(levelArena, AllocationTag::Physics, btDiscreteDynamicsWorld, dispatcher, broadphase, solver, collisionConfiguration);
 	dynamicsWorld->setGravity(btVector3(0.f, -10.f, 0.f));
 	dynamicsWorld->setDebugDrawer(&physicsDebug);
 
@@ -128,28 +150,29 @@ void Game::LoadLevel(EngineCore& engine)
 	// Level Meshes & Collision
 	level1MeshDataGPU.clear();
 
-	GltfResult* level1Gltf = LoadGltfFromFile("models/level1.glb", levelArena);
-	btTriangleMesh* levelCollisionMesh = NewObject(levelArena, btTriangleMesh, true, false);
+	GltfResult* level1Gltf = LoadModel("models/level1.glb", levelArena);
+	btTriangleMesh* levelCollisionMesh = NewObjectTagged(levelArena, AllocationTag::Physics, btTriangleMesh, true, false);
 	for (MeshFile& meshFile : level1Gltf->meshes)
 	{
 		MeshData& meshData = meshFile.mesh;
-		for (int i = 0; i < meshData.vertexCount / 3; i++)
+		// Optimized meshes share and reorder vertices, the triangles are only in the index buffer
+		for (size_t i = 0; i < meshData.indexCount / 3; i++)
 		{
 			levelCollisionMesh->addTriangle(
-				ToBulletVec3(meshData.vertices[i * 3 + 0].position),
-				ToBulletVec3(meshData.vertices[i * 3 + 1].position),
-				ToBulletVec3(meshData.vertices[i * 3 + 2].position)
+				ToBulletVec3(meshData.GetPosition(meshData.indices[i * 3 + 0])),
+				ToBulletVec3(meshData.GetPosition(meshData.indices[i * 3 + 1])),
+				ToBulletVec3(meshData.GetPosition(meshData.indices[i * 3 + 2]))
 			);
 		}
 
 		level1MeshDataGPU.newElement() = engine.CreateMesh(meshData);
 	}
-	btTriangleIndexVertexArray* levelMeshInterface = NewObject(levelArena, btTriangleIndexVertexArray);
+	btTriangleIndexVertexArray* levelMeshInterface = NewObjectTagged(levelArena, AllocationTag::Physics, btTriangleIndexVertexArray);
 	levelMeshInterface->addIndexedMesh(levelCollisionMesh->getIndexedMeshArray()[0]);
-	levelShape = NewObject(levelArena, btBvhTriangleMeshShape, levelMeshInterface, true);
+	levelShape = NewObjectTagged(levelArena, AllocationTag::Physics, btBvhTriangleMeshShape, levelMeshInterface, true);
 
 	// Portals
-	auto createPortal = [&](MaterialData* material, XMVECTOR pos, const char* name, size_t stencilIdx) {
+	auto createPortal = [&](MaterialData* material, XMVECTOR pos, Name name, size_t stencilIdx) {
 		Entity* portal = CreateEmptyEntity(engine);
 		portal->SetLocalPosition(pos);
 		portal->name = name;
@@ -157,7 +180,7 @@ void Game::LoadLevel(EngineCore& engine)
 		PhysicsInit portalInit{ 0.f, PhysicsInitType::RigidBodyStatic };
 		portalInit.ownCollisionLayers = CollisionLayers::CL_Portal;
 		portalInit.collidesWithLayers = CollisionLayers::CL_Player;
-		btCollisionShape* portalShape = NewObject(levelArena, btBoxShape, btVector3(1.0f, 2.0f, 0.1f));
+		btCollisionShape* portalShape = NewObjectTagged(levelArena, AllocationTag::Physics, btBoxShape, btVector3(1.0f, 2.0f, 0.1f));
 		portal->AddRigidBody(levelArena, dynamicsWorld, portalShape, portalInit);
 		if (portal->rigidBody != nullptr) portal->rigidBody->setCollisionFlags(portal->rigidBody->getCollisionFlags() | btCollisionObject::CF_NO_CONTACT_RESPONSE);
 
@@ -188,7 +211,7 @@ void Game::LoadLevel(EngineCore& engine)
 	playerEntity->name = "Player";
 	playerEntity->SetLocalPosition({ 0.f, 1.f, 0.f });
 
-	btBoxShape* playerPhysicsShape = NewObject(levelArena, btBoxShape, btVector3{ .5f, 1.f, .5f });
+	btBoxShape* playerPhysicsShape = NewObjectTagged(levelArena, AllocationTag::Physics, btBoxShape, btVector3{ .5f, 1.f, .5f });
 	playerEntity->physicsShapeOffset = { 0.f, 1.f, 0.f };
 	PhysicsInit playerPhysics{ 10.f, PhysicsInitType::RigidBodyDynamic };
 	playerPhysics.ownCollisionLayers = CollisionLayers::CL_Player;
@@ -258,12 +281,17 @@ void Game::LoadLevel(EngineCore& engine)
 		Entity* yea = CreateMeshEntity(engine, materialIndices[Material::ShellTexture], cubeMeshDataGPU);
 		yea->name = "Yea";
 		yea->SetLocalPosition({ 3.f, 0.5f + i * 16.f, 0.f });
-		btBoxShape* boxShape = NewObject(levelArena, btBoxShape, btVector3{ .5f, .5f, .5f });
+		btBoxShape* boxShape = NewObjectTagged(levelArena, AllocationTag::Physics, btBoxShape, btVector3{ .5f, .5f, .5f });
 		PhysicsInit yeaPhysics{ 1.f, PhysicsInitType::RigidBodyDynamic };
 		yeaPhysics.ownCollisionLayers = CollisionLayers::CL_Entity;
 		yeaPhysics.collidesWithLayers = CollisionLayers::CL_Player | CollisionLayers::CL_World;
 		yea->AddRigidBody(levelArena, dynamicsWorld, boxShape, yeaPhysics);
 	}*/
+
+	// Keep a copy of the freshly loaded level, Ctrl+R restores it without loading anything.
+	// Bullet keeps allocating from physicsArena while playing, restoring rewinds it together with the world that points into it
+	MemoryArena* snapshotArenas[] = { &entityArena, &physicsArena };
+	engine.TakeLevelSnapshot(snapshotArenas, _countof(snapshotArenas));
 }
 
 void PlayerMovement::Update(EngineInput& input, TimeData& time, Entity* playerEntity, Entity* playerLookEntity, Entity* cameraEntity, btDynamicsWorld* dynamicsWorld, bool frameStep)
@@ -462,11 +490,20 @@ void Game::UpdateGame(EngineCore& engine)
 		playerModelEntity->SetForwardDirection(XMVector3Normalize(horizontalCamForward));
 	}
 
-	if (input.KeyComboJustPressed(VK_KEY_R, VK_CONTROL))
+	// Ctrl+R restores the level snapshot, Ctrl+Shift+R loads everything again
+	bool restoreLevel = input.KeyComboJustPressed(VK_KEY_R, VK_CONTROL);
+	if (input.KeyComboJustPressed(VK_KEY_R, VK_CONTROL, VK_SHIFT) || (restoreLevel && !engine.m_levelSnapshot.valid))
 	{
 		engine.m_resetLevel = true;
 		levelLoaded = false;
 	}
+	else if (restoreLevel)
+	{
+		engine.m_restoreLevel = true;
+		gizmo.editElement = nullptr;
+		gizmo.selectedGizmoElement = nullptr;
+		gizmo.selectedGizmoTarget = nullptr;
+	}
 
 	playerMovement.Update(input, timeData, playerEntity, playerLookEntity, cameraEntity, dynamicsWorld, frameStep);
 	gizmo.Update(input);
@@ -663,17 +700,10 @@ void Game::BeforeMainRender(EngineCore& engine)
 	}
 }
 
-MaterialFile* Game::GetMaterialFile(uint64_t materialHash)
+MaterialFile* Game::GetMaterialFile(Name materialName)
 {
-	for (MaterialFile& material : materials)
-	{
-		if (material.materialHash == materialHash)
-		{
-			return &material;
-		}
-	}
-
-	return nullptr;
+	MaterialFile** material = materialsByName.find(materialName);
+	return material != nullptr ? *material : nullptr;
 }
 
 float* Game::GetClearColor()
@@ -688,7 +718,7 @@ EngineInput& Game::GetInput()
 
 Entity* Game::CreateEmptyEntity(EngineCore& engine)
 {
-	Entity* entity = NewObject(entityArena, Entity);
+	Entity* entity = NewObjectTagged(entityArena, AllocationTag::Entity, Entity);
 	entity->engine = &engine;
 	entity->isRendered = false;
 	return entity;
@@ -697,7 +727,7 @@ Entity* Game::CreateEmptyEntity(EngineCore& engine)
 Entity* Game::CreateMeshEntity(EngineCore& engine, MaterialData* material, MeshDataGPU* meshData)
 {
 	assert(material != nullptr);
-	Entity* entity = NewObject(entityArena, Entity);
+	Entity* entity = NewObjectTagged(entityArena, AllocationTag::Entity, Entity);
 	entity->engine = &engine;
 	entity->isRendered = true;
 	entity->material = material;
@@ -723,7 +753,7 @@ Entity* Game::CreateQuadEntity(EngineCore& engine, MaterialData* material, float
 
 	if (physicsInit.type != PhysicsInitType::None)
 	{
-		btBoxShape* physicsShape = NewObject(levelArena, btBoxShape, btVector3{ width / 2.f, 0.05f, height / 2.f });
+		btBoxShape* physicsShape = NewObjectTagged(levelArena, AllocationTag::Physics, btBoxShape, btVector3{ width / 2.f, 0.05f, height / 2.f });
 		entity->physicsShapeOffset = XMVECTOR{ width / 2.f, -.05f, height / 2.f };
 		entity->AddRigidBody(levelArena, dynamicsWorld, physicsShape, physicsInit);
 	}
@@ -733,11 +763,11 @@ Entity* Game::CreateQuadEntity(EngineCore& engine, MaterialData* material, float
 
 Entity* Game::LoadEntity(EngineCore& engine, MeshFile& meshFile)
 {
-	MaterialFile* materialFile = GetMaterialFile(meshFile.materialHash);
+	MaterialFile* materialFile = GetMaterialFile(meshFile.materialName);
 	MaterialData* material;
 	if (materialFile == nullptr || materialFile->data == nullptr)
 	{
-		WARN("Material {} not found", meshFile.materialName.str);
+		WARN("Material {} not found", meshFile.materialName);
 		material = defaultMaterial;
 	}
 	else
@@ -747,13 +777,13 @@ Entity* Game::LoadEntity(EngineCore& engine, MeshFile& meshFile)
 
 	MeshDataGPU* meshData = engine.CreateMesh(meshFile.mesh);
 	Entity* entity = CreateMeshEntity(engine, material, meshData);
-	entity->name = meshFile.materialName.str;
+	entity->name = meshFile.materialName;
 	return entity;
 }
 
 Entity* Game::CreateEntityFromGltf(EngineCore& engine, const char* path)
 {
-	GltfResult* gltfResult = LoadGltfFromFile(path, levelArena);
+	GltfResult* gltfResult = LoadModel(path, levelArena);
 	if (!gltfResult->success)
 	{
 		WARN("Failed to load glTF {}", path);
@@ -8,6 +8,7 @@
 #include "../core/IGame.h"
 #include "../core/EngineCore.h"
 #include "../core/Mesh.h"
+#include "../core/CookedMesh.h"
 
 #include "imgui.h"
 #include "ImGuiProfilerRenderer.h"
@@ -70,6 +71,7 @@ public:
 	MemoryArena& configArena;
 	MemoryArena& levelArena;                // Cleared on every level reload
 	TypedMemoryArena<Entity> entityArena{}; // Cleared on every level reload
+	MemoryArena physicsArena{ ARENA_DEFAULT_CAPACITY, false, ArenaBacking::Default, true }; // Bullet's own allocations, cleared on every level reload
 	
 	// Logging
 	bool showLog = ISDEBUG;
@@ -77,6 +79,7 @@ public:
 
 	bool showProfiler = false;
 	bool pauseProfiler = false;
+	bool showMemoryWindow = false;
 	ImGuiUtils::ProfilersWindow profilerWindow{};
 	FrameDebugData lastFrames[256] = {};
 	size_t lastDebugFrameIndex = 0;
@@ -137,6 +140,7 @@ public:
 	// Materials & Textures
 	ArenaArray<TextureFile> textures = { globalArena, MAX_TEXTURES };
 	ArenaArray<MaterialFile> materials = { globalArena, MAX_MATERIALS };
+	ArenaHashMap<Name, MaterialFile*> materialsByName = { globalArena, MAX_MATERIALS };
 	MaterialData* defaultMaterial = 0;
 	MaterialData* portal1Material = 0;
 	MaterialData* portal2Material = 0;
@@ -197,7 +201,7 @@ public:
 	XMVECTOR ScreenToWorldPosition(EngineCore& engine, CameraData& cameraData, XMVECTOR screenPos);
 	//void RaycastScreenPosition(EngineCore& engine, CameraData& cameraData, XMVECTOR screenPos, EngineRaycastCallback* callback, CollisionLayers layers = CollisionLayers::All);
 
-	MaterialFile* GetMaterialFile(uint64_t materialHash);
+	MaterialFile* GetMaterialFile(Name materialName);
 	float* GetClearColor() override;
 	EngineInput& GetInput() override;
 
@@ -8,6 +8,7 @@
 #define SLIDER_SPEED 0.005f
 #define SLIDER_MIN (-1000.f)
 #define SLIDER_MAX 1000.f
+#define MEMORY_REPORT_PATH "memory_report.json"
 
 XMVECTOR GetMatrixColumn(XMMATRIX& mat, size_t index)
 {
@@ -221,6 +222,11 @@ void Game::DrawDebugUI(EngineCore& engine)
 			{
 				showProfiler = !showProfiler;
 			}
+			ImGui::SameLine();
+			if (ImGui::Button("Memory"))
+			{
+				showMemoryWindow = !showMemoryWindow;
+			}
 
 			if (ImGui::Button("Movement"))
 			{
@@ -396,24 +402,31 @@ void Game::DrawDebugUI(EngineCore& engine)
 
 			for (Entity& entity : entityArena)
 			{
+				ArenaScope scratch{ GetScratchArena() };
 				int offset = &entity - (Entity*)entityArena.base;
 				ImGui::PushID(&entity);
 
 				const char* icon = entity.IsActive() ? ICON_CHECK_FILL : "";
-				std::string entityTitle = std::format("{} [{}] {}###{}", entity.name.str, offset, icon, reinterpret_cast<void*>(&entity));
-				if ((showInactiveEntities || entity.IsActive()) && ImGui::CollapsingHeader(entityTitle.c_str()))
+				const char* entityTitle = ArenaFormat(scratch.arena, "{} [{}] {}###{}", entity.name, offset, icon, reinterpret_cast<void*>(&entity));
+				if ((showInactiveEntities || entity.IsActive()) && ImGui::CollapsingHeader(entityTitle))
 				{
 					ImGui::Text("NAME");
-					ImGui::InputText("##entityname", entity.name.str, FixedStr::SIZE);
+					// Names are immutable, so edit a copy and intern it once the user is done
+					char nameBuffer[128];
+					strncpy_s(nameBuffer, entity.name.c_str(), _TRUNCATE);
+					if (ImGui::InputText("##entityname", nameBuffer, sizeof(nameBuffer), ImGuiInputTextFlags_EnterReturnsTrue))
+					{
+						entity.name = Name::Intern(nameBuffer);
+					}
 
 					ImGui::Separator();
 
 
-					ImGui::Text(std::format("CHILDREN ({})", entity.children.size).c_str());
+					ImGui::Text(ArenaFormat(scratch.arena, "CHILDREN ({})", entity.children.size));
 
 					for (int i = 0; i < entity.children.size; i++)
 					{
-						if (ImGui::SmallButton(std::format("{}###{}", ICON_CLOSE_FILL, i).c_str()))
+						if (ImGui::SmallButton(ArenaFormat(scratch.arena, "{}###{}", ICON_CLOSE_FILL, i)))
 						{
 							entity.RemoveChild(entity.children[i], true);
 							i--;
@@ -423,7 +436,7 @@ void Game::DrawDebugUI(EngineCore& engine)
 						ImGui::SameLine();
 						if (entity.children[i].Get() == nullptr) continue;
 						Entity* child = entity.children[i].Get();
-						ImGui::Text(std::format("{} [{}]", child->name.str, (child - (Entity*)entityArena.base)).c_str());
+						ImGui::Text(ArenaFormat(scratch.arena, "{} [{}]", child->name, (child - (Entity*)entityArena.base)));
 					}
 
 					if (ImGui::Button("Add"))
@@ -638,8 +651,8 @@ void Game::DrawDebugUI(EngineCore& engine)
 					for (TextureGPU* tex : mat.textures)
 					{
 						ImGui::PushID(tex);
-						std::string name = tex->name.empty() ? "texture" : tex->name;
-						if (ImGui::TreeNode(name.c_str()))
+						const char* name = tex->name == Name{} ? "texture" : tex->name.c_str();
+						if (ImGui::TreeNode(name))
 						{
 							auto desc = tex->buffer->GetDesc();
 							float aspectRatio = static_cast<float>(desc.Width) / static_cast<float>(desc.Height);
@@ -657,10 +670,10 @@ void Game::DrawDebugUI(EngineCore& engine)
 						switch (info.type)
 						{
 						case RootConstantType::UINT:
-							ImGui::InputScalar(info.name.str, ImGuiDataType_U64, &mat.rootConstantData[i]);
+							ImGui::InputScalar(info.name.c_str(), ImGuiDataType_U64, &mat.rootConstantData[i]);
 							break;
 						case RootConstantType::FLOAT:
-							ImGui::InputFloat(info.name.str, reinterpret_cast<float*>(&mat.rootConstantData[i]));
+							ImGui::InputFloat(info.name.c_str(), reinterpret_cast<float*>(&mat.rootConstantData[i]));
 							break;
 						default:
 							ImGui::Text("Unknown root constant type");
@@ -694,7 +707,7 @@ void Game::DrawDebugUI(EngineCore& engine)
 	{
 		if (ImGui::Begin("Matrix Calc", &showMatrixCalculator))
 		{
-			if (ImGui::BeginCombo("Camera", matrixCalcSelectedCam == nullptr ? "-" : matrixCalcSelectedCam->name.str))
+			if (ImGui::BeginCombo("Camera", matrixCalcSelectedCam == nullptr ? "-" : matrixCalcSelectedCam->name.c_str()))
 			{
 				if (ImGui::Selectable("-", matrixCalcSelectedCam == nullptr))
 				{
@@ -706,7 +719,7 @@ void Game::DrawDebugUI(EngineCore& engine)
 				for (CameraData& cam : engine.m_cameras)
 				{
 					bool isSelected = matrixCalcSelectedCam == &cam;
-					if (ImGui::Selectable(cam.name.str, isSelected))
+					if (ImGui::Selectable(cam.name.c_str(), isSelected))
 					{
 						matrixCalcSelectedCam = &cam;
 					}
@@ -766,6 +779,67 @@ void Game::DrawDebugUI(EngineCore& engine)
 	{
 		profilerWindow.Render(&showProfiler);
 	}
+
+	// Memory
+	if (showMemoryWindow)
+	{
+		if (ImGui::Begin("Memory", &showMemoryWindow))
+		{
+			ArenaArray<const MemoryArena*>& arenas = engine.m_arenas;
+
+			const float toMB = 1.f / (1024.f * 1024.f);
+			if (ImGui::BeginTable("Arenas", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+			{
+				ImGui::TableSetupColumn("Arena");
+				ImGui::TableSetupColumn("Used");
+				ImGui::TableSetupColumn("Peak");
+				ImGui::TableSetupColumn("Committed");
+				ImGui::TableSetupColumn("Commits");
+				ImGui::TableSetupColumn("Decommits");
+				ImGui::TableHeadersRow();
+
+				for (const MemoryArena* arena : arenas)
+				{
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::Text("%s", arena->debugName);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.2f MB", arena->used.load() * toMB);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.2f MB", arena->GetHighWaterMark() * toMB);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.2f MB", arena->committed.load() * toMB);
+					ImGui::TableNextColumn();
+					ImGui::Text("%zu", arena->commitCount.load());
+					ImGui::TableNextColumn();
+					ImGui::Text("%zu", arena->decommitCount.load());
+				}
+				ImGui::EndTable();
+			}
+
+			for (const MemoryArena* arena : arenas)
+			{
+				if (ImGui::TreeNode(arena->debugName))
+				{
+					ImGui::Text("Untagged: %.2f MB", arena->GetUntaggedBytes() * toMB);
+					for (size_t tag = 1; tag < static_cast<size_t>(AllocationTag::Count); tag++)
+					{
+						ImGui::Text("%s: %.2f MB", GetAllocationTagName(static_cast<AllocationTag>(tag)), arena->taggedBytes[tag].load() * toMB);
+					}
+					ImGui::TreePop();
+				}
+			}
+
+			if (ImGui::Button("Dump JSON"))
+			{
+				if (!WriteArenaStatsJson(MEMORY_REPORT_PATH, arenas.base, arenas.size))
+				{
+					ERR("Failed to write memory report to {}", MEMORY_REPORT_PATH);
+				}
+			}
+		}
+		ImGui::End();
+	}
 }
 
 void LoadUIStyle()
@@ -5,9 +5,9 @@ void Gizmo::Init(MemoryArena& arena, IEntityCreator* game, EngineCore& engine, M
 {
 	assert(material != nullptr);
 
-	translateArrowMesh = engine.CreateMesh(LoadGltfFromFile("models/translate-arrow.glb", arena)->meshes[0].mesh);
-	rotateArrowMesh = engine.CreateMesh(LoadGltfFromFile("models/rotate-arrow.glb", arena)->meshes[0].mesh);
-	scaleArrowMesh = engine.CreateMesh(LoadGltfFromFile("models/scale-arrow.glb", arena)->meshes[0].mesh);
+	translateArrowMesh = engine.CreateMesh(LoadModel("models/translate-arrow.glb", arena)->meshes[0].mesh);
+	rotateArrowMesh = engine.CreateMesh(LoadModel("models/rotate-arrow.glb", arena)->meshes[0].mesh);
+	scaleArrowMesh = engine.CreateMesh(LoadModel("models/scale-arrow.glb", arena)->meshes[0].mesh);
 
 	XMVECTOR xyzColors[3] = {
 		{ 1.f, 0.f, 0.f, 1.f },
@@ -45,7 +45,7 @@ void Gizmo::Init(MemoryArena& arena, IEntityCreator* game, EngineCore& engine, M
 		//translateArrow->InitCollisionBody(game->physicsWorld);
 		//translateArrow->InitBoxCollider(game->physicsCommon, { 0.1f, 1.f, 0.1f }, { 0.f, .5f, 0.f }, CollisionLayers::GizmoClick);
 		translateArrow->SetLocalRotation(xyzRotations[i]);
-		translateArrow->name = std::format("TranslateArrow{}", xyzNames[i]).c_str();
+		translateArrow->name = Name::Intern(std::format("TranslateArrow{}", xyzNames[i]));
 		translateArrow->isGizmoTranslationArrow = true;
 		translateArrow->gizmoTranslationAxis = transformAxis[i];
 		root->AddChild(translateArrow, false);
@@ -56,7 +56,7 @@ void Gizmo::Init(MemoryArena& arena, IEntityCreator* game, EngineCore& engine, M
 		//rotateArrow->InitCollisionBody(game->physicsWorld);
 		//rotateArrow->InitBoxCollider(game->physicsCommon, { 2.f, .05f, 2.f }, { 0.f, 0.f, 0.f }, CollisionLayers::GizmoClick);
 		rotateArrow->SetLocalRotation(xyzRotations[i]);
-		rotateArrow->name = std::format("RotateArrow{}", xyzNames[i]).c_str();
+		rotateArrow->name = Name::Intern(std::format("RotateArrow{}", xyzNames[i]));
 		rotateArrow->isGizmoRotationRing = true;
 		rotateArrow->gizmoRotationAxis = transformAxis[i];
 		root->AddChild(rotateArrow, false);
@@ -67,7 +67,7 @@ void Gizmo::Init(MemoryArena& arena, IEntityCreator* game, EngineCore& engine, M
 		//scaleArrow->InitCollisionBody(game->physicsWorld);
 		//scaleArrow->InitBoxCollider(game->physicsCommon, { .15f, .5f, .15f }, { .0f, .25f, .0f }, CollisionLayers::GizmoClick);
 		scaleArrow->SetLocalRotation(xyzRotations[i]);
-		scaleArrow->name = std::format("ScaleArrow{}", xyzNames[i]).c_str();
+		scaleArrow->name = Name::Intern(std::format("ScaleArrow{}", xyzNames[i]));
 		scaleArrow->isGizmoScaleCube = true;
 		scaleArrow->gizmoScaleAxis = transformAxis[i];
 		root->AddChild(scaleArrow, false);
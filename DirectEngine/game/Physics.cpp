@@ -1,5 +1,85 @@
 #include "Physics.h"
 
+#include <malloc.h>
+
+// Freed blocks go into a list per power of two size class and are handed out again, otherwise moving proxies
+// between the broadphase trees and pool overflows of manifolds and algorithms would grow the arena every frame
+#define PHYSICS_MIN_SIZE_CLASS 4
+#define PHYSICS_SIZE_CLASS_COUNT 48
+
+// Lives at the start of the physics arena, so restoring a snapshot rewinds the lists together with the blocks in them
+struct PhysicsFreeLists
+{
+	void* heads[PHYSICS_SIZE_CLASS_COUNT] = {};
+};
+
+static MemoryArena* physicsAllocationArena = nullptr;
+static PhysicsFreeLists* physicsFreeLists = nullptr;
+
+static size_t GetPhysicsSizeClass(size_t size)
+{
+	size_t sizeClass = PHYSICS_MIN_SIZE_CLASS;
+	while ((1ull << sizeClass) < size)
+	{
+		sizeClass++;
+	}
+	assert(sizeClass < PHYSICS_SIZE_CLASS_COUNT);
+	return sizeClass;
+}
+
+// Arena blocks have their size class stored in the MIN_ALIGN bytes in front of them
+static void* PhysicsAlignedAlloc(size_t size, int alignment)
+{
+	if (physicsAllocationArena == nullptr)
+	{
+		return _aligned_malloc(size, alignment);
+	}
+
+	assert(alignment <= MIN_ALIGN);
+	const size_t sizeClass = GetPhysicsSizeClass(size);
+	void*& head = physicsFreeLists->heads[sizeClass];
+	if (head != nullptr)
+	{
+		void* block = head;
+		head = *static_cast<void**>(block);
+		return block;
+	}
+
+	uint8_t* block = static_cast<uint8_t*>(physicsAllocationArena->AllocateRaw(MIN_ALIGN + (1ull << sizeClass), MIN_ALIGN, AllocationTag::Physics));
+	*reinterpret_cast<size_t*>(block) = sizeClass;
+	return block + MIN_ALIGN;
+}
+
+static void PhysicsAlignedFree(void* memory)
+{
+	if (memory == nullptr) return;
+
+	uint8_t* bytes = static_cast<uint8_t*>(memory);
+	if (physicsAllocationArena != nullptr && bytes >= physicsAllocationArena->base && bytes < physicsAllocationArena->base + physicsAllocationArena->capacity)
+	{
+		const size_t sizeClass = *reinterpret_cast<size_t*>(bytes - MIN_ALIGN);
+		assert(sizeClass < PHYSICS_SIZE_CLASS_COUNT);
+		void*& head = physicsFreeLists->heads[sizeClass];
+		*static_cast<void**>(memory) = head;
+		head = memory;
+		return;
+	}
+	_aligned_free(memory);
+}
+
+// Has to be in place before Bullet allocates anything, otherwise we'd free blocks from its default allocator
+static const bool physicsAllocatorInstalled = []()
+{
+	btAlignedAllocSetCustomAligned(PhysicsAlignedAlloc, PhysicsAlignedFree);
+	return true;
+}();
+
+void SetPhysicsAllocationArena(MemoryArena* arena)
+{
+	physicsAllocationArena = arena;
+	physicsFreeLists = arena != nullptr ? NewObjectTagged(*arena, AllocationTag::Physics, PhysicsFreeLists) : nullptr;
+}
+
 void PhysicsDebugDrawer::drawLine(const btVector3& from, const btVector3& to, const btVector3& color)
 {
 	assert(engine != nullptr);
@@ -63,6 +63,12 @@ struct PhysicsInit
 	CollisionLayers collidesWithLayers = CollisionLayers::CL_All;
 };
 
+// While set, Bullet's internal allocations (object arrays, broadphase trees, pools, pair caches) go into the arena so a snapshot
+// of it contains the whole physics world and restoring it takes back everything allocated since. Blocks Bullet frees are reused
+// for later allocations of a similar size, their free lists are put into the arena here so pass it right after resetting it.
+// Only pass nullptr or another arena once no Bullet object that allocated from the current one is used anymore.
+void SetPhysicsAllocationArena(MemoryArena* arena);
+
 struct PhysicsDebugDrawer : btIDebugDraw
 {
 	int debugMode = 0;
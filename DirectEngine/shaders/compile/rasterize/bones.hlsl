@@ -5,7 +5,7 @@ cbuffer DrawConstants : register(b0, space1)
 	uint boneIndex;
 };
 
-PSInputDefault VSMain(float4 position : POSITION, float4 vertColor : COLOR, float3 normal : NORMAL, float2 uv : UV)
+PSInputDefault VSMain(float4 position : POSITION, float2 packedNormal : NORMAL, float2 uv : UV)
 {
 	PSInputDefault result;
 
@@ -20,7 +20,7 @@ PSInputDefault VSMain(float4 position : POSITION, float4 vertColor : COLOR, floa
 	float4x4 lightVP = mul(lightView, lightProjection);
 	result.lightSpacePosition = mul(float4(worldPos.xyz, 1.0), lightVP);
 
-	result.worldNormal = mul(float4(normal, 0.), worldTransform).xyz;
+	result.worldNormal = mul(float4(DecodeOctahedral(packedNormal), 0.), worldTransform).xyz;
 	result.uv = uv;
 
 	return result;
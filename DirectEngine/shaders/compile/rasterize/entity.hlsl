@@ -12,7 +12,7 @@ Texture2D normalTexture : register(t1, space1);
 Texture2D metalRoughnessTexture : register(t2, space1);
 #endif
 
-PSInputDefault VSMain(float4 position : POSITION, float3 normal : NORMAL, float3 tangent : TANGENT, float3 bitangent : BITANGENT, float2 uv : UV, float4 boneWeights : BONE_WEIGHTS, uint4 boneIndices : BONE_INDICES)
+PSInputDefault VSMain(float4 position : POSITION, float2 packedNormal : NORMAL, float4 packedTangent : TANGENT, float2 uv : UV, float4 boneWeights : BONE_WEIGHTS, uint4 boneIndices : BONE_INDICES)
 {
     #ifdef SKINNED_MESH
     float4 vertexPos = boneWeights.x * float4(mul(float4(position.xyz, 1.0), mul(inverseJointBinds[boneIndices.x], jointTransforms[boneIndices.x])).xyz, 1.0);
@@ -24,7 +24,7 @@ PSInputDefault VSMain(float4 position : POSITION, float3 normal : NORMAL, float3
     float4 vertexPos = position;
     #endif
     
-    PSInputDefault result = VSCalcDefault(vertexPos, normal, tangent, bitangent, uv);
+    PSInputDefault result = VSCalcDefaultPacked(vertexPos, packedNormal, packedTangent, uv);
     return result;
 }
 
@@ -13,13 +13,13 @@ struct PSOutput
     float4 worldPosition : SV_Target1;
 };
 
-PSInput VSMain(float4 position : POSITION, float3 normal : NORMAL, float2 uv : UV, float4 boneWeights : BONE_WEIGHTS, uint4 boneIndices : BONE_INDICES)
+PSInput VSMain(float4 position : POSITION, float2 packedNormal : NORMAL, float2 uv : UV, float4 boneWeights : BONE_WEIGHTS, uint4 boneIndices : BONE_INDICES)
 {
     PSInput result;
     
     result.worldPosition = mul(position, worldTransform);
     result.position = mul(result.worldPosition, VSGetVP());
-    result.worldNormal = mul(float4(normal, 0.), worldTransform);
+    result.worldNormal = mul(float4(DecodeOctahedral(packedNormal), 0.), worldTransform);
 
     return result;
 }
@@ -5,7 +5,7 @@ struct PSInput
 	float4 position : SV_POSITION;
 };
 
-PSInput VSMain(float4 position : POSITION, float3 normal : NORMAL, float2 uv : UV, float4 boneWeights : BONE_WEIGHTS, uint4 boneIndices : BONE_INDICES)
+PSInput VSMain(float4 position : POSITION, float2 packedNormal : NORMAL, float2 uv : UV, float4 boneWeights : BONE_WEIGHTS, uint4 boneIndices : BONE_INDICES)
 {
 	float4 pos = position;
 	if (boneWeights[0] > 0.01)
@@ -7,8 +7,11 @@ struct RootConstants
 };
 ConstantBuffer<RootConstants> rootConstants : register(b0, space1);
 
-void VSMain(float4 position : POSITION, float3 normal : NORMAL, float3 tangent : TANGENT, float3 bitangent : BITANGENT, float2 uv : UV, out PSInputDefault result, inout uint instanceID : SV_InstanceID)
+void VSMain(float4 position : POSITION, float2 packedNormal : NORMAL, float4 packedTangent : TANGENT, float2 uv : UV, out PSInputDefault result, inout uint instanceID : SV_InstanceID)
 {
+    float3 normal, tangent, bitangent;
+    DecodeTangentFrame(packedNormal, packedTangent, normal, tangent, bitangent);
+
     // Offset the position based on the layer
     float3 newPos = position.xyz + normal * instanceID * rootConstants.layerOffset;
     result = VSCalcDefault(float4(newPos, 1.0), normal, tangent, bitangent, uv);
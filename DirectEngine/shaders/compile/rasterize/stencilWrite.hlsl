@@ -1,8 +1,8 @@
 #include "util/common.hlsl"
 
-PSInputDefault VSMain(float4 position : POSITION, float3 normal : NORMAL, float3 tangent : TANGENT, float3 bitangent : BITANGENT, float2 uv : UV)
+PSInputDefault VSMain(float4 position : POSITION, float2 packedNormal : NORMAL, float4 packedTangent : TANGENT, float2 uv : UV)
 {
-    PSInputDefault result = VSCalcDefault(position, normal, tangent, bitangent, uv);
+    PSInputDefault result = VSCalcDefaultPacked(position, packedNormal, packedTangent, uv);
     return result;
 }
 
@@ -45,17 +45,23 @@ TextureCube<float4> irradianceMap : register(t6);
 TextureCube<float4> reflectanceMap : register(t7);
 Texture2D ambientLUT : register(t8);
 
-struct Vertex
+// Mesh vertex buffers hold VertexData::PackedVertex, has to match PackVertices in Vertex.cpp
+float3 DecodeOctahedral(float2 encoded)
 {
-	float3 position;
-	float4 color;
-	float3 normal;
-	float3 tangent;
-	float3 bitangent;
-	float2 uv;
-	float4 boneWeights;
-	uint4 boneIndices;
-};
+	float3 n = float3(encoded.x, encoded.y, 1. - abs(encoded.x) - abs(encoded.y));
+	float t = saturate(-n.z);
+	n.x += n.x >= 0. ? -t : t;
+	n.y += n.y >= 0. ? -t : t;
+	return normalize(n);
+}
+
+// packedNormal is snorm, packedTangent is unorm with the bitangent sign in w
+void DecodeTangentFrame(float2 packedNormal, float4 packedTangent, out float3 normal, out float3 tangent, out float3 bitangent)
+{
+	normal = DecodeOctahedral(packedNormal);
+	tangent = DecodeOctahedral(packedTangent.xy * 2. - 1.);
+	bitangent = cross(normal, tangent) * (packedTangent.w > .5 ? 1. : -1.);
+}
 
 struct PSInputDefault
 {
@@ -100,6 +106,13 @@ PSInputDefault VSCalcDefault(float4 position, float3 normal, float3 tangent, flo
 	return result;
 }
 
+PSInputDefault VSCalcDefaultPacked(float4 position, float2 packedNormal, float4 packedTangent, float2 uv)
+{
+	float3 normal, tangent, bitangent;
+	DecodeTangentFrame(packedNormal, packedTangent, normal, tangent, bitangent);
+	return VSCalcDefault(position, normal, tangent, bitangent, uv);
+}
+
 float4 CalcScreenPos(float4 clipPos)
 {
 	float4 screenPos = clipPos * .5;
@@ -0,0 +1,848 @@
+#include "TestCommon.h"
+
+#include "../core/Memory.h"
+#include "../core/Mesh.h"
+#include "../core/CookedMesh.h"
+#include "../core/GlbReader.h"
+#include "../core/HashMap.h"
+#include "../core/WorkerPool.h"
+#include "../game/Entity.h"
+
+#include <cfloat>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <Psapi.h>
+
+// The engine reads .glb files with GlbReader, tinygltf is only compiled in here to compare against
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#define TINYGLTF_USE_CPP14
+#include "../import/tiny_gltf.h"
+
+// Benchmarks are disabled by default so they don't slow down the regular test runs.
+// Run them with: --gtest_also_run_disabled_tests --gtest_filter=Benchmark.*
+namespace Benchmark
+{
+	const size_t ARENA_BENCHMARK_ALLOCATIONS = 1 << 20;
+
+	double RunArenaBenchmark(size_t threadCount, bool concurrent)
+	{
+		MemoryArena arena(1024ull * 1024 * 1024, concurrent);
+		std::mutex arenaMutex;
+		const size_t allocationsPerThread = ARENA_BENCHMARK_ALLOCATIONS / threadCount;
+
+		return MeasureSeconds([&]()
+		{
+			std::vector<std::thread> threads;
+			for (size_t threadIndex = 0; threadIndex < threadCount; threadIndex++)
+			{
+				threads.emplace_back([&]()
+				{
+					for (size_t i = 0; i < allocationsPerThread; i++)
+					{
+						const size_t size = 16 + (i % 16) * 16;
+						void* data = nullptr;
+						if (concurrent)
+						{
+							data = arena.AllocateRaw(size);
+						}
+						else
+						{
+							std::lock_guard<std::mutex> lock(arenaMutex);
+							data = arena.AllocateRaw(size);
+						}
+						static_cast<uint8_t*>(data)[0] = 1;
+					}
+				});
+			}
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+		});
+	}
+
+	TEST(Benchmark, DISABLED_ConcurrentArena)
+	{
+		for (size_t threadCount : { 1, 4, 8, 16 })
+		{
+			const double mutexSeconds = RunArenaBenchmark(threadCount, false);
+			const double concurrentSeconds = RunArenaBenchmark(threadCount, true);
+			std::cout << std::format("{:2} threads: mutex {:.2f}ms, concurrent {:.2f}ms ({:.2f}x)\n",
+				threadCount, mutexSeconds * 1000.0, concurrentSeconds * 1000.0, mutexSeconds / concurrentSeconds);
+		}
+	}
+
+	size_t GetPageFaultCount()
+	{
+		PROCESS_MEMORY_COUNTERS counters{};
+		GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+		return counters.PageFaultCount;
+	}
+
+	TEST(Benchmark, DISABLED_ArenaBackingModelLoad)
+	{
+		const char* models[] = { "models/Sponza.glb", "models/kaiju.glb", "models/DamagedHelmet.glb", "models/log1.glb", "models/level1.glb" };
+		for (const char* model : models)
+		{
+			if (!std::filesystem::exists(model))
+			{
+				GTEST_SKIP() << "Models not found, run this from the build directory";
+			}
+		}
+
+		const ArenaBacking backings[] = { ArenaBacking::Default, ArenaBacking::CommitAhead, ArenaBacking::LargePages };
+		const char* backingNames[] = { "Default", "CommitAhead", "LargePages" };
+
+		for (ArenaBacking backing : backings)
+		{
+			const char* backingName = backingNames[static_cast<size_t>(backing)];
+			MemoryArena arena(1024 * 1024 * 512, false, backing);
+			const size_t pageFaultsBefore = GetPageFaultCount();
+			const double seconds = MeasureSeconds([&]()
+			{
+				for (const char* model : models)
+				{
+					LoadGltfFromFile(model, arena);
+				}
+			});
+			const size_t pageFaults = GetPageFaultCount() - pageFaultsBefore;
+
+			std::cout << std::format("{:12} (actual {:12}): {:.2f}ms, {} page faults, {:.2f}MB used, {:.2f}MB committed\n",
+				backingName, backingNames[static_cast<size_t>(arena.backing)], seconds * 1000.0, pageFaults,
+				arena.used.load() / (1024.0 * 1024.0), arena.committed.load() / (1024.0 * 1024.0));
+		}
+	}
+
+	// Stand in for EngineCore::CreateMesh copying into the upload buffer, so the cooked load also pays for faulting its pages in
+	void CopyToUpload(const GltfResult& model, MemoryArena& upload)
+	{
+		ArenaScope scope{ upload };
+		for (size_t i = 0; i < model.meshes.size; i++)
+		{
+			const MeshData& mesh = model.meshes[i].mesh;
+			PackedVertex* vertices = upload.Allocate<PackedVertex>(mesh.vertexCount);
+			if (mesh.packedVertices != nullptr)
+			{
+				memcpy(vertices, mesh.packedVertices, sizeof(PackedVertex) * mesh.vertexCount);
+			}
+			else
+			{
+				PackVertices(mesh.vertices, vertices, mesh.vertexCount);
+			}
+			memcpy(upload.Allocate<INDEX_BUFFER_TYPE>(mesh.indexCount), mesh.indices, sizeof(INDEX_BUFFER_TYPE) * mesh.indexCount);
+		}
+	}
+
+	TEST(Benchmark, DISABLED_CookedMeshLoad)
+	{
+		const char* models[] = { "models/Sponza.glb", "models/kaiju.glb" };
+		for (const char* model : models)
+		{
+			if (!std::filesystem::exists(model))
+			{
+				GTEST_SKIP() << "Models not found, run this from the build directory";
+			}
+		}
+
+		MemoryArena arena(1024 * 1024 * 512);
+		MemoryArena upload(1024 * 1024 * 512);
+		for (const char* model : models)
+		{
+			const std::pmr::string cookedPath = GetCookedMeshPath(model);
+			if (!IsCookedMeshCurrent(model, cookedPath.c_str()))
+			{
+				ASSERT_TRUE(WriteCookedMesh(*LoadGltfFromFile(model, arena), cookedPath.c_str()));
+				arena.Reset();
+			}
+
+			const double gltfSeconds = MeasureSeconds([&]() { CopyToUpload(*LoadGltfFromFile(model, arena), upload); });
+			const size_t gltfBytes = arena.used.load();
+			arena.Reset();
+
+			// The first load maps the file and faults the pages in, later ones reuse the mapping
+			const double cookedSeconds = MeasureSeconds([&]() { CopyToUpload(*LoadCookedMesh(cookedPath.c_str(), arena), upload); });
+			const size_t cookedBytes = arena.used.load();
+			arena.Reset();
+			const double cookedWarmSeconds = MeasureSeconds([&]() { CopyToUpload(*LoadCookedMesh(cookedPath.c_str(), arena), upload); });
+			arena.Reset();
+
+			std::cout << std::format("{:20} glTF: {:8.2f}ms {:8.2f}MB arena, cooked: {:8.2f}ms (warm {:6.2f}ms) {:8.2f}MB arena, {:.1f}x faster\n",
+				model, gltfSeconds * 1000.0, gltfBytes / (1024.0 * 1024.0), cookedSeconds * 1000.0, cookedWarmSeconds * 1000.0,
+				cookedBytes / (1024.0 * 1024.0), gltfSeconds / cookedSeconds);
+		}
+	}
+
+	TEST(Benchmark, DISABLED_ParallelGltfLoad)
+	{
+		const char* models[] = { "models/Sponza.glb", "models/kaiju.glb", "models/DamagedHelmet.glb", "models/log1.glb", "models/level1.glb" };
+		for (const char* model : models)
+		{
+			if (!std::filesystem::exists(model))
+			{
+				GTEST_SKIP() << "Models not found, run this from the build directory";
+			}
+		}
+
+		MemoryArena arena(1024 * 1024 * 1024);
+		double singleThreadSeconds = 0.;
+		for (size_t threadCount = 1; threadCount <= std::thread::hardware_concurrency(); threadCount *= 2)
+		{
+			WorkerPool pool{ threadCount - 1 };
+			double bestSeconds = DBL_MAX;
+			for (int run = 0; run < 3; run++)
+			{
+				bestSeconds = std::min<double>(bestSeconds, MeasureSeconds([&]()
+				{
+					for (const char* model : models)
+					{
+						LoadGltfFromFile(model, arena, pool);
+					}
+				}));
+				arena.Reset();
+			}
+
+			if (threadCount == 1)
+			{
+				singleThreadSeconds = bestSeconds;
+			}
+			std::cout << std::format("{:2} threads: {:8.2f}ms, {:.2f}x\n", threadCount, bestSeconds * 1000.0, singleThreadSeconds / bestSeconds);
+		}
+	}
+
+	size_t GetWorkingSetSize()
+	{
+		PROCESS_MEMORY_COUNTERS counters{};
+		GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+		return counters.WorkingSetSize;
+	}
+
+	// Freed pages can leave the working set in between, so it can shrink
+	size_t GetWorkingSetGrowth(size_t workingSetBefore)
+	{
+		return std::max(GetWorkingSetSize(), workingSetBefore) - workingSetBefore;
+	}
+
+	const int GLB_BENCHMARK_RUNS = 10;
+
+	// Parse only, decoding into meshes is the same for both. Memory is what the parsed file holds on to while it's alive,
+	// mapped BIN pages only count once decoding touches them so that part of the GLB reader's cost shows up later
+	TEST(Benchmark, DISABLED_GlbReader)
+	{
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("models"))
+		{
+			if (entry.path().extension() != ".glb")
+			{
+				continue;
+			}
+			const std::string path = entry.path().string();
+			MemoryArena arena(1024 * 1024 * 64);
+
+			auto loadTinyGltf = [&]()
+			{
+				tinygltf::Model model;
+				tinygltf::TinyGLTF loader;
+				std::string err;
+				std::string warn;
+				return loader.LoadBinaryFromFile(&model, &err, &warn, path);
+			};
+
+			size_t workingSetBefore = GetWorkingSetSize();
+			size_t allocationsBefore = GetHeapAllocationCount();
+			size_t glbWorkingSet = 0;
+			{
+				ArenaScope scope{ arena };
+				GlbFile file;
+				if (!ReadGlbFile(path.c_str(), file, arena))
+				{
+					std::cout << std::format("{:30} skipped, not a valid glb file\n", path);
+					continue;
+				}
+				glbWorkingSet = GetWorkingSetGrowth(workingSetBefore);
+			}
+			const size_t glbAllocations = GetHeapAllocationCount() - allocationsBefore;
+
+			workingSetBefore = GetWorkingSetSize();
+			allocationsBefore = GetHeapAllocationCount();
+			size_t tinyGltfWorkingSet = 0;
+			{
+				tinygltf::Model model;
+				tinygltf::TinyGLTF loader;
+				std::string err;
+				std::string warn;
+				ASSERT_TRUE(loader.LoadBinaryFromFile(&model, &err, &warn, path)) << err;
+				tinyGltfWorkingSet = GetWorkingSetGrowth(workingSetBefore);
+			}
+			const size_t tinyGltfAllocations = GetHeapAllocationCount() - allocationsBefore;
+
+			double glbSeconds = DBL_MAX;
+			double tinyGltfSeconds = DBL_MAX;
+			for (int run = 0; run < GLB_BENCHMARK_RUNS; run++)
+			{
+				glbSeconds = std::min<double>(glbSeconds, MeasureSeconds([&]()
+				{
+					ArenaScope scope{ arena };
+					GlbFile file;
+					ReadGlbFile(path.c_str(), file, arena);
+				}));
+				tinyGltfSeconds = std::min<double>(tinyGltfSeconds, MeasureSeconds([&]() { loadTinyGltf(); }));
+			}
+
+			std::cout << std::format("{:30} tinygltf: {:8.3f}ms {:8.2f}MB {:6} allocations, GlbReader: {:8.3f}ms {:8.2f}MB {:6} allocations, {:.1f}x faster\n",
+				path, tinyGltfSeconds * 1000.0, tinyGltfWorkingSet / (1024.0 * 1024.0), tinyGltfAllocations,
+				glbSeconds * 1000.0, glbWorkingSet / (1024.0 * 1024.0), glbAllocations, tinyGltfSeconds / glbSeconds);
+		}
+	}
+
+	const size_t LOOKUP_BENCHMARK_COUNT = 1 << 22;
+
+	template <typename Lookup>
+	double RunLookupBenchmark(size_t keyCount, Lookup lookup)
+	{
+		size_t checksum = 0;
+		const double seconds = MeasureSeconds([&]()
+		{
+			for (size_t i = 0; i < LOOKUP_BENCHMARK_COUNT; i++)
+			{
+				checksum += lookup((i * 7919) % keyCount);
+			}
+		});
+		EXPECT_NE(checksum, 0);
+		return seconds;
+	}
+
+	void RunHashLookupBenchmark(const char* name, const char* keyPrefix, size_t keyCount)
+	{
+		MemoryArena arena(1024 * 1024 * 64);
+		std::vector<uint64_t> keys;
+		std::unordered_map<uint64_t, size_t> stdMap;
+		ArenaHashMap<uint64_t, size_t> arenaMap{ arena, keyCount };
+		for (size_t i = 0; i < keyCount; i++)
+		{
+			keys.push_back(std::hash<std::string>{}(std::format("{}{}", keyPrefix, i)));
+			stdMap.emplace(keys[i], i + 1);
+			arenaMap.insert(keys[i], i + 1);
+		}
+
+		const double linearSeconds = RunLookupBenchmark(keyCount, [&](size_t i)
+		{
+			for (size_t j = 0; j < keys.size(); j++)
+			{
+				if (keys[j] == keys[i]) return j + 1;
+			}
+			return size_t(0);
+		});
+		const double stdSeconds = RunLookupBenchmark(keyCount, [&](size_t i) { return stdMap.find(keys[i])->second; });
+		const double arenaSeconds = RunLookupBenchmark(keyCount, [&](size_t i) { return *arenaMap.find(keys[i]); });
+
+		std::cout << std::format("{} lookup ({} keys): linear {:.2f}ms, unordered_map {:.2f}ms, ArenaHashMap {:.2f}ms\n",
+			name, keyCount, linearSeconds * 1000.0, stdSeconds * 1000.0, arenaSeconds * 1000.0);
+	}
+
+	TEST(Benchmark, DISABLED_MaterialLookup)
+	{
+		RunHashLookupBenchmark("Material", "material_", MAX_MATERIALS);
+	}
+
+	TEST(Benchmark, DISABLED_TextureLookup)
+	{
+		RunHashLookupBenchmark("Texture", "textures/texture_", MAX_TEXTURES);
+	}
+
+	TEST(Benchmark, DISABLED_AnimationLookup)
+	{
+		MemoryArena arena(1024 * 1024 * 64);
+		std::vector<std::string> names;
+		std::unordered_map<std::string, size_t> stdMap;
+		ArenaHashMap<std::string_view, size_t> arenaMap{ arena, MAX_ANIMATIONS };
+		names.reserve(MAX_ANIMATIONS);
+		for (size_t i = 0; i < MAX_ANIMATIONS; i++)
+		{
+			names.push_back(std::format("Armature|Animation_{}", i));
+			stdMap.emplace(names[i], i + 1);
+			arenaMap.insert(names[i], i + 1);
+		}
+
+		const double stdSeconds = RunLookupBenchmark(MAX_ANIMATIONS, [&](size_t i) { return stdMap.find(names[i])->second; });
+		const double arenaSeconds = RunLookupBenchmark(MAX_ANIMATIONS, [&](size_t i) { return *arenaMap.find(names[i]); });
+
+		std::cout << std::format("Animation lookup ({} keys): unordered_map {:.2f}ms, ArenaHashMap {:.2f}ms\n",
+			MAX_ANIMATIONS, stdSeconds * 1000.0, arenaSeconds * 1000.0);
+	}
+
+	// One decode batch like the importer converts them, big enough to measure and small enough to stay in cache
+	const size_t CONVERSION_BENCHMARK_VERTICES = GLTF_DECODE_BATCH_SIZE;
+	const int CONVERSION_BENCHMARK_RUNS = 100;
+
+	TEST(Benchmark, DISABLED_VertexStreamConversion)
+	{
+		const size_t count = CONVERSION_BENCHMARK_VERTICES;
+		std::vector<float> floats(count * 16);
+		std::vector<uint8_t> joints(count * 4);
+		for (size_t i = 0; i < floats.size(); i++)
+		{
+			floats[i] = static_cast<float>(i % 1000) / 1000.f;
+		}
+		for (size_t i = 0; i < count; i++)
+		{
+			joints[i * 4] = static_cast<uint8_t>(i);
+			floats[count * 12 + i * 4 + 0] = 1.f;
+			floats[count * 12 + i * 4 + 1] = 0.f;
+			floats[count * 12 + i * 4 + 2] = 0.f;
+			floats[count * 12 + i * 4 + 3] = 0.f;
+		}
+		VertexData::VertexStreams streams{ &floats[0], &floats[count * 3], &floats[count * 6], &floats[count * 10], joints.data(), &floats[count * 12] };
+		std::vector<VertexData::Vertex> vertices(count);
+
+		auto measure = [&](auto convert)
+		{
+			double bestSeconds = DBL_MAX;
+			for (int run = 0; run < CONVERSION_BENCHMARK_RUNS; run++)
+			{
+				bestSeconds = std::min<double>(bestSeconds, MeasureSeconds([&]() { convert(streams, vertices.data(), 0, count); }));
+			}
+			return count / bestSeconds / 1e6;
+		};
+		const double scalarRate = measure(VertexData::ConvertVertexStreamsScalar);
+		const double simdRate = measure(VertexData::ConvertVertexStreams);
+		std::cout << std::format("Vertex conversion: scalar {:.1f}M vertices/s, SIMD {:.1f}M vertices/s, {:.2f}x\n", scalarRate, simdRate, simdRate / scalarRate);
+
+		std::vector<uint16_t> indices16(count * 3);
+		std::vector<uint32_t> indices32(count * 3);
+		for (size_t i = 0; i < indices16.size(); i++)
+		{
+			indices16[i] = static_cast<uint16_t>(i * 7);
+		}
+		auto measureIndices = [&](auto widen)
+		{
+			double bestSeconds = DBL_MAX;
+			for (int run = 0; run < CONVERSION_BENCHMARK_RUNS; run++)
+			{
+				bestSeconds = std::min<double>(bestSeconds, MeasureSeconds([&]() { widen(indices16.data(), indices32.data(), indices16.size()); }));
+			}
+			return indices16.size() / bestSeconds / 1e6;
+		};
+		const double scalarIndexRate = measureIndices(VertexData::WidenIndicesScalar);
+		const double simdIndexRate = measureIndices(VertexData::WidenIndices);
+		std::cout << std::format("Index widening: scalar {:.1f}M indices/s, SIMD {:.1f}M indices/s, {:.2f}x\n", scalarIndexRate, simdIndexRate, simdIndexRate / scalarIndexRate);
+	}
+
+	// 60 fps playback over this many loops of every clip, seeks jump to random times instead
+	const int ANIMATION_BENCHMARK_LOOPS = 20;
+	const size_t ANIMATION_BENCHMARK_SEEKS = 100000;
+
+	// How SampleAnimation searched keys before it had a cursor
+	XMVECTOR SampleAnimationLinear(const AnimationData& animData, float animationTime, XMVECTOR(__vectorcall* interp)(XMVECTOR a, XMVECTOR b, float t))
+	{
+		for (size_t i = 0; i < animData.frameCount; i++)
+		{
+			if (animData.times[i] > animationTime)
+			{
+				if (i == 0)
+				{
+					return animData.data[0];
+				}
+				float t = (animationTime - animData.times[i - 1]) / (animData.times[i] - animData.times[i - 1]);
+				return interp(animData.data[i - 1], animData.data[i], t);
+			}
+		}
+		return animData.data[animData.frameCount - 1];
+	}
+
+	// Every channel gets sampled at every time like UpdateAnimation does, lerp keeps the interpolation cost out of the comparison.
+	// Resampled copies of the channels show what sampling costs without any search
+	void RunAnimationSamplingBenchmark(const char* name, const std::vector<AnimationData*>& channels, float duration, MemoryArena& arena)
+	{
+		std::vector<AnimationData> resampledData(channels.size());
+		std::vector<AnimationData*> resampled;
+		for (size_t i = 0; i < channels.size(); i++)
+		{
+			if (!ResampleAnimationData(*channels[i], false, ANIMATION_SAMPLE_RATE, ANIMATION_RESAMPLE_TOLERANCE, resampledData[i], arena))
+			{
+				resampledData[i] = *channels[i];
+			}
+			resampled.push_back(&resampledData[i]);
+		}
+
+		size_t maxKeys = 0;
+		for (AnimationData* channel : channels)
+		{
+			maxKeys = std::max(maxKeys, channel->frameCount);
+		}
+
+		std::vector<float> playbackTimes;
+		for (float time = 0.f; time < duration * ANIMATION_BENCHMARK_LOOPS; time += 1.f / 60.f)
+		{
+			playbackTimes.push_back(fmodf(time, duration));
+		}
+		std::vector<float> seekTimes(ANIMATION_BENCHMARK_SEEKS / channels.size() + 1);
+		for (size_t i = 0; i < seekTimes.size(); i++)
+		{
+			seekTimes[i] = duration * static_cast<float>((i * 7919) % 1000) / 1000.f;
+		}
+
+		auto measure = [&](const std::vector<float>& times, auto sample, const std::vector<AnimationData*>& sampledChannels)
+		{
+			XMVECTOR sum = XMVectorZero();
+			const double seconds = MeasureSeconds([&]()
+			{
+				for (float time : times)
+				{
+					for (AnimationData* channel : sampledChannels)
+					{
+						sum = XMVectorAdd(sum, sample(*channel, time));
+					}
+				}
+			});
+			EXPECT_TRUE(std::isfinite(XMVectorGetX(sum)));
+			return times.size() * channels.size() / seconds / 1e6;
+		};
+		auto linear = [](AnimationData& channel, float time) { return SampleAnimationLinear(channel, time, &XMVectorLerp); };
+		auto cursor = [](AnimationData& channel, float time) { return SampleAnimation(channel, time, &XMVectorLerp); };
+
+		std::cout << std::format("{:24} {:3} channels, up to {:4} keys: playback linear {:7.1f}M/s, cursor {:7.1f}M/s, resampled {:7.1f}M/s, seeks linear {:7.1f}M/s, binary {:7.1f}M/s, resampled {:7.1f}M/s\n",
+			name, channels.size(), maxKeys, measure(playbackTimes, linear, channels), measure(playbackTimes, cursor, channels), measure(playbackTimes, cursor, resampled),
+			measure(seekTimes, linear, channels), measure(seekTimes, cursor, channels), measure(seekTimes, cursor, resampled));
+	}
+
+	// The clips of kaiju.glb with their keys, then clips of growing length at 30 keys per second on all channels of its skeleton
+	TEST(Benchmark, DISABLED_AnimationSampling)
+	{
+		const char* path = "models/kaiju.glb";
+		if (!std::filesystem::exists(path))
+		{
+			GTEST_SKIP() << "Models not found, run this from the build directory";
+		}
+
+		MemoryArena arena(1024 * 1024 * 256);
+		GltfResult* model = LoadGltfFromFile(path, arena, GetWorkerPool(), true, 0.f);
+		ASSERT_TRUE(model->success);
+		ASSERT_NE(model->transformHierachy, nullptr);
+		TransformHierachy& hierachy = *model->transformHierachy;
+
+		for (size_t animIndex = 0; animIndex < hierachy.animationCount; animIndex++)
+		{
+			TransformAnimation& animation = hierachy.animations[animIndex];
+			std::vector<AnimationData*> channels;
+			for (size_t jointIdx = 0; jointIdx < hierachy.nodeCount; jointIdx++)
+			{
+				AnimationJointData& joint = animation.jointChannels[jointIdx];
+				for (AnimationData* channel : { &joint.translations, &joint.rotations, &joint.scales })
+				{
+					if (channel->frameCount > 0)
+					{
+						channels.push_back(channel);
+					}
+				}
+			}
+			if (!channels.empty() && animation.duration > 0.f)
+			{
+				RunAnimationSamplingBenchmark(animation.name.c_str(), channels, animation.duration, arena);
+			}
+		}
+
+		for (size_t keyCount : { 8, 64, 512, 4096 })
+		{
+			std::vector<float> times(keyCount);
+			std::vector<XMVECTOR> data(keyCount);
+			for (size_t i = 0; i < keyCount; i++)
+			{
+				times[i] = i / 30.f;
+				data[i] = XMVectorReplicate(static_cast<float>(i % 17));
+			}
+			std::vector<AnimationData> channelData(hierachy.nodeCount * 3, AnimationData{ keyCount, times.data(), data.data() });
+			std::vector<AnimationData*> channels;
+			for (AnimationData& channel : channelData)
+			{
+				channels.push_back(&channel);
+			}
+			RunAnimationSamplingBenchmark(std::format("Generated {} keys", keyCount).c_str(), channels, times.back(), arena);
+		}
+	}
+
+	// Channels of one clip, rotations get compared up to sign
+	struct CompressionChannel
+	{
+		AnimationData* keys;
+		bool rotation;
+	};
+
+	// Memory of the keys against the compressed channels, the largest error of translations, rotations and scales and what decoding costs during playback
+	void RunAnimationCompressionBenchmark(const char* name, const std::vector<CompressionChannel>& channels, float duration, MemoryArena& arena)
+	{
+		size_t keyBytes = 0;
+		size_t compressedBytes = 0;
+		size_t keyCount = 0;
+		size_t keptCount = 0;
+		size_t failedCount = 0;
+		float translationError = 0.f;
+		float rotationError = 0.f;
+		std::vector<AnimationData> compressedData(channels.size());
+		std::vector<AnimationData*> keyChannels;
+		std::vector<AnimationData*> compressedChannels;
+		const double seconds = MeasureSeconds([&]()
+		{
+			for (size_t i = 0; i < channels.size(); i++)
+			{
+				if (!CompressAnimationData(*channels[i].keys, channels[i].rotation, ANIMATION_COMPRESSION_TOLERANCE, compressedData[i], arena))
+				{
+					compressedData[i] = *channels[i].keys;
+					failedCount++;
+				}
+			}
+		});
+
+		for (size_t i = 0; i < channels.size(); i++)
+		{
+			const AnimationData& keys = *channels[i].keys;
+			const AnimationData& compressed = compressedData[i];
+			keyBytes += (sizeof(float) + sizeof(XMVECTOR)) * keys.frameCount;
+			keyCount += keys.frameCount;
+			keptCount += compressed.frameCount;
+			compressedBytes += compressed.compressed != nullptr ? (sizeof(float) + sizeof(XMUSHORTN4)) * compressed.frameCount + sizeof(CompressedAnimationData)
+				: (sizeof(float) + sizeof(XMVECTOR)) * compressed.frameCount;
+
+			const float error = GetAnimationDataError(compressed, keys, channels[i].rotation);
+			float& maxError = channels[i].rotation ? rotationError : translationError;
+			maxError = std::max(maxError, error);
+			keyChannels.push_back(channels[i].keys);
+			compressedChannels.push_back(&compressedData[i]);
+		}
+
+		auto measure = [&](const std::vector<AnimationData*>& sampledChannels)
+		{
+			XMVECTOR sum = XMVectorZero();
+			size_t sampleCount = 0;
+			const double sampleSeconds = MeasureSeconds([&]()
+			{
+				for (float time = 0.f; time < duration * ANIMATION_BENCHMARK_LOOPS; time += 1.f / 60.f)
+				{
+					for (size_t i = 0; i < sampledChannels.size(); i++)
+					{
+						sum = XMVectorAdd(sum, SampleAnimation(*sampledChannels[i], fmodf(time, duration), channels[i].rotation ? &XMQuaternionSlerp : &XMVectorLerp));
+					}
+					sampleCount += sampledChannels.size();
+				}
+			});
+			EXPECT_TRUE(std::isfinite(XMVectorGetX(sum)));
+			return sampleCount / sampleSeconds / 1e6;
+		};
+
+		std::cout << std::format("{:24} {:3} channels: {:6} keys {:8} bytes -> {:6} keys {:8} bytes ({:5.1f}%), {} kept their keys, max error translation/scale {:.5f} rotation {:.5f}, "
+			"compressed in {:6.2f}ms, playback {:6.1f}M/s -> {:6.1f}M/s\n",
+			name, channels.size(), keyCount, keyBytes, keptCount, compressedBytes, 100.0 * compressedBytes / keyBytes, failedCount, translationError, rotationError,
+			seconds * 1000.0, measure(keyChannels), measure(compressedChannels));
+	}
+
+	// The clips of kaiju.glb, then generated clips on its skeleton with smooth motion, a few jerky joints and joints that hold still
+	TEST(Benchmark, DISABLED_AnimationCompression)
+	{
+		const char* path = "models/kaiju.glb";
+		if (!std::filesystem::exists(path))
+		{
+			GTEST_SKIP() << "Models not found, run this from the build directory";
+		}
+
+		MemoryArena arena(1024 * 1024 * 256);
+		GltfResult* model = LoadGltfFromFile(path, arena, GetWorkerPool(), true, 0.f);
+		ASSERT_TRUE(model->success);
+		ASSERT_NE(model->transformHierachy, nullptr);
+		TransformHierachy& hierachy = *model->transformHierachy;
+
+		for (size_t animIndex = 0; animIndex < hierachy.animationCount; animIndex++)
+		{
+			TransformAnimation& animation = hierachy.animations[animIndex];
+			std::vector<CompressionChannel> channels;
+			for (size_t jointIdx = 0; jointIdx < hierachy.nodeCount; jointIdx++)
+			{
+				AnimationJointData& joint = animation.jointChannels[jointIdx];
+				for (const auto& [channel, rotation] : { std::pair{ &joint.translations, false }, std::pair{ &joint.rotations, true }, std::pair{ &joint.scales, false } })
+				{
+					if (channel->frameCount > 0)
+					{
+						channels.push_back({ channel, rotation });
+					}
+				}
+			}
+			if (!channels.empty() && animation.duration > 0.f)
+			{
+				RunAnimationCompressionBenchmark(animation.name.c_str(), channels, animation.duration, arena);
+			}
+		}
+
+		for (float duration : { 2.f, 10.f })
+		{
+			const size_t keyCount = static_cast<size_t>(duration * 30.f) + 1;
+			std::vector<float> times(keyCount);
+			for (size_t i = 0; i < keyCount; i++)
+			{
+				times[i] = i / 30.f;
+			}
+			std::vector<XMVECTOR> data(hierachy.nodeCount * 3 * keyCount);
+			std::vector<AnimationData> channelData(hierachy.nodeCount * 3);
+			std::vector<CompressionChannel> channels;
+			for (size_t jointIdx = 0; jointIdx < hierachy.nodeCount; jointIdx++)
+			{
+				const float phase = static_cast<float>(jointIdx) * 0.37f;
+				const float speed = jointIdx % 11 == 0 ? 9.f : 1.5f;
+				for (size_t part = 0; part < 3; part++)
+				{
+					XMVECTOR* values = &data[(jointIdx * 3 + part) * keyCount];
+					for (size_t i = 0; i < keyCount; i++)
+					{
+						const float time = times[i];
+						if (part == 0)
+						{
+							values[i] = XMVectorSet(0.1f * sinf(time * speed + phase), 0.05f * cosf(time * speed), 0.f, 0.f);
+						}
+						else if (part == 1)
+						{
+							values[i] = XMQuaternionRotationRollPitchYaw(0.5f * sinf(time * speed + phase), 0.3f * sinf(time * 0.5f * speed), jointIdx % 3 == 0 ? 0.f : 0.2f * cosf(time * speed));
+						}
+						else
+						{
+							values[i] = XMVectorReplicate(1.f);
+						}
+					}
+					channelData[jointIdx * 3 + part] = { keyCount, times.data(), values };
+					channels.push_back({ &channelData[jointIdx * 3 + part], part == 1 });
+				}
+			}
+			RunAnimationCompressionBenchmark(std::format("Generated {}s", duration).c_str(), channels, duration, arena);
+		}
+	}
+
+	// Entity::UpdateAnimation before poses, every joint got decomposed, sampled and rebuilt on its own
+	void UpdatePoseDecompose(TransformHierachy& hierachy, TransformAnimation& animation, float animationTime)
+	{
+		for (size_t jointIdx = 0; jointIdx < hierachy.nodeCount; jointIdx++)
+		{
+			TransformNode& node = hierachy.nodes[jointIdx];
+			node.currentLocal = node.baseLocal;
+			if (animation.jointMask.Get(jointIdx))
+			{
+				XMVECTOR translation, rotation, scale;
+				XMMatrixDecompose(&scale, &rotation, &translation, node.currentLocal);
+				AnimationJointData& channels = animation.jointChannels[jointIdx];
+				if (channels.translations.frameCount > 0) translation = SampleAnimation(channels.translations, animationTime, &XMVectorLerp);
+				if (channels.rotations.frameCount > 0) rotation = SampleAnimation(channels.rotations, animationTime, &XMQuaternionSlerp);
+				if (channels.scales.frameCount > 0) scale = SampleAnimation(channels.scales, animationTime, &XMVectorLerp);
+				node.currentLocal = XMMatrixAffineTransformation(scale, XMVectorZero(), rotation, translation);
+			}
+		}
+	}
+
+	// Local matrices of the whole kaiju skeleton per second, with a generated clip that moves every joint since the bundled clips only move some
+	TEST(Benchmark, DISABLED_PoseEvaluation)
+	{
+		const char* path = "models/kaiju.glb";
+		if (!std::filesystem::exists(path))
+		{
+			GTEST_SKIP() << "Models not found, run this from the build directory";
+		}
+
+		MemoryArena arena(1024 * 1024 * 256);
+		GltfResult* model = LoadGltfFromFile(path, arena);
+		ASSERT_TRUE(model->success);
+		ASSERT_NE(model->transformHierachy, nullptr);
+		TransformHierachy& hierachy = *model->transformHierachy;
+
+		const float duration = 4.f;
+		const size_t keyCount = static_cast<size_t>(duration * 30.f) + 1;
+		std::vector<float> times(keyCount);
+		for (size_t i = 0; i < keyCount; i++)
+		{
+			times[i] = i / 30.f;
+		}
+		std::vector<XMVECTOR> data(hierachy.nodeCount * 3 * keyCount);
+		TransformAnimation& generated = *NewObject(arena, TransformAnimation);
+		for (size_t jointIdx = 0; jointIdx < hierachy.nodeCount; jointIdx++)
+		{
+			generated.jointMask.Set(jointIdx, true);
+			XMVECTOR* translations = &data[(jointIdx * 3 + 0) * keyCount];
+			XMVECTOR* rotations = &data[(jointIdx * 3 + 1) * keyCount];
+			XMVECTOR* scales = &data[(jointIdx * 3 + 2) * keyCount];
+			for (size_t i = 0; i < keyCount; i++)
+			{
+				const float time = times[i] + static_cast<float>(jointIdx) * 0.37f;
+				translations[i] = XMVectorSet(0.1f * sinf(time), 0.05f * cosf(time * 2.f), 0.f, 0.f);
+				rotations[i] = XMQuaternionRotationRollPitchYaw(0.5f * sinf(time), 0.3f * cosf(time * 0.5f), 0.2f * sinf(time * 3.f));
+				scales[i] = XMVectorSet(1.f + 0.1f * sinf(time), 1.f, 1.f, 0.f);
+			}
+			AnimationJointData& channels = generated.jointChannels[jointIdx];
+			channels.translations = { keyCount, times.data(), translations };
+			channels.rotations = { keyCount, times.data(), rotations };
+			channels.scales = { keyCount, times.data(), scales };
+		}
+
+		std::vector<float> playbackTimes;
+		for (float time = 0.f; time < duration * ANIMATION_BENCHMARK_LOOPS; time += 1.f / 60.f)
+		{
+			playbackTimes.push_back(fmodf(time, duration));
+		}
+
+		XMVECTOR sum = XMVectorZero();
+		const double decomposeSeconds = MeasureSeconds([&]()
+		{
+			for (float time : playbackTimes)
+			{
+				UpdatePoseDecompose(hierachy, generated, time);
+				sum = XMVectorAdd(sum, hierachy.nodes[hierachy.nodeCount - 1].currentLocal.r[3]);
+			}
+		});
+		const double poseSeconds = MeasureSeconds([&]()
+		{
+			for (float time : playbackTimes)
+			{
+				generated.time = time;
+				TransformAnimation* layers[] = { &generated };
+				AnimationPose pose = hierachy.basePose;
+				BlendAnimationLayers(layers, 1, hierachy.basePose, hierachy.nodeCount, pose);
+				BuildPoseMatrices(pose, hierachy);
+				sum = XMVectorAdd(sum, hierachy.nodes[hierachy.nodeCount - 1].currentLocal.r[3]);
+			}
+		});
+
+		// Three more layers that only cover 8 joints each should cost about as much as those joints, not as the whole skeleton
+		TransformAnimation* layers[4] = { &generated };
+		for (size_t layerIndex = 1; layerIndex < _countof(layers); layerIndex++)
+		{
+			TransformAnimation& layer = *NewObject(arena, TransformAnimation);
+			layer.weight = 0.5f;
+			layer.blendMode = layerIndex == 2 ? AnimationBlendMode::Additive : AnimationBlendMode::Override;
+			for (size_t jointIdx = layerIndex * 8; jointIdx < layerIndex * 8 + 8 && jointIdx < hierachy.nodeCount; jointIdx++)
+			{
+				layer.jointMask.Set(jointIdx, true);
+				layer.jointChannels[jointIdx] = generated.jointChannels[jointIdx];
+			}
+			layers[layerIndex] = &layer;
+		}
+		const double layeredSeconds = MeasureSeconds([&]()
+		{
+			for (float time : playbackTimes)
+			{
+				for (TransformAnimation* layer : layers)
+				{
+					layer->time = time;
+				}
+				AnimationPose pose = hierachy.basePose;
+				BlendAnimationLayers(layers, _countof(layers), hierachy.basePose, hierachy.nodeCount, pose);
+				BuildPoseMatrices(pose, hierachy);
+				sum = XMVectorAdd(sum, hierachy.nodes[hierachy.nodeCount - 1].currentLocal.r[3]);
+			}
+		});
+		EXPECT_TRUE(std::isfinite(XMVectorGetX(sum)));
+
+		std::cout << std::format("{} joints, {} keys per channel: decompose {:8.0f} poses/s, SoA pose {:8.0f} poses/s ({:.2f}x), with 3 partial layers {:8.0f} poses/s\n",
+			hierachy.nodeCount, keyCount, playbackTimes.size() / decomposeSeconds, playbackTimes.size() / poseSeconds, decomposeSeconds / poseSeconds,
+			playbackTimes.size() / layeredSeconds);
+	}
+}
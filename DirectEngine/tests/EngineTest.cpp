@@ -1,6 +1,14 @@
 #include "TestCommon.h"
 
 #include "../core/Memory.h"
+#include "../core/HashMap.h"
+#include "../core/Name.h"
+#include "../core/WorkerPool.h"
+
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace Engine
 {
@@ -85,4 +93,557 @@ namespace Engine
 
 		EXPECT_EQ(arena.used, structSize * 3);
 	}
+
+	TEST(Memory, ScopeRewind)
+	{
+		MemoryArena arena(1024 * 64 * 2);
+		NewObject(arena, TestStruct);
+		const size_t outerUsed = arena.used;
+
+		{
+			ArenaScope scope{ arena };
+			NewArray(arena, TestStruct, 16);
+			EXPECT_EQ(arena.used, outerUsed + sizeof(TestStruct) * 16);
+		}
+		EXPECT_EQ(arena.used, outerUsed);
+	}
+
+	TEST(Memory, NestedScopes)
+	{
+		MemoryArena arena(1024 * 64 * 2);
+
+		ArenaScope outer{ arena };
+		SmallStruct* a = NewObject(arena, SmallStruct);
+		a->a = 1;
+		const size_t afterA = arena.used;
+
+		{
+			ArenaScope middle{ arena };
+			SmallStruct* b = NewObject(arena, SmallStruct);
+			b->a = 2;
+			const size_t afterB = arena.used;
+
+			{
+				ArenaScope inner{ arena };
+				NewArray(arena, SmallStruct, 64);
+				EXPECT_GT(arena.used, afterB);
+			}
+			EXPECT_EQ(arena.used, afterB);
+			EXPECT_EQ(b->a, 2);
+		}
+		EXPECT_EQ(arena.used, afterA);
+		EXPECT_EQ(a->a, 1);
+	}
+
+	TEST(Memory, ReuseAfterRewind)
+	{
+		MemoryArena arena(1024 * 64 * 2);
+		NewObject(arena, SmallStruct);
+
+		TestStruct* first = nullptr;
+		{
+			ArenaScope scope{ arena };
+			first = NewObject(arena, TestStruct);
+			first->a = 3;
+		}
+
+		const size_t committed = arena.committed;
+		TestStruct* second = nullptr;
+		{
+			ArenaScope scope{ arena };
+			second = NewObject(arena, TestStruct);
+			second->a = 4;
+		}
+
+		EXPECT_EQ(first, second);
+		EXPECT_EQ(first->a, 4);
+		EXPECT_EQ(arena.committed, committed);
+	}
+
+	TEST(Memory, ScratchArena)
+	{
+		MemoryArena& scratch1 = GetScratchArena();
+		MemoryArena& scratch2 = GetScratchArena(&scratch1);
+		EXPECT_NE(&scratch1, &scratch2);
+		EXPECT_EQ(&GetScratchArena(), &scratch1);
+		EXPECT_EQ(&GetScratchArena(&scratch2), &scratch1);
+
+		const size_t usedBefore = scratch1.used;
+		{
+			ArenaScope scope{ scratch1 };
+			const char* text = ArenaFormat(scope.arena, "{} {}", "test", 42);
+			EXPECT_STREQ(text, "test 42");
+		}
+		EXPECT_EQ(scratch1.used, usedBefore);
+	}
+
+	TEST(Memory, CommitAhead)
+	{
+		MemoryArena arena(1024 * 1024 * 256, false, ArenaBacking::CommitAhead);
+		const size_t granularity = arena.allocationGranularity;
+
+		arena.AllocateRaw(1);
+		EXPECT_EQ(arena.committed, granularity);
+
+		arena.AllocateRaw(granularity);
+		EXPECT_EQ(arena.committed, granularity * 3);
+
+		arena.AllocateRaw(granularity * 2);
+		EXPECT_EQ(arena.committed, granularity * 7);
+
+		arena.Reset(true);
+		EXPECT_EQ(arena.committed, 0);
+		EXPECT_EQ(arena.commitAhead, granularity);
+	}
+
+	TEST(Memory, LargePages)
+	{
+		// Falls back to commit ahead when the process isn't allowed to lock pages
+		MemoryArena arena(1024 * 1024 * 64, false, ArenaBacking::LargePages);
+		EXPECT_NE(arena.backing, ArenaBacking::Default);
+
+		int64_t* values = arena.Allocate<int64_t>(1024 * 1024);
+		values[1024 * 1024 - 1] = 42;
+		EXPECT_EQ(values[1024 * 1024 - 1], 42);
+		EXPECT_GE(arena.committed, arena.used);
+	}
+
+	TEST(Memory, ArenaVector)
+	{
+		ArenaVector<TestStruct> vector{};
+		EXPECT_EQ(vector.base, nullptr);
+
+		TestStruct& first = vector.newElement();
+		first.a = 1;
+		TestStruct* firstAddress = &first;
+
+		// Grow well past the first commit
+		const size_t count = ARENA_VECTOR_MIN_COMMIT / sizeof(TestStruct) * 10;
+		for (size_t i = 1; i < count; i++)
+		{
+			vector.newElement(TestStruct{ static_cast<int64_t>(i + 1), 0 });
+		}
+
+		EXPECT_EQ(vector.size, count);
+		EXPECT_GE(vector.committedCount, count);
+		EXPECT_EQ(&vector[0], firstAddress);
+		EXPECT_EQ(firstAddress->a, 1);
+		for (size_t i = 0; i < count; i++)
+		{
+			ASSERT_EQ(vector.at(i).a, i + 1);
+		}
+
+		const size_t committedCount = vector.committedCount;
+		vector.clear();
+		EXPECT_EQ(vector.getSize(), 0);
+		EXPECT_EQ(&vector.newElement(), firstAddress);
+		EXPECT_EQ(vector.committedCount, committedCount);
+
+		size_t iterated = 0;
+		for (TestStruct& element : vector)
+		{
+			iterated++;
+		}
+		EXPECT_EQ(iterated, 1);
+	}
+
+	TEST(Memory, ConcurrentAllocation)
+	{
+		const size_t threadCount = 8;
+		const size_t allocationsPerThread = 10000;
+		MemoryArena arena(1024 * 1024 * 256, true);
+
+		struct Allocation
+		{
+			uint8_t* data;
+			size_t size;
+		};
+		std::vector<Allocation> allocations[threadCount];
+		std::vector<std::thread> threads;
+
+		for (size_t threadIndex = 0; threadIndex < threadCount; threadIndex++)
+		{
+			threads.emplace_back([&arena, &allocations, threadIndex]()
+			{
+				for (size_t i = 0; i < allocationsPerThread; i++)
+				{
+					const size_t size = 1 + (i * 7 + threadIndex * 13) % 300;
+					const size_t alignment = size_t(16) << (i % 4);
+					uint8_t* data = static_cast<uint8_t*>(arena.AllocateRaw(size, alignment));
+					EXPECT_EQ(reinterpret_cast<uintptr_t>(data) % alignment, 0);
+					memset(data, static_cast<int>(threadIndex + 1), size);
+					allocations[threadIndex].push_back({ data, size });
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		std::vector<Allocation> sorted;
+		for (size_t threadIndex = 0; threadIndex < threadCount; threadIndex++)
+		{
+			for (const Allocation& allocation : allocations[threadIndex])
+			{
+				for (size_t i = 0; i < allocation.size; i++)
+				{
+					ASSERT_EQ(allocation.data[i], threadIndex + 1) << "Allocation was overwritten by another thread";
+				}
+				sorted.push_back(allocation);
+			}
+		}
+
+		std::sort(sorted.begin(), sorted.end(), [](const Allocation& a, const Allocation& b) { return a.data < b.data; });
+		for (size_t i = 1; i < sorted.size(); i++)
+		{
+			ASSERT_LE(sorted[i - 1].data + sorted[i - 1].size, sorted[i].data);
+		}
+		EXPECT_LE(sorted.back().data + sorted.back().size, arena.base + arena.used);
+		EXPECT_GE(arena.committed, arena.used);
+	}
+
+	TEST(Memory, Telemetry)
+	{
+		MemoryArena arena(1024 * 1024 * 64);
+		arena.debugName = "Telemetry";
+
+		arena.Allocate<int64_t>(8, AllocationTag::Mesh);
+		arena.AllocateRaw(64, MIN_ALIGN, AllocationTag::Animation);
+		arena.AllocateRaw(32);
+		EXPECT_EQ(arena.taggedBytes[static_cast<size_t>(AllocationTag::Mesh)], sizeof(int64_t) * 8);
+		EXPECT_EQ(arena.taggedBytes[static_cast<size_t>(AllocationTag::Animation)], 64);
+		EXPECT_EQ(arena.GetUntaggedBytes(), arena.used - sizeof(int64_t) * 8 - 64);
+		EXPECT_EQ(arena.commitCount, 1);
+
+		{
+			ArenaScope scope{ arena };
+			arena.AllocateRaw(1024);
+		}
+		const size_t peak = arena.used + 1024;
+		EXPECT_EQ(arena.GetHighWaterMark(), peak);
+
+		arena.Reset(true);
+		EXPECT_EQ(arena.GetHighWaterMark(), peak);
+		EXPECT_EQ(arena.taggedBytes[static_cast<size_t>(AllocationTag::Mesh)], 0);
+		EXPECT_EQ(arena.decommitCount, 1);
+
+		const MemoryArena* arenas[] = { &arena };
+		const std::string json = GetArenaStatsJson(arenas, 1);
+		EXPECT_NE(json.find("\"name\": \"Telemetry\""), std::string::npos);
+		EXPECT_NE(json.find(std::format("\"highWaterMark\": {}", peak)), std::string::npos);
+		EXPECT_NE(json.find("\"Animation\": 0"), std::string::npos);
+	}
+
+	TEST(Memory, Snapshot)
+	{
+		struct Node
+		{
+			int64_t value;
+			Node* next;
+		};
+
+		for (bool writeWatch : { false, true })
+		{
+			MemoryArena arena(1024 * 1024 * 64, false, ArenaBacking::Default, writeWatch);
+			MemoryArena storage(1024 * 1024 * 64);
+
+			// Linked list so the snapshot contains pointers into the arena itself
+			Node* head = nullptr;
+			for (int64_t i = 0; i < 1000; i++)
+			{
+				head = NewObjectTagged(arena, AllocationTag::Entity, Node, i, head);
+			}
+			const size_t used = arena.used;
+
+			ArenaSnapshot snapshot{};
+			arena.TakeSnapshot(snapshot, storage);
+			EXPECT_EQ(snapshot.used, used);
+
+			for (Node* node = head; node != nullptr; node = node->next)
+			{
+				node->value = -1;
+				node->next = nullptr;
+			}
+			arena.AllocateRaw(1024 * 1024, MIN_ALIGN, AllocationTag::Mesh);
+
+			arena.RestoreSnapshot(snapshot);
+			EXPECT_EQ(arena.used, used);
+			EXPECT_EQ(arena.taggedBytes[static_cast<size_t>(AllocationTag::Mesh)], 0);
+			EXPECT_EQ(arena.taggedBytes[static_cast<size_t>(AllocationTag::Entity)], sizeof(Node) * 1000);
+
+			int64_t expected = 999;
+			for (Node* node = head; node != nullptr; node = node->next)
+			{
+				ASSERT_EQ(node->value, expected--);
+			}
+			EXPECT_EQ(expected, -1);
+
+			// Freed pages lose their contents, restoring has to bring them back too
+			arena.Reset(true);
+			arena.RestoreSnapshot(snapshot);
+			EXPECT_EQ(head->value, 999);
+			EXPECT_EQ(head->next->value, 998);
+		}
+	}
+
+	TEST(Memory, FrameArenaRing)
+	{
+		FrameArenaRing<3> ring{};
+		uint64_t signaledValue = 0;
+		uint64_t completedValue = 0;
+
+		// Each frame allocates something and signals the next fence value, the simulated GPU lags two frames behind
+		int64_t* frameData[6] = {};
+		for (size_t frame = 0; frame < 6; frame++)
+		{
+			frameData[frame] = ring.Current().Allocate<int64_t>();
+			*frameData[frame] = frame;
+			ring.EndFrame(++signaledValue);
+
+			completedValue = signaledValue > 2 ? signaledValue - 2 : 0;
+			ring.BeginFrame((frame + 1) % 3, completedValue);
+
+			// Everything the GPU could still be reading is untouched
+			for (size_t pending = completedValue; pending < signaledValue; pending++)
+			{
+				ASSERT_EQ(*frameData[pending], pending);
+			}
+		}
+
+		// Frame 6 reuses the arena of frame 3, which the GPU finished
+		EXPECT_EQ(ring.GetFrameIndex(), 0);
+		EXPECT_EQ(ring.Current().used, 0);
+
+		// GPU stalled, the arena of frame 4 must not be reset and new allocations go on top
+		ring.EndFrame(++signaledValue);
+		ring.BeginFrame(1, 4);
+		EXPECT_EQ(ring.Current().used, sizeof(int64_t));
+		EXPECT_EQ(*frameData[4], 4);
+		EXPECT_NE(ring.Current().Allocate<int64_t>(), frameData[4]);
+
+		ring.EndFrame(++signaledValue);
+		ring.BeginFrame(2, signaledValue);
+		ring.EndFrame(++signaledValue);
+		ring.BeginFrame(1, signaledValue);
+		EXPECT_EQ(ring.Current().used, 0);
+	}
+
+	TEST(Memory, PmrResource)
+	{
+		MemoryArena arena(1024 * 1024 * 64);
+		ArenaMemoryResource monotonic{ arena, AllocationTag::Material };
+
+		// Warm up anything the standard library allocates lazily
+		std::pmr::vector<int> warmup{ &monotonic };
+		warmup.push_back(0);
+
+		const size_t heapAllocations = GetHeapAllocationCount();
+		{
+			std::pmr::vector<std::pmr::string> strings{ &monotonic };
+			std::pmr::unordered_map<int, std::pmr::string> map{ &monotonic };
+			for (int i = 0; i < 1000; i++)
+			{
+				strings.emplace_back("a string that is too long for the small string buffer");
+				map.emplace(i, strings.back());
+			}
+			EXPECT_EQ(map.at(999), strings[999]);
+		}
+		EXPECT_EQ(GetHeapAllocationCount(), heapAllocations);
+		EXPECT_GT(arena.taggedBytes[static_cast<size_t>(AllocationTag::Material)], 1000 * 50);
+
+		// Scoped resources give everything back when they go out of scope
+		const size_t used = arena.used;
+		{
+			ScopedArenaMemoryResource scoped{ arena };
+			std::pmr::string line{ &scoped };
+			for (int i = 0; i < 100; i++)
+			{
+				line.append("token ");
+			}
+			EXPECT_GT(arena.used, used);
+		}
+		EXPECT_EQ(arena.used, used);
+		EXPECT_EQ(GetHeapAllocationCount(), heapAllocations);
+	}
+
+	struct CollidingHash
+	{
+		uint64_t operator()(uint64_t key) const { return key % 4; }
+	};
+
+	TEST(HashMap, InsertFind)
+	{
+		MemoryArena arena(1024 * 1024);
+		ArenaHashMap<uint64_t, int> map{ arena };
+
+		EXPECT_TRUE(map.insert(5, 50));
+		EXPECT_TRUE(map.insert(7, 70));
+		EXPECT_FALSE(map.insert(5, 99));
+		EXPECT_EQ(map.getSize(), 2);
+
+		ASSERT_NE(map.find(5), nullptr);
+		EXPECT_EQ(*map.find(5), 50);
+		EXPECT_EQ(*map.find(7), 70);
+		EXPECT_EQ(map.find(6), nullptr);
+		EXPECT_FALSE(map.contains(6));
+
+		map[6] = 60;
+		EXPECT_EQ(*map.find(6), 60);
+		EXPECT_EQ(map.getSize(), 3);
+
+		map.clear();
+		EXPECT_EQ(map.getSize(), 0);
+		EXPECT_EQ(map.find(5), nullptr);
+	}
+
+	TEST(HashMap, Grow)
+	{
+		MemoryArena arena(1024 * 1024 * 16);
+		ArenaHashMap<uint64_t, uint64_t> map{ arena };
+		const size_t initialCapacity = map.getCapacity();
+
+		for (uint64_t i = 0; i < 10000; i++)
+		{
+			map.insert(i * 31, i);
+		}
+		EXPECT_GT(map.getCapacity(), initialCapacity);
+		EXPECT_EQ(map.getSize(), 10000);
+		for (uint64_t i = 0; i < 10000; i++)
+		{
+			ASSERT_NE(map.find(i * 31), nullptr);
+			ASSERT_EQ(*map.find(i * 31), i);
+		}
+		EXPECT_EQ(map.find(1), nullptr);
+	}
+
+	TEST(HashMap, Collisions)
+	{
+		MemoryArena arena(1024 * 1024);
+		ArenaHashMap<uint64_t, uint64_t, CollidingHash> map{ arena, 64 };
+
+		for (uint64_t i = 0; i < 40; i++)
+		{
+			map.insert(i, i * 2);
+		}
+		for (uint64_t i = 0; i < 40; i++)
+		{
+			ASSERT_NE(map.find(i), nullptr);
+			EXPECT_EQ(*map.find(i), i * 2);
+		}
+		EXPECT_EQ(map.find(40), nullptr);
+	}
+
+	struct ClusteringHash
+	{
+		uint64_t operator()(uint64_t key) const { return key << 12; }
+	};
+
+	TEST(HashMap, ProbeDistanceLimit)
+	{
+		// All keys start in the same slot until the table is big enough to split the cluster
+		MemoryArena arena(1024 * 1024 * 16);
+		ArenaHashMap<uint64_t, uint64_t, ClusteringHash> map{ arena };
+
+		for (uint64_t i = 0; i < 1000; i++)
+		{
+			map[i] = i * 3;
+		}
+		EXPECT_EQ(map.getSize(), 1000);
+		for (uint64_t i = 0; i < 1000; i++)
+		{
+			ASSERT_NE(map.find(i), nullptr);
+			EXPECT_EQ(*map.find(i), i * 3);
+		}
+		EXPECT_EQ(map.find(1000), nullptr);
+	}
+
+	TEST(HashMap, StringKeys)
+	{
+		MemoryArena arena(1024 * 1024);
+		ArenaHashMap<std::string_view, size_t> map{ arena };
+		const char* names[] = { "Idle", "Walk", "Run", "Shoot", "Reload" };
+		for (size_t i = 0; i < _countof(names); i++)
+		{
+			map.insert(names[i], i);
+		}
+
+		std::string run = "Run";
+		ASSERT_NE(map.find(run), nullptr);
+		EXPECT_EQ(*map.find(run), 2);
+		EXPECT_EQ(map.find("Jump"), nullptr);
+	}
+
+	TEST(HashMap, HashBytes)
+	{
+		uint8_t data[37];
+		for (size_t i = 0; i < sizeof(data); i++)
+		{
+			data[i] = static_cast<uint8_t>(i * 7);
+		}
+		uint8_t copy[sizeof(data)];
+		memcpy(copy, data, sizeof(data));
+
+		const uint64_t hash = HashBytes(data, sizeof(data));
+		EXPECT_EQ(HashBytes(copy, sizeof(copy)), hash);
+		EXPECT_NE(HashBytes(data, sizeof(data), 1), hash);
+
+		// Every bit counts, including the ones in the partial last word
+		for (size_t bit = 0; bit < sizeof(data) * 8; bit++)
+		{
+			copy[bit / 8] ^= 1 << (bit % 8);
+			EXPECT_NE(HashBytes(copy, sizeof(copy)), hash) << bit;
+			copy[bit / 8] ^= 1 << (bit % 8);
+		}
+
+		// Zero bytes at the end still change the length
+		uint8_t zeros[16] = {};
+		EXPECT_NE(HashBytes(zeros, 8), HashBytes(zeros, 9));
+		EXPECT_NE(HashBytes(zeros, 0), HashBytes(zeros, 16));
+	}
+
+	TEST(Name, Intern)
+	{
+		std::string runtimeString = "Kaiju";
+		runtimeString += "Root";
+
+		Name a = Name::Intern(runtimeString);
+		Name b = Name::Intern("KaijuRoot");
+		EXPECT_EQ(a, b);
+		EXPECT_EQ(a.c_str(), b.c_str());
+		EXPECT_NE(a.c_str(), runtimeString.c_str());
+		EXPECT_STREQ(a.c_str(), "KaijuRoot");
+		EXPECT_FALSE(a == Name::Intern("KaijuRoot2"));
+	}
+
+	TEST(Name, Literal)
+	{
+		constexpr Name literal = "Player";
+		static_assert(literal.id == HashName("Player"));
+		EXPECT_EQ(literal, Name::Intern(std::string{ "Play" } + "er"));
+		EXPECT_STREQ(literal.c_str(), "Player");
+
+		EXPECT_EQ(Name{}, Name::Intern(""));
+		EXPECT_EQ(std::format("{}", literal), "Player");
+	}
+
+	TEST(WorkerPool, ParallelFor)
+	{
+		for (size_t workerCount : { 0, 1, 3 })
+		{
+			WorkerPool pool{ workerCount };
+			EXPECT_EQ(pool.GetThreadCount(), workerCount + 1);
+
+			// Several loops in a row so workers have to pick up new work after finishing the last one
+			for (size_t count : { 0, 1, 7, 1000 })
+			{
+				std::vector<std::atomic<int>> calls(count);
+				pool.ParallelFor(count, [&](size_t i) { calls[i]++; });
+				for (size_t i = 0; i < count; i++)
+				{
+					EXPECT_EQ(calls[i], 1) << "index " << i << " with " << workerCount << " workers";
+				}
+			}
+		}
+	}
 }
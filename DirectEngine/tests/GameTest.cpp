@@ -2,6 +2,17 @@
 
 #include "../game/Entity.h"
 #include "../game/Game.h"
+#include "../core/GlbReader.h"
+#include "../core/MeshOptimizer.h"
+#include "../core/Meshlet.h"
+#include "../core/MeshoptDecoder.h"
+#include "../core/MeshSimplifier.h"
+
+#include <array>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <vector>
 
 TEST(Animation, Sample)
 {
@@ -21,6 +32,568 @@ TEST(Animation, Sample)
 	AssertVectorEqual(SampleAnimation(animData, 1.25f, XMVectorLerp), { 3.f, 3.f, 3.f, 3.f });
 }
 
+// SampleAnimation before it had a cursor
+static XMVECTOR SampleAnimationLinear(const AnimationData& animData, float animationTime, XMVECTOR(__vectorcall* interp)(XMVECTOR a, XMVECTOR b, float t))
+{
+	for (size_t i = 0; i < animData.frameCount; i++)
+	{
+		if (animData.times[i] > animationTime)
+		{
+			if (i == 0)
+			{
+				return animData.data[0];
+			}
+			float t = (animationTime - animData.times[i - 1]) / (animData.times[i] - animData.times[i - 1]);
+			return interp(animData.data[i - 1], animData.data[i], t);
+		}
+	}
+	return animData.data[animData.frameCount - 1];
+}
+
+TEST(Animation, SampleCursorMatchesLinearSearch)
+{
+	const size_t frameCount = 50;
+	std::vector<float> times(frameCount);
+	std::vector<XMVECTOR> data(frameCount);
+	float time = 0.f;
+	for (size_t i = 0; i < frameCount; i++)
+	{
+		times[i] = time;
+		time += 0.01f + 0.05f * static_cast<float>(i % 7);
+		data[i] = XMQuaternionRotationRollPitchYaw(0.1f * i, 0.05f * i, -0.2f * i);
+	}
+	AnimationData animData{};
+	animData.frameCount = frameCount;
+	animData.times = times.data();
+	animData.data = data.data();
+	const float duration = times.back();
+
+	// Playback at different rates with loops, backwards, random seeks, exact key times and times outside of the clip
+	std::vector<float> sampleTimes;
+	for (float step : { 1.f / 60.f, 1.f / 8.f, 0.7f })
+	{
+		for (float t = 0.f; t < duration * 3.f; t += step)
+		{
+			sampleTimes.push_back(fmodf(t, duration));
+		}
+	}
+	for (float t = duration; t > 0.f; t -= 0.03f)
+	{
+		sampleTimes.push_back(t);
+	}
+	uint32_t random = 4711;
+	for (size_t i = 0; i < 200; i++)
+	{
+		random = random * 1664525u + 1013904223u;
+		sampleTimes.push_back((random >> 8) / static_cast<float>(1 << 24) * duration * 1.2f - duration * 0.1f);
+	}
+	sampleTimes.insert(sampleTimes.end(), times.begin(), times.end());
+	sampleTimes.insert(sampleTimes.end(), { -1.f, duration, duration + 1.f, 0.f, times[10], times[11] });
+
+	for (float sampleTime : sampleTimes)
+	{
+		const XMVECTOR expectedLerp = SampleAnimationLinear(animData, sampleTime, &XMVectorLerp);
+		const XMVECTOR actualLerp = SampleAnimation(animData, sampleTime, &XMVectorLerp);
+		ASSERT_EQ(memcmp(&actualLerp, &expectedLerp, sizeof(XMVECTOR)), 0) << sampleTime;
+		const XMVECTOR expectedSlerp = SampleAnimationLinear(animData, sampleTime, &XMQuaternionSlerp);
+		const XMVECTOR actualSlerp = SampleAnimation(animData, sampleTime, &XMQuaternionSlerp);
+		ASSERT_EQ(memcmp(&actualSlerp, &expectedSlerp, sizeof(XMVECTOR)), 0) << sampleTime;
+		ASSERT_LE(animData.cursor, frameCount);
+	}
+}
+
+TEST(Animation, ResampleWithinTolerance)
+{
+	// Irregular keys along curves, with a channel starting late and one with a single key
+	const size_t frameCount = 40;
+	std::vector<float> times(frameCount);
+	std::vector<XMVECTOR> translations(frameCount);
+	std::vector<XMVECTOR> rotations(frameCount);
+	float time = 0.5f;
+	for (size_t i = 0; i < frameCount; i++)
+	{
+		times[i] = time;
+		translations[i] = XMVectorSet(sinf(time * 2.f), time * 0.5f, cosf(time) * 2.f, 0.f);
+		rotations[i] = XMQuaternionRotationRollPitchYaw(sinf(time), time * 0.7f, 0.f);
+		time += 0.02f + 0.04f * static_cast<float>(i % 5);
+	}
+	AnimationData translationKeys{ frameCount, times.data(), translations.data() };
+	AnimationData rotationKeys{ frameCount, times.data(), rotations.data() };
+	float singleTime = 1.f;
+	XMVECTOR singleValue = XMVectorSet(1.f, 2.f, 3.f, 0.f);
+	AnimationData singleKey{ 1, &singleTime, &singleValue };
+
+	MemoryArena arena{ 1024 * 1024 };
+	for (float tolerance : { 0.01f, 0.001f })
+	{
+		for (const auto& [keys, rotation] : { std::pair{ &translationKeys, false }, std::pair{ &rotationKeys, true }, std::pair{ &singleKey, false } })
+		{
+			AnimationData resampled{};
+			ASSERT_TRUE(ResampleAnimationData(*keys, rotation, 30.f, tolerance, resampled, arena)) << tolerance << " " << rotation;
+			EXPECT_EQ(resampled.times, nullptr);
+			EXPECT_GE(resampled.sampleRate, 30.f);
+			EXPECT_EQ(resampled.startTime, keys->times[0]);
+			EXPECT_LE(GetAnimationDataError(resampled, *keys, rotation), tolerance);
+
+			// Independent of where GetAnimationDataError looks, including times before and after the keys
+			const auto interp = rotation ? &XMQuaternionSlerp : &XMVectorLerp;
+			AnimationData original = *keys;
+			for (float sampleTime = 0.f; sampleTime < time + 1.f; sampleTime += 0.001f)
+			{
+				const XMVECTOR expected = SampleAnimation(original, sampleTime, interp);
+				XMVECTOR actual = SampleAnimation(resampled, sampleTime, interp);
+				if (rotation && XMVectorGetX(XMVector4Dot(expected, actual)) < 0.f)
+				{
+					actual = XMVectorNegate(actual);
+				}
+				ASSERT_TRUE(XMVector4NearEqual(actual, expected, XMVectorReplicate(tolerance * 1.01f))) << sampleTime;
+			}
+		}
+	}
+
+	// Keys exactly on the resampled frames come back unchanged
+	AnimationData resampledTranslations{};
+	ASSERT_TRUE(ResampleAnimationData(translationKeys, false, 30.f, 0.001f, resampledTranslations, arena));
+	AssertVectorEqual(SampleAnimation(resampledTranslations, times[0], &XMVectorLerp), translations[0]);
+	AssertVectorEqual(SampleAnimation(resampledTranslations, times.back(), &XMVectorLerp), translations.back());
+	AssertVectorEqual(SampleAnimation(resampledTranslations, -1.f, &XMVectorLerp), translations[0]);
+	AssertVectorEqual(SampleAnimation(resampledTranslations, time + 1.f, &XMVectorLerp), translations.back());
+
+	// A jump within a millisecond can't be resampled at any rate, the channel has to keep its keys
+	float stepTimes[] = { 0.f, 1.f, 1.001f, 2.f };
+	XMVECTOR stepValues[] = { XMVectorZero(), XMVectorZero(), XMVectorReplicate(1.f), XMVectorReplicate(1.f) };
+	AnimationData step{ _countof(stepTimes), stepTimes, stepValues };
+	AnimationData untouched{};
+	EXPECT_FALSE(ResampleAnimationData(step, false, 30.f, 0.001f, untouched, arena));
+	EXPECT_EQ(untouched.frameCount, 0);
+	EXPECT_EQ(untouched.data, nullptr);
+}
+
+TEST(Animation, CompressWithinTolerance)
+{
+	// Irregular keys along curves, a straight line, a constant rotation and one with a single key
+	const size_t frameCount = 200;
+	std::vector<float> times(frameCount);
+	std::vector<XMVECTOR> translations(frameCount);
+	std::vector<XMVECTOR> rotations(frameCount);
+	std::vector<XMVECTOR> line(frameCount);
+	std::vector<XMVECTOR> constant(frameCount);
+	float time = 0.5f;
+	for (size_t i = 0; i < frameCount; i++)
+	{
+		times[i] = time;
+		translations[i] = XMVectorSet(sinf(time * 2.f), time * 0.5f, cosf(time) * 2.f, 0.f);
+		rotations[i] = XMQuaternionRotationRollPitchYaw(sinf(time), time * 0.7f, -time * 0.3f);
+		line[i] = XMVectorSet(time * 3.f, -1.f, 2.f - time, 0.f);
+		constant[i] = XMQuaternionRotationRollPitchYaw(0.f, 3.f, 0.5f);
+		time += 0.01f + 0.02f * static_cast<float>(i % 5);
+	}
+	AnimationData translationKeys{ frameCount, times.data(), translations.data() };
+	AnimationData rotationKeys{ frameCount, times.data(), rotations.data() };
+	AnimationData lineKeys{ frameCount, times.data(), line.data() };
+	AnimationData constantKeys{ frameCount, times.data(), constant.data() };
+	float singleTime = 1.f;
+	XMVECTOR singleValue = XMVectorSet(1.f, 2.f, 3.f, 0.f);
+	AnimationData singleKey{ 1, &singleTime, &singleValue };
+
+	MemoryArena arena{ 1024 * 1024 };
+	for (float tolerance : { 0.01f, 0.001f })
+	{
+		for (const auto& [keys, rotation] : { std::pair{ &translationKeys, false }, std::pair{ &rotationKeys, true }, std::pair{ &lineKeys, false },
+			std::pair{ &constantKeys, true }, std::pair{ &singleKey, false } })
+		{
+			AnimationData compressed{};
+			ASSERT_TRUE(CompressAnimationData(*keys, rotation, tolerance, compressed, arena)) << tolerance << " " << rotation;
+			ASSERT_NE(compressed.compressed, nullptr);
+			EXPECT_EQ(compressed.data, nullptr);
+			EXPECT_EQ(compressed.compressed->rotation, rotation);
+			EXPECT_LE(compressed.frameCount, keys->frameCount);
+			EXPECT_EQ(compressed.times[0], keys->times[0]);
+			EXPECT_EQ(compressed.times[compressed.frameCount - 1], keys->times[keys->frameCount - 1]);
+
+			// Independent of where GetAnimationDataError looks, slerp between the kept keys only follows the removed ones up to rounding
+			const auto interp = rotation ? &XMQuaternionSlerp : &XMVectorLerp;
+			AnimationData original = *keys;
+			for (float sampleTime = 0.f; sampleTime < time + 1.f; sampleTime += 0.001f)
+			{
+				const XMVECTOR expected = SampleAnimation(original, sampleTime, interp);
+				XMVECTOR actual = SampleAnimation(compressed, sampleTime, interp);
+				if (rotation && XMVectorGetX(XMVector4Dot(expected, actual)) < 0.f)
+				{
+					actual = XMVectorNegate(actual);
+				}
+				ASSERT_TRUE(XMVector4NearEqual(actual, expected, XMVectorReplicate(tolerance * 1.01f))) << sampleTime;
+			}
+		}
+	}
+
+	// Straight lines and constant rotations only need their ends, curves still get far fewer keys than they had
+	AnimationData compressedLine{};
+	ASSERT_TRUE(CompressAnimationData(lineKeys, false, 0.001f, compressedLine, arena));
+	EXPECT_EQ(compressedLine.frameCount, 2);
+	AnimationData compressedConstant{};
+	ASSERT_TRUE(CompressAnimationData(constantKeys, true, 0.001f, compressedConstant, arena));
+	EXPECT_EQ(compressedConstant.frameCount, 2);
+	AnimationData compressedRotations{};
+	ASSERT_TRUE(CompressAnimationData(rotationKeys, true, 0.001f, compressedRotations, arena));
+	EXPECT_LT(compressedRotations.frameCount, frameCount / 2);
+
+	// Nothing can be stored within a tolerance below the quantization step
+	AnimationData untouched{};
+	EXPECT_FALSE(CompressAnimationData(translationKeys, false, 1e-7f, untouched, arena));
+	EXPECT_EQ(untouched.frameCount, 0);
+	EXPECT_EQ(untouched.compressed, nullptr);
+}
+
+// Entity::UpdateAnimation before poses, every animation decomposes the matrices the previous one left behind
+static void UpdatePoseDecompose(TransformHierachy& hierachy, float animationTime)
+{
+	for (size_t jointIdx = 0; jointIdx < hierachy.nodeCount; jointIdx++)
+	{
+		hierachy.nodes[jointIdx].currentLocal = hierachy.nodes[jointIdx].baseLocal;
+	}
+	for (size_t animIndex = 0; animIndex < hierachy.animationCount; animIndex++)
+	{
+		TransformAnimation& animation = hierachy.animations[animIndex];
+		for (size_t jointIdx = 0; animation.active && jointIdx < hierachy.nodeCount; jointIdx++)
+		{
+			if (animation.jointMask.Get(jointIdx))
+			{
+				TransformNode& node = hierachy.nodes[jointIdx];
+				XMVECTOR translation, rotation, scale;
+				XMMatrixDecompose(&scale, &rotation, &translation, node.currentLocal);
+				AnimationJointData& channels = animation.jointChannels[jointIdx];
+				if (channels.translations.frameCount > 0) translation = SampleAnimation(channels.translations, animationTime, &XMVectorLerp);
+				if (channels.rotations.frameCount > 0) rotation = SampleAnimation(channels.rotations, animationTime, &XMQuaternionSlerp);
+				if (channels.scales.frameCount > 0) scale = SampleAnimation(channels.scales, animationTime, &XMVectorLerp);
+				node.currentLocal = XMMatrixAffineTransformation(scale, XMVectorZero(), rotation, translation);
+			}
+		}
+	}
+}
+
+TEST(Animation, PoseMatchesDecompose)
+{
+	// A joint count that doesn't fill the last group, channels of every kind and two animations on top of each other
+	const size_t jointCount = 11;
+	MemoryArena arena{ 1024 * 1024 * 64 };
+	TransformHierachy& hierachy = *NewObject(arena, TransformHierachy, arena);
+	hierachy.nodeCount = jointCount;
+	for (size_t i = 0; i < jointCount; i++)
+	{
+		TransformNode& node = hierachy.nodes[i] = {};
+		const float f = static_cast<float>(i);
+		node.baseLocal = XMMatrixAffineTransformation(XMVectorSet(1.f + 0.1f * f, 1.f, 1.f - 0.05f * f, 0.f), XMVectorZero(),
+			XMQuaternionRotationRollPitchYaw(0.1f * f, -0.2f * f, 0.3f), XMVectorSet(f, 0.5f, -f, 0.f));
+		node.parent = i > 0 ? &hierachy.nodes[(i - 1) / 2] : nullptr;
+		if (node.parent != nullptr)
+		{
+			node.parent->children[node.parent->childCount++] = &node;
+		}
+	}
+	hierachy.root = &hierachy.nodes[0];
+	InitializeBasePose(hierachy);
+
+	const size_t frameCount = 30;
+	std::vector<float> times(frameCount);
+	std::vector<XMVECTOR> values(jointCount * 3 * frameCount);
+	for (size_t i = 0; i < frameCount; i++)
+	{
+		times[i] = 0.1f * i + 0.02f * (i % 3);
+	}
+	for (size_t animIndex = 0; animIndex < 2; animIndex++)
+	{
+		TransformAnimation& animation = hierachy.animations[animIndex] = {};
+		animation.active = true;
+		hierachy.animationCount++;
+		for (size_t jointIdx = 0; jointIdx < jointCount; jointIdx++)
+		{
+			// The second animation only has a rotation on a few joints, the first leaves out one joint and some channels
+			animation.jointMask.Set(jointIdx, animIndex == 0 ? jointIdx != 5 : jointIdx % 4 == 2);
+			if (!animation.jointMask.Get(jointIdx))
+			{
+				continue;
+			}
+			AnimationJointData& channels = animation.jointChannels[jointIdx];
+			XMVECTOR* translations = &values[(jointIdx * 3 + 0) * frameCount];
+			XMVECTOR* rotations = &values[(jointIdx * 3 + 1) * frameCount];
+			XMVECTOR* scales = &values[(jointIdx * 3 + 2) * frameCount];
+			for (size_t i = 0; i < frameCount; i++)
+			{
+				const float f = static_cast<float>(i + jointIdx + animIndex);
+				translations[i] = XMVectorSet(sinf(f * 0.3f), cosf(f * 0.2f), f * 0.1f, 0.f);
+				// Every third key on the other side of the sphere, sampling has to take the short way
+				rotations[i] = XMVectorScale(XMQuaternionRotationRollPitchYaw(f * 0.2f, sinf(f) * 0.5f, f * -0.1f), i % 3 == 0 ? -1.f : 1.f);
+				scales[i] = XMVectorSet(1.f + 0.2f * sinf(f), 1.f, 1.f + 0.1f * cosf(f), 0.f);
+			}
+			if (jointIdx % 2 == 0 || animIndex == 1)
+			{
+				channels.rotations = { frameCount, times.data(), rotations };
+			}
+			if (jointIdx % 3 == 0 && animIndex == 0)
+			{
+				channels.translations = { frameCount, times.data(), translations };
+			}
+			if (jointIdx % 3 == 1 && animIndex == 0)
+			{
+				AnimationData scaleKeys{ frameCount, times.data(), scales };
+				ASSERT_TRUE(ResampleAnimationData(scaleKeys, false, 30.f, 0.01f, channels.scales, arena));
+			}
+			if (jointIdx == 7 && animIndex == 0)
+			{
+				AnimationData rotationKeys{ frameCount, times.data(), rotations };
+				ASSERT_TRUE(CompressAnimationData(rotationKeys, true, 0.001f, channels.rotations, arena));
+			}
+		}
+	}
+
+	for (float time : { -1.f, 0.f, 0.05f, 0.5f, 1.234f, times.back(), 3.f, 0.75f })
+	{
+		UpdatePoseDecompose(hierachy, time);
+		std::vector<XMMATRIX> expected(jointCount);
+		for (size_t i = 0; i < jointCount; i++)
+		{
+			expected[i] = hierachy.nodes[i].currentLocal;
+		}
+
+		TransformAnimation* layers[] = { &hierachy.animations[0], &hierachy.animations[1] };
+		for (TransformAnimation* layer : layers)
+		{
+			layer->time = time;
+		}
+		AnimationPose pose = hierachy.basePose;
+		BlendAnimationLayers(layers, _countof(layers), hierachy.basePose, hierachy.nodeCount, pose);
+		BuildPoseMatrices(pose, hierachy);
+		for (size_t i = 0; i < jointCount; i++)
+		{
+			AssertMatrixEqual(hierachy.nodes[i].currentLocal, expected[i]);
+		}
+	}
+
+	// Without animations the pose is the base pose
+	hierachy.animations[0].active = false;
+	hierachy.animations[1].active = false;
+	BuildPoseMatrices(hierachy.basePose, hierachy);
+	for (size_t i = 0; i < jointCount; i++)
+	{
+		AssertMatrixEqual(hierachy.nodes[i].currentLocal, hierachy.nodes[i].baseLocal);
+	}
+}
+
+// BlendAnimationLayers one joint at a time, starting from the decomposed base transforms
+static void BlendLayersReference(TransformHierachy& hierachy, TransformAnimation* const* layers, size_t layerCount)
+{
+	for (size_t jointIdx = 0; jointIdx < hierachy.nodeCount; jointIdx++)
+	{
+		TransformNode& node = hierachy.nodes[jointIdx];
+		XMVECTOR baseTranslation, baseRotation, baseScale;
+		XMMatrixDecompose(&baseScale, &baseRotation, &baseTranslation, node.baseLocal);
+		XMVECTOR translation = baseTranslation, rotation = baseRotation, scale = baseScale;
+		for (size_t layerIndex = 0; layerIndex < layerCount; layerIndex++)
+		{
+			TransformAnimation& layer = *layers[layerIndex];
+			if (!layer.jointMask.Get(jointIdx))
+			{
+				continue;
+			}
+			AnimationJointData& channels = layer.jointChannels[jointIdx];
+			const float weight = layer.weight;
+			if (channels.translations.frameCount > 0)
+			{
+				const XMVECTOR sampled = SampleAnimation(channels.translations, layer.time, &XMVectorLerp);
+				translation = layer.blendMode == AnimationBlendMode::Additive ? XMVectorAdd(translation, XMVectorScale(XMVectorSubtract(sampled, baseTranslation), weight))
+					: XMVectorLerp(translation, sampled, std::min(weight, 1.f));
+			}
+			if (channels.rotations.frameCount > 0)
+			{
+				const XMVECTOR sampled = SampleAnimation(channels.rotations, layer.time, &XMQuaternionSlerp);
+				const XMVECTOR difference = XMQuaternionMultiply(sampled, XMQuaternionConjugate(baseRotation));
+				rotation = layer.blendMode == AnimationBlendMode::Additive ? XMQuaternionMultiply(XMQuaternionSlerp(XMQuaternionIdentity(), difference, weight), rotation)
+					: XMQuaternionSlerp(rotation, sampled, std::min(weight, 1.f));
+			}
+			if (channels.scales.frameCount > 0)
+			{
+				const XMVECTOR sampled = SampleAnimation(channels.scales, layer.time, &XMVectorLerp);
+				scale = layer.blendMode == AnimationBlendMode::Additive ? XMVectorMultiply(scale, XMVectorLerp(XMVectorReplicate(1.f), XMVectorDivide(sampled, baseScale), weight))
+					: XMVectorLerp(scale, sampled, std::min(weight, 1.f));
+			}
+		}
+		node.currentLocal = XMMatrixAffineTransformation(scale, XMVectorZero(), rotation, translation);
+	}
+}
+
+TEST(Animation, BlendLayers)
+{
+	// A full body layer, a partial override on some joints and an additive layer across group boundaries
+	const size_t jointCount = 10;
+	MemoryArena arena{ 1024 * 1024 * 64 };
+	TransformHierachy& hierachy = *NewObject(arena, TransformHierachy, arena);
+	hierachy.nodeCount = jointCount;
+	for (size_t i = 0; i < jointCount; i++)
+	{
+		TransformNode& node = hierachy.nodes[i] = {};
+		const float f = static_cast<float>(i);
+		node.baseLocal = XMMatrixAffineTransformation(XMVectorSet(1.f + 0.1f * f, 1.f, 1.f, 0.f), XMVectorZero(),
+			XMQuaternionRotationRollPitchYaw(0.2f * f, 0.1f, -0.1f * f), XMVectorSet(0.f, f, 1.f, 0.f));
+		node.parent = i > 0 ? &hierachy.nodes[i - 1] : nullptr;
+		if (node.parent != nullptr)
+		{
+			node.parent->children[node.parent->childCount++] = &node;
+		}
+	}
+	hierachy.root = &hierachy.nodes[0];
+	InitializeBasePose(hierachy);
+
+	float times[] = { 0.f, 0.5f, 1.f, 2.f };
+	const size_t frameCount = _countof(times);
+	std::vector<XMVECTOR> values(3 * jointCount * 3 * frameCount);
+	const AnimationBlendMode modes[] = { AnimationBlendMode::Override, AnimationBlendMode::Override, AnimationBlendMode::Additive };
+	const float weights[] = { 1.f, 0.3f, 0.7f };
+	TransformAnimation* layers[3];
+	for (size_t layerIndex = 0; layerIndex < 3; layerIndex++)
+	{
+		TransformAnimation& layer = hierachy.animations[layerIndex] = {};
+		layers[layerIndex] = &layer;
+		layer.blendMode = modes[layerIndex];
+		layer.weight = weights[layerIndex];
+		for (size_t jointIdx = 0; jointIdx < jointCount; jointIdx++)
+		{
+			// Joint 9 has channels in the first layer but is left out of its mask
+			const bool masked = layerIndex == 0 ? jointIdx != 9 : layerIndex == 1 ? jointIdx % 3 == 1 : jointIdx >= 3 && jointIdx <= 6;
+			layer.jointMask.Set(jointIdx, masked);
+			if (!masked && !(layerIndex == 0 && jointIdx == 9))
+			{
+				continue;
+			}
+			XMVECTOR* channelValues = &values[((layerIndex * jointCount + jointIdx) * 3) * frameCount];
+			for (size_t i = 0; i < frameCount; i++)
+			{
+				const float f = static_cast<float>(i + jointIdx) + static_cast<float>(layerIndex) * 0.5f;
+				channelValues[i] = XMVectorSet(sinf(f), f * 0.1f, cosf(f), 0.f);
+				channelValues[frameCount + i] = XMVectorScale(XMQuaternionRotationRollPitchYaw(0.3f * f, sinf(f), 0.1f), i == 2 ? -1.f : 1.f);
+				channelValues[2 * frameCount + i] = XMVectorSet(1.f + 0.1f * sinf(f), 1.f + 0.2f * cosf(f), 1.f, 0.f);
+			}
+			AnimationJointData& channels = layer.jointChannels[jointIdx];
+			channels.rotations = { frameCount, times, channelValues + frameCount };
+			if (jointIdx % 2 == 0)
+			{
+				channels.translations = { frameCount, times, channelValues };
+			}
+			if (jointIdx % 3 != 2)
+			{
+				channels.scales = { frameCount, times, channelValues + 2 * frameCount };
+			}
+		}
+	}
+
+	for (float time : { 0.f, 0.25f, 0.8f, 1.5f, 3.f })
+	{
+		for (TransformAnimation* layer : layers)
+		{
+			layer->time = time;
+		}
+		BlendLayersReference(hierachy, layers, _countof(layers));
+		std::vector<XMMATRIX> expected(jointCount);
+		for (size_t i = 0; i < jointCount; i++)
+		{
+			expected[i] = hierachy.nodes[i].currentLocal;
+		}
+
+		AnimationPose pose = hierachy.basePose;
+		BlendAnimationLayers(layers, _countof(layers), hierachy.basePose, hierachy.nodeCount, pose);
+		BuildPoseMatrices(pose, hierachy);
+		for (size_t i = 0; i < jointCount; i++)
+		{
+			AssertMatrixEqual(hierachy.nodes[i].currentLocal, expected[i]);
+		}
+		AssertMatrixEqual(hierachy.nodes[9].currentLocal, hierachy.nodes[9].baseLocal);
+	}
+
+	// An additive layer that plays the base pose changes nothing
+	TransformAnimation& still = hierachy.animations[3] = {};
+	still.blendMode = AnimationBlendMode::Additive;
+	XMVECTOR baseTranslation, baseRotation, baseScale;
+	XMMatrixDecompose(&baseScale, &baseRotation, &baseTranslation, hierachy.nodes[5].baseLocal);
+	still.jointMask.Set(5, true);
+	still.jointChannels[5].translations = { 1, times, &baseTranslation };
+	still.jointChannels[5].rotations = { 1, times, &baseRotation };
+	still.jointChannels[5].scales = { 1, times, &baseScale };
+	TransformAnimation* stillLayers[] = { layers[0], &still };
+	AnimationPose withoutStill = hierachy.basePose;
+	BlendAnimationLayers(layers, 1, hierachy.basePose, hierachy.nodeCount, withoutStill);
+	AnimationPose withStill = hierachy.basePose;
+	BlendAnimationLayers(stillLayers, _countof(stillLayers), hierachy.basePose, hierachy.nodeCount, withStill);
+	BuildPoseMatrices(withoutStill, hierachy);
+	const XMMATRIX expected = hierachy.nodes[5].currentLocal;
+	BuildPoseMatrices(withStill, hierachy);
+	AssertMatrixEqual(hierachy.nodes[5].currentLocal, expected);
+}
+
+TEST(Animation, ImportMask)
+{
+	// Joint indices differ from node indices, the armature node isn't a joint and the second animation is masked to the neck
+	const float identity[16] = { 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f };
+	const float times[2] = { 0.f, 1.f };
+	const float translations[6] = { 0.f, 0.f, 0.f, 1.f, 2.f, 3.f };
+	const float rotations[8] = { 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 1.f, 0.f };
+	std::vector<uint8_t> bin(128 + sizeof(times) + sizeof(translations) + sizeof(rotations));
+	memcpy(bin.data(), identity, sizeof(identity));
+	memcpy(bin.data() + 64, identity, sizeof(identity));
+	memcpy(bin.data() + 128, times, sizeof(times));
+	memcpy(bin.data() + 136, translations, sizeof(translations));
+	memcpy(bin.data() + 160, rotations, sizeof(rotations));
+
+	const char* json = R"json({
+		"asset": { "version": "2.0" },
+		"buffers": [{ "byteLength": 192 }],
+		"bufferViews": [
+			{ "buffer": 0, "byteOffset": 0, "byteLength": 128 },
+			{ "buffer": 0, "byteOffset": 128, "byteLength": 8 },
+			{ "buffer": 0, "byteOffset": 136, "byteLength": 24 },
+			{ "buffer": 0, "byteOffset": 160, "byteLength": 32 }],
+		"accessors": [
+			{ "bufferView": 0, "componentType": 5126, "count": 2, "type": "MAT4" },
+			{ "bufferView": 1, "componentType": 5126, "count": 2, "type": "SCALAR", "min": [0], "max": [1] },
+			{ "bufferView": 2, "componentType": 5126, "count": 2, "type": "VEC3" },
+			{ "bufferView": 3, "componentType": 5126, "count": 2, "type": "VEC4" }],
+		"nodes": [{ "name": "Armature", "children": [1] }, { "name": "hip", "children": [2] }, { "name": "neck" }],
+		"skins": [{ "inverseBindMatrices": 0, "joints": [1, 2] }],
+		"animations": [
+			{ "name": "Walk", "samplers": [{ "input": 1, "output": 2, "interpolation": "LINEAR" }, { "input": 1, "output": 3, "interpolation": "LINEAR" }],
+				"channels": [{ "sampler": 0, "target": { "node": 1, "path": "translation" } }, { "sampler": 1, "target": { "node": 2, "path": "rotation" } },
+					{ "sampler": 0, "target": { "node": 0, "path": "translation" } }] },
+			{ "name": "Look", "extras": { "mask": "neck" }, "samplers": [{ "input": 1, "output": 3, "interpolation": "LINEAR" }],
+				"channels": [{ "sampler": 0, "target": { "node": 1, "path": "rotation" } }, { "sampler": 0, "target": { "node": 2, "path": "rotation" } }] }]
+	})json";
+
+	MemoryArena arena{ 1024 * 1024 * 64 };
+	GltfResult* model = LoadGltfFromFile(WriteTestGlb("ImportMask.glb", json, bin).c_str(), arena, GetWorkerPool(), true, 0.f);
+	ASSERT_TRUE(model->success);
+	ASSERT_NE(model->transformHierachy, nullptr);
+	TransformHierachy& hierachy = *model->transformHierachy;
+	ASSERT_EQ(hierachy.nodeCount, 2);
+	EXPECT_EQ(hierachy.nodes[1].name, Name("neck"));
+	ASSERT_EQ(hierachy.animationCount, 2);
+
+	const TransformAnimation& walk = hierachy.animations[*hierachy.animationNameToIndex.find("Walk")];
+	EXPECT_TRUE(walk.jointMask.Get(0));
+	EXPECT_TRUE(walk.jointMask.Get(1));
+	EXPECT_FALSE(walk.jointMask.Get(2));
+	EXPECT_EQ(walk.jointChannels[0].translations.frameCount, 2);
+	EXPECT_EQ(walk.jointChannels[0].rotations.frameCount, 0);
+	EXPECT_EQ(walk.jointChannels[1].rotations.frameCount, 2);
+	EXPECT_EQ(walk.jointChannels[1].translations.frameCount, 0);
+	AnimationData walkTranslations = walk.jointChannels[0].translations;
+	AssertVectorEqual(SampleAnimation(walkTranslations, 1.f, &XMVectorLerp), XMVectorSet(1.f, 2.f, 3.f, 0.f));
+
+	// The hip channel is outside of the mask and doesn't get loaded
+	const TransformAnimation& look = hierachy.animations[*hierachy.animationNameToIndex.find("Look")];
+	EXPECT_FALSE(look.jointMask.Get(0));
+	EXPECT_TRUE(look.jointMask.Get(1));
+	EXPECT_EQ(look.jointChannels[0].rotations.frameCount, 0);
+	EXPECT_EQ(look.jointChannels[1].rotations.frameCount, 2);
+}
+
 TEST(Shadows, ShadowSpaceBasic)
 {
 	// directx coordinate system: +x is right, +y is up, +z is forward
@@ -54,4 +627,1919 @@ TEST(Shadows, ShadowSpaceTopDown)
 		{.0f,  1.002f,  .5f,   1.0f}
 	};
 	AssertMatrixEqual(result, expected);
-}
\ No newline at end of file
+}
+
+TEST(Physics, RestoreSnapshotTakesBackAllocations)
+{
+	MemoryArena levelArena{ 1024 * 1024 * 64 };
+	MemoryArena physicsArena{ 1024 * 1024 * 64 };
+	MemoryArena storage{ 1024 * 1024 * 64 };
+	SetPhysicsAllocationArena(&physicsArena);
+
+	// Same setup as Game::LoadLevel, the objects live in the level arena and Bullet's own allocations in the physics arena
+	btDefaultCollisionConfiguration* collisionConfiguration = NewObject(levelArena, btDefaultCollisionConfiguration);
+	btCollisionDispatcher* dispatcher = NewObject(levelArena, btCollisionDispatcher, collisionConfiguration);
+	btDbvtBroadphase* broadphase = NewObject(levelArena, btDbvtBroadphase);
+	btSequentialImpulseConstraintSolver* solver = NewObject(levelArena, btSequentialImpulseConstraintSolver);
+	btDiscreteDynamicsWorld* dynamicsWorld = NewObject(levelArena, btDiscreteDynamicsWorld, dispatcher, broadphase, solver, collisionConfiguration);
+	dynamicsWorld->setGravity(btVector3(0.f, -10.f, 0.f));
+
+	btBoxShape* groundShape = NewObject(levelArena, btBoxShape, btVector3{ 50.f, 1.f, 50.f });
+	btRigidBody::btRigidBodyConstructionInfo groundInfo{ 0.f, nullptr, groundShape };
+	groundInfo.m_startWorldTransform.setOrigin(btVector3(0.f, -1.f, 0.f));
+	dynamicsWorld->addRigidBody(NewObject(levelArena, btRigidBody, groundInfo));
+
+	// A stack of boxes that fall onto each other, which grows the pair cache, the manifolds and the solver arrays
+	btBoxShape* boxShape = NewObject(levelArena, btBoxShape, btVector3{ .5f, .5f, .5f });
+	btVector3 boxInertia{};
+	boxShape->calculateLocalInertia(1.f, boxInertia);
+	btRigidBody* topBox = nullptr;
+	for (int i = 0; i < 16; i++)
+	{
+		btRigidBody::btRigidBodyConstructionInfo boxInfo{ 1.f, nullptr, boxShape, boxInertia };
+		boxInfo.m_startWorldTransform.setOrigin(btVector3(i % 4 * .8f, 1.f + i * 1.1f, i / 4 * .8f));
+		topBox = NewObject(levelArena, btRigidBody, boxInfo);
+		dynamicsWorld->addRigidBody(topBox);
+	}
+
+	ArenaSnapshot levelSnapshot{};
+	ArenaSnapshot physicsSnapshot{};
+	levelArena.TakeSnapshot(levelSnapshot, storage);
+	physicsArena.TakeSnapshot(physicsSnapshot, storage);
+	const float startHeight = topBox->getWorldTransform().getOrigin().getY();
+
+	size_t heapAllocations = 0;
+	for (int restore = 0; restore < 10; restore++)
+	{
+		for (int step = 0; step < 120; step++)
+		{
+			dynamicsWorld->stepSimulation(1.f / 60.f, 0);
+		}
+		EXPECT_GT(dispatcher->getNumManifolds(), 0);
+		EXPECT_LT(topBox->getWorldTransform().getOrigin().getY(), startHeight);
+		EXPECT_GT(physicsArena.used, physicsSnapshot.used);
+
+		levelArena.RestoreSnapshot(levelSnapshot);
+		physicsArena.RestoreSnapshot(physicsSnapshot);
+		EXPECT_EQ(physicsArena.used, physicsSnapshot.used);
+		EXPECT_EQ(levelArena.used, levelSnapshot.used);
+		EXPECT_EQ(dispatcher->getNumManifolds(), 0);
+		EXPECT_EQ(topBox->getWorldTransform().getOrigin().getY(), startHeight);
+
+		// Bullet's profiler creates its nodes on the heap during the first steps
+		if (restore == 0) heapAllocations = GetHeapAllocationCount();
+	}
+	EXPECT_EQ(GetHeapAllocationCount(), heapAllocations);
+
+	SetPhysicsAllocationArena(nullptr);
+}
+
+TEST(Physics, SteadyStateReusesFreedAllocations)
+{
+	MemoryArena levelArena{ 1024 * 1024 * 64 };
+	MemoryArena physicsArena{ 1024 * 1024 * 64 };
+	SetPhysicsAllocationArena(&physicsArena);
+
+	btDefaultCollisionConfiguration* collisionConfiguration = NewObject(levelArena, btDefaultCollisionConfiguration);
+	btCollisionDispatcher* dispatcher = NewObject(levelArena, btCollisionDispatcher, collisionConfiguration);
+	btDbvtBroadphase* broadphase = NewObject(levelArena, btDbvtBroadphase);
+	btSequentialImpulseConstraintSolver* solver = NewObject(levelArena, btSequentialImpulseConstraintSolver);
+	btDiscreteDynamicsWorld* dynamicsWorld = NewObject(levelArena, btDiscreteDynamicsWorld, dispatcher, broadphase, solver, collisionConfiguration);
+	dynamicsWorld->setGravity(btVector3(0.f, -10.f, 0.f));
+
+	btBoxShape* groundShape = NewObject(levelArena, btBoxShape, btVector3{ 50.f, 1.f, 50.f });
+	btRigidBody::btRigidBodyConstructionInfo groundInfo{ 0.f, nullptr, groundShape };
+	groundInfo.m_startWorldTransform.setOrigin(btVector3(0.f, -1.f, 0.f));
+	dynamicsWorld->addRigidBody(NewObject(levelArena, btRigidBody, groundInfo));
+
+	// Boxes far enough apart to only touch the ground, so every drop plays out the same
+	btBoxShape* boxShape = NewObject(levelArena, btBoxShape, btVector3{ .5f, .5f, .5f });
+	btVector3 boxInertia{};
+	boxShape->calculateLocalInertia(1.f, boxInertia);
+	btRigidBody* boxes[16]{};
+	btTransform startTransforms[16]{};
+	for (size_t i = 0; i < _countof(boxes); i++)
+	{
+		btRigidBody::btRigidBodyConstructionInfo boxInfo{ 1.f, nullptr, boxShape, boxInertia };
+		boxInfo.m_startWorldTransform.setOrigin(btVector3(i % 4 * 3.f, 3.f, i / 4 * 3.f));
+		startTransforms[i] = boxInfo.m_startWorldTransform;
+		boxes[i] = NewObject(levelArena, btRigidBody, boxInfo);
+		dynamicsWorld->addRigidBody(boxes[i]);
+	}
+
+	// Each drop wakes the boxes, moves their proxies into the dynamic tree, breaks and makes contacts and ends with them asleep
+	auto dropBoxes = [&]()
+	{
+		for (size_t i = 0; i < _countof(boxes); i++)
+		{
+			boxes[i]->setWorldTransform(startTransforms[i]);
+			boxes[i]->setInterpolationWorldTransform(startTransforms[i]);
+			boxes[i]->setLinearVelocity(btVector3(0.f, 0.f, 0.f));
+			boxes[i]->setAngularVelocity(btVector3(0.f, 0.f, 0.f));
+			boxes[i]->activate(true);
+		}
+		for (int step = 0; step < 360; step++)
+		{
+			dynamicsWorld->stepSimulation(1.f / 60.f, 0);
+		}
+		EXPECT_GT(dispatcher->getNumManifolds(), 0);
+		EXPECT_FALSE(boxes[0]->isActive());
+	};
+
+	// The first drops grow Bullet's arrays to their peak size, after that everything freed gets reused
+	for (int drop = 0; drop < 3; drop++)
+	{
+		dropBoxes();
+	}
+	const size_t warmUsed = physicsArena.used;
+	for (int drop = 0; drop < 20; drop++)
+	{
+		dropBoxes();
+		EXPECT_EQ(physicsArena.used, warmUsed);
+	}
+
+	SetPhysicsAllocationArena(nullptr);
+}
+
+// Grid of gridSize x gridSize quads in the xz plane with the triangles in random order, like a worst case exporter
+static MeshData CreateShuffledGrid(size_t gridSize, MemoryArena& arena)
+{
+	const size_t rowVertices = gridSize + 1;
+	MeshData mesh{};
+	mesh.vertexCount = rowVertices * rowVertices;
+	mesh.vertices = NewArray(arena, Vertex, mesh.vertexCount);
+	for (size_t z = 0; z < rowVertices; z++)
+	{
+		for (size_t x = 0; x < rowVertices; x++)
+		{
+			Vertex& vertex = mesh.vertices[z * rowVertices + x];
+			vertex.position = { static_cast<float>(x), 0.f, static_cast<float>(z) };
+			vertex.normal = { 0.f, 1.f, 0.f };
+		}
+	}
+
+	mesh.indexCount = gridSize * gridSize * 6;
+	mesh.indices = NewArray(arena, INDEX_BUFFER_TYPE, mesh.indexCount);
+	size_t index = 0;
+	for (size_t z = 0; z < gridSize; z++)
+	{
+		for (size_t x = 0; x < gridSize; x++)
+		{
+			INDEX_BUFFER_TYPE corner = static_cast<INDEX_BUFFER_TYPE>(z * rowVertices + x);
+			INDEX_BUFFER_TYPE triangles[] = { corner, corner + rowVertices, corner + 1, corner + 1, corner + rowVertices, corner + rowVertices + 1 };
+			memcpy(mesh.indices + index, triangles, sizeof(triangles));
+			index += 6;
+		}
+	}
+
+	uint32_t random = 12345;
+	for (size_t triangle = mesh.indexCount / 3 - 1; triangle > 0; triangle--)
+	{
+		random = random * 1664525u + 1013904223u;
+		size_t other = random % (triangle + 1);
+		std::swap_ranges(mesh.indices + triangle * 3, mesh.indices + triangle * 3 + 3, mesh.indices + other * 3);
+	}
+	return mesh;
+}
+
+TEST(Mesh, CookedRoundTrip)
+{
+	MemoryArena arena{ 1024 * 1024 * 64 };
+	GltfResult* model = NewObject(arena, GltfResult, arena);
+	model->success = true;
+	MeshFile& quad = model->meshes.newElement();
+	quad.mesh = CreateQuad(2.f, 3.f, arena);
+	quad.mesh.meshlets = NewArray(arena, Meshlet, GetMaxMeshletCount(quad.mesh.indexCount));
+	quad.mesh.meshletCount = BuildMeshlets(quad.mesh, quad.mesh.meshlets, arena);
+	quad.materialName = "quad";
+	MeshFile& quadY = model->meshes.newElement();
+	quadY.mesh = CreateQuadY(1.f, 1.f, arena);
+	quadY.materialName = Name::Intern("quadY");
+	MeshFile& grid = model->meshes.newElement();
+	grid.mesh = CreateShuffledGrid(8, arena);
+	GenerateLods(grid.mesh, NewArray(arena, INDEX_BUFFER_TYPE, GetMaxLodIndexCount(grid.mesh.indexCount)), arena);
+	grid.materialName = "grid";
+
+	TransformHierachy* hierachy = model->transformHierachy = NewObject(arena, TransformHierachy, arena);
+	hierachy->nodeCount = 2;
+	hierachy->nodes[0] = {};
+	hierachy->nodes[0].inverseBind = XMMatrixIdentity();
+	hierachy->nodes[0].baseLocal = XMMatrixTranslation(1.f, 0.f, 0.f);
+	hierachy->nodes[0].childCount = 1;
+	hierachy->nodes[0].children[0] = &hierachy->nodes[1];
+	hierachy->nodes[0].name = "root";
+	hierachy->nodes[1] = {};
+	hierachy->nodes[1].inverseBind = XMMatrixScaling(2.f, 2.f, 2.f);
+	hierachy->nodes[1].baseLocal = XMMatrixTranslation(0.f, 1.f, 0.f);
+	hierachy->nodes[1].parent = &hierachy->nodes[0];
+	hierachy->nodes[1].name = "child";
+	hierachy->root = &hierachy->nodes[0];
+	hierachy->jointToNodeIndex[0] = 3;
+	hierachy->jointToNodeIndex[1] = 5;
+	hierachy->nodeToJointIndex[3] = 0;
+	hierachy->nodeToJointIndex[5] = 1;
+
+	float times[] = { 0.f, 0.5f, 1.f };
+	XMVECTOR rotations[] = { XMQuaternionIdentity(), XMQuaternionRotationRollPitchYaw(0.f, 1.f, 0.f), XMQuaternionRotationRollPitchYaw(0.f, 2.f, 0.f) };
+	TransformAnimation& animation = hierachy->animations[0] = {};
+	animation.name = "wave";
+	animation.duration = 1.f;
+	animation.onlyInMainCamera = true;
+	animation.jointMask.Set(5, true);
+	animation.jointChannels[1].rotations = { _countof(times), times, rotations };
+	XMVECTOR translations[] = { XMVectorSet(0.f, 0.f, 0.f, 0.f), XMVectorSet(1.f, 2.f, 3.f, 0.f) };
+	animation.jointChannels[0].translations = { _countof(translations), nullptr, translations, 0, 4.f, 0.25f };
+	AnimationData rotationKeys{ _countof(times), times, rotations };
+	ASSERT_TRUE(CompressAnimationData(rotationKeys, true, 0.001f, animation.jointChannels[0].rotations, arena));
+	hierachy->animationCount = 1;
+
+	const std::string path = (std::filesystem::temp_directory_path() / "CookedRoundTrip" COOKED_MESH_EXTENSION).string();
+	ASSERT_TRUE(WriteCookedMesh(*model, path.c_str()));
+	GltfResult* cooked = LoadCookedMesh(path.c_str(), arena);
+	ASSERT_NE(cooked, nullptr);
+	EXPECT_TRUE(cooked->success);
+
+	ASSERT_EQ(cooked->meshes.size, model->meshes.size);
+	for (size_t i = 0; i < model->meshes.size; i++)
+	{
+		const MeshData& expected = model->meshes[i].mesh;
+		const MeshData& actual = cooked->meshes[i].mesh;
+		ASSERT_EQ(actual.vertexCount, expected.vertexCount);
+		ASSERT_EQ(actual.indexCount, expected.indexCount);
+		EXPECT_EQ(actual.vertices, nullptr);
+		ASSERT_NE(actual.packedVertices, nullptr);
+		std::vector<PackedVertex> expectedPacked(expected.vertexCount);
+		PackVertices(expected.vertices, expectedPacked.data(), expected.vertexCount);
+		EXPECT_EQ(memcmp(actual.packedVertices, expectedPacked.data(), sizeof(PackedVertex) * expected.vertexCount), 0);
+		EXPECT_EQ(memcmp(actual.indices, expected.indices, sizeof(INDEX_BUFFER_TYPE) * expected.indexCount), 0);
+		ASSERT_EQ(actual.meshletCount, expected.meshletCount);
+		EXPECT_EQ(memcmp(actual.meshlets, expected.meshlets, sizeof(Meshlet) * expected.meshletCount), 0);
+		ASSERT_EQ(actual.lodCount, expected.lodCount);
+		for (size_t level = 0; level < expected.lodCount; level++)
+		{
+			ASSERT_EQ(actual.lods[level].indexCount, expected.lods[level].indexCount);
+			EXPECT_EQ(memcmp(actual.lods[level].indices, expected.lods[level].indices, sizeof(INDEX_BUFFER_TYPE) * expected.lods[level].indexCount), 0);
+			EXPECT_EQ(actual.lods[level].error, expected.lods[level].error);
+		}
+		EXPECT_EQ(reinterpret_cast<uintptr_t>(actual.packedVertices) % COOKED_MESH_ALIGNMENT, 0);
+		EXPECT_EQ(cooked->meshes[i].materialName, model->meshes[i].materialName);
+	}
+
+	TransformHierachy* cookedHierachy = cooked->transformHierachy;
+	ASSERT_NE(cookedHierachy, nullptr);
+	ASSERT_EQ(cookedHierachy->nodeCount, 2);
+	EXPECT_EQ(cookedHierachy->root, &cookedHierachy->nodes[0]);
+	EXPECT_EQ(cookedHierachy->nodes[0].parent, nullptr);
+	EXPECT_EQ(cookedHierachy->nodes[1].parent, &cookedHierachy->nodes[0]);
+	ASSERT_EQ(cookedHierachy->nodes[0].childCount, 1);
+	EXPECT_EQ(cookedHierachy->nodes[0].children[0], &cookedHierachy->nodes[1]);
+	EXPECT_EQ(cookedHierachy->nodes[1].name, Name("child"));
+	AssertMatrixEqual(cookedHierachy->nodes[1].inverseBind, XMMatrixScaling(2.f, 2.f, 2.f));
+	AssertMatrixEqual(cookedHierachy->nodes[1].global, XMMatrixTranslation(1.f, 1.f, 0.f));
+	EXPECT_EQ(cookedHierachy->jointToNodeIndex[1], 5);
+	EXPECT_EQ(cookedHierachy->nodeToJointIndex[3], 0);
+
+	ASSERT_EQ(cookedHierachy->animationCount, 1);
+	const size_t* animationIndex = cookedHierachy->animationNameToIndex.find("wave");
+	ASSERT_NE(animationIndex, nullptr);
+	const TransformAnimation& cookedAnimation = cookedHierachy->animations[*animationIndex];
+	EXPECT_FLOAT_EQ(cookedAnimation.duration, 1.f);
+	EXPECT_TRUE(cookedAnimation.onlyInMainCamera);
+	EXPECT_TRUE(cookedAnimation.jointMask.Get(5));
+	EXPECT_FALSE(cookedAnimation.jointMask.Get(3));
+	EXPECT_EQ(cookedAnimation.jointChannels[1].translations.frameCount, 0);
+	EXPECT_EQ(cookedAnimation.jointChannels[1].rotations.compressed, nullptr);
+	const AnimationData& cookedTranslations = cookedAnimation.jointChannels[0].translations;
+	ASSERT_EQ(cookedTranslations.frameCount, _countof(translations));
+	EXPECT_EQ(cookedTranslations.times, nullptr);
+	EXPECT_EQ(cookedTranslations.sampleRate, 4.f);
+	EXPECT_EQ(cookedTranslations.startTime, 0.25f);
+	AssertVectorEqual(cookedTranslations.data[1], translations[1]);
+	const AnimationData& cookedRotations = cookedAnimation.jointChannels[1].rotations;
+	ASSERT_EQ(cookedRotations.frameCount, _countof(times));
+	for (size_t i = 0; i < _countof(times); i++)
+	{
+		EXPECT_FLOAT_EQ(cookedRotations.times[i], times[i]);
+		AssertVectorEqual(cookedRotations.data[i], rotations[i]);
+	}
+	const AnimationData& compressed = animation.jointChannels[0].rotations;
+	AnimationData cookedCompressed = cookedAnimation.jointChannels[0].rotations;
+	ASSERT_EQ(cookedCompressed.frameCount, compressed.frameCount);
+	EXPECT_EQ(cookedCompressed.data, nullptr);
+	ASSERT_NE(cookedCompressed.compressed, nullptr);
+	EXPECT_TRUE(cookedCompressed.compressed->rotation);
+	EXPECT_EQ(memcmp(cookedCompressed.compressed->keys, compressed.compressed->keys, sizeof(XMUSHORTN4) * compressed.frameCount), 0);
+	EXPECT_EQ(memcmp(&cookedCompressed.compressed->rangeExtent, &compressed.compressed->rangeExtent, sizeof(XMFLOAT4)), 0);
+	EXPECT_EQ(GetAnimationDataError(cookedCompressed, compressed, true), 0.f);
+}
+
+// Copies a cooked file with a modification applied, the copy gets its own name since mappings are cached by path
+static std::string WriteModifiedCookedMesh(const std::string& path, const char* name, const std::function<void(std::vector<uint8_t>&)>& modify)
+{
+	std::vector<uint8_t> bytes(std::filesystem::file_size(path));
+	FILE* file = fopen(path.c_str(), "rb");
+	fread(bytes.data(), 1, bytes.size(), file);
+	fclose(file);
+
+	modify(bytes);
+
+	const std::string modifiedPath = (std::filesystem::temp_directory_path() / name).string();
+	file = fopen(modifiedPath.c_str(), "wb");
+	fwrite(bytes.data(), 1, bytes.size(), file);
+	fclose(file);
+	return modifiedPath;
+}
+
+TEST(Mesh, CookedRejectsCorruptFiles)
+{
+	MemoryArena arena{ 1024 * 1024 * 16 };
+	GltfResult* model = NewObject(arena, GltfResult, arena);
+	model->success = true;
+	MeshFile& grid = model->meshes.newElement();
+	grid.mesh = CreateShuffledGrid(8, arena);
+	grid.materialName = "grid";
+
+	const std::string path = (std::filesystem::temp_directory_path() / "CookedCorrupt" COOKED_MESH_EXTENSION).string();
+	ASSERT_TRUE(WriteCookedMesh(*model, path.c_str()));
+	ASSERT_NE(LoadCookedMesh(path.c_str(), arena), nullptr);
+
+	// Cut off the end, with the header claiming the shorter size so only the ranges give it away
+	const std::string truncated = WriteModifiedCookedMesh(path, "CookedTruncated" COOKED_MESH_EXTENSION, [](std::vector<uint8_t>& bytes)
+	{
+		bytes.resize(bytes.size() - 64);
+		reinterpret_cast<CookedMeshHeader*>(bytes.data())->fileSize = bytes.size();
+	});
+	EXPECT_EQ(LoadCookedMesh(truncated.c_str(), arena), nullptr);
+
+	const std::string badCount = WriteModifiedCookedMesh(path, "CookedBadCount" COOKED_MESH_EXTENSION, [](std::vector<uint8_t>& bytes)
+	{
+		const CookedMeshHeader* header = reinterpret_cast<const CookedMeshHeader*>(bytes.data());
+		reinterpret_cast<CookedMeshEntry*>(bytes.data() + header->meshesOffset)->vertexCount = ~0ull / 2;
+	});
+	EXPECT_EQ(LoadCookedMesh(badCount.c_str(), arena), nullptr);
+
+	const std::string misaligned = WriteModifiedCookedMesh(path, "CookedMisaligned" COOKED_MESH_EXTENSION, [](std::vector<uint8_t>& bytes)
+	{
+		const CookedMeshHeader* header = reinterpret_cast<const CookedMeshHeader*>(bytes.data());
+		reinterpret_cast<CookedMeshEntry*>(bytes.data() + header->meshesOffset)->verticesOffset += 2;
+	});
+	EXPECT_EQ(LoadCookedMesh(misaligned.c_str(), arena), nullptr);
+
+	const std::string badString = WriteModifiedCookedMesh(path, "CookedBadString" COOKED_MESH_EXTENSION, [](std::vector<uint8_t>& bytes)
+	{
+		const CookedMeshHeader* header = reinterpret_cast<const CookedMeshHeader*>(bytes.data());
+		reinterpret_cast<CookedMeshEntry*>(bytes.data() + header->meshesOffset)->materialName.length = bytes.size();
+	});
+	EXPECT_EQ(LoadCookedMesh(badString.c_str(), arena), nullptr);
+}
+
+TEST(Mesh, CookedRewriteAfterRelease)
+{
+	MemoryArena arena{ 1024 * 1024 * 16 };
+	auto writeGrid = [&](size_t size, const char* path)
+	{
+		GltfResult* model = NewObject(arena, GltfResult, arena);
+		model->success = true;
+		MeshFile& grid = model->meshes.newElement();
+		grid.mesh = CreateShuffledGrid(size, arena);
+		grid.materialName = "grid";
+		EXPECT_TRUE(WriteCookedMesh(*model, path));
+		return grid.mesh.vertexCount;
+	};
+
+	const std::string path = (std::filesystem::temp_directory_path() / "CookedRewrite" COOKED_MESH_EXTENSION).string();
+	const size_t smallCount = writeGrid(4, path.c_str());
+	GltfResult* small = LoadCookedMesh(path.c_str(), arena);
+	ASSERT_NE(small, nullptr);
+	EXPECT_EQ(small->meshes[0].mesh.vertexCount, smallCount);
+
+	// A mapped file can't be truncated on Windows, MeshCook only succeeds once the level let go of it
+	ReleaseCookedMeshes();
+	const size_t largeCount = writeGrid(8, path.c_str());
+	ASSERT_NE(smallCount, largeCount);
+	GltfResult* large = LoadCookedMesh(path.c_str(), arena);
+	ASSERT_NE(large, nullptr);
+	EXPECT_EQ(large->meshes[0].mesh.vertexCount, largeCount);
+}
+
+TEST(Mesh, LevelLoadWithoutHeapAllocations)
+{
+	const char* path = "models/level1.glb";
+	if (!std::filesystem::exists(path) || !std::filesystem::exists("materials.txt"))
+	{
+		GTEST_SKIP() << "Models not found, run this from the build directory";
+	}
+
+	// Loads through the parser and the cooked file, LoadModel picks whichever is current
+	MemoryArena arena{ 1024 * 1024 * 256 };
+	const std::string cookedPath = (std::filesystem::temp_directory_path() / "LevelLoad" COOKED_MESH_EXTENSION).string();
+	ASSERT_TRUE(WriteCookedMesh(*LoadGltfFromFile(path, arena), cookedPath.c_str()));
+
+	auto loadLevel = [&]()
+	{
+		arena.Reset();
+		ArenaArray<MaterialFile> materials{ arena, MAX_MATERIALS };
+		ArenaArray<TextureFile> textures{ arena, MAX_TEXTURES };
+		ArenaArray<StandaloneShaderFile> standaloneShaders{ arena, 64 };
+		LoadMaterials("materials.txt", materials, textures, standaloneShaders);
+		EXPECT_GT(materials.size, 0);
+		EXPECT_TRUE(LoadGltfFromFile(path, arena)->success);
+		EXPECT_TRUE(LoadModel(path, arena)->success);
+		EXPECT_NE(LoadCookedMesh(cookedPath.c_str(), arena), nullptr);
+	};
+
+	// The first load interns names, starts the workers and maps the cooked file
+	loadLevel();
+	const size_t heapAllocations = GetHeapAllocationCount();
+	loadLevel();
+	EXPECT_EQ(GetHeapAllocationCount(), heapAllocations);
+}
+
+// Writes a .glb with the given JSON and BIN chunks, both get padded to 4 bytes like the spec wants
+static std::string WriteTestGlb(const char* name, std::string json, const std::vector<uint8_t>& bin)
+{
+	json.resize(Align(json.size(), 4), ' ');
+	const uint32_t binLength = static_cast<uint32_t>(Align(bin.size(), 4));
+	const uint32_t jsonHeader[2] = { static_cast<uint32_t>(json.size()), GLB_CHUNK_JSON };
+	const uint32_t binHeader[2] = { binLength, GLB_CHUNK_BIN };
+	const uint32_t header[3] = { GLB_MAGIC, GLB_VERSION, static_cast<uint32_t>(sizeof(header) + 8 + json.size() + 8 + binLength) };
+
+	const std::string path = (std::filesystem::temp_directory_path() / name).string();
+	FILE* file = fopen(path.c_str(), "wb");
+	fwrite(header, sizeof(header), 1, file);
+	fwrite(jsonHeader, sizeof(jsonHeader), 1, file);
+	fwrite(json.data(), json.size(), 1, file);
+	fwrite(binHeader, sizeof(binHeader), 1, file);
+	std::vector<uint8_t> paddedBin = bin;
+	paddedBin.resize(binLength);
+	fwrite(paddedBin.data(), paddedBin.size(), 1, file);
+	fclose(file);
+	return path;
+}
+
+TEST(Mesh, GlbReader)
+{
+	const float positions[12] = { 0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f, 8.f, 9.f, 10.f, 11.f };
+	std::vector<uint8_t> bin(sizeof(positions));
+	memcpy(bin.data(), positions, sizeof(positions));
+
+	// Fields the reader doesn't know have to be skipped whatever their type, strings with escapes get decoded
+	const char* json = R"json({
+		"asset": { "version": "2.0", "extras": [1, { "a": null }, true, -2.5e-3] },
+		"buffers": [{ "byteLength": 48 }],
+		"bufferViews": [{ "buffer": 0, "byteOffset": 0, "byteLength": 48, "target": 34962 }],
+		"accessors": [{ "bufferView": 0, "componentType": 5126, "count": COUNT, "type": "VEC3", "max": [9, 10, 11], "min": [0, 1, 2] }],
+		"materials": [{ "name": "Caf\u00e9 \"quoted\" \ud83d\ude00", "doubleSided": false }],
+		"meshes": [{ "name": "mesh", "primitives": [{ "attributes": { "COLOR_0": 0, "POSITION": 0 }, "material": 0, "mode": 4 }] }],
+		"nodes": [{ "name": "root", "children": [1], "translation": [1, 2, 3] }, { "name": "child", "rotation": [0, 0, 0.5, 0.5] }],
+		"animations": [{ "name": "Idle", "extras": { "mask": "child", "mainrender": 1 }, "channels": [], "samplers": [] }]
+	})json";
+	auto withCount = [&](const char* count)
+	{
+		std::string result = json;
+		result.replace(result.find("COUNT"), 5, count);
+		return result;
+	};
+
+	MemoryArena arena{ 1024 * 1024 };
+	{
+		GlbFile file;
+		ASSERT_TRUE(ReadGlbFile(WriteTestGlb("GlbReader.glb", withCount("4"), bin).c_str(), file, arena));
+
+		ASSERT_EQ(file.accessorCount, 1);
+		const GltfAccessor& accessor = file.accessors[0];
+		ASSERT_EQ(accessor.count, 4);
+		ASSERT_EQ(accessor.componentType, GLTF_FLOAT);
+		ASSERT_EQ(accessor.componentCount, 3);
+		ASSERT_EQ(accessor.byteStride, 12);
+		ASSERT_EQ(memcmp(GetAccessorData<float>(accessor), positions, sizeof(positions)), 0);
+
+		ASSERT_EQ(file.materialCount, 1);
+		ASSERT_EQ(file.materialNames[0], "Caf\xc3\xa9 \"quoted\" \xf0\x9f\x98\x80");
+
+		ASSERT_EQ(file.meshCount, 1);
+		ASSERT_EQ(file.meshes[0].primitiveCount, 1);
+		const GltfPrimitive& primitive = file.meshes[0].primitives[0];
+		ASSERT_EQ(primitive.attributes[static_cast<size_t>(GltfAttribute::Position)], 0);
+		ASSERT_EQ(primitive.attributes[static_cast<size_t>(GltfAttribute::Normal)], -1);
+		ASSERT_EQ(primitive.indices, -1);
+		ASSERT_EQ(primitive.material, 0);
+
+		ASSERT_EQ(file.nodeCount, 2);
+		ASSERT_EQ(file.nodes[0].name, "root");
+		ASSERT_EQ(file.nodes[0].childCount, 1);
+		ASSERT_EQ(file.nodes[0].children[0], 1);
+		ASSERT_EQ(file.nodes[0].translation[2], 3.f);
+		ASSERT_EQ(file.nodes[0].rotation[3], 1.f);
+		ASSERT_EQ(file.nodes[1].rotation[2], 0.5f);
+		ASSERT_EQ(file.nodes[1].translation[0], 0.f);
+		ASSERT_EQ(file.nodes[1].scale[1], 1.f);
+
+		ASSERT_EQ(file.animationCount, 1);
+		ASSERT_EQ(file.animations[0].name, "Idle");
+		ASSERT_EQ(file.animations[0].mask, "child");
+		ASSERT_TRUE(file.animations[0].mainRender);
+	}
+
+	// One element past the end of the buffer view
+	GlbFile outOfBounds;
+	ASSERT_FALSE(ReadGlbFile(WriteTestGlb("GlbReaderOutOfBounds.glb", withCount("5"), bin).c_str(), outOfBounds, arena));
+
+	std::string truncated = withCount("4");
+	truncated.resize(truncated.size() / 2);
+	GlbFile malformed;
+	ASSERT_FALSE(ReadGlbFile(WriteTestGlb("GlbReaderMalformed.glb", truncated, bin).c_str(), malformed, arena));
+
+	GlbFile missing;
+	ASSERT_FALSE(ReadGlbFile("does/not/exist.glb", missing, arena));
+}
+
+TEST(Mesh, ParallelDecodeDeterministic)
+{
+	const char* path = "models/kaiju.glb";
+	if (!std::filesystem::exists(path))
+	{
+		GTEST_SKIP() << "Models not found, run this from the build directory";
+	}
+
+	MemoryArena arena{ 1024 * 1024 * 256 };
+	WorkerPool serialPool{ 0 };
+	WorkerPool parallelPool{ 3 };
+	GltfResult* serial = LoadGltfFromFile(path, arena, serialPool);
+	GltfResult* parallel = LoadGltfFromFile(path, arena, parallelPool);
+	ASSERT_TRUE(serial->success);
+	ASSERT_TRUE(parallel->success);
+
+	ASSERT_EQ(parallel->meshes.size, serial->meshes.size);
+	for (size_t i = 0; i < serial->meshes.size; i++)
+	{
+		const MeshData& expected = serial->meshes[i].mesh;
+		const MeshData& actual = parallel->meshes[i].mesh;
+		ASSERT_EQ(actual.vertexCount, expected.vertexCount);
+		ASSERT_EQ(actual.indexCount, expected.indexCount);
+		EXPECT_EQ(memcmp(actual.vertices, expected.vertices, sizeof(Vertex) * expected.vertexCount), 0);
+		EXPECT_EQ(memcmp(actual.indices, expected.indices, sizeof(INDEX_BUFFER_TYPE) * expected.indexCount), 0);
+		ASSERT_EQ(actual.meshletCount, expected.meshletCount);
+		EXPECT_EQ(memcmp(actual.meshlets, expected.meshlets, sizeof(Meshlet) * expected.meshletCount), 0);
+		ASSERT_EQ(actual.lodCount, expected.lodCount);
+		for (size_t level = 0; level < expected.lodCount; level++)
+		{
+			ASSERT_EQ(actual.lods[level].indexCount, expected.lods[level].indexCount);
+			EXPECT_EQ(memcmp(actual.lods[level].indices, expected.lods[level].indices, sizeof(INDEX_BUFFER_TYPE) * expected.lods[level].indexCount), 0);
+			EXPECT_EQ(actual.lods[level].error, expected.lods[level].error);
+		}
+		EXPECT_EQ(parallel->meshes[i].materialName, serial->meshes[i].materialName);
+	}
+}
+
+// Triangles by position with the corners rotated to a fixed start, so reordering triangles and vertices compares equal but flipped winding doesn't
+static std::vector<std::array<float, 9>> GetSortedTriangles(const MeshData& mesh)
+{
+	std::vector<std::array<float, 9>> triangles;
+	for (size_t i = 0; i < mesh.indexCount; i += 3)
+	{
+		std::array<XMFLOAT3, 3> corners = { mesh.vertices[mesh.indices[i]].position, mesh.vertices[mesh.indices[i + 1]].position, mesh.vertices[mesh.indices[i + 2]].position };
+		auto lessPosition = [](const XMFLOAT3& a, const XMFLOAT3& b) { return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z); };
+		std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end(), lessPosition), corners.end());
+		triangles.push_back({ corners[0].x, corners[0].y, corners[0].z, corners[1].x, corners[1].y, corners[1].z, corners[2].x, corners[2].y, corners[2].z });
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+TEST(Mesh, VertexCacheOptimization)
+{
+	MemoryArena arena{ 1024 * 1024 * 64 };
+	MeshData mesh = CreateShuffledGrid(64, arena);
+	std::vector<std::array<float, 9>> expectedTriangles = GetSortedTriangles(mesh);
+
+	VertexCacheStats before = AnalyzeVertexCache(mesh.indices, mesh.indexCount, mesh.vertexCount);
+	OptimizeMesh(mesh, arena);
+	VertexCacheStats after = AnalyzeVertexCache(mesh.indices, mesh.indexCount, mesh.vertexCount);
+
+	EXPECT_GT(before.acmr, 2.5f);
+	EXPECT_LT(after.acmr, 0.8f);
+	EXPECT_LT(after.atvr, 1.5f);
+	EXPECT_EQ(GetSortedTriangles(mesh), expectedTriangles);
+
+	// Vertex fetch order, every index is at most one past the highest one before it
+	INDEX_BUFFER_TYPE nextNewVertex = 0;
+	for (size_t i = 0; i < mesh.indexCount; i++)
+	{
+		ASSERT_LE(mesh.indices[i], nextNewVertex);
+		if (mesh.indices[i] == nextNewVertex) nextNewVertex++;
+	}
+}
+
+// Loads everything the game loads, in the same order, once without and once with mesh optimization.
+// Skips the calling test if the models aren't there.
+static void ForEachBundledModel(const std::function<void(const char* path, GltfResult* original, GltfResult* optimized)>& func)
+{
+	if (!std::filesystem::exists("models"))
+	{
+		GTEST_SKIP() << "Models not found, run this from the build directory";
+	}
+
+	const char* paths[] = { "models/log1.glb", "models/log2.glb", "models/DamagedHelmet.glb", "models/Sponza.glb", "models/level1.glb", "models/kaiju.glb",
+		"models/skybox-cube.glb", "models/translate-arrow.glb", "models/rotate-arrow.glb", "models/scale-arrow.glb" };
+
+	for (const char* path : paths)
+	{
+		if (!std::filesystem::exists(path)) continue;
+
+		MemoryArena arena{ 1024ull * 1024 * 1024 };
+		GltfResult* original = LoadGltfFromFile(path, arena, GetWorkerPool(), false);
+		GltfResult* optimized = LoadGltfFromFile(path, arena, GetWorkerPool(), true);
+		if (!original->success || !optimized->success) continue;
+
+		func(path, original, optimized);
+	}
+}
+
+TEST(Mesh, VertexCacheBundledModels)
+{
+	ForEachBundledModel([](const char* path, GltfResult* original, GltfResult* optimized)
+	{
+		VertexCacheStats totalBefore{};
+		VertexCacheStats totalAfter{};
+		size_t triangleCount = 0;
+		size_t vertexCount = 0;
+		for (size_t i = 0; i < original->meshes.size; i++)
+		{
+			const MeshData& before = original->meshes[i].mesh;
+			const MeshData& after = optimized->meshes[i].mesh;
+			ASSERT_EQ(GetSortedTriangles(after), GetSortedTriangles(before));
+
+			totalBefore.transformCount += AnalyzeVertexCache(before.indices, before.indexCount, before.vertexCount).transformCount;
+			totalAfter.transformCount += AnalyzeVertexCache(after.indices, after.indexCount, after.vertexCount).transformCount;
+			triangleCount += before.indexCount / 3;
+			vertexCount += before.vertexCount;
+		}
+		if (triangleCount == 0) return;
+
+		EXPECT_LE(totalAfter.transformCount, totalBefore.transformCount) << path;
+		std::cout << std::format("{:30} ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}\n", path,
+			static_cast<float>(totalBefore.transformCount) / triangleCount, static_cast<float>(totalAfter.transformCount) / triangleCount,
+			static_cast<float>(totalBefore.transformCount) / vertexCount, static_cast<float>(totalAfter.transformCount) / vertexCount);
+	});
+}
+
+TEST(Mesh, WeldVertices)
+{
+	MemoryArena arena{ 1024 * 1024 * 64 };
+	MeshData grid = CreateShuffledGrid(16, arena);
+	std::vector<std::array<float, 9>> expectedTriangles = GetSortedTriangles(grid);
+
+	// Unindexed copy, like exporters that write every corner of every triangle
+	MeshData soup{};
+	soup.vertexCount = grid.indexCount;
+	soup.vertices = NewArray(arena, Vertex, soup.vertexCount);
+	soup.indexCount = grid.indexCount;
+	soup.indices = NewArray(arena, INDEX_BUFFER_TYPE, soup.indexCount);
+	for (size_t i = 0; i < grid.indexCount; i++)
+	{
+		soup.vertices[i] = grid.vertices[grid.indices[i]];
+		soup.indices[i] = static_cast<INDEX_BUFFER_TYPE>(i);
+	}
+
+	// Same position but a different uv has to stay a separate vertex
+	soup.vertices[0].uv.x += 1.f;
+
+	size_t welded = WeldVertices(soup, arena);
+	EXPECT_EQ(soup.vertexCount, grid.vertexCount + 1);
+	EXPECT_EQ(welded, grid.indexCount - grid.vertexCount - 1);
+	EXPECT_EQ(GetSortedTriangles(soup), expectedTriangles);
+	for (size_t i = 0; i < soup.indexCount; i++)
+	{
+		ASSERT_LT(soup.indices[i], soup.vertexCount);
+	}
+
+	EXPECT_EQ(HashMeshContent(grid), HashMeshContent(grid));
+	EXPECT_NE(HashMeshContent(soup), HashMeshContent(grid));
+}
+
+TEST(Mesh, DeduplicationBundledModels)
+{
+	MemoryArena hashArena{ 1024 * 1024 };
+	ArenaHashMap<uint64_t, size_t> uploaded{ hashArena, MAX_MESHES };
+	size_t weldedBytes = 0;
+	size_t sharedBytes = 0;
+	size_t totalBytes = 0;
+
+	ForEachBundledModel([&](const char* path, GltfResult* original, GltfResult* optimized)
+	{
+		for (size_t i = 0; i < optimized->meshes.size; i++)
+		{
+			const MeshData& before = original->meshes[i].mesh;
+			const MeshData& after = optimized->meshes[i].mesh;
+			ASSERT_LE(after.vertexCount, before.vertexCount);
+			ASSERT_EQ(GetSortedTriangles(after), GetSortedTriangles(before));
+
+			const size_t meshBytes = sizeof(PackedVertex) * after.vertexCount + sizeof(INDEX_BUFFER_TYPE) * after.indexCount;
+			weldedBytes += sizeof(PackedVertex) * (before.vertexCount - after.vertexCount);
+			totalBytes += sizeof(PackedVertex) * before.vertexCount + sizeof(INDEX_BUFFER_TYPE) * before.indexCount;
+			if (!uploaded.insert(HashMeshContent(after), i))
+			{
+				sharedBytes += meshBytes;
+			}
+		}
+	});
+	if (IsSkipped()) return;
+
+	std::cout << std::format("Level geometry {:.2f} KB, welding saves {:.2f} KB, sharing identical meshes saves {:.2f} KB\n",
+		totalBytes / 1024.f, weldedBytes / 1024.f, sharedBytes / 1024.f);
+}
+
+static float AngleBetween(XMFLOAT3 a, XMFLOAT3 b)
+{
+	// atan2 instead of acos, acos can't resolve angles this small in float precision
+	XMVECTOR va = XMLoadFloat3(&a);
+	XMVECTOR vb = XMLoadFloat3(&b);
+	return atan2f(XMVectorGetX(XMVector3Length(XMVector3Cross(va, vb))), XMVectorGetX(XMVector3Dot(va, vb)));
+}
+
+// Fibonacci sphere so the directions cover every octant, including the folded lower hemisphere
+static XMFLOAT3 SphereDirection(size_t i, size_t count)
+{
+	float y = 1.f - 2.f * (i + 0.5f) / count;
+	float radius = sqrtf(1.f - y * y);
+	float phi = i * XM_PI * (3.f - sqrtf(5.f));
+	return { cosf(phi) * radius, y, sinf(phi) * radius };
+}
+
+// Limits, coverage of the index buffer and bounds of every meshlet
+static void ExpectValidMeshlets(const MeshData& mesh)
+{
+	size_t nextIndex = 0;
+	for (size_t m = 0; m < mesh.meshletCount; m++)
+	{
+		const Meshlet& meshlet = mesh.meshlets[m];
+		ASSERT_EQ(meshlet.firstIndex, nextIndex);
+		ASSERT_GT(meshlet.indexCount, 0);
+		ASSERT_LE(meshlet.indexCount / 3, MESHLET_MAX_TRIANGLES);
+		nextIndex += meshlet.indexCount;
+
+		std::vector<INDEX_BUFFER_TYPE> uniqueVertices{ mesh.indices + meshlet.firstIndex, mesh.indices + meshlet.firstIndex + meshlet.indexCount };
+		std::sort(uniqueVertices.begin(), uniqueVertices.end());
+		uniqueVertices.erase(std::unique(uniqueVertices.begin(), uniqueVertices.end()), uniqueVertices.end());
+		ASSERT_EQ(meshlet.vertexCount, uniqueVertices.size());
+		ASSERT_LE(meshlet.vertexCount, MESHLET_MAX_VERTICES);
+
+		for (INDEX_BUFFER_TYPE index : uniqueVertices)
+		{
+			XMFLOAT3 position = mesh.vertices[index].position;
+			ASSERT_GE(position.x, meshlet.aabbMin.x);
+			ASSERT_GE(position.y, meshlet.aabbMin.y);
+			ASSERT_GE(position.z, meshlet.aabbMin.z);
+			ASSERT_LE(position.x, meshlet.aabbMax.x);
+			ASSERT_LE(position.y, meshlet.aabbMax.y);
+			ASSERT_LE(position.z, meshlet.aabbMax.z);
+			float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&position), XMLoadFloat3(&meshlet.center))));
+			ASSERT_LE(distance, meshlet.radius * 1.0001f + 1e-6f);
+		}
+	}
+	ASSERT_EQ(nextIndex, mesh.indexCount);
+}
+
+TEST(Mesh, MeshletBuilder)
+{
+	MemoryArena arena{ 1024 * 1024 * 64 };
+	MeshData mesh = CreateShuffledGrid(64, arena);
+	OptimizeMesh(mesh, arena);
+
+	mesh.meshlets = NewArray(arena, Meshlet, GetMaxMeshletCount(mesh.indexCount));
+	mesh.meshletCount = BuildMeshlets(mesh, mesh.meshlets, arena);
+	ExpectValidMeshlets(mesh);
+
+	// A cache optimized grid should fill meshlets well, the worst case is MESHLET_MAX_VERTICES / 3 triangles each
+	const size_t triangleCount = mesh.indexCount / 3;
+	EXPECT_LT(mesh.meshletCount, triangleCount / 60);
+
+	Meshlet* rebuilt = NewArray(arena, Meshlet, GetMaxMeshletCount(mesh.indexCount));
+	ASSERT_EQ(BuildMeshlets(mesh, rebuilt, arena), mesh.meshletCount);
+	EXPECT_EQ(memcmp(rebuilt, mesh.meshlets, sizeof(Meshlet) * mesh.meshletCount), 0);
+}
+
+TEST(Mesh, MeshletNormalCone)
+{
+	MemoryArena arena{ 1024 * 1024 * 64 };
+
+	// 7x7 quads are 98 triangles on exactly 64 vertices, one meshlet facing +y
+	MeshData flat = CreateShuffledGrid(7, arena);
+	Meshlet flatMeshlets[2];
+	ASSERT_EQ(BuildMeshlets(flat, flatMeshlets, arena), 1);
+	const Meshlet& plane = flatMeshlets[0];
+	EXPECT_NEAR(plane.coneAxis.y, 1.f, 1e-5f);
+	EXPECT_NEAR(plane.coneCutoff, 0.f, 1e-3f);
+	EXPECT_TRUE(IsMeshletBackfacing(plane, XMVectorSet(3.f, -20.f, 3.f, 0.f)));
+	EXPECT_TRUE(IsMeshletBackfacing(plane, XMVectorSet(-50.f, -30.f, 80.f, 0.f)));
+	EXPECT_FALSE(IsMeshletBackfacing(plane, XMVectorSet(3.f, 20.f, 3.f, 0.f)));
+	EXPECT_FALSE(IsMeshletBackfacing(plane, XMVectorSet(-50.f, 0.1f, 80.f, 0.f)));
+	// Close to the plane the sphere covers too much of the view to decide
+	EXPECT_FALSE(IsMeshletBackfacing(plane, XMVectorSet(3.f, -0.5f, 3.f, 0.f)));
+
+	// Bending the grid into a trough widens the cone, culling has to stay conservative from every direction
+	MeshData trough = CreateShuffledGrid(7, arena);
+	for (size_t i = 0; i < trough.vertexCount; i++)
+	{
+		XMFLOAT3& position = trough.vertices[i].position;
+		position.y = 0.1f * (position.x - 3.5f) * (position.x - 3.5f);
+	}
+	Meshlet troughMeshlets[2];
+	ASSERT_EQ(BuildMeshlets(trough, troughMeshlets, arena), 1);
+	const Meshlet& curved = troughMeshlets[0];
+	EXPECT_GT(curved.coneCutoff, 0.f);
+	EXPECT_LT(curved.coneCutoff, 1.f);
+
+	size_t culledCount = 0;
+	const size_t cameraCount = 1000;
+	for (size_t c = 0; c < cameraCount; c++)
+	{
+		XMFLOAT3 direction = SphereDirection(c, cameraCount);
+		XMVECTOR camera = XMVectorMultiplyAdd(XMLoadFloat3(&direction), XMVectorReplicate(30.f), XMLoadFloat3(&curved.center));
+		if (!IsMeshletBackfacing(curved, camera)) continue;
+
+		culledCount++;
+		for (size_t i = 0; i < trough.indexCount; i += 3)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&trough.vertices[trough.indices[i + 0]].position);
+			XMVECTOR p1 = XMLoadFloat3(&trough.vertices[trough.indices[i + 1]].position);
+			XMVECTOR p2 = XMLoadFloat3(&trough.vertices[trough.indices[i + 2]].position);
+			XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+			ASSERT_GE(XMVectorGetX(XMVector3Dot(XMVectorSubtract(p0, camera), normal)), 0.f) << "camera " << c << " triangle " << i / 3;
+		}
+	}
+	EXPECT_GT(culledCount, cameraCount / 10);
+
+	// Triangles facing every direction can never be culled
+	MeshData cube{};
+	XMFLOAT3 corners[] = { { 0.f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 1.f, 1.f, 0.f }, { 0.f, 0.f, 1.f }, { 1.f, 0.f, 1.f }, { 0.f, 1.f, 1.f }, { 1.f, 1.f, 1.f } };
+	INDEX_BUFFER_TYPE cubeIndices[] = { 0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4, 2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5 };
+	Vertex cubeVertices[_countof(corners)]{};
+	for (size_t i = 0; i < _countof(corners); i++)
+	{
+		cubeVertices[i].position = corners[i];
+	}
+	cube.vertices = cubeVertices;
+	cube.vertexCount = _countof(cubeVertices);
+	cube.indices = cubeIndices;
+	cube.indexCount = _countof(cubeIndices);
+	Meshlet cubeMeshlets[2];
+	ASSERT_EQ(BuildMeshlets(cube, cubeMeshlets, arena), 1);
+	EXPECT_EQ(cubeMeshlets[0].coneCutoff, 1.f);
+	EXPECT_NEAR(cubeMeshlets[0].radius, std::sqrt(0.75f), 1e-5f);
+	for (size_t c = 0; c < 100; c++)
+	{
+		XMFLOAT3 direction = SphereDirection(c, 100);
+		EXPECT_FALSE(IsMeshletBackfacing(cubeMeshlets[0], XMVectorScale(XMLoadFloat3(&direction), 5.f)));
+	}
+}
+
+TEST(Mesh, MeshletBundledModels)
+{
+	ForEachBundledModel([](const char* path, GltfResult*, GltfResult* model)
+	{
+		size_t meshletCount = 0;
+		size_t triangleCount = 0;
+		size_t cullableCount = 0;
+		for (size_t i = 0; i < model->meshes.size; i++)
+		{
+			const MeshData& mesh = model->meshes[i].mesh;
+			ExpectValidMeshlets(mesh);
+			meshletCount += mesh.meshletCount;
+			triangleCount += mesh.indexCount / 3;
+			for (size_t m = 0; m < mesh.meshletCount; m++)
+			{
+				if (mesh.meshlets[m].coneCutoff < 1.f) cullableCount++;
+			}
+		}
+		if (meshletCount == 0) return;
+
+		std::cout << std::format("{:30} {} meshlets, {:.1f} triangles each, {:.0f}% have a normal cone\n", path,
+			meshletCount, static_cast<float>(triangleCount) / meshletCount, 100.f * cullableCount / meshletCount);
+	});
+}
+
+// Sum of triangle areas and whether any triangle faces away from +y
+static float GetGridArea(const MeshData& mesh, const INDEX_BUFFER_TYPE* indices, size_t indexCount, bool& anyFlipped)
+{
+	float area = 0.f;
+	anyFlipped = false;
+	for (size_t i = 0; i < indexCount; i += 3)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&mesh.vertices[indices[i + 0]].position);
+		XMVECTOR p1 = XMLoadFloat3(&mesh.vertices[indices[i + 1]].position);
+		XMVECTOR p2 = XMLoadFloat3(&mesh.vertices[indices[i + 2]].position);
+		XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+		area += XMVectorGetX(XMVector3Length(normal)) * 0.5f;
+		anyFlipped |= XMVectorGetY(normal) <= 0.f;
+	}
+	return area;
+}
+
+TEST(Mesh, SimplifyFlatGrid)
+{
+	MemoryArena arena{ 1024 * 1024 * 64 };
+	MeshData grid = CreateShuffledGrid(32, arena);
+	OptimizeMesh(grid, arena);
+
+	INDEX_BUFFER_TYPE* simplified = NewArray(arena, INDEX_BUFFER_TYPE, grid.indexCount);
+	float error = 1.f;
+	size_t indexCount = SimplifyMesh(simplified, grid.indices, grid.indexCount, grid.vertices, grid.vertexCount, grid.indexCount / 4, &error, arena);
+
+	// Everything is in one plane with straight borders, so the outline and the area can't change
+	EXPECT_LE(indexCount, grid.indexCount / 4);
+	EXPECT_GT(indexCount, 0);
+	EXPECT_LT(error, 1e-3f);
+	bool anyFlipped = false;
+	EXPECT_NEAR(GetGridArea(grid, simplified, indexCount, anyFlipped), 32.f * 32.f, 1e-2f);
+	EXPECT_FALSE(anyFlipped);
+
+	float error2 = 0.f;
+	INDEX_BUFFER_TYPE* again = NewArray(arena, INDEX_BUFFER_TYPE, grid.indexCount);
+	ASSERT_EQ(SimplifyMesh(again, grid.indices, grid.indexCount, grid.vertices, grid.vertexCount, grid.indexCount / 4, &error2, arena), indexCount);
+	EXPECT_EQ(memcmp(again, simplified, sizeof(INDEX_BUFFER_TYPE) * indexCount), 0);
+}
+
+TEST(Mesh, SimplifyKeepsSeams)
+{
+	MemoryArena arena{ 1024 * 1024 * 64 };
+	MeshData grid = CreateShuffledGrid(16, arena);
+
+	// The right half gets its own copies of every vertex it uses, like a second UV chart with a seam at x = 8.
+	// Its skin is bound to another bone so collapses across the seam would also be visible in animation
+	MeshData charts = grid;
+	charts.vertices = NewArray(arena, Vertex, grid.vertexCount * 2);
+	charts.vertexCount = grid.vertexCount * 2;
+	charts.indices = NewArray(arena, INDEX_BUFFER_TYPE, grid.indexCount);
+	for (size_t i = 0; i < grid.vertexCount; i++)
+	{
+		charts.vertices[i] = grid.vertices[i];
+		charts.vertices[i].boneWeights = { 1.f, 0.f, 0.f, 0.f };
+		charts.vertices[grid.vertexCount + i] = grid.vertices[i];
+		charts.vertices[grid.vertexCount + i].uv = { 100.f, 0.f };
+		charts.vertices[grid.vertexCount + i].boneIndices = { 1, 0, 0, 0 };
+		charts.vertices[grid.vertexCount + i].boneWeights = { 1.f, 0.f, 0.f, 0.f };
+	}
+	for (size_t i = 0; i < grid.indexCount; i += 3)
+	{
+		float centroidX = 0.f;
+		for (size_t corner = 0; corner < 3; corner++)
+		{
+			centroidX += grid.vertices[grid.indices[i + corner]].position.x / 3.f;
+		}
+		for (size_t corner = 0; corner < 3; corner++)
+		{
+			charts.indices[i + corner] = grid.indices[i + corner] + (centroidX > 8.f ? static_cast<INDEX_BUFFER_TYPE>(grid.vertexCount) : 0);
+		}
+	}
+
+	INDEX_BUFFER_TYPE* simplified = NewArray(arena, INDEX_BUFFER_TYPE, charts.indexCount);
+	float error = 1.f;
+	size_t indexCount = SimplifyMesh(simplified, charts.indices, charts.indexCount, charts.vertices, charts.vertexCount, charts.indexCount / 4, &error, arena);
+	EXPECT_LE(indexCount, charts.indexCount / 4);
+	EXPECT_LT(error, 1e-3f);
+
+	bool anyFlipped = false;
+	EXPECT_NEAR(GetGridArea(charts, simplified, indexCount, anyFlipped), 16.f * 16.f, 1e-2f);
+	EXPECT_FALSE(anyFlipped);
+
+	// Triangles stay on their side of the seam, so the area of each chart is unchanged too
+	float rightArea = 0.f;
+	for (size_t i = 0; i < indexCount; i += 3)
+	{
+		bool right = simplified[i] >= grid.vertexCount;
+		ASSERT_EQ(simplified[i + 1] >= grid.vertexCount, right);
+		ASSERT_EQ(simplified[i + 2] >= grid.vertexCount, right);
+		if (right)
+		{
+			rightArea += GetGridArea(charts, simplified + i, 3, anyFlipped);
+		}
+	}
+	EXPECT_NEAR(rightArea, 8.f * 16.f, 1e-2f);
+}
+
+TEST(Mesh, LodSelection)
+{
+	const float errors[] = { 0.f, 0.01f, 0.05f, 0.2f };
+	EXPECT_EQ(SelectLod(errors, _countof(errors), 1000.f), 0);
+	EXPECT_EQ(SelectLod(errors, _countof(errors), 50.f), 1);
+	EXPECT_EQ(SelectLod(errors, _countof(errors), 20.f), 2);
+	EXPECT_EQ(SelectLod(errors, _countof(errors), 4.f), 3);
+	EXPECT_EQ(SelectLod(errors, 1, 0.f), 0);
+
+	// A 1000 pixel high viewport with a 90 degree field of view, one unit at 10 units distance covers 50 pixels
+	EXPECT_NEAR(GetLodPixelsPerUnit(10.f, 1.f, 1000.f), 50.f, 1e-4f);
+	size_t previousLod = 0;
+	for (float distance = 1.f; distance < 1000.f; distance *= 1.5f)
+	{
+		size_t lod = SelectLod(errors, _countof(errors), GetLodPixelsPerUnit(distance, 1.f, 1000.f));
+		EXPECT_GE(lod, previousLod);
+		previousLod = lod;
+	}
+	EXPECT_EQ(previousLod, 3);
+}
+
+TEST(Mesh, LodBundledModels)
+{
+	ForEachBundledModel([](const char* path, GltfResult*, GltfResult* model)
+	{
+		size_t triangleCounts[MAX_MESH_LODS]{};
+		float relativeErrors[MAX_MESH_LODS]{};
+		for (size_t i = 0; i < model->meshes.size; i++)
+		{
+			const MeshData& mesh = model->meshes[i].mesh;
+			XMVECTOR boundsMin = g_XMFltMax;
+			XMVECTOR boundsMax = XMVectorNegate(g_XMFltMax);
+			for (size_t v = 0; v < mesh.vertexCount; v++)
+			{
+				boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&mesh.vertices[v].position));
+				boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&mesh.vertices[v].position));
+			}
+			float radius = XMVectorGetX(XMVector3Length(XMVectorSubtract(boundsMax, boundsMin))) * 0.5f;
+
+			// Meshes without a level keep drawing their full mesh in the coarser columns
+			size_t previousIndexCount = mesh.indexCount;
+			float previousError = 0.f;
+			triangleCounts[0] += mesh.indexCount / 3;
+			for (size_t level = 1; level < MAX_MESH_LODS; level++)
+			{
+				if (level <= mesh.lodCount)
+				{
+					const MeshLod& lod = mesh.lods[level - 1];
+					ASSERT_LE(lod.indexCount, previousIndexCount * LOD_MIN_REDUCTION);
+					ASSERT_GE(lod.error, previousError);
+					for (size_t index = 0; index < lod.indexCount; index++)
+					{
+						ASSERT_LT(lod.indices[index], mesh.vertexCount);
+					}
+					previousIndexCount = lod.indexCount;
+					previousError = lod.error;
+				}
+				triangleCounts[level] += previousIndexCount / 3;
+				relativeErrors[level] = std::max(relativeErrors[level], radius > 0.f ? previousError / radius : 0.f);
+			}
+		}
+
+		std::cout << std::format("{:30} triangles {} / {} / {} / {}, max error {:.2f}% / {:.2f}% / {:.2f}% of the radius\n", path,
+			triangleCounts[0], triangleCounts[1], triangleCounts[2], triangleCounts[3], relativeErrors[1] * 100.f, relativeErrors[2] * 100.f, relativeErrors[3] * 100.f);
+	});
+}
+
+TEST(Vertex, PackedTangentFrame)
+{
+	const size_t count = 10000;
+	float maxNormalError = 0.f;
+	float maxTangentError = 0.f;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		VertexData::Vertex vertex{};
+		vertex.normal = SphereDirection(i, count);
+		XMVECTOR normal = XMLoadFloat3(&vertex.normal);
+		XMVECTOR helper = fabsf(vertex.normal.y) < 0.9f ? XMVectorSet(0.f, 1.f, 0.f, 0.f) : XMVectorSet(1.f, 0.f, 0.f, 0.f);
+		XMVECTOR tangent = XMVector3Normalize(XMVector3Cross(helper, normal));
+		XMStoreFloat3(&vertex.tangent, tangent);
+		float handedness = i % 2 == 0 ? 1.f : -1.f;
+		XMStoreFloat3(&vertex.bitangent, XMVectorScale(XMVector3Cross(normal, tangent), handedness));
+
+		VertexData::PackedVertex packed;
+		VertexData::PackVertices(&vertex, &packed, 1);
+		VertexData::Vertex unpacked = VertexData::UnpackVertex(packed);
+
+		maxNormalError = std::max(maxNormalError, AngleBetween(vertex.normal, unpacked.normal));
+		maxTangentError = std::max(maxTangentError, AngleBetween(vertex.tangent, unpacked.tangent));
+		ASSERT_LT(AngleBetween(vertex.bitangent, unpacked.bitangent), XMConvertToRadians(1.f));
+	}
+
+	// snorm16 and unorm10 octahedral encodings
+	ASSERT_LT(maxNormalError, XMConvertToRadians(0.01f));
+	ASSERT_LT(maxTangentError, XMConvertToRadians(0.2f));
+}
+
+TEST(Vertex, PackedAttributes)
+{
+	ASSERT_EQ(sizeof(VertexData::PackedVertex), 32);
+
+	VertexData::Vertex vertex{};
+	vertex.position = { 123.456f, -0.001f, 1e6f };
+	vertex.normal = { 0.f, 0.f, 1.f };
+	vertex.tangent = { 1.f, 0.f, 0.f };
+	vertex.bitangent = { 0.f, 1.f, 0.f };
+
+	for (size_t i = 0; i < 1000; i++)
+	{
+		float u = i / 1000.f * 4.f - 2.f;
+		vertex.uv = { u, 1.f - u };
+		// Weights that don't land on multiples of 1/255, so the rounded sum drifts
+		float w0 = (i % 97) / 96.f;
+		float w1 = (1.f - w0) * 0.6f;
+		float w2 = (1.f - w0) * 0.3f;
+		vertex.boneWeights = { w0, w1, w2, 1.f - w0 - w1 - w2 };
+		vertex.boneIndices = { (uint32_t)(i % 256), 0, 17, 255 };
+
+		VertexData::PackedVertex packed;
+		VertexData::PackVertices(&vertex, &packed, 1);
+		VertexData::Vertex unpacked = VertexData::UnpackVertex(packed);
+
+		ASSERT_EQ(memcmp(&vertex.position, &unpacked.position, sizeof(XMFLOAT3)), 0);
+
+		// Half floats keep 11 significant bits
+		ASSERT_NEAR(unpacked.uv.x, vertex.uv.x, fabsf(vertex.uv.x) / 2048.f + 1e-7f);
+		ASSERT_NEAR(unpacked.uv.y, vertex.uv.y, fabsf(vertex.uv.y) / 2048.f + 1e-7f);
+
+		float sum = unpacked.boneWeights.x + unpacked.boneWeights.y + unpacked.boneWeights.z + unpacked.boneWeights.w;
+		ASSERT_NEAR(sum, 1.f, 1e-5f);
+		ASSERT_NEAR(unpacked.boneWeights.x, vertex.boneWeights.x, 2.f / 255.f);
+		ASSERT_NEAR(unpacked.boneWeights.y, vertex.boneWeights.y, 2.f / 255.f);
+		ASSERT_NEAR(unpacked.boneWeights.z, vertex.boneWeights.z, 2.f / 255.f);
+		ASSERT_NEAR(unpacked.boneWeights.w, vertex.boneWeights.w, 2.f / 255.f);
+
+		ASSERT_EQ(unpacked.boneIndices.x, vertex.boneIndices.x);
+		ASSERT_EQ(unpacked.boneIndices.y, vertex.boneIndices.y);
+		ASSERT_EQ(unpacked.boneIndices.z, vertex.boneIndices.z);
+		ASSERT_EQ(unpacked.boneIndices.w, vertex.boneIndices.w);
+	}
+}
+
+// Random attribute streams for vertexCount vertices, weights add up to one like the importer asserts
+static VertexData::VertexStreams CreateRandomStreams(size_t vertexCount, bool skinned, std::vector<float>& floats, std::vector<uint8_t>& joints)
+{
+	floats.resize(vertexCount * (skinned ? 16 : 12));
+	joints.resize(skinned ? vertexCount * 4 : 0);
+	uint32_t random = 12345;
+	auto next = [&]() { random = random * 1664525u + 1013904223u; return random >> 8; };
+	for (float& value : floats)
+	{
+		value = next() / float(1 << 23) - 1.f;
+	}
+	for (uint8_t& joint : joints)
+	{
+		joint = static_cast<uint8_t>(next());
+	}
+
+	VertexData::VertexStreams streams;
+	streams.positions = &floats[0];
+	streams.normals = &floats[vertexCount * 3];
+	streams.tangents = &floats[vertexCount * 6];
+	streams.uvs = &floats[vertexCount * 10];
+	if (skinned)
+	{
+		float* weights = &floats[vertexCount * 12];
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			float* w = &weights[i * 4];
+			w[0] = fabsf(w[0]);
+			w[1] = (1.f - w[0]) * 0.5f;
+			w[2] = (1.f - w[0]) * 0.25f;
+			w[3] = 1.f - w[0] - w[1] - w[2];
+		}
+		streams.joints = joints.data();
+		streams.weights = weights;
+	}
+	return streams;
+}
+
+TEST(Vertex, ConvertStreamsMatchesScalar)
+{
+	const size_t vertexCount = 37;
+	for (bool skinned : { false, true })
+	{
+		std::vector<float> floats;
+		std::vector<uint8_t> joints;
+		VertexData::VertexStreams streams = CreateRandomStreams(vertexCount, skinned, floats, joints);
+
+		// Every start and length, so ranges end inside and outside of the four vertex groups
+		for (size_t first = 0; first < vertexCount; first++)
+		{
+			for (size_t count = 0; first + count <= vertexCount; count += 3)
+			{
+				std::vector<VertexData::Vertex> simd(vertexCount);
+				std::vector<VertexData::Vertex> scalar(vertexCount);
+				VertexData::ConvertVertexStreams(streams, simd.data(), first, count);
+				VertexData::ConvertVertexStreamsScalar(streams, scalar.data(), first, count);
+				ASSERT_EQ(memcmp(simd.data(), scalar.data(), sizeof(VertexData::Vertex) * vertexCount), 0) << first << " " << count;
+			}
+		}
+
+		std::vector<VertexData::Vertex> vertices(vertexCount);
+		VertexData::ConvertVertexStreams(streams, vertices.data(), 0, vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			const VertexData::Vertex& vertex = vertices[i];
+			ASSERT_EQ(vertex.position.z, streams.positions[i * 3 + 2]);
+			ASSERT_EQ(vertex.tangent.x, streams.tangents[i * 4 + 0]);
+			ASSERT_EQ(vertex.uv.y, streams.uvs[i * 2 + 1]);
+			ASSERT_EQ(vertex.color.x, 0.f);
+
+			XMFLOAT3 bitangent;
+			XMStoreFloat3(&bitangent, XMVectorScale(XMVector3Cross(XMLoadFloat3(&vertex.normal), XMLoadFloat3(&vertex.tangent)), streams.tangents[i * 4 + 3]));
+			ASSERT_NEAR(vertex.bitangent.x, bitangent.x, 1e-6f);
+			ASSERT_NEAR(vertex.bitangent.y, bitangent.y, 1e-6f);
+			ASSERT_NEAR(vertex.bitangent.z, bitangent.z, 1e-6f);
+
+			if (skinned)
+			{
+				ASSERT_EQ(vertex.boneIndices.w, streams.joints[i * 4 + 3]);
+				ASSERT_EQ(vertex.boneWeights.y, streams.weights[i * 4 + 1]);
+			}
+			else
+			{
+				ASSERT_EQ(vertex.boneIndices.x, 0);
+				ASSERT_EQ(vertex.boneWeights.x, 0.f);
+			}
+		}
+	}
+}
+
+TEST(Vertex, WidenIndicesMatchesScalar)
+{
+	std::vector<uint16_t> source(100);
+	for (size_t i = 0; i < source.size(); i++)
+	{
+		source[i] = static_cast<uint16_t>(65535 - i * 661);
+	}
+
+	for (size_t count = 0; count <= source.size(); count++)
+	{
+		// One extra entry that has to stay untouched
+		std::vector<uint32_t> simd(count + 1, 7);
+		std::vector<uint32_t> scalar(count + 1, 7);
+		VertexData::WidenIndices(source.data(), simd.data(), count);
+		VertexData::WidenIndicesScalar(source.data(), scalar.data(), count);
+		ASSERT_EQ(simd, scalar);
+		ASSERT_EQ(simd[count], 7);
+		for (size_t i = 0; i < count; i++)
+		{
+			ASSERT_EQ(simd[i], source[i]);
+		}
+	}
+}
+
+// Encoders for the EXT_meshopt_compression bitstreams, written from the format description so the decoder gets checked against more than itself
+static uint8_t Zigzag8(uint8_t v)
+{
+	return static_cast<uint8_t>((static_cast<int8_t>(v) >> 7) ^ (v << 1));
+}
+
+static void EncodeVByte(std::vector<uint8_t>& out, uint32_t v)
+{
+	do
+	{
+		out.push_back(static_cast<uint8_t>((v & 127) | (v > 127 ? 128 : 0)));
+		v >>= 7;
+	} while (v != 0);
+}
+
+// Groups of 16 bytes with 2 header bits each, every group uses whichever of 0, 2, 4 or 8 bits is smallest
+static void EncodeByteGroups(std::vector<uint8_t>& out, const uint8_t* bytes, size_t size)
+{
+	const size_t headerStart = out.size();
+	out.resize(out.size() + (size / 16 + 3) / 4);
+	for (size_t i = 0; i < size; i += 16)
+	{
+		const uint8_t* group = &bytes[i];
+		int bestBitsLog2 = std::all_of(group, group + 16, [](uint8_t b) { return b == 0; }) ? 0 : 3;
+		size_t bestSize = bestBitsLog2 == 0 ? 0 : 16;
+		for (int bitsLog2 : { 1, 2 })
+		{
+			const int sentinel = (1 << (1 << bitsLog2)) - 1;
+			const size_t groupSize = 16 * (1 << bitsLog2) / 8 + std::count_if(group, group + 16, [&](uint8_t b) { return b >= sentinel; });
+			if (groupSize < bestSize)
+			{
+				bestSize = groupSize;
+				bestBitsLog2 = bitsLog2;
+			}
+		}
+
+		out[headerStart + i / 64] |= static_cast<uint8_t>(bestBitsLog2 << ((i / 16 % 4) * 2));
+		if (bestBitsLog2 == 3)
+		{
+			out.insert(out.end(), group, group + 16);
+		}
+		else if (bestBitsLog2 > 0)
+		{
+			const size_t bits = size_t(1) << bestBitsLog2;
+			const uint8_t sentinel = static_cast<uint8_t>((1 << bits) - 1);
+			const size_t packedStart = out.size();
+			out.resize(out.size() + 16 * bits / 8);
+			for (size_t j = 0; j < 16; j++)
+			{
+				out[packedStart + j * bits / 8] |= static_cast<uint8_t>(std::min(group[j], sentinel) << (8 - bits - j * bits % 8));
+			}
+			for (size_t j = 0; j < 16; j++)
+			{
+				if (group[j] >= sentinel)
+				{
+					out.push_back(group[j]);
+				}
+			}
+		}
+	}
+}
+
+static std::vector<uint8_t> EncodeMeshoptAttributes(const uint8_t* data, size_t count, size_t byteStride)
+{
+	std::vector<uint8_t> out{ MESHOPT_VERTEX_HEADER };
+	std::vector<uint8_t> firstElement(byteStride);
+	if (count > 0)
+	{
+		memcpy(firstElement.data(), data, byteStride);
+	}
+
+	std::vector<uint8_t> last = firstElement;
+	const size_t blockSize = GetMeshoptVertexBlockSize(byteStride);
+	for (size_t first = 0; first < count; first += blockSize)
+	{
+		const size_t blockCount = std::min(blockSize, count - first);
+		std::vector<uint8_t> deltas((blockCount + 15) & ~size_t(15));
+		for (size_t k = 0; k < byteStride; k++)
+		{
+			for (size_t i = 0; i < blockCount; i++)
+			{
+				const uint8_t value = data[(first + i) * byteStride + k];
+				deltas[i] = Zigzag8(static_cast<uint8_t>(value - last[k]));
+				last[k] = value;
+			}
+			EncodeByteGroups(out, deltas.data(), deltas.size());
+		}
+	}
+
+	out.resize(out.size() + std::max<size_t>(byteStride, MESHOPT_VERTEX_TAIL_MIN) - byteStride);
+	out.insert(out.end(), firstElement.begin(), firstElement.end());
+	return out;
+}
+
+// Version 1 of the triangle codec with the code aux table of the reference encoder
+static std::vector<uint8_t> EncodeMeshoptTriangles(const uint32_t* indices, size_t count)
+{
+	const uint8_t codeAuxTable[16] = { 0x00, 0x76, 0x87, 0x56, 0x67, 0x78, 0xa9, 0x86, 0x65, 0x89, 0x68, 0x98, 0x01, 0x69, 0x00, 0x00 };
+	std::vector<uint8_t> codes;
+	std::vector<uint8_t> data;
+	uint32_t edges[16][2];
+	uint32_t vertices[16];
+	memset(edges, -1, sizeof(edges));
+	memset(vertices, -1, sizeof(vertices));
+	size_t edgeOffset = 0;
+	size_t vertexOffset = 0;
+	uint32_t next = 0;
+	uint32_t last = 0;
+
+	auto pushEdge = [&](uint32_t a, uint32_t b) { edges[edgeOffset][0] = a; edges[edgeOffset][1] = b; edgeOffset = (edgeOffset + 1) & 15; };
+	auto pushVertex = [&](uint32_t v) { vertices[vertexOffset] = v; vertexOffset = (vertexOffset + 1) & 15; };
+	auto findVertex = [&](uint32_t v)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			if (vertices[(vertexOffset - 1 - i) & 15] == v) return i;
+		}
+		return -1;
+	};
+	auto encodeIndex = [&](uint32_t v)
+	{
+		const uint32_t delta = v - last;
+		EncodeVByte(data, (delta << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(delta) >> 31));
+		last = v;
+	};
+
+	for (size_t i = 0; i < count; i += 3)
+	{
+		const uint32_t triangle[3] = { indices[i], indices[i + 1], indices[i + 2] };
+		int edge = -1;
+		size_t rotation = 0;
+		for (int e = 0; e < 15 && edge < 0; e++)
+		{
+			const uint32_t* fifoEdge = edges[(edgeOffset - 1 - e) & 15];
+			for (size_t r = 0; r < 3; r++)
+			{
+				if (fifoEdge[0] == triangle[r] && fifoEdge[1] == triangle[(r + 1) % 3])
+				{
+					edge = e;
+					rotation = r;
+					break;
+				}
+			}
+		}
+
+		if (edge >= 0)
+		{
+			const uint32_t a = triangle[rotation], b = triangle[(rotation + 1) % 3], c = triangle[(rotation + 2) % 3];
+			const int fc = findVertex(c);
+			int fec = fc >= 1 && fc < 13 ? fc : c == next ? (next++, 0) : 15;
+			if (fec == 15 && c + 1 == last) fec = 13, last = c;
+			if (fec == 15 && c == last + 1) fec = 14, last = c;
+			codes.push_back(static_cast<uint8_t>((edge << 4) | fec));
+			if (fec == 15) encodeIndex(c);
+			if (fec == 0 || fec >= 13) pushVertex(c);
+			pushEdge(c, b);
+			pushEdge(a, c);
+		}
+		else
+		{
+			rotation = triangle[1] == next ? 1 : triangle[2] == next ? 2 : 0;
+			const uint32_t a = triangle[rotation], b = triangle[(rotation + 1) % 3], c = triangle[(rotation + 2) % 3];
+			const bool reset = a == 0 && b == 1 && c == 2 && next > 0;
+			if (reset)
+			{
+				next = 0;
+				memset(vertices, -1, sizeof(vertices));
+			}
+
+			const int fb = findVertex(b);
+			const int fc = findVertex(c);
+			const int fea = a == next ? (next++, 0) : 15;
+			const int feb = fb >= 0 && fb < 14 ? fb + 1 : b == next ? (next++, 0) : 15;
+			const int fec = fc >= 0 && fc < 14 ? fc + 1 : c == next ? (next++, 0) : 15;
+			const uint8_t codeAux = static_cast<uint8_t>((feb << 4) | fec);
+			const size_t codeAuxIndex = std::find(codeAuxTable, codeAuxTable + 14, codeAux) - codeAuxTable;
+			if (fea == 0 && codeAuxIndex < 14 && !reset)
+			{
+				codes.push_back(static_cast<uint8_t>(0xf0 | codeAuxIndex));
+			}
+			else
+			{
+				codes.push_back(static_cast<uint8_t>(0xf0 | 14 | fea));
+				data.push_back(codeAux);
+			}
+			if (fea == 15) encodeIndex(a);
+			if (feb == 15) encodeIndex(b);
+			if (fec == 15) encodeIndex(c);
+			pushVertex(a);
+			if (feb == 0 || feb == 15) pushVertex(b);
+			if (fec == 0 || fec == 15) pushVertex(c);
+			pushEdge(b, a);
+			pushEdge(c, b);
+			pushEdge(a, c);
+		}
+	}
+
+	std::vector<uint8_t> out{ MESHOPT_INDEX_HEADER | 1 };
+	out.insert(out.end(), codes.begin(), codes.end());
+	out.insert(out.end(), data.begin(), data.end());
+	out.insert(out.end(), codeAuxTable, codeAuxTable + 16);
+	return out;
+}
+
+static std::vector<uint8_t> EncodeMeshoptIndexSequence(const uint32_t* indices, size_t count)
+{
+	std::vector<uint8_t> out{ MESHOPT_SEQUENCE_HEADER | 1 };
+	uint32_t last[2] = {};
+	uint32_t baseline = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		// Switch to the other baseline once the delta doesn't fit into a byte anymore
+		const int32_t closest = static_cast<int32_t>(indices[i] - last[baseline]);
+		baseline ^= (closest < 0 ? -closest : closest) >= 30;
+		const uint32_t delta = indices[i] - last[baseline];
+		const uint32_t zigzag = (delta << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(delta) >> 31);
+		EncodeVByte(out, (zigzag << 1) | baseline);
+		last[baseline] = indices[i];
+	}
+	out.resize(out.size() + 4);
+	return out;
+}
+
+static int QuantizeSnorm(float value, int bits)
+{
+	const float scale = static_cast<float>((1 << (bits - 1)) - 1);
+	value = std::clamp(value, -1.f, 1.f);
+	return static_cast<int>(value * scale + (value >= 0.f ? 0.5f : -0.5f));
+}
+
+// Octahedral x and y, 1.0 quantized into z so the decoder knows the scale, w as is
+static void EncodeOctahedralFilter(XMFLOAT4 vector, int bits, int* encoded)
+{
+	const float length = fabsf(vector.x) + fabsf(vector.y) + fabsf(vector.z);
+	const float x = vector.x / length;
+	const float y = vector.y / length;
+	const float u = vector.z >= 0.f ? x : (1.f - fabsf(y)) * (x >= 0.f ? 1.f : -1.f);
+	const float v = vector.z >= 0.f ? y : (1.f - fabsf(x)) * (y >= 0.f ? 1.f : -1.f);
+	encoded[0] = QuantizeSnorm(u, bits);
+	encoded[1] = QuantizeSnorm(v, bits);
+	encoded[2] = QuantizeSnorm(1.f, bits);
+	encoded[3] = QuantizeSnorm(vector.w, bits);
+}
+
+// The three smallest components scaled by sqrt(2), the index of the largest one goes into the low bits of the fourth
+static void EncodeQuaternionFilter(XMFLOAT4 quaternion, int bits, int16_t* encoded)
+{
+	const float q[4] = { quaternion.x, quaternion.y, quaternion.z, quaternion.w };
+	int largest = 0;
+	for (int i = 1; i < 4; i++)
+	{
+		largest = fabsf(q[i]) > fabsf(q[largest]) ? i : largest;
+	}
+	const float sign = q[largest] < 0.f ? -1.f : 1.f;
+	for (int i = 0; i < 3; i++)
+	{
+		encoded[i] = static_cast<int16_t>(QuantizeSnorm(q[(largest + 1 + i) & 3] * sqrtf(2.f) * sign, bits));
+	}
+	encoded[3] = static_cast<int16_t>((QuantizeSnorm(1.f, bits) & ~3) | largest);
+}
+
+static uint32_t EncodeExponentialFilter(float value, int bits)
+{
+	int exponent = 0;
+	frexpf(value, &exponent);
+	exponent -= bits - 1;
+	const int32_t mantissa = static_cast<int32_t>(ldexpf(value, -exponent) + (value >= 0.f ? 0.5f : -0.5f));
+	return (static_cast<uint32_t>(exponent) << 24) | (static_cast<uint32_t>(mantissa) & 0xffffff);
+}
+
+// The triangle codec keeps the order and winding of triangles but can start each one at another corner
+static bool IsSameTriangleList(const std::vector<uint32_t>& actual, const std::vector<uint32_t>& expected)
+{
+	if (actual.size() != expected.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < expected.size(); i += 3)
+	{
+		const uint32_t* a = &actual[i];
+		const uint32_t* e = &expected[i];
+		if (!(a[0] == e[0] && a[1] == e[1] && a[2] == e[2]) && !(a[0] == e[1] && a[1] == e[2] && a[2] == e[0]) && !(a[0] == e[2] && a[1] == e[0] && a[2] == e[1]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+TEST(Mesh, MeshoptCodec)
+{
+	uint32_t random = 4711;
+	auto next = [&]() { random = random * 1664525u + 1013904223u; return random >> 8; };
+
+	// Slowly changing bytes end up in the 2 and 4 bit groups, noise in raw groups and sentinels
+	for (size_t byteStride : { 4, 8, 12, 16, 64, 256 })
+	{
+		for (size_t count : { 1, 15, 16, 17, 255, 1000 })
+		{
+			std::vector<uint8_t> data(count * byteStride);
+			for (size_t i = 0; i < data.size(); i++)
+			{
+				const size_t element = i / byteStride;
+				switch (i % 4)
+				{
+				case 0: data[i] = static_cast<uint8_t>(next()); break;
+				case 1: data[i] = static_cast<uint8_t>(element / 3); break;
+				case 2: data[i] = static_cast<uint8_t>(element * 7 + (next() & 3)); break;
+				default: data[i] = 0; break;
+				}
+			}
+
+			const std::vector<uint8_t> encoded = EncodeMeshoptAttributes(data.data(), count, byteStride);
+			std::vector<uint8_t> simd(data.size());
+			std::vector<uint8_t> scalar(data.size());
+			ASSERT_TRUE(DecodeMeshoptBuffer(simd.data(), count, byteStride, encoded.data(), encoded.size(), MeshoptMode::Attributes, MeshoptFilter::None)) << byteStride << " " << count;
+			ASSERT_TRUE(DecodeMeshoptBufferScalar(scalar.data(), count, byteStride, encoded.data(), encoded.size(), MeshoptMode::Attributes, MeshoptFilter::None));
+			ASSERT_EQ(simd, data) << byteStride << " " << count;
+			ASSERT_EQ(scalar, data);
+
+			// Cut off streams have to be rejected without reading past the end
+			ASSERT_FALSE(DecodeMeshoptBuffer(simd.data(), count, byteStride, encoded.data(), encoded.size() - 1, MeshoptMode::Attributes, MeshoptFilter::None));
+		}
+	}
+
+	// Shuffled triangles mostly need free indices, cache optimized ones mostly the FIFOs. The last triangle restarts at index 0
+	MemoryArena arena{ 1024 * 1024 * 16 };
+	MeshData shuffled = CreateShuffledGrid(40, arena);
+	MeshData optimized = CreateShuffledGrid(40, arena);
+	OptimizeMesh(optimized, arena);
+	for (const MeshData* mesh : { &shuffled, &optimized })
+	{
+		std::vector<uint32_t> indices(mesh->indices, mesh->indices + mesh->indexCount);
+		indices.insert(indices.end(), { 0, 1, 2 });
+
+		const std::vector<uint8_t> triangles = EncodeMeshoptTriangles(indices.data(), indices.size());
+		std::vector<uint32_t> decoded(indices.size());
+		ASSERT_TRUE(DecodeMeshoptBuffer(reinterpret_cast<uint8_t*>(decoded.data()), indices.size(), 4, triangles.data(), triangles.size(), MeshoptMode::Triangles, MeshoptFilter::None));
+		ASSERT_TRUE(IsSameTriangleList(decoded, indices));
+		std::vector<uint16_t> decoded16(indices.size());
+		ASSERT_TRUE(DecodeMeshoptBuffer(reinterpret_cast<uint8_t*>(decoded16.data()), indices.size(), 2, triangles.data(), triangles.size(), MeshoptMode::Triangles, MeshoptFilter::None));
+		ASSERT_TRUE(IsSameTriangleList({ decoded16.begin(), decoded16.end() }, indices));
+		ASSERT_FALSE(DecodeMeshoptBuffer(reinterpret_cast<uint8_t*>(decoded.data()), indices.size(), 4, triangles.data(), triangles.size() - 1, MeshoptMode::Triangles, MeshoptFilter::None));
+
+		const std::vector<uint8_t> sequence = EncodeMeshoptIndexSequence(indices.data(), indices.size());
+		ASSERT_TRUE(DecodeMeshoptBuffer(reinterpret_cast<uint8_t*>(decoded.data()), indices.size(), 4, sequence.data(), sequence.size(), MeshoptMode::Indices, MeshoptFilter::None));
+		ASSERT_EQ(decoded, indices);
+	}
+
+	// Filters, with the SIMD path bit identical to the scalar one
+	const size_t vectorCount = 203;
+	std::vector<XMFLOAT4> vectors(vectorCount);
+	for (size_t i = 0; i < vectorCount; i++)
+	{
+		const XMFLOAT3 direction = SphereDirection(i, vectorCount);
+		vectors[i] = { direction.x, direction.y, direction.z, i % 2 == 0 ? 1.f : -1.f };
+	}
+	for (int bits : { 8, 16 })
+	{
+		const size_t byteStride = bits / 2;
+		std::vector<uint8_t> filtered(vectorCount * byteStride);
+		for (size_t i = 0; i < vectorCount; i++)
+		{
+			int encoded[4];
+			EncodeOctahedralFilter(vectors[i], bits, encoded);
+			for (size_t c = 0; c < 4; c++)
+			{
+				if (bits == 8) reinterpret_cast<int8_t*>(filtered.data())[i * 4 + c] = static_cast<int8_t>(encoded[c]);
+				else reinterpret_cast<int16_t*>(filtered.data())[i * 4 + c] = static_cast<int16_t>(encoded[c]);
+			}
+		}
+
+		const std::vector<uint8_t> encoded = EncodeMeshoptAttributes(filtered.data(), vectorCount, byteStride);
+		std::vector<uint8_t> simd(filtered.size());
+		std::vector<uint8_t> scalar(filtered.size());
+		ASSERT_TRUE(DecodeMeshoptBuffer(simd.data(), vectorCount, byteStride, encoded.data(), encoded.size(), MeshoptMode::Attributes, MeshoptFilter::Octahedral));
+		ASSERT_TRUE(DecodeMeshoptBufferScalar(scalar.data(), vectorCount, byteStride, encoded.data(), encoded.size(), MeshoptMode::Attributes, MeshoptFilter::Octahedral));
+		ASSERT_EQ(simd, scalar);
+
+		const float max = static_cast<float>((1 << (bits - 1)) - 1);
+		for (size_t i = 0; i < vectorCount; i++)
+		{
+			float decoded[4];
+			for (size_t c = 0; c < 4; c++)
+			{
+				decoded[c] = (bits == 8 ? reinterpret_cast<int8_t*>(simd.data())[i * 4 + c] : reinterpret_cast<int16_t*>(simd.data())[i * 4 + c]) / max;
+			}
+			EXPECT_LT(AngleBetween({ decoded[0], decoded[1], decoded[2] }, { vectors[i].x, vectors[i].y, vectors[i].z }), bits == 8 ? 0.02f : 0.0002f) << i;
+			EXPECT_EQ(decoded[3], vectors[i].w);
+		}
+	}
+
+	std::vector<int16_t> quaternions(vectorCount * 4);
+	std::vector<XMFLOAT4> rotations(vectorCount);
+	for (size_t i = 0; i < vectorCount; i++)
+	{
+		const XMFLOAT3 axis = SphereDirection(i, vectorCount);
+		XMStoreFloat4(&rotations[i], XMQuaternionRotationAxis(XMLoadFloat3(&axis), i * 0.1f));
+		EncodeQuaternionFilter(rotations[i], 12, &quaternions[i * 4]);
+	}
+	const std::vector<uint8_t> encodedQuaternions = EncodeMeshoptAttributes(reinterpret_cast<const uint8_t*>(quaternions.data()), vectorCount, 8);
+	ASSERT_TRUE(DecodeMeshoptBuffer(reinterpret_cast<uint8_t*>(quaternions.data()), vectorCount, 8, encodedQuaternions.data(), encodedQuaternions.size(), MeshoptMode::Attributes, MeshoptFilter::Quaternion));
+	for (size_t i = 0; i < vectorCount; i++)
+	{
+		// Double cover, q and -q are the same rotation
+		const XMVECTOR decoded = XMVectorScale(XMVectorSet(quaternions[i * 4], quaternions[i * 4 + 1], quaternions[i * 4 + 2], quaternions[i * 4 + 3]), 1.f / 32767.f);
+		EXPECT_GT(fabsf(XMVectorGetX(XMVector4Dot(decoded, XMLoadFloat4(&rotations[i])))), 0.9999f) << i;
+	}
+
+	std::vector<float> values(vectorCount * 3);
+	std::vector<uint32_t> exponential(values.size());
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		values[i] = (static_cast<float>(next()) / (1 << 24) - 0.5f) * powf(10.f, static_cast<float>(i % 7) - 3.f);
+		exponential[i] = EncodeExponentialFilter(values[i], 15);
+	}
+	const std::vector<uint8_t> encodedValues = EncodeMeshoptAttributes(reinterpret_cast<const uint8_t*>(exponential.data()), vectorCount, 12);
+	std::vector<float> simdValues(values.size());
+	std::vector<float> scalarValues(values.size());
+	ASSERT_TRUE(DecodeMeshoptBuffer(reinterpret_cast<uint8_t*>(simdValues.data()), vectorCount, 12, encodedValues.data(), encodedValues.size(), MeshoptMode::Attributes, MeshoptFilter::Exponential));
+	ASSERT_TRUE(DecodeMeshoptBufferScalar(reinterpret_cast<uint8_t*>(scalarValues.data()), vectorCount, 12, encodedValues.data(), encodedValues.size(), MeshoptMode::Attributes, MeshoptFilter::Exponential));
+	ASSERT_EQ(memcmp(simdValues.data(), scalarValues.data(), sizeof(float) * values.size()), 0);
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		EXPECT_NEAR(simdValues[i], values[i], fabsf(values[i]) / (1 << 14)) << i;
+	}
+}
+
+// The codec test above only checks the decoder against the encoder in this file, these are fixed streams so a
+// misreading of the format both share can't pass. Index streams and filter values are the ones from meshoptimizer's own tests.
+TEST(Mesh, MeshoptKnownAnswers)
+{
+	const uint8_t trianglesV0[] = {
+		0xe0, 0xf0, 0x10, 0xfe, 0xff, 0xf0, 0x0c, 0xff, 0x02, 0x02, 0x02, 0x00, 0x76, 0x87, 0x56, 0x67,
+		0x78, 0xa9, 0x86, 0x65, 0x89, 0x68, 0x98, 0x01, 0x69, 0x00, 0x00,
+	};
+	const uint32_t expectedTrianglesV0[] = { 0, 1, 2, 2, 1, 3, 4, 6, 5, 7, 8, 9 };
+	uint32_t trianglesV0Decoded[_countof(expectedTrianglesV0)]{};
+	ASSERT_TRUE(DecodeMeshoptBuffer(reinterpret_cast<uint8_t*>(trianglesV0Decoded), _countof(expectedTrianglesV0), 4, trianglesV0, sizeof(trianglesV0), MeshoptMode::Triangles, MeshoptFilter::None));
+	EXPECT_EQ(memcmp(trianglesV0Decoded, expectedTrianglesV0, sizeof(expectedTrianglesV0)), 0);
+
+	// Version 1 with a restart at index 0 and a free index one after the last one
+	const uint8_t trianglesV1[] = {
+		0xe1, 0xf0, 0x10, 0xfe, 0x1f, 0x3d, 0x00, 0x0a, 0x00, 0x76, 0x87, 0x56, 0x67, 0x78, 0xa9, 0x86,
+		0x65, 0x89, 0x68, 0x98, 0x01, 0x69, 0x00, 0x00,
+	};
+	const uint16_t expectedTrianglesV1[] = { 0, 1, 2, 2, 1, 3, 0, 1, 2, 2, 1, 5, 2, 1, 4 };
+	uint16_t trianglesV1Decoded[_countof(expectedTrianglesV1)]{};
+	ASSERT_TRUE(DecodeMeshoptBuffer(reinterpret_cast<uint8_t*>(trianglesV1Decoded), _countof(expectedTrianglesV1), 2, trianglesV1, sizeof(trianglesV1), MeshoptMode::Triangles, MeshoptFilter::None));
+	EXPECT_EQ(memcmp(trianglesV1Decoded, expectedTrianglesV1, sizeof(expectedTrianglesV1)), 0);
+
+	const uint8_t sequence[] = { 0xd1, 0x00, 0x04, 0xcd, 0x01, 0x04, 0x07, 0x98, 0x1f, 0x00, 0x00, 0x00, 0x00 };
+	const uint32_t expectedSequence[] = { 0, 1, 51, 2, 49, 1000 };
+	uint32_t sequenceDecoded[_countof(expectedSequence)]{};
+	ASSERT_TRUE(DecodeMeshoptBuffer(reinterpret_cast<uint8_t*>(sequenceDecoded), _countof(expectedSequence), 4, sequence, sizeof(sequence), MeshoptMode::Indices, MeshoptFilter::None));
+	EXPECT_EQ(memcmp(sequenceDecoded, expectedSequence, sizeof(expectedSequence)), 0);
+
+	// Four 12 byte vertices of 16 bit position and texcoord with zero normal bytes, written out by hand from the spec.
+	// One byte group per column: 2 bit zigzag deltas with 3 as the sentinel for a following raw byte, or nothing for all zero
+	const uint8_t attributes[] = {
+		0xa0,
+		0x01, 0x3f, 0x00, 0x00, 0x00, 0x58, 0x57, 0x58, // x low: +44, -44, +44
+		0x01, 0x26, 0x00, 0x00, 0x00, // x high: +1, -1, +1
+		0x01, 0x0c, 0x00, 0x00, 0x00, 0x58, // y low: 0, +44, 0
+		0x01, 0x08, 0x00, 0x00, 0x00, // y high: 0, +1, 0
+		0x00, 0x00, 0x00, 0x00, // z and the normal
+		0x01, 0x3f, 0x00, 0x00, 0x00, 0x17, 0x18, 0x17, // u low: -12, +12, -12
+		0x01, 0x26, 0x00, 0x00, 0x00, // u high: +1, -1, +1
+		0x01, 0x0c, 0x00, 0x00, 0x00, 0x17, // v low: 0, -12, 0
+		0x01, 0x08, 0x00, 0x00, 0x00, // v high: 0, +1, 0
+		// Tail, the first vertex padded to 32 bytes
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	};
+	const uint16_t expectedAttributes[] = {
+		0, 0, 0, 0, 0, 0,
+		300, 0, 0, 0, 500, 0,
+		0, 300, 0, 0, 0, 500,
+		300, 300, 0, 0, 500, 500,
+	};
+	uint16_t simdAttributes[_countof(expectedAttributes)]{};
+	uint16_t scalarAttributes[_countof(expectedAttributes)]{};
+	ASSERT_TRUE(DecodeMeshoptBuffer(reinterpret_cast<uint8_t*>(simdAttributes), 4, 12, attributes, sizeof(attributes), MeshoptMode::Attributes, MeshoptFilter::None));
+	ASSERT_TRUE(DecodeMeshoptBufferScalar(reinterpret_cast<uint8_t*>(scalarAttributes), 4, 12, attributes, sizeof(attributes), MeshoptMode::Attributes, MeshoptFilter::None));
+	EXPECT_EQ(memcmp(simdAttributes, expectedAttributes, sizeof(expectedAttributes)), 0);
+	EXPECT_EQ(memcmp(scalarAttributes, expectedAttributes, sizeof(expectedAttributes)), 0);
+
+	// Filters only run after attribute decoding, which the stream above checks on its own
+	auto checkFilter = [](const void* data, const void* expected, size_t byteStride, MeshoptFilter filter)
+	{
+		const std::vector<uint8_t> encoded = EncodeMeshoptAttributes(static_cast<const uint8_t*>(data), 4, byteStride);
+		std::vector<uint8_t> simd(4 * byteStride);
+		std::vector<uint8_t> scalar(4 * byteStride);
+		ASSERT_TRUE(DecodeMeshoptBuffer(simd.data(), 4, byteStride, encoded.data(), encoded.size(), MeshoptMode::Attributes, filter));
+		ASSERT_TRUE(DecodeMeshoptBufferScalar(scalar.data(), 4, byteStride, encoded.data(), encoded.size(), MeshoptMode::Attributes, filter));
+		EXPECT_EQ(memcmp(simd.data(), expected, simd.size()), 0) << static_cast<int>(filter) << " " << byteStride;
+		EXPECT_EQ(memcmp(scalar.data(), expected, scalar.size()), 0) << static_cast<int>(filter) << " " << byteStride;
+	};
+
+	const uint8_t octahedral8[] = { 0, 1, 127, 0, 0, 187, 127, 1, 255, 1, 127, 0, 14, 130, 127, 1 };
+	const uint8_t expectedOctahedral8[] = { 0, 1, 127, 0, 0, 159, 82, 1, 255, 1, 127, 0, 1, 130, 241, 1 };
+	checkFilter(octahedral8, expectedOctahedral8, 4, MeshoptFilter::Octahedral);
+
+	const uint16_t octahedral12[] = { 0, 1, 2047, 0, 0, 1870, 2047, 1, 2017, 1, 2047, 0, 14, 1300, 2047, 1 };
+	const uint16_t expectedOctahedral12[] = { 0, 16, 32767, 0, 0, 32621, 3088, 1, 32764, 16, 471, 0, 307, 28541, 16093, 1 };
+	checkFilter(octahedral12, expectedOctahedral12, 8, MeshoptFilter::Octahedral);
+
+	const uint16_t quaternion12[] = { 0, 1, 0, 0x7fc, 0, 1870, 0, 0x7fd, 2017, 1, 0, 0x7fe, 14, 1300, 0, 0x7ff };
+	const uint16_t expectedQuaternion12[] = { 32767, 0, 11, 0, 0, 25013, 0, 21166, 11, 0, 23504, 22830, 158, 14715, 0, 29277 };
+	checkFilter(quaternion12, expectedQuaternion12, 8, MeshoptFilter::Quaternion);
+
+	const uint32_t exponential[] = { 0, 0xff000003, 0x02fffff7, 0xfe7fffff };
+	const uint32_t expectedExponential[] = { 0, 0x3fc00000, 0xc2100000, 0x49fffffe };
+	checkFilter(exponential, expectedExponential, 4, MeshoptFilter::Exponential);
+}
+
+TEST(Mesh, QuantizedMeshoptRoundTrip)
+{
+	const char* path = "models/kaiju.glb";
+	if (!std::filesystem::exists(path))
+	{
+		GTEST_SKIP() << "Models not found, run this from the build directory";
+	}
+
+	MemoryArena arena{ 1024 * 1024 * 256 };
+	WorkerPool pool{ 3 };
+	GltfResult* reference = LoadGltfFromFile(path, arena, pool, false);
+	ASSERT_TRUE(reference->success);
+	const MeshData& expected = reference->meshes[0].mesh;
+	const size_t vertexCount = expected.vertexCount;
+	const bool wideIndices = vertexCount > UINT16_MAX;
+
+	// Positions as unsigned shorts over the bounding box, the node transform maps them back
+	XMFLOAT3 min = expected.vertices[0].position;
+	XMFLOAT3 max = min;
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const XMFLOAT3& p = expected.vertices[i].position;
+		min = { std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z) };
+		max = { std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z) };
+	}
+	const float step = std::max({ max.x - min.x, max.y - min.y, max.z - min.z }) / UINT16_MAX;
+
+	std::vector<uint16_t> positions(vertexCount * 4);
+	std::vector<int8_t> normals(vertexCount * 4);
+	std::vector<int16_t> tangents(vertexCount * 4);
+	std::vector<uint32_t> uvs(vertexCount * 2);
+	std::vector<uint16_t> joints(vertexCount * 4);
+	std::vector<uint8_t> weights(vertexCount * 4);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const Vertex& vertex = expected.vertices[i];
+		positions[i * 4 + 0] = static_cast<uint16_t>((vertex.position.x - min.x) / step + 0.5f);
+		positions[i * 4 + 1] = static_cast<uint16_t>((vertex.position.y - min.y) / step + 0.5f);
+		positions[i * 4 + 2] = static_cast<uint16_t>((vertex.position.z - min.z) / step + 0.5f);
+
+		int encoded[4];
+		EncodeOctahedralFilter({ vertex.normal.x, vertex.normal.y, vertex.normal.z, 0.f }, 8, encoded);
+		for (size_t c = 0; c < 4; c++) normals[i * 4 + c] = static_cast<int8_t>(encoded[c]);
+
+		// The sign of the bitangent goes into w like glTF wants it
+		const XMVECTOR normal = XMLoadFloat3(&vertex.normal);
+		const XMVECTOR tangent = XMLoadFloat3(&vertex.tangent);
+		const float handedness = XMVectorGetX(XMVector3Dot(XMVector3Cross(normal, tangent), XMLoadFloat3(&vertex.bitangent))) < 0.f ? -1.f : 1.f;
+		EncodeOctahedralFilter({ vertex.tangent.x, vertex.tangent.y, vertex.tangent.z, handedness }, 16, encoded);
+		for (size_t c = 0; c < 4; c++) tangents[i * 4 + c] = static_cast<int16_t>(encoded[c]);
+
+		uvs[i * 2 + 0] = EncodeExponentialFilter(vertex.uv.x, 15);
+		uvs[i * 2 + 1] = EncodeExponentialFilter(vertex.uv.y, 15);
+
+		const float weightArray[4] = { vertex.boneWeights.x, vertex.boneWeights.y, vertex.boneWeights.z, vertex.boneWeights.w };
+		const uint32_t jointArray[4] = { vertex.boneIndices.x, vertex.boneIndices.y, vertex.boneIndices.z, vertex.boneIndices.w };
+		int sum = 0;
+		for (size_t c = 0; c < 4; c++)
+		{
+			joints[i * 4 + c] = static_cast<uint16_t>(jointArray[c]);
+			weights[i * 4 + c] = static_cast<uint8_t>(weightArray[c] * 255.f + 0.5f);
+			sum += weights[i * 4 + c];
+		}
+		uint8_t& largest = *std::max_element(&weights[i * 4], &weights[i * 4 + 4]);
+		largest = static_cast<uint8_t>(largest + 255 - sum);
+	}
+	std::vector<uint32_t> indices(expected.indices, expected.indices + expected.indexCount);
+
+	// Compressed views live in the fallback buffer, their data in the BIN chunk
+	std::vector<uint8_t> bin;
+	std::string views;
+	size_t fallbackSize = 0;
+	auto addView = [&](const void* data, size_t count, size_t byteStride, const std::vector<uint8_t>& compressed, const char* mode, const char* filter)
+	{
+		const size_t offset = bin.size();
+		if (compressed.empty())
+		{
+			bin.insert(bin.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + count * byteStride);
+			views += std::format(R"({{ "buffer": 0, "byteOffset": {}, "byteLength": {}, "byteStride": {} }},)", offset, count * byteStride, byteStride);
+		}
+		else
+		{
+			bin.insert(bin.end(), compressed.begin(), compressed.end());
+			views += std::format(R"({{ "buffer": 1, "byteOffset": {}, "byteLength": {}, {} "extensions": {{ "EXT_meshopt_compression": {{ "buffer": 0, "byteOffset": {}, "byteLength": {}, "byteStride": {}, "count": {}, "mode": "{}", "filter": "{}" }} }} }},)",
+				fallbackSize, count * byteStride, strcmp(mode, "ATTRIBUTES") == 0 ? std::format(R"("byteStride": {},)", byteStride) : "", offset, compressed.size(), byteStride, count, mode, filter);
+			fallbackSize += count * byteStride;
+		}
+		bin.resize(Align(bin.size(), 4));
+	};
+	auto attributes = [&](const void* data, size_t byteStride) { return EncodeMeshoptAttributes(static_cast<const uint8_t*>(data), vertexCount, byteStride); };
+
+	addView(positions.data(), vertexCount, 8, attributes(positions.data(), 8), "ATTRIBUTES", "NONE");
+	addView(normals.data(), vertexCount, 4, attributes(normals.data(), 4), "ATTRIBUTES", "OCTAHEDRAL");
+	addView(tangents.data(), vertexCount, 8, attributes(tangents.data(), 8), "ATTRIBUTES", "OCTAHEDRAL");
+	addView(uvs.data(), vertexCount, 8, attributes(uvs.data(), 8), "ATTRIBUTES", "EXPONENTIAL");
+	addView(joints.data(), vertexCount, 8, attributes(joints.data(), 8), "ATTRIBUTES", "NONE");
+	addView(weights.data(), vertexCount, 4, {}, nullptr, nullptr);
+	addView(nullptr, indices.size(), wideIndices ? 4 : 2, EncodeMeshoptTriangles(indices.data(), indices.size()), "TRIANGLES", "NONE");
+	const XMFLOAT4X4 identity{ 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+	addView(&identity, 1, 64, {}, nullptr, nullptr);
+	views.pop_back();
+
+	const std::string json = std::format(R"json({{
+		"asset": {{ "version": "2.0" }},
+		"extensionsUsed": ["KHR_mesh_quantization", "EXT_meshopt_compression"],
+		"extensionsRequired": ["KHR_mesh_quantization", "EXT_meshopt_compression"],
+		"buffers": [{{ "byteLength": {} }}, {{ "byteLength": {}, "extensions": {{ "EXT_meshopt_compression": {{ "fallback": true }} }} }}],
+		"bufferViews": [{}],
+		"accessors": [
+			{{ "bufferView": 0, "componentType": 5123, "count": {}, "type": "VEC3" }},
+			{{ "bufferView": 1, "componentType": 5120, "normalized": true, "count": {}, "type": "VEC3" }},
+			{{ "bufferView": 2, "componentType": 5122, "normalized": true, "count": {}, "type": "VEC4" }},
+			{{ "bufferView": 3, "componentType": 5126, "count": {}, "type": "VEC2" }},
+			{{ "bufferView": 4, "componentType": 5123, "count": {}, "type": "VEC4" }},
+			{{ "bufferView": 5, "componentType": 5121, "normalized": true, "count": {}, "type": "VEC4" }},
+			{{ "bufferView": 6, "componentType": {}, "count": {}, "type": "SCALAR" }},
+			{{ "bufferView": 7, "componentType": 5126, "count": 1, "type": "MAT4" }}
+		],
+		"meshes": [{{ "primitives": [{{ "attributes": {{ "POSITION": 0, "NORMAL": 1, "TANGENT": 2, "TEXCOORD_0": 3, "JOINTS_0": 4, "WEIGHTS_0": 5 }}, "indices": 6 }}] }}],
+		"nodes": [{{ "mesh": 0, "translation": [{}, {}, {}], "scale": [{}, {}, {}] }}, {{ "name": "root" }}],
+		"skins": [{{ "joints": [1], "inverseBindMatrices": 7 }}]
+	}})json", bin.size(), fallbackSize, views, vertexCount, vertexCount, vertexCount, vertexCount, vertexCount, vertexCount, wideIndices ? 5125 : 5123, indices.size(),
+		min.x, min.y, min.z, step, step, step);
+
+	GltfResult* quantized = LoadGltfFromFile(WriteTestGlb("QuantizedMeshopt.glb", json, bin).c_str(), arena, pool, false);
+	ASSERT_TRUE(quantized->success);
+	ASSERT_EQ(quantized->meshes.size, 1);
+	const MeshData& actual = quantized->meshes[0].mesh;
+	ASSERT_EQ(actual.vertexCount, vertexCount);
+	ASSERT_TRUE(IsSameTriangleList({ actual.indices, actual.indices + actual.indexCount }, indices));
+
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const Vertex& e = expected.vertices[i];
+		const Vertex& a = actual.vertices[i];
+		const float positionTolerance = step * 0.5f + 1e-4f * std::max({ fabsf(min.x), fabsf(min.y), fabsf(min.z), fabsf(max.x), fabsf(max.y), fabsf(max.z) });
+		EXPECT_NEAR(a.position.x, e.position.x, positionTolerance) << i;
+		EXPECT_NEAR(a.position.y, e.position.y, positionTolerance) << i;
+		EXPECT_NEAR(a.position.z, e.position.z, positionTolerance) << i;
+		EXPECT_LT(AngleBetween(a.normal, e.normal), 0.03f) << i;
+		EXPECT_LT(AngleBetween(a.tangent, e.tangent), 0.001f) << i;
+		EXPECT_GT(XMVectorGetX(XMVector3Dot(XMLoadFloat3(&a.bitangent), XMLoadFloat3(&e.bitangent))), 0.f) << i;
+		EXPECT_NEAR(a.uv.x, e.uv.x, fabsf(e.uv.x) / (1 << 14)) << i;
+		EXPECT_NEAR(a.uv.y, e.uv.y, fabsf(e.uv.y) / (1 << 14)) << i;
+		EXPECT_EQ(memcmp(&a.boneIndices, &e.boneIndices, sizeof(XMUINT4)), 0) << i;
+		EXPECT_NEAR(a.boneWeights.x, e.boneWeights.x, 2.5f / 255.f) << i;
+		EXPECT_NEAR(a.boneWeights.y, e.boneWeights.y, 2.5f / 255.f) << i;
+		EXPECT_NEAR(a.boneWeights.z, e.boneWeights.z, 2.5f / 255.f) << i;
+		EXPECT_NEAR(a.boneWeights.w, e.boneWeights.w, 2.5f / 255.f) << i;
+	}
+}
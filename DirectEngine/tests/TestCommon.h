@@ -2,6 +2,7 @@
 
 #include "gtest/gtest.h"
 #include <assert.h>
+#include <functional>
 
 #include <DirectXMath.h>
 using namespace DirectX;
@@ -10,4 +11,14 @@ using namespace DirectX;
 
 void AssertVectorEqual(XMVECTOR a, XMVECTOR b, const char* errorPrefix = "");
 
-void AssertMatrixEqual(XMMATRIX a, XMMATRIX b);
\ No newline at end of file
+void AssertMatrixEqual(XMMATRIX a, XMMATRIX b);
+
+/// <summary>
+/// Runs the function once and returns the wall clock time it took in seconds.
+/// </summary>
+double MeasureSeconds(const std::function<void()>& func);
+
+/// <summary>
+/// Number of global operator new calls so far, the test executable replaces operator new to count them.
+/// </summary>
+size_t GetHeapAllocationCount();
\ No newline at end of file
@@ -1,5 +1,35 @@
 #include "TestCommon.h"
 
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<size_t> heapAllocationCount = 0;
+
+void* operator new(size_t byteCount)
+{
+	heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+	void* pointer = malloc(byteCount == 0 ? 1 : byteCount);
+	if (pointer == nullptr) throw std::bad_alloc{};
+	return pointer;
+}
+
+void operator delete(void* pointer) noexcept
+{
+	free(pointer);
+}
+
+void operator delete(void* pointer, size_t byteCount) noexcept
+{
+	free(pointer);
+}
+
+size_t GetHeapAllocationCount()
+{
+	return heapAllocationCount.load(std::memory_order_relaxed);
+}
+
 int main(int argc, char** argv)
 {
 	::testing::InitGoogleTest(&argc, argv);
@@ -20,4 +50,12 @@ void AssertMatrixEqual(XMMATRIX a, XMMATRIX b)
 	AssertVectorEqual(a.r[1], b.r[1], "Matrix row 1: ");
 	AssertVectorEqual(a.r[2], b.r[2], "Matrix row 2: ");
 	AssertVectorEqual(a.r[3], b.r[3], "Matrix row 3: ");
+}
+
+double MeasureSeconds(const std::function<void()>& func)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+	func();
+	const auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double>(end - start).count();
 }
\ No newline at end of file
@@ -0,0 +1,41 @@
+#include "../DirectEngine/core/CookedMesh.h"
+
+#include <filesystem>
+#include <iostream>
+
+int main(int argc, char** argv)
+{
+	if (argc != 2)
+	{
+		std::cerr << "Usage: MeshCook.exe <models dir>" << std::endl;
+		return 1;
+	}
+
+	int result = 0;
+	MemoryArena arena{};
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(argv[1]))
+	{
+		if (!entry.is_regular_file() || entry.path().extension() != ".glb")
+		{
+			continue;
+		}
+
+		const std::string gltfPath = entry.path().string();
+		const std::pmr::string cookedPath = GetCookedMeshPath(gltfPath);
+		if (IsCookedMeshCurrent(gltfPath.c_str(), cookedPath.c_str()))
+		{
+			continue;
+		}
+
+		arena.Reset();
+		GltfResult* model = LoadGltfFromFile(gltfPath.c_str(), arena);
+		if (!model->success || !WriteCookedMesh(*model, cookedPath.c_str()))
+		{
+			std::cerr << "Failed to cook " << gltfPath << std::endl;
+			result = 1;
+			continue;
+		}
+		std::cout << "Cooked " << cookedPath << std::endl;
+	}
+	return result;
+}